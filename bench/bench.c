@@ -0,0 +1,743 @@
+/**
+  ******************************************************************************
+  * @file    bench.c
+  * @brief   Benchmark image: times the hot paths of the application and
+  *          prints a JSON report through semihosting, then exits.
+  *
+  *          Built by scons as bench.elf, linked at 0x08000000 on its own
+  *          and run by tools/bench_run.py under qemu-system-arm -M netduino2
+  *          (STM32F205, Cortex-M3). Time is counted by SysTick on the
+  *          processor clock, with the wraps counted in SysTick_Handler.
+  *          With -icount QEMU gives the same counts at every run.
+  *
+  *          QEMU does not model the FLASH interface nor the CRC unit: there
+  *          the flash_ and crc_block kernels time the driver code only, on
+  *          the board they include the peripherals. Writes to the flash are
+  *          lost under QEMU, so FLASH_If_Write() stops at the check of the
+  *          first word and FLASH_If_WriteBlock() compares two CRCs of 0. Neither does
+  *          it model the DMA: there the dma_copy_ kernels time the setup of
+  *          the stream, on the board the copy to the end, so they do not
+  *          give the size where the stream wins. Nor the HASH: the hmac_
+  *          kernels count the writes of the key and message words and the
+  *          driver code, not the hashing, and the hkey_ kernels wait out
+  *          the timeout of a digest that never completes. Neither compares
+  *          the two HMACs. These kernels are reported with "board": 1: their
+  *          counts are instructions of the driver code, the same at every
+  *          run, and tools/bench_run.py gates them as the others.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "stm32f2xx.h"
+#include "ikv_crypto.h"
+#include "dma_mem.h"
+#include "hash_engine.h"
+#include "hmac_key.h"
+#include "flash_if.h"
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  const char* Name;
+  uint32_t Bytes;            /* data handled by one run, 0 if not a stream */
+  void (*Setup)(void);       /* not timed, may be 0 */
+  void (*Run)(void);
+  uint32_t Board;            /* 1: uses a peripheral QEMU does not model */
+} BENCH_Kernel;
+
+/* Private define ------------------------------------------------------------*/
+/* Semihosting operations and exit reasons */
+#define SYS_WRITE0            0x04
+#define SYS_EXIT              0x18
+#define ADP_EXIT_OK           0x20026   /* ADP_Stopped_ApplicationExit */
+#define ADP_EXIT_ERROR        0x20023   /* ADP_Stopped_RunTimeErrorUnknown */
+
+#define BENCH_BYTES           4096
+#define BENCH_WORDS           (BENCH_BYTES / 4)
+/* Last sector, 128 KB: the flash_ kernels erase it */
+#define BENCH_FLASH_ADDRESS   0x080E0000
+#define BENCH_FLASH_SECTOR    FLASH_Sector_11
+
+#define BENCH_MUL_COUNT       100
+#define BENCH_SHA_BLOCKS      16
+/* USART1 set up again BENCH_CLOCK_COUNT times per run */
+#define BENCH_CLOCK_COUNT     100
+#define BENCH_CLOCK_BAUD      115200
+/* Block sizes of the copy crossover, processor against DMA */
+#define BENCH_COPY_SMALL      64
+#define BENCH_COPY_MEDIUM     256
+#define BENCH_COPY_LARGE      1024
+/* HMAC-SHA1 of BENCH_HMAC_COUNT messages per run, with a key of
+   BENCH_HMAC_KEY bytes */
+#define BENCH_HMAC_COUNT      16
+#define BENCH_HMAC_KEY        20
+#define BENCH_HMAC_SMALL      16
+#define BENCH_HMAC_MEDIUM     64
+#define BENCH_HMAC_LARGE      256
+#define CURVE_DEGREE          163
+
+/* Private variables ---------------------------------------------------------*/
+static uint32_t Source[BENCH_WORDS + 1];
+static uint32_t Destination[BENCH_WORDS + 1];
+static volatile uint32_t SysTickWraps = 0;
+static volatile uint32_t Sink = 0;
+static HKEY_Context HmacKey;
+static uint8_t Mac[HENG_SHA1_SIZE];
+
+/* sect163r2 (NIST B-163), as in boot_driver/image_verify.c */
+static dwordvec_t CurveA = {0x00000001};
+static dwordvec_t CurveSqrtB = {0x69F34DA5, 0xDA89C039, 0x3D21C366, 0xDF892759, 0xC25B85BA, 0x00000002};
+static dwordvec_t CurveGx = {0xE8343E36, 0xD4994637, 0xA0991168, 0x86A2D57E, 0xF0EBA162, 0x00000003};
+static dwordvec_t CurveGy = {0x797324F1, 0xB11C5C0C, 0xA2CDD545, 0x71A0094F, 0xD51FBC6C, 0x00000000};
+static dwordvec_t CurveOrder = {0xA4234C33, 0x77E70C12, 0x000292FE, 0x00000000, 0x00000000, 0x00000004};
+
+static curve_parameter_t Curve = {CURVE_DEGREE, CurveA, CurveSqrtB, CurveGx, CurveGy, CurveOrder};
+static ikv_crypto_ecc_context* Ecc = 0;
+
+/* Private function prototypes -----------------------------------------------*/
+static void Kernel_FlashErase(void);
+static void Kernel_FlashWrite(void);
+static void Kernel_FlashIfWrite(void);
+static void Kernel_FlashIfWriteBlock(void);
+static void Kernel_CrcBlock(void);
+static void Kernel_MemcpyByte(void);
+static void Kernel_MemcpyWord(void);
+static void Kernel_Memcpy(void);
+static void Kernel_MemcpyUnaligned(void);
+static void Kernel_Gf2nMul(void);
+static void Kernel_Sha256Block(void);
+static void Kernel_EccMul(void);
+static void Kernel_ClocksDecode(void);
+static void Kernel_ClocksUpdate(void);
+static void Kernel_ClocksCached(void);
+static void Bench_UsartInit(uint32_t Index);
+static void Kernel_MemcpySmall(void);
+static void Kernel_MemcpyMedium(void);
+static void Kernel_MemcpyLarge(void);
+static void Kernel_DmaCopySmall(void);
+static void Kernel_DmaCopyMedium(void);
+static void Kernel_DmaCopyLarge(void);
+static void Kernel_DmaCopy(void);
+static void Bench_DmaCopy(uint32_t Bytes);
+static void Kernel_HmacSmall(void);
+static void Kernel_HmacMedium(void);
+static void Kernel_HmacLarge(void);
+static void Kernel_HkeyInit(void);
+static void Kernel_HkeySmall(void);
+static void Kernel_HkeyMedium(void);
+static void Kernel_HkeyLarge(void);
+static void Bench_Hmac(uint32_t Bytes);
+static void Bench_Hkey(uint32_t Bytes);
+static uint64_t Bench_Now(void);
+static uint32_t Semihost(uint32_t Operation, uint32_t Argument);
+static void Bench_Print(const char* Text);
+static void Bench_PrintNumber(uint64_t Value);
+
+static const BENCH_Kernel Kernels[] =
+{
+  {"flash_write",         BENCH_BYTES,                          Kernel_FlashErase,   Kernel_FlashWrite,        1},
+  {"flash_if_write",      BENCH_BYTES,                          Kernel_FlashErase,   Kernel_FlashIfWrite,      1},
+  {"flash_if_writeblock", BENCH_BYTES,                          Kernel_FlashErase,   Kernel_FlashIfWriteBlock, 1},
+  {"crc_block",           BENCH_BYTES,                          0,                   Kernel_CrcBlock,          1},
+  {"memcpy_byte",         BENCH_BYTES,                          0,                   Kernel_MemcpyByte,        0},
+  {"memcpy_word",         BENCH_BYTES,                          0,                   Kernel_MemcpyWord,        0},
+  {"memcpy",              BENCH_BYTES,                          0,                   Kernel_Memcpy,            0},
+  {"memcpy_unaligned",    BENCH_BYTES,                          0,                   Kernel_MemcpyUnaligned,   0},
+  {"gf2n_163_mul",        0,                                    0,                   Kernel_Gf2nMul,           0},
+  {"sha256_block",        BENCH_SHA_BLOCKS * 64,                0,                   Kernel_Sha256Block,       0},
+  {"ecc_mul_projective",  0,                                    0,                   Kernel_EccMul,            0},
+  {"clocks_decode",       0,                                    0,                   Kernel_ClocksDecode,      0},
+  {"clocks_cached",       0,                                    Kernel_ClocksUpdate, Kernel_ClocksCached,      0},
+  {"memcpy_64",           BENCH_COPY_SMALL,                     0,                   Kernel_MemcpySmall,       0},
+  {"memcpy_256",          BENCH_COPY_MEDIUM,                    0,                   Kernel_MemcpyMedium,      0},
+  {"memcpy_1024",         BENCH_COPY_LARGE,                     0,                   Kernel_MemcpyLarge,       0},
+  {"dma_copy_64",         BENCH_COPY_SMALL,                     0,                   Kernel_DmaCopySmall,      1},
+  {"dma_copy_256",        BENCH_COPY_MEDIUM,                    0,                   Kernel_DmaCopyMedium,     1},
+  {"dma_copy_1024",       BENCH_COPY_LARGE,                     0,                   Kernel_DmaCopyLarge,      1},
+  {"dma_copy_4096",       BENCH_BYTES,                          0,                   Kernel_DmaCopy,           1},
+  {"hmac_sha1_16",        BENCH_HMAC_COUNT * BENCH_HMAC_SMALL,  0,                   Kernel_HmacSmall,         1},
+  {"hmac_sha1_64",        BENCH_HMAC_COUNT * BENCH_HMAC_MEDIUM, 0,                   Kernel_HmacMedium,        1},
+  {"hmac_sha1_256",       BENCH_HMAC_COUNT * BENCH_HMAC_LARGE,  0,                   Kernel_HmacLarge,         1},
+  {"hkey_sha1_16",        BENCH_HMAC_COUNT * BENCH_HMAC_SMALL,  Kernel_HkeyInit,     Kernel_HkeySmall,         1},
+  {"hkey_sha1_64",        BENCH_HMAC_COUNT * BENCH_HMAC_MEDIUM, Kernel_HkeyInit,     Kernel_HkeyMedium,        1},
+  {"hkey_sha1_256",       BENCH_HMAC_COUNT * BENCH_HMAC_LARGE,  Kernel_HkeyInit,     Kernel_HkeyLarge,         1},
+};
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Called by Reset_Handler in place of the one of
+  *         src/system_stm32f2xx.c. The benchmark runs on the reset clock,
+  *         the counts are in cycles of whatever clock the core runs on.
+  * @param  None
+  * @retval None
+  */
+void SystemInit(void)
+{
+}
+
+/**
+  * @brief  Main program: runs every kernel once and prints
+  *         {"kernels": [{"name": ..., "bytes": ..., "cycles": ...,
+  *         "board": ...}, ...]}
+  * @param  None
+  * @retval None
+  */
+int main(void)
+{
+  uint64_t start = 0, cycles = 0;
+  uint32_t i = 0;
+
+  RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_CRC, ENABLE);
+  RCC_AHB2PeriphClockCmd(RCC_AHB2Periph_HASH, ENABLE);
+  RCC_APB2PeriphClockCmd(RCC_APB2Periph_USART1, ENABLE);
+  for (i = 0; i < BENCH_WORDS + 1; i++)
+  {
+    Source[i] = i * 0x9E3779B9;
+  }
+  Ecc = ecc_init(&Curve);
+  /* Every size to the stream, the dma_copy_ kernels find the threshold */
+  if (DMEM_Init() != 0)
+  {
+    Semihost(SYS_EXIT, ADP_EXIT_ERROR);
+  }
+  DMEM_SetThreshold(0);
+
+  if (SysTick_Config(SysTick_LOAD_RELOAD_Msk) != 0)
+  {
+    Semihost(SYS_EXIT, ADP_EXIT_ERROR);
+  }
+
+  Bench_Print("{\"kernels\": [");
+  for (i = 0; i < sizeof(Kernels) / sizeof(Kernels[0]); i++)
+  {
+    if (Kernels[i].Setup != 0)
+    {
+      Kernels[i].Setup();
+    }
+    start = Bench_Now();
+    Kernels[i].Run();
+    cycles = Bench_Now() - start;
+
+    Bench_Print((i == 0) ? "\n  {\"name\": \"" : ",\n  {\"name\": \"");
+    Bench_Print(Kernels[i].Name);
+    Bench_Print("\", \"bytes\": ");
+    Bench_PrintNumber(Kernels[i].Bytes);
+    Bench_Print(", \"cycles\": ");
+    Bench_PrintNumber(cycles);
+    Bench_Print(", \"board\": ");
+    Bench_PrintNumber(Kernels[i].Board);
+    Bench_Print("}");
+  }
+  Bench_Print("\n]}\n");
+
+  Semihost(SYS_EXIT, ADP_EXIT_OK);
+  while (1)
+  {
+  }
+}
+
+/**
+  * @brief  Counts the wraps of the 24-bit SysTick counter
+  * @param  None
+  * @retval None
+  */
+void SysTick_Handler(void)
+{
+  SysTickWraps++;
+}
+
+/**
+  * @brief  Erases the sector of the flash_ kernels
+  * @param  None
+  * @retval None
+  */
+static void Kernel_FlashErase(void)
+{
+  FLASH_Unlock();
+  FLASH_ClearFlag(FLASH_FLAG_EOP | FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR |
+                  FLASH_FLAG_PGAERR | FLASH_FLAG_PGPERR | FLASH_FLAG_PGSERR);
+  FLASH_EraseSector(BENCH_FLASH_SECTOR, VoltageRange_3);
+}
+
+/**
+  * @brief  Programs BENCH_BYTES word by word in the erased last sector,
+  *         FLASH_ProgramWord() alone
+  * @param  None
+  * @retval None
+  */
+static void Kernel_FlashWrite(void)
+{
+  uint32_t i = 0;
+
+  for (i = 0; i < BENCH_WORDS; i++)
+  {
+    FLASH_ProgramWord(BENCH_FLASH_ADDRESS + i * 4, Source[i]);
+  }
+  FLASH_Lock();
+}
+
+/**
+  * @brief  FLASH_If_Write() of BENCH_BYTES in the erased last sector: a
+  *         FLASH_ProgramWord() and a read back per word
+  * @param  None
+  * @retval None
+  */
+static void Kernel_FlashIfWrite(void)
+{
+  __IO uint32_t address = BENCH_FLASH_ADDRESS;
+
+  Sink = FLASH_If_Write(&address, Source, BENCH_WORDS);
+  FLASH_Lock();
+}
+
+/**
+  * @brief  FLASH_If_WriteBlock() of BENCH_BYTES in the erased last sector:
+  *         one programming sequence and a CRC check of the range
+  * @param  None
+  * @retval None
+  */
+static void Kernel_FlashIfWriteBlock(void)
+{
+  __IO uint32_t address = BENCH_FLASH_ADDRESS;
+
+  Sink = FLASH_If_WriteBlock(&address, Source, BENCH_WORDS);
+  FLASH_Lock();
+}
+
+/**
+  * @brief  CRC unit over BENCH_BYTES
+  * @param  None
+  * @retval None
+  */
+static void Kernel_CrcBlock(void)
+{
+  CRC_ResetDR();
+  Sink = CRC_CalcBlockCRC(Source, BENCH_WORDS);
+}
+
+/**
+  * @brief  Byte loop copy, kept a loop: GCC would make it a memcpy() call
+  * @param  None
+  * @retval None
+  */
+__attribute__((optimize("no-tree-loop-distribute-patterns")))
+static void Kernel_MemcpyByte(void)
+{
+  const uint8_t* source = (const uint8_t*)Source;
+  uint8_t* destination = (uint8_t*)Destination;
+  uint32_t i = 0;
+
+  for (i = 0; i < BENCH_BYTES; i++)
+  {
+    destination[i] = source[i];
+  }
+}
+
+/**
+  * @brief  Word loop copy
+  * @param  None
+  * @retval None
+  */
+__attribute__((optimize("no-tree-loop-distribute-patterns")))
+static void Kernel_MemcpyWord(void)
+{
+  uint32_t i = 0;
+
+  for (i = 0; i < BENCH_WORDS; i++)
+  {
+    Destination[i] = Source[i];
+  }
+}
+
+/**
+  * @brief  memcpy() of newlib, aligned
+  * @param  None
+  * @retval None
+  */
+static void Kernel_Memcpy(void)
+{
+  memcpy(Destination, Source, BENCH_BYTES);
+}
+
+/**
+  * @brief  memcpy() of newlib, source and destination not word aligned
+  * @param  None
+  * @retval None
+  */
+static void Kernel_MemcpyUnaligned(void)
+{
+  memcpy((uint8_t*)Destination + 3, (const uint8_t*)Source + 1, BENCH_BYTES);
+}
+
+/**
+  * @brief  BENCH_MUL_COUNT products in GF(2^163), each one fed by the last
+  * @param  None
+  * @retval None
+  */
+static void Kernel_Gf2nMul(void)
+{
+  dwordvec_t a = {0}, b = {0}, c = {0};
+  uint32_t i = 0;
+
+  memcpy(a, CurveGx, sizeof(a));
+  memcpy(b, CurveGy, sizeof(b));
+  for (i = 0; i < BENCH_MUL_COUNT; i += 2)
+  {
+    gf2n_163_mul(c, a, b);
+    gf2n_163_mul(a, c, b);
+  }
+  Sink = a[0];
+}
+
+/**
+  * @brief  SHA-256 of BENCH_SHA_BLOCKS whole blocks: sha256_compress() is
+  *         internal to lib/libikv.a, sha256_update() calls it once per
+  *         block given in one piece
+  * @param  None
+  * @retval None
+  */
+static void Kernel_Sha256Block(void)
+{
+  sha256_context_t sha;
+  uint32_t i = 0;
+
+  sha256_init(&sha);
+  for (i = 0; i < BENCH_SHA_BLOCKS; i++)
+  {
+    sha256_update((const uint8_t*)Source + i * 64, 64, &sha);
+  }
+  Sink = sha.H[0];
+}
+
+/**
+  * @brief  Scalar multiplication of the base point by a scalar of the size
+  *         of the order, the bulk of ecdsa_verify()
+  * @param  None
+  * @retval None
+  */
+static void Kernel_EccMul(void)
+{
+  eccpoint_t point;
+  dwordvec_t x = {0}, y = {0}, z = {0}, scalar = {0};
+
+  memcpy(point.x_coord, CurveGx, sizeof(dwordvec_t));
+  memcpy(point.y_coord, CurveGy, sizeof(dwordvec_t));
+  memcpy(scalar, CurveOrder, sizeof(scalar));
+  scalar[0] -= 0x12345;
+  ecc_mul_projective(Ecc, x, y, z, &point, scalar);
+  Sink = x[0];
+}
+
+/**
+  * @brief  USART_Init() of USART1 after RCC_GetClocksFreq(), which decodes
+  *         the RCC registers at each call: the set up again of the USART
+  *         before SystemClocks
+  * @param  None
+  * @retval None
+  */
+static void Kernel_ClocksDecode(void)
+{
+  RCC_ClocksTypeDef clocks;
+  uint32_t i = 0;
+
+  for (i = 0; i < BENCH_CLOCK_COUNT; i++)
+  {
+    RCC_GetClocksFreq(&clocks);
+    Sink = clocks.PCLK2_Frequency;
+    Bench_UsartInit(i);
+  }
+}
+
+/**
+  * @brief  Fills SystemClocks, as SystemClockSwitch() does
+  * @param  None
+  * @retval None
+  */
+static void Kernel_ClocksUpdate(void)
+{
+  SystemCoreClockUpdate();
+}
+
+/**
+  * @brief  USART_Init() of USART1 alone, its divisor from SystemClocks
+  * @param  None
+  * @retval None
+  */
+static void Kernel_ClocksCached(void)
+{
+  uint32_t i = 0;
+
+  for (i = 0; i < BENCH_CLOCK_COUNT; i++)
+  {
+    Bench_UsartInit(i);
+  }
+}
+
+/**
+  * @brief  Sets USART1 up again as the IAP does, at one of four baud rates
+  * @param  Index: picks the baud rate
+  * @retval None
+  */
+static void Bench_UsartInit(uint32_t Index)
+{
+  USART_InitTypeDef USART_InitStructure;
+
+  USART_InitStructure.USART_BaudRate = BENCH_CLOCK_BAUD << (Index & 3);
+  USART_InitStructure.USART_WordLength = USART_WordLength_8b;
+  USART_InitStructure.USART_StopBits = USART_StopBits_1;
+  USART_InitStructure.USART_Parity = USART_Parity_No;
+  USART_InitStructure.USART_HardwareFlowControl = USART_HardwareFlowControl_None;
+  USART_InitStructure.USART_Mode = USART_Mode_Rx | USART_Mode_Tx;
+  USART_Init(USART1, &USART_InitStructure);
+}
+
+/**
+  * @brief  memcpy() of newlib, BENCH_COPY_SMALL bytes
+  * @param  None
+  * @retval None
+  */
+static void Kernel_MemcpySmall(void)
+{
+  memcpy(Destination, Source, BENCH_COPY_SMALL);
+}
+
+/**
+  * @brief  memcpy() of newlib, BENCH_COPY_MEDIUM bytes
+  * @param  None
+  * @retval None
+  */
+static void Kernel_MemcpyMedium(void)
+{
+  memcpy(Destination, Source, BENCH_COPY_MEDIUM);
+}
+
+/**
+  * @brief  memcpy() of newlib, BENCH_COPY_LARGE bytes
+  * @param  None
+  * @retval None
+  */
+static void Kernel_MemcpyLarge(void)
+{
+  memcpy(Destination, Source, BENCH_COPY_LARGE);
+}
+
+/**
+  * @brief  DMEM_Copy() of BENCH_COPY_SMALL bytes, to the end
+  * @param  None
+  * @retval None
+  */
+static void Kernel_DmaCopySmall(void)
+{
+  Bench_DmaCopy(BENCH_COPY_SMALL);
+}
+
+/**
+  * @brief  DMEM_Copy() of BENCH_COPY_MEDIUM bytes, to the end
+  * @param  None
+  * @retval None
+  */
+static void Kernel_DmaCopyMedium(void)
+{
+  Bench_DmaCopy(BENCH_COPY_MEDIUM);
+}
+
+/**
+  * @brief  DMEM_Copy() of BENCH_COPY_LARGE bytes, to the end
+  * @param  None
+  * @retval None
+  */
+static void Kernel_DmaCopyLarge(void)
+{
+  Bench_DmaCopy(BENCH_COPY_LARGE);
+}
+
+/**
+  * @brief  DMEM_Copy() of BENCH_BYTES, to the end
+  * @param  None
+  * @retval None
+  */
+static void Kernel_DmaCopy(void)
+{
+  Bench_DmaCopy(BENCH_BYTES);
+}
+
+/**
+  * @brief  Copies Source to Destination on the stream, waiting for the end
+  *         and the stream interrupt
+  * @param  Bytes: bytes copied
+  * @retval None
+  */
+static void Bench_DmaCopy(uint32_t Bytes)
+{
+  DMEM_Copy(Destination, Source, Bytes, 0, 0);
+  while (DMEM_Busy() != 0)
+  {
+  }
+}
+
+/**
+  * @brief  HMAC_SHA1() of the library, BENCH_HMAC_SMALL byte messages
+  * @param  None
+  * @retval None
+  */
+static void Kernel_HmacSmall(void)
+{
+  Bench_Hmac(BENCH_HMAC_SMALL);
+}
+
+/**
+  * @brief  HMAC_SHA1() of the library, BENCH_HMAC_MEDIUM byte messages
+  * @param  None
+  * @retval None
+  */
+static void Kernel_HmacMedium(void)
+{
+  Bench_Hmac(BENCH_HMAC_MEDIUM);
+}
+
+/**
+  * @brief  HMAC_SHA1() of the library, BENCH_HMAC_LARGE byte messages
+  * @param  None
+  * @retval None
+  */
+static void Kernel_HmacLarge(void)
+{
+  Bench_Hmac(BENCH_HMAC_LARGE);
+}
+
+/**
+  * @brief  Prepares the key of the hkey_ kernels
+  * @param  None
+  * @retval None
+  */
+static void Kernel_HkeyInit(void)
+{
+  HKEY_Init(&HmacKey, HASH_AlgoSelection_SHA1, (const uint8_t*)Destination, BENCH_HMAC_KEY);
+}
+
+/**
+  * @brief  HKEY_Mac(), BENCH_HMAC_SMALL byte messages
+  * @param  None
+  * @retval None
+  */
+static void Kernel_HkeySmall(void)
+{
+  Bench_Hkey(BENCH_HMAC_SMALL);
+}
+
+/**
+  * @brief  HKEY_Mac(), BENCH_HMAC_MEDIUM byte messages
+  * @param  None
+  * @retval None
+  */
+static void Kernel_HkeyMedium(void)
+{
+  Bench_Hkey(BENCH_HMAC_MEDIUM);
+}
+
+/**
+  * @brief  HKEY_Mac(), BENCH_HMAC_LARGE byte messages
+  * @param  None
+  * @retval None
+  */
+static void Kernel_HkeyLarge(void)
+{
+  Bench_Hkey(BENCH_HMAC_LARGE);
+}
+
+/**
+  * @brief  BENCH_HMAC_COUNT messages of Source through HMAC_SHA1(), the
+  *         key written at each one
+  * @param  Bytes: bytes of a message
+  * @retval None
+  */
+static void Bench_Hmac(uint32_t Bytes)
+{
+  uint32_t i = 0;
+
+  for (i = 0; i < BENCH_HMAC_COUNT; i++)
+  {
+    HMAC_SHA1((uint8_t*)Destination, BENCH_HMAC_KEY, (uint8_t*)Source + i * Bytes, Bytes, Mac);
+  }
+  Sink = Mac[0];
+}
+
+/**
+  * @brief  The messages of Bench_Hmac() through HKEY_Mac()
+  * @param  Bytes: bytes of a message
+  * @retval None
+  */
+static void Bench_Hkey(uint32_t Bytes)
+{
+  uint32_t i = 0;
+
+  for (i = 0; i < BENCH_HMAC_COUNT; i++)
+  {
+    HKEY_Mac(&HmacKey, (const uint8_t*)Source + i * Bytes, Bytes, Mac);
+  }
+  Sink = Mac[0];
+}
+
+/**
+  * @brief  Cycles since SysTick_Config()
+  * @param  None
+  * @retval Cycle count
+  */
+static uint64_t Bench_Now(void)
+{
+  uint32_t wraps = 0, value = 0;
+
+  do
+  {
+    wraps = SysTickWraps;
+    value = SysTick->VAL;
+  } while ((wraps != SysTickWraps) || ((SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) != 0));
+
+  return ((uint64_t)wraps << 24) + (SysTick_LOAD_RELOAD_Msk - value);
+}
+
+/**
+  * @brief  Semihosting call to the debugger or QEMU
+  * @param  Operation: SYS_ operation
+  * @param  Argument: argument of the operation, in r1
+  * @retval Result of the operation
+  */
+static uint32_t Semihost(uint32_t Operation, uint32_t Argument)
+{
+  register uint32_t r0 __asm__("r0") = Operation;
+  register uint32_t r1 __asm__("r1") = Argument;
+
+  __asm__ volatile ("bkpt 0xAB" : "+r" (r0) : "r" (r1) : "memory");
+  return r0;
+}
+
+/**
+  * @brief  Prints a string on the semihosting console
+  * @param  Text: NUL terminated string
+  * @retval None
+  */
+static void Bench_Print(const char* Text)
+{
+  Semihost(SYS_WRITE0, (uint32_t)Text);
+}
+
+/**
+  * @brief  Prints a decimal number on the semihosting console
+  * @param  Value: number
+  * @retval None
+  */
+static void Bench_PrintNumber(uint64_t Value)
+{
+  char text[21];
+  uint32_t i = sizeof(text) - 1;
+
+  text[i] = 0;
+  do
+  {
+    text[--i] = (char)('0' + (Value % 10));
+    Value /= 10;
+  } while (Value != 0);
+  Bench_Print(&text[i]);
+}
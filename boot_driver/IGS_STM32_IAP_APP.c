@@ -15,35 +15,978 @@
 #include <string.h>
 #include "stm32f2xx.h"
 #include "flash_if.h"
+#include "boot_record.h"
+#include "lz_flash.h"
+#include "delta_flash.h"
+#include "image_verify.h"
+#include "iap_frame.h"
+#include "profile.h"
+#include "dma_manager.h"
+#include "startup.h"
 #include "IGS_STM32_IAP_APP.h"
 
+/* Start of the vector table, in startup_stm32f2xx.s */
+extern uint32_t g_pfnVectors[];
+
 
 static uint8_t FirmwareVer[VERSION_LENGTH] = VERSION;
 
+typedef enum {
+	IAP_DL_IDLE = 0,
+	IAP_DL_HEADER,
+	IAP_DL_ERASE,
+	IAP_DL_DATA,
+} IAP_DL_State;
+
+typedef enum {
+	IAP_BAUD_IDLE = 0,
+	IAP_BAUD_TEST,							/* receiving the test pattern at the new rate */
+	IAP_BAUD_CONFIRM,						/* pattern echoed, waiting for CMD_ACK */
+	IAP_BAUD_RESYNC,						/* test failed, waiting for IAP_BAUD_SYNC */
+} IAP_Baud_State;
+
+/* RX DMA buffer. Raw download: double buffer, the DMA fills one block
+   while the other is programmed. Framed link: ring the DMA fills for good.
+   Written by the DMA before it is read, not zeroed at the start. */
+static union {
+	uint32_t Block[2][IAP_DL_BLOCK_SIZE/4];
+	uint8_t Ring[IAP_FRAME_RING_SIZE];
+} IAP_Rx DEFERRED_BSS;
+
+static IAP_DL_State IAP_DlState = IAP_DL_IDLE;
+static uint32_t IAP_DlHeader[VERIFY_SIGNATURE_SIZE / 4];	/* the largest header: a signature */
+static uint32_t IAP_DlHeaderCnt;
+static uint32_t IAP_DlHeaderSize;
+static uint8_t IAP_DlCommand;				/* command of the header being received */
+static uint32_t IAP_DlSize;					/* image length from the header, in bytes */
+static uint32_t IAP_DlStreamSize;		/* bytes the host streams: image, compressed or patch length */
+static uint32_t IAP_DlBaseSize;			/* running image length a patch applies to */
+static uint32_t IAP_DlCrc;					/* image CRC from the header */
+static uint32_t IAP_DlSlot;					/* slot the image is written to */
+static uint32_t IAP_DlReady;				/* a verified image waits for CMD_Activate */
+static uint32_t IAP_DlSigned;				/* and its signature is valid */
+static uint32_t IAP_DlReceived;		/* stream bytes handled so far */
+static uint32_t IAP_DlBlock;				/* blocks received so far */
+static __IO uint32_t IAP_DlAddress;	/* next flash address to program */
+static IAP_Baud_State IAP_BaudState = IAP_BAUD_IDLE;
+static uint32_t IAP_Baud;						/* rate in use */
+static uint32_t IAP_BaudPrevious;		/* restored when the test fails */
+static uint32_t IAP_BaudCnt;
+static const uint8_t IAP_BaudSync[IAP_BAUD_SYNC_SIZE] = IAP_BAUD_SYNC;
+static uint8_t IAP_BaudEcho[IAP_BAUD_PATTERN_SIZE];	/* test pattern received, sent back by the TX DMA */
+static uint32_t IAP_Framed;					/* CMD_Frame received, the link carries frames */
+static uint32_t IAP_RingPos;				/* next ring byte to parse */
+static uint32_t IAP_DeltaCalls;			/* RX DMA interrupts a delta had work left */
+static const DMAM_Stream* IAP_TxDma;
+static const DMAM_Stream* IAP_RxDma;
+static FRAME_Link IAP_Frame DEFERRED_BSS;	/* set up by FRAME_Init() */
+static __IO uint32_t IAP_ResetPending;	/* reset once the port and the flash are idle */
+static uint32_t IAP_Answered;				/* a command has been handled, the image is confirmed */
+
+/* Decodes CMD_Download_LZ or CMD_Download_Delta into the slot */
+static union {
+	LZ_Decoder Lz;
+	DELTA_Patch Delta;
+} IAP_Decoder;
+
+static void IAP_Command(uint8_t data);
+static void IAP_SendByte(uint8_t data);
+static void IAP_SendBuffer(const uint8_t* data, uint32_t length);
+static void IAP_Reset(void);
+static void IAP_Reset_Check(void);
+static uint32_t IAP_RunningSlot(void);
+static uint32_t IAP_DownloadSlot(void);
+static uint32_t IAP_Activate(void);
+static uint32_t IAP_Rollback(void);
+static void IAP_Confirm(void);
+static void IAP_Download_Header(uint8_t command, uint32_t size);
+static void IAP_Download_Start(void);
+static void IAP_Download_Erased(uint32_t status);
+static void IAP_Download_Stop(uint8_t status);
+static uint32_t IAP_Download_Data(uint32_t *block, uint32_t length);
+static void IAP_Signature(void);
+static uint32_t IAP_Baud_Divisor(uint32_t baud);
+static void IAP_Baud_Set(uint32_t baud);
+static void IAP_Clock_Changed(void);
+static void IAP_TxDma_Done(void* context, uint32_t flags);
+static void IAP_RxDma_Done(void* context, uint32_t flags);
+static void IAP_Baud_Start(void);
+static void IAP_Baud_Receive(uint8_t data, uint32_t error);
+static void IAP_Frame_Start(void);
+static void IAP_Frame_Poll(void);
+static uint32_t IAP_Frame_Crc(const uint32_t* data, uint32_t words);
+static void IAP_Frame_Send(const uint8_t* data, uint32_t length);
+static void IAP_Frame_Deliver(uint32_t type, const uint32_t* data, uint32_t length);
+static uint32_t IAP_Delta_Pending(void);
+
 
 void IAP_COM_IRQHandler(void)
 {
-	uint32_t for_tmp;
+	uint8_t data;
+	uint32_t error;
+	
+	PROF_BEGIN(PROF_IAP_COM_IRQ);
+	
+	if (USART_GetITStatus(IAP_COM, USART_IT_TC) == SET) {
+		IAP_Reset_Check();
+	}
+	
+	if (IAP_Framed != 0) {
+		if (USART_GetITStatus(IAP_COM, USART_IT_IDLE) == SET) {
+			/* Cleared by reading SR then DR. The line is idle, the DMA has
+			   taken the last byte: parse it at the DMA interrupt priority */
+			USART_ReceiveData(IAP_COM);
+			NVIC_SetPendingIRQ(IAP_RxDma->IRQn);
+		}
+	} else if (USART_GetITStatus(IAP_COM, USART_IT_RXNE) == SET) {
+		/* The error flags are cleared by reading SR then DR */
+		error = IAP_COM->SR & (USART_FLAG_ORE | USART_FLAG_NE | USART_FLAG_FE);
+		data = USART_ReceiveData(IAP_COM);
+		
+		if (IAP_BaudState != IAP_BAUD_IDLE) {
+			IAP_Baud_Receive(data, error);
+		} else if (error == 0) {
+			IAP_Command(data);
+		}
+	}
+	
+	PROF_END(PROF_IAP_COM_IRQ);
+}
+
+/***********************************************************
+  * @brief  Command byte from the raw link or from a FRAME_CMD frame
+  * @param  data: received byte
+  * @retval None
+  */
+static void IAP_Command(uint8_t data)
+{
+	uint32_t i;
+	
+	if (IAP_ResetPending != 0) {
+		return;
+	}
+	
+	if (IAP_DlState == IAP_DL_HEADER) {
+		((uint8_t *)IAP_DlHeader)[IAP_DlHeaderCnt++] = data;
+		if (IAP_DlHeaderCnt == IAP_DlHeaderSize) {
+			if (IAP_DlCommand == CMD_Signature) {
+				IAP_Signature();
+			} else if (IAP_DlCommand == CMD_Baud) {
+				IAP_Baud_Start();
+			} else {
+				IAP_Download_Start();
+			}
+		}
+		return;
+	}
 	
-	if (USART_GetITStatus(IAP_COM, USART_IT_RXNE) == SET) {
-		switch(USART_ReceiveData(IAP_COM)){
-			case CMD_Return_Ver:
-				DMA_Cmd(IAP_TX_DMA_STREAM, ENABLE);
-			break;
+	switch(data){
+		case CMD_Return_Ver:
+			if (IAP_Framed != 0) {
+				for (i = 0; i < VERSION_LENGTH; i++) {
+					IAP_SendByte(FirmwareVer[i]);
+				}
+			} else {
+				IAP_SendBuffer(FirmwareVer, VERSION_LENGTH);
+			}
+		break;
+		
+		case CMD_RunPROG:
+			/* Single image layout only: in the slots APPLICATION_ADDRESS is
+			   the boot selector, which must not be cleared */
+			if ((uint32_t)g_pfnVectors != APPLICATION_ADDRESS) {
+				IAP_SendByte(CMD_NACK);
+				break;
+			}
+			FLASH_If_Init();
+			
+			FLASH_If_DisableWriteProtection();
+			FLASH_ProgramWord(APPLICATION_ADDRESS, 0x00000000);
 			
-			case CMD_RunPROG:
-				FLASH_If_Init();
-				
-				FLASH_If_DisableWriteProtection();
-				FLASH_ProgramWord(APPLICATION_ADDRESS, 0x00000000);
-				
-				for(for_tmp=0;for_tmp<100000;for_tmp++);
-				
-				NVIC_SystemReset();
-				
-			break;
+			IAP_Reset();
+		break;
+		
+		case CMD_Download:
+			IAP_Download_Header(data, IAP_DL_HEADER_SIZE);
+		break;
+		
+		case CMD_Download_LZ:
+			IAP_Download_Header(data, IAP_DL_LZ_HEADER_SIZE);
+		break;
+		
+		case CMD_Download_Delta:
+			IAP_Download_Header(data, IAP_DL_DELTA_HEADER_SIZE);
+		break;
+		
+		case CMD_Signature:
+			IAP_Download_Header(data, VERIFY_SIGNATURE_SIZE);
+		break;
+		
+		case CMD_Baud:
+			if (IAP_Framed != 0) {
+				IAP_SendByte(CMD_NACK);
+			} else {
+				IAP_Download_Header(data, IAP_BAUD_HEADER_SIZE);
+			}
+		break;
+		
+		case CMD_Frame:
+			if ((IAP_Framed == 0) && (IAP_DlState == IAP_DL_IDLE)) {
+				IAP_SendByte(CMD_ACK);
+				IAP_Frame_Start();
+			} else {
+				IAP_SendByte(CMD_NACK);
+			}
+		break;
+		
+		case CMD_Activate:
+			if ((IAP_DlState == IAP_DL_IDLE) && (IAP_Activate() == 0)) {
+				IAP_SendByte(CMD_ACK);
+				IAP_Reset();
+			} else {
+				IAP_SendByte(CMD_NACK);
+			}
+		break;
+		
+		case CMD_Rollback:
+			if ((IAP_DlState == IAP_DL_IDLE) && (IAP_Rollback() == 0)) {
+				IAP_SendByte(CMD_ACK);
+				IAP_Reset();
+			} else {
+				IAP_SendByte(CMD_NACK);
+			}
+		break;
+		
+		case CMD_Return_Slot:
+			IAP_SendByte((uint8_t)IAP_DownloadSlot());
+		break;
+		
+		case CMD_Profile:
+			if (IAP_Framed != 0) {
+				IAP_SendByte(CMD_NACK);
+			} else {
+				IAP_SendBuffer(PROF_Dump(), PROF_DUMP_SIZE);
+			}
+		break;
+		
+		default:
+		return;
+	}
+	
+	/* The host talks to this image: it runs well enough to be updated */
+	if (IAP_Answered == 0) {
+		IAP_Answered = 1;
+		IAP_Confirm();
+	}
+}
+
+/***********************************************************
+  * @brief  Sends one status byte on the IAP COM port, or queues it
+  *         for the next FRAME_ACK on the framed link
+  * @param  data: byte to send
+  * @retval None
+  */
+static void IAP_SendByte(uint8_t data)
+{
+	if (IAP_Framed != 0) {
+		FRAME_Reply(&IAP_Frame, data);
+		return;
+	}
+	
+	while (USART_GetFlagStatus(IAP_COM, USART_FLAG_TXE) == RESET);
+	USART_SendData(IAP_COM, data);
+}
+
+/***********************************************************
+  * @brief  Sends a buffer on the IAP COM port with the TX DMA, after
+  *         the previous one
+  * @param  data: bytes to send, left untouched until the DMA is done
+  * @param  length: number of bytes
+  * @retval None
+  */
+static void IAP_SendBuffer(const uint8_t* data, uint32_t length)
+{
+	while (DMA_GetCmdStatus(IAP_TxDma->Stream) != DISABLE);
+	
+	DMA_MemoryTargetConfig(IAP_TxDma->Stream, (uint32_t)data, DMA_Memory_0);
+	DMA_SetCurrDataCounter(IAP_TxDma->Stream, length);
+	DMA_Cmd(IAP_TxDma->Stream, ENABLE);
+}
+
+/***********************************************************
+  * @brief  Resets the MCU as soon as the answer has left the port and
+  *         the flash is idle. Until then the commands are ignored and
+  *         IAP_Reset_Check() runs again from the USART TC, TX DMA TC
+  *         and end of erase interrupts.
+  * @param  None
+  * @retval None
+  */
+static void IAP_Reset(void)
+{
+	/* The answer to the frame being handled is still queued */
+	if (IAP_Framed != 0) {
+		FRAME_Ack(&IAP_Frame);
+	}
+	
+	IAP_ResetPending = 1;
+	IAP_Reset_Check();
+}
+
+/***********************************************************
+  * @brief  Resets the MCU if a reset is pending and nothing is left
+  *         to wait for: TX DMA stopped, last stop bit sent, no erase,
+  *         program or option byte operation running
+  * @param  None
+  * @retval None
+  */
+static void IAP_Reset_Check(void)
+{
+	if (IAP_ResetPending == 0) {
+		return;
+	}
+	
+	/* CMD_Return_Ver, CMD_Profile: its TC interrupt calls back */
+	if (DMA_GetCmdStatus(IAP_TxDma->Stream) != DISABLE) {
+		return;
+	}
+	
+	/* TC stays set once the last byte is out: the interrupt is only
+	   wanted until then */
+	if (USART_GetFlagStatus(IAP_COM, USART_FLAG_TC) == RESET) {
+		USART_ITConfig(IAP_COM, USART_IT_TC, ENABLE);
+		return;
+	}
+	USART_ITConfig(IAP_COM, USART_IT_TC, DISABLE);
+	
+	/* An erase calls back when it is over. Programming and option byte
+	   launches are waited for by the StdPeriph calls, BSY and OPTSTRT are
+	   only checked for safety. */
+	if ((FLASH_If_EraseBusy() != 0) || (FLASH_GetFlagStatus(FLASH_FLAG_BSY) != RESET) ||
+			((FLASH->OPTCR & FLASH_OPTCR_OPTSTRT) != 0)) {
+		return;
+	}
+	
+	NVIC_SystemReset();
+}
+
+/***********************************************************
+  * @brief  Gets the slot this image runs from
+  * @param  None
+  * @retval BOOT_SLOT_A, BOOT_SLOT_B, or 0xFF for an image linked
+  *         outside the slots (DEBUG build, single image layout)
+  */
+static uint32_t IAP_RunningSlot(void)
+{
+	uint32_t vectors = (uint32_t)g_pfnVectors;
+	
+	if ((vectors >= SLOT_A_ADDRESS) && (vectors < (SLOT_A_ADDRESS + SLOT_SIZE))) {
+		return BOOT_SLOT_A;
+	}
+	if ((vectors >= SLOT_B_ADDRESS) && (vectors < (SLOT_B_ADDRESS + SLOT_SIZE))) {
+		return BOOT_SLOT_B;
+	}
+	return 0xFF;
+}
+
+/***********************************************************
+  * @brief  Gets the slot a download is written to: the one that is
+  *         not running, or not active for an image outside the slots
+  * @param  None
+  * @retval BOOT_SLOT_A or BOOT_SLOT_B
+  */
+static uint32_t IAP_DownloadSlot(void)
+{
+	BOOT_Record record;
+	uint32_t slot = IAP_RunningSlot();
+	
+	if (slot == 0xFF) {
+		if (BOOT_ReadRecord(&record) != 0) {
+			return BOOT_SLOT_A;
+		}
+		slot = record.Active;
+	}
+	return BOOT_OTHER_SLOT(slot);
+}
+
+/***********************************************************
+  * @brief  Makes the downloaded slot active: the selector starts it
+  *         in TRIAL state after the reset
+  * @param  None
+  * @retval 0: record written, 1: no verified and signed image or error
+  */
+static uint32_t IAP_Activate(void)
+{
+	BOOT_Record record;
+	uint32_t status;
+	
+	if ((IAP_DlReady == 0) || (IAP_DlSigned == 0)) {
+		return 1;
+	}
+	
+	/* Check the slot again, the image must not have changed since the download */
+	if ((BOOT_IsValidImage(IAP_DlSlot) == 0) ||
+			(BOOT_ImageCrc(IAP_DlSlot, IAP_DlSize) != IAP_DlCrc)) {
+		return 1;
+	}
+	
+	record.Active = IAP_DlSlot;
+	record.State = BOOT_STATE_TRIAL;
+	record.Attempts = 0;
+	record.Size = IAP_DlSize;
+	record.Crc = IAP_DlCrc;
+	
+	FLASH_If_Init();
+	status = BOOT_WriteRecord(&record);
+	FLASH_Lock();
+	
+	return status;
+}
+
+/***********************************************************
+  * @brief  Makes the other slot active again
+  * @param  None
+  * @retval 0: record written, 1: the other slot can not be started or error
+  */
+static uint32_t IAP_Rollback(void)
+{
+	BOOT_Record record;
+	uint32_t status;
+	uint32_t slot = IAP_RunningSlot();
+	
+	if (slot == 0xFF) {
+		if (BOOT_ReadRecord(&record) != 0) {
+			return 1;
+		}
+		slot = record.Active;
+	}
+	slot = BOOT_OTHER_SLOT(slot);
+	
+	if (BOOT_IsValidImage(slot) == 0) {
+		return 1;
+	}
+	
+	record.Active = slot;
+	record.State = BOOT_STATE_CONFIRMED;
+	record.Attempts = 0;
+	record.Size = 0;
+	record.Crc = 0;
+	
+	IAP_DlReady = 0;
+	FLASH_If_Init();
+	status = BOOT_WriteRecord(&record);
+	FLASH_Lock();
+	
+	return status;
+}
+
+/***********************************************************
+  * @brief  Confirms an image started in TRIAL state, at the first command
+  *         handled on the IAP link: it runs and can be updated again.
+  *         Otherwise the selector goes back to the other slot after
+  *         BOOT_TRIAL_MAX boots.
+  * @param  None
+  * @retval None
+  */
+static void IAP_Confirm(void)
+{
+	BOOT_Record record;
+	
+	if ((BOOT_ReadRecord(&record) != 0) || (record.State != BOOT_STATE_TRIAL) ||
+			(record.Active != IAP_RunningSlot())) {
+		return;
+	}
+	
+	record.State = BOOT_STATE_CONFIRMED;
+	record.Attempts = 0;
+	
+	FLASH_If_Init();
+	BOOT_WriteRecord(&record);
+	FLASH_Lock();
+}
+
+/***********************************************************
+  * @brief  Starts receiving the header of a download command or a
+  *         signature. Ignored while a download is still running.
+  * @param  command: CMD_Download, CMD_Download_LZ, CMD_Download_Delta,
+  *         CMD_Signature or CMD_Baud
+  * @param  size: header length of the command in bytes
+  * @retval None
+  */
+static void IAP_Download_Header(uint8_t command, uint32_t size)
+{
+	if (IAP_DlState == IAP_DL_IDLE) {
+		IAP_DlCommand = command;
+		IAP_DlHeaderCnt = 0;
+		IAP_DlHeaderSize = size;
+		IAP_DlState = IAP_DL_HEADER;
+	}
+}
+
+/***********************************************************
+  * @brief  Checks the download header and starts erasing the sectors
+  *         the image needs. The erase runs from the FLASH interrupt,
+  *         IAP_Download_Erased() is called when it is over.
+  * @param  None
+  * @retval None
+  */
+static void IAP_Download_Start(void)
+{
+	uint32_t *header = IAP_DlHeader;
+	uint32_t valid = 1;
+	
+	/* The header fields are little endian words, as the core */
+	if (IAP_DlCommand == CMD_Download_LZ) {
+		valid = (*header++ == IAP_DL_LZ_MAGIC);
+	} else if (IAP_DlCommand == CMD_Download_Delta) {
+		valid = (*header++ == IAP_DL_DELTA_MAGIC);
+	}
+	IAP_DlSize = header[0];
+	IAP_DlCrc = header[1];
+	IAP_DlStreamSize = (IAP_DlCommand == CMD_Download) ? IAP_DlSize : header[2];
+	IAP_DlSlot = IAP_DownloadSlot();
+	IAP_DlReady = 0;
+	IAP_DlSigned = 0;
+	
+	if (IAP_DlCommand == CMD_Download_Delta) {
+		/* The patch applies to the image of the other slot: the running one,
+		   or the active one for an image outside the slots. The CRC tells it
+		   is the image the patch was made from. */
+		IAP_DlBaseSize = header[3];
+		if ((IAP_DlBaseSize > SLOT_SIZE) ||
+				(BOOT_ImageCrc(BOOT_OTHER_SLOT(IAP_DlSlot), IAP_DlBaseSize) != header[4])) {
+			valid = 0;
+		}
+	}
+	
+	if ((valid == 0) || (IAP_DlSize == 0) || (IAP_DlSize > SLOT_SIZE) ||
+			(IAP_DlStreamSize == 0) || (IAP_DlStreamSize > SLOT_SIZE)) {
+		IAP_DlState = IAP_DL_IDLE;
+		IAP_SendByte(CMD_NACK);
+		return;
+	}
+	
+	FLASH_If_Init();
+	IAP_DlState = IAP_DL_ERASE;
+	if (FLASH_If_EraseStart(BOOT_SlotAddress(IAP_DlSlot), IAP_DlSize, IAP_Download_Erased) != 0) {
+		FLASH_Lock();
+		IAP_DlState = IAP_DL_IDLE;
+		IAP_SendByte(CMD_NACK);
+	}
+}
+
+/***********************************************************
+  * @brief  End of the download area erase: hands the reception over
+  *         to the RX DMA double buffer, unless the link is framed, and
+  *         answers CMD_ACK when the host may start streaming the image.
+  * @param  status: 0 if the erase succeeded
+  * @retval None
+  */
+static void IAP_Download_Erased(uint32_t status)
+{
+	if (IAP_ResetPending != 0) {
+		FLASH_Lock();
+		IAP_DlState = IAP_DL_IDLE;
+		IAP_Reset_Check();
+		return;
+	}
+	
+	if (status != 0) {
+		FLASH_Lock();
+		IAP_DlState = IAP_DL_IDLE;
+		IAP_SendByte(CMD_NACK);
+		return;
+	}
+	
+	/* The decoders hand the image to the digest as they program it */
+	VERIFY_Start();
+	IAP_DlAddress = BOOT_SlotAddress(IAP_DlSlot);
+	if (IAP_DlCommand == CMD_Download_LZ) {
+		LZ_Init(&IAP_Decoder.Lz, IAP_DlAddress, IAP_DlSize, VERIFY_Update);
+	} else if (IAP_DlCommand == CMD_Download_Delta) {
+		DELTA_Init(&IAP_Decoder.Delta, IAP_DlAddress, IAP_DlSize,
+							 BOOT_SlotAddress(BOOT_OTHER_SLOT(IAP_DlSlot)), IAP_DlBaseSize, VERIFY_Update);
+	}
+	IAP_DlReceived = 0;
+	IAP_DlBlock = 0;
+	IAP_DeltaCalls = 0;
+	IAP_DlState = IAP_DL_DATA;
+	
+	if (IAP_Framed != 0) {
+		IAP_SendByte(CMD_ACK);
+		return;
+	}
+	
+	/* From now on the data bytes are moved by the DMA, not by the RXNE interrupt */
+	USART_ITConfig(IAP_COM, USART_IT_RXNE, DISABLE);
+	DMAM_ClearFlags(IAP_RxDma, DMAM_FLAG_TC);
+	DMA_DoubleBufferModeConfig(IAP_RxDma->Stream, (uint32_t)IAP_Rx.Block[1], DMA_Memory_0);
+	DMA_SetCurrDataCounter(IAP_RxDma->Stream, IAP_DL_BLOCK_SIZE);
+	DMA_Cmd(IAP_RxDma->Stream, ENABLE);
+	USART_DMACmd(IAP_COM, USART_DMAReq_Rx, ENABLE);
+	
+	IAP_SendByte(CMD_ACK);
+}
+
+/***********************************************************
+  * @brief  Ends the download and gives the reception back to the
+  *         RXNE interrupt
+  * @param  status: CMD_ACK or CMD_NACK, sent to the host
+  * @retval None
+  */
+static void IAP_Download_Stop(uint8_t status)
+{
+	FLASH_Lock();
+	IAP_DlState = IAP_DL_IDLE;
+	
+	if (IAP_Framed == 0) {
+		USART_DMACmd(IAP_COM, USART_DMAReq_Rx, DISABLE);
+		DMA_Cmd(IAP_RxDma->Stream, DISABLE);
+		USART_ReceiveData(IAP_COM);
+		USART_ITConfig(IAP_COM, USART_IT_RXNE, ENABLE);
+	}
+	
+	IAP_SendByte(status);
+}
+
+/***********************************************************
+  * @brief  Programs a piece of the download stream. Ends the download
+  *         on an error or with the last piece. A delta left with work sets
+  *         the RX DMA interrupt pending, which calls again with no data.
+  * @param  block: stream bytes, word aligned, 0xFF padded to a word
+  * @param  length: number of stream bytes, the bytes past the end of
+  *         the stream are ignored. 0 for a delta with work left.
+  * @retval 0: more data expected, 1: download over
+  */
+static uint32_t IAP_Download_Data(uint32_t *block, uint32_t length)
+{
+	uint32_t status;
+	
+	if (length > IAP_DlStreamSize - IAP_DlReceived) {
+		length = IAP_DlStreamSize - IAP_DlReceived;
+	}
+	IAP_DlReceived += length;
+	
+	if (IAP_DlCommand == CMD_Download_LZ) {
+		status = LZ_Decode(&IAP_Decoder.Lz, (uint8_t *)block, length);
+		if ((status == 0) && (IAP_DlReceived >= IAP_DlStreamSize)) {
+			status = LZ_Finish(&IAP_Decoder.Lz);
+		}
+	} else if (IAP_DlCommand == CMD_Download_Delta) {
+		status = DELTA_Apply(&IAP_Decoder.Delta, (uint8_t *)block, length);
+		if ((status == 0) && (DELTA_Pending(&IAP_Decoder.Delta) != 0)) {
+			NVIC_SetPendingIRQ(IAP_RxDma->IRQn);
+			return 0;
+		}
+		if ((status == 0) && (IAP_DlReceived >= IAP_DlStreamSize)) {
+			status = DELTA_Finish(&IAP_Decoder.Delta);
+		}
+	} else {
+		VERIFY_Update((uint8_t *)block, length);
+		status = FLASH_If_WriteBlock(&IAP_DlAddress, block, (length + 3) / 4);
+	}
+	if (status != 0) {
+		IAP_Download_Stop(CMD_NACK);
+		return 1;
+	}
+	
+	if (IAP_DlReceived < IAP_DlStreamSize) {
+		return 0;
+	}
+	
+	VERIFY_Finish();
+	
+	/* Whole image check: CRC from the header, vector table linked for the slot */
+	if ((BOOT_ImageCrc(IAP_DlSlot, IAP_DlSize) == IAP_DlCrc) &&
+			(BOOT_IsValidImage(IAP_DlSlot) != 0)) {
+		IAP_DlReady = 1;
+		IAP_Download_Stop(CMD_ACK);
+	} else {
+		IAP_Download_Stop(CMD_NACK);
+	}
+	return 1;
+}
+
+/***********************************************************
+  * @brief  Checks the signature received after a download against
+  *         the SHA-256 computed while the image was programmed
+  * @note   The ECDSA check takes a few hundred milliseconds, the
+  *         host waits for the answer before any other command.
+  * @param  None
+  * @retval None
+  */
+static void IAP_Signature(void)
+{
+	IAP_DlState = IAP_DL_IDLE;
+	
+	PROF_BEGIN(PROF_SIGNATURE);
+	IAP_DlSigned = ((IAP_DlReady != 0) && (VERIFY_Signature(IAP_DlHeader) == 0)) ? 1 : 0;
+	PROF_END(PROF_SIGNATURE);
+	
+	IAP_SendByte((IAP_DlSigned != 0) ? CMD_ACK : CMD_NACK);
+}
+
+/***********************************************************
+  * @brief  Gets the divisor of a baud rate: PCLK periods per bit,
+  *         rounded to the nearest
+  * @param  baud: baud rate asked by the host
+  * @retval Divisor, 0 if the rate can not be made within
+  *         IAP_BAUD_TOLERANCE
+  */
+static uint32_t IAP_Baud_Divisor(uint32_t baud)
+{
+	uint32_t pclk, divisor, actual;
+	
+	if ((baud == 0) || (baud > IAP_BAUD_MAX)) {
+		return 0;
+	}
+	
+	pclk = IAP_PCLK(SystemClocks);
+	divisor = (pclk + baud / 2) / baud;
+	
+	/* 8 samples per bit at least, with OVER8 */
+	if (divisor < 8) {
+		return 0;
+	}
+	
+	actual = pclk / divisor;
+	if (((actual > baud) ? (actual - baud) : (baud - actual)) > (baud / 1000) * IAP_BAUD_TOLERANCE) {
+		return 0;
+	}
+	return divisor;
+}
+
+/***********************************************************
+  * @brief  Changes the baud rate once the last byte has left
+  *         IAP_BAUD_DEFAULT when the clock can not make the rate
+  * @param  baud: new rate
+  * @retval None
+  */
+static void IAP_Baud_Set(uint32_t baud)
+{
+	uint32_t divisor = IAP_Baud_Divisor(baud);
+	
+	if (divisor == 0) {
+		baud = IAP_BAUD_DEFAULT;
+		divisor = IAP_Baud_Divisor(baud);
+	}
+	while (USART_GetFlagStatus(IAP_COM, USART_FLAG_TC) == RESET);
+	
+	USART_Cmd(IAP_COM, DISABLE);
+	if (divisor < 16) {
+		/* BRR: mantissa, 3 fraction bits */
+		USART_OverSampling8Cmd(IAP_COM, ENABLE);
+		USART_OneBitMethodCmd(IAP_COM, ENABLE);
+		IAP_COM->BRR = (uint16_t)(((divisor >> 3) << 4) | (divisor & 0x07));
+	} else {
+		USART_OverSampling8Cmd(IAP_COM, DISABLE);
+		USART_OneBitMethodCmd(IAP_COM, DISABLE);
+		IAP_COM->BRR = (uint16_t)divisor;
+	}
+	IAP_Baud = baud;
+	USART_Cmd(IAP_COM, ENABLE);
+}
+
+/***********************************************************
+  * @brief  Sets the rate up again for the new PCLK, called by
+  *         SystemClockSwitch()
+  * @param  None
+  * @retval None
+  */
+static void IAP_Clock_Changed(void)
+{
+	IAP_Baud_Set(IAP_Baud);
+}
+
+/***********************************************************
+  * @brief  CMD_Baud: answers at the current rate, then switches to
+  *         the new one and waits for the test pattern
+  * @param  None
+  * @retval None
+  */
+static void IAP_Baud_Start(void)
+{
+	IAP_DlState = IAP_DL_IDLE;
+	if (IAP_Baud_Divisor(IAP_DlHeader[0]) == 0) {
+		IAP_SendByte(CMD_NACK);
+		return;
+	}
+	
+	IAP_SendByte(CMD_ACK);
+	IAP_BaudPrevious = IAP_Baud;
+	IAP_BaudCnt = 0;
+	IAP_BaudState = IAP_BAUD_TEST;
+	IAP_Baud_Set(IAP_DlHeader[0]);
+}
+
+/***********************************************************
+  * @brief  Byte received while a new baud rate is tested
+  * @param  data: received byte
+  * @param  error: error flags of the byte
+  * @retval None
+  */
+static void IAP_Baud_Receive(uint8_t data, uint32_t error)
+{
+	switch (IAP_BaudState) {
+		case IAP_BAUD_TEST:
+			if ((error == 0) && (data == (uint8_t)IAP_BaudCnt)) {
+				IAP_BaudEcho[IAP_BaudCnt] = data;
+				if (++IAP_BaudCnt == IAP_BAUD_PATTERN_SIZE) {
+					/* The host checks what the board sends at the new rate. The
+					   DMA sends it, the interrupt does not wait for the port. */
+					IAP_SendBuffer(IAP_BaudEcho, IAP_BAUD_PATTERN_SIZE);
+					IAP_BaudState = IAP_BAUD_CONFIRM;
+				}
+				return;
+			}
+		break;
+		
+		case IAP_BAUD_CONFIRM:
+			if ((error == 0) && (data == CMD_ACK)) {
+				IAP_BaudState = IAP_BAUD_IDLE;
+				IAP_SendByte(CMD_ACK);
+				return;
+			}
+		break;
+		
+		default:
+			/* What the host sent at the other rate is ignored up to the sync */
+			if ((error == 0) && (data == IAP_BaudSync[IAP_BaudCnt])) {
+				if (++IAP_BaudCnt == IAP_BAUD_SYNC_SIZE) {
+					IAP_BaudState = IAP_BAUD_IDLE;
+					IAP_SendByte(CMD_ACK);
+				}
+			} else {
+				IAP_BaudCnt = ((error == 0) && (data == IAP_BaudSync[0])) ? 1 : 0;
+			}
+		return;
+	}
+	
+	/* Test failed: back to the rate that worked */
+	IAP_Baud_Set(IAP_BaudPrevious);
+	IAP_BaudCnt = 0;
+	IAP_BaudState = IAP_BAUD_RESYNC;
+}
+
+/***********************************************************
+  * @brief  CMD_Frame: the RX DMA fills the ring for good, parsed on
+  *         half and full transfer and when the line goes idle
+  * @param  None
+  * @retval None
+  */
+static void IAP_Frame_Start(void)
+{
+	FRAME_Init(&IAP_Frame, IAP_Frame_Crc, IAP_Frame_Send, IAP_Frame_Deliver);
+	IAP_RingPos = 0;
+	IAP_Framed = 1;
+	
+	USART_ITConfig(IAP_COM, USART_IT_RXNE, DISABLE);
+	DMA_Cmd(IAP_RxDma->Stream, DISABLE);
+	while (DMA_GetCmdStatus(IAP_RxDma->Stream) != DISABLE);
+	
+	DMA_DoubleBufferModeCmd(IAP_RxDma->Stream, DISABLE);
+	DMA_MemoryTargetConfig(IAP_RxDma->Stream, (uint32_t)IAP_Rx.Ring, DMA_Memory_0);
+	DMA_SetCurrDataCounter(IAP_RxDma->Stream, IAP_FRAME_RING_SIZE);
+	DMAM_ClearFlags(IAP_RxDma, DMAM_FLAG_HT | DMAM_FLAG_TC);
+	DMA_ITConfig(IAP_RxDma->Stream, DMA_IT_HT, ENABLE);
+	DMA_Cmd(IAP_RxDma->Stream, ENABLE);
+	
+	USART_ReceiveData(IAP_COM);
+	USART_DMACmd(IAP_COM, USART_DMAReq_Rx, ENABLE);
+	USART_ITConfig(IAP_COM, USART_IT_IDLE, ENABLE);
+}
+
+/***********************************************************
+  * @brief  Hands the bytes the DMA has put in the ring to the frame
+  *         link, including those received while they are handled. Stops
+  *         while a delta has work left: the bytes wait in the ring and the
+  *         host, without FRAME_ACK, within its window.
+  * @param  None
+  * @retval None
+  */
+static void IAP_Frame_Poll(void)
+{
+	uint32_t end, length;
+	
+	/* NDTR reloads to the ring size instead of reaching 0 */
+	while ((end = IAP_FRAME_RING_SIZE - DMA_GetCurrDataCounter(IAP_RxDma->Stream)) != IAP_RingPos) {
+		if (IAP_Delta_Pending() != 0) {
+			return;
+		}
+		/* A piece completes one data frame at most */
+		length = ((end < IAP_RingPos) ? IAP_FRAME_RING_SIZE : end) - IAP_RingPos;
+		if (length > IAP_FRAME_POLL_SIZE) {
+			length = IAP_FRAME_POLL_SIZE;
+		}
+		FRAME_Receive(&IAP_Frame, IAP_Rx.Ring + IAP_RingPos, length);
+		IAP_RingPos = (IAP_RingPos + length) % IAP_FRAME_RING_SIZE;
+	}
+}
+
+/***********************************************************
+  * @brief  CRC unit value of a frame
+  * @param  data: frame words
+  * @param  words: number of words
+  * @retval CRC value
+  */
+static uint32_t IAP_Frame_Crc(const uint32_t* data, uint32_t words)
+{
+	CRC_ResetDR();
+	return CRC_CalcBlockCRC((uint32_t *)data, words);
+}
+
+/***********************************************************
+  * @brief  Sends a FRAME_ACK frame on the IAP COM port
+  * @param  data: frame bytes
+  * @param  length: frame length
+  * @retval None
+  */
+static void IAP_Frame_Send(const uint8_t* data, uint32_t length)
+{
+	while (length-- > 0) {
+		while (USART_GetFlagStatus(IAP_COM, USART_FLAG_TXE) == RESET);
+		USART_SendData(IAP_COM, *data++);
+	}
+}
+
+/***********************************************************
+  * @brief  Payload of a frame, in sequence order
+  * @param  type: FRAME_CMD or FRAME_DATA
+  * @param  data: payload, word aligned and 0xFF padded to a word
+  * @param  length: payload length
+  * @retval None
+  */
+static void IAP_Frame_Deliver(uint32_t type, const uint32_t* data, uint32_t length)
+{
+	uint32_t i;
+	
+	if (type == FRAME_CMD) {
+		for (i = 0; i < length; i++) {
+			IAP_Command(((const uint8_t *)data)[i]);
 		}
+		return;
+	}
+	
+	if (IAP_DlState != IAP_DL_DATA) {
+		return;
+	}
+	
+	/* The flash is programmed by words: only the last piece may end inside one */
+	if (((length & 3) != 0) && (IAP_DlReceived + length < IAP_DlStreamSize)) {
+		IAP_Download_Stop(CMD_NACK);
+		return;
 	}
+	IAP_Download_Data((uint32_t *)data, length);
+}
+
+/***********************************************************
+  * @brief  Tells whether a delta download has work left without new data
+  * @param  None
+  * @retval 1: DELTA_Apply() is to be called again, 0: otherwise
+  */
+static uint32_t IAP_Delta_Pending(void)
+{
+	return ((IAP_DlState == IAP_DL_DATA) && (IAP_DlCommand == CMD_Download_Delta) &&
+					(DELTA_Pending(&IAP_Decoder.Delta) != 0)) ? 1 : 0;
 }
 
 /***********************************************************
@@ -58,11 +1001,12 @@ void IAP_Init(void)
 	USART_InitTypeDef USART_InitStructure;
 	DMA_InitTypeDef DMA_InitStructure;
 	
-	#ifdef DEBUG
-		NVIC_SetVectorTable(NVIC_VectTab_FLASH, (0x08000000&0x0000FFFF));
-	#else
-		NVIC_SetVectorTable(NVIC_VectTab_FLASH, (APPLICATION_ADDRESS&0x0000FFFF));
-	#endif
+	/* The vector table is where this image is linked: 0x08000000 for a
+	   DEBUG build, APPLICATION_ADDRESS or a slot otherwise */
+	NVIC_SetVectorTable(NVIC_VectTab_FLASH, (uint32_t)g_pfnVectors - NVIC_VectTab_FLASH);
+	
+	/* Cycle counter of the probes read by CMD_Profile */
+	PROF_Init();
 	
 	/* Enable GPIO clock */
 	RCC_AHB1PeriphClockCmd(IAP_TX_GPIO_CLK, ENABLE);
@@ -74,8 +1018,16 @@ void IAP_Init(void)
 	RCC_APB1PeriphClockCmd(IAP_CLK, ENABLE);
 #endif
 	
-	/* Enable DMA clock */
-	RCC_AHB1PeriphClockCmd(IAP_DMA_CLK, ENABLE);
+	/* TX and RX streams, their DMA clock enabled. Taken by the application
+	   before IAP_Init(): no IAP port */
+	IAP_TxDma = DMAM_Alloc(IAP_TX_DMA_REQUEST, IAP_TxDma_Done, 0);
+	IAP_RxDma = DMAM_Alloc(IAP_RX_DMA_REQUEST, IAP_RxDma_Done, 0);
+	if ((IAP_TxDma == 0) || (IAP_RxDma == 0)) {
+		return;
+	}
+	
+	/* Enable CRC clock, used by the boot selection records */
+	RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_CRC, ENABLE);
 	
 	/* Connect Tx*/
 	GPIO_PinAFConfig(IAP_TX_GPIO_PORT, IAP_TX_SOURCE, IAP_TX_AF);
@@ -100,7 +1052,7 @@ void IAP_Init(void)
 	NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
 	NVIC_Init(&NVIC_InitStructure);
 
-  USART_InitStructure.USART_BaudRate = 115200;
+  USART_InitStructure.USART_BaudRate = IAP_BAUD_DEFAULT;
   USART_InitStructure.USART_WordLength = USART_WordLength_8b;
   USART_InitStructure.USART_StopBits = USART_StopBits_1;
   USART_InitStructure.USART_Parity = USART_Parity_No;
@@ -108,9 +1060,12 @@ void IAP_Init(void)
   USART_InitStructure.USART_Mode = USART_Mode_Rx | USART_Mode_Tx;
 
 	USART_Init(IAP_COM, &USART_InitStructure);
+	IAP_Baud = IAP_BAUD_DEFAULT;
+	SystemClockRegister(IAP_Clock_Changed);
 	USART_ITConfig(IAP_COM, USART_IT_RXNE, ENABLE);
 	USART_Cmd(IAP_COM, ENABLE);
 	USART_DMACmd(IAP_COM, USART_DMAReq_Tx,ENABLE);
+	USART_DMACmd(IAP_COM, USART_DMAReq_Rx,DISABLE);
 	
   DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
   DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
@@ -123,30 +1078,100 @@ void IAP_Init(void)
   DMA_InitStructure.DMA_MemoryBurst = DMA_MemoryBurst_Single;
   DMA_InitStructure.DMA_PeripheralBurst = DMA_PeripheralBurst_Single;
 	
-	DMA_DeInit(IAP_TX_DMA_STREAM);
+	DMA_DeInit(IAP_TxDma->Stream);
 	DMA_InitStructure.DMA_DIR = DMA_DIR_MemoryToPeripheral;
 	DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)&IAP_COM->DR;
 	DMA_InitStructure.DMA_Memory0BaseAddr = (uint32_t)FirmwareVer;
-	DMA_InitStructure.DMA_Channel = IAP_TX_DMA_CHANNEL;
+	DMA_InitStructure.DMA_Channel = IAP_TxDma->Channel;
 	DMA_InitStructure.DMA_BufferSize = VERSION_LENGTH;
-	DMA_Init(IAP_TX_DMA_STREAM, &DMA_InitStructure);
-	DMA_ITConfig(IAP_TX_DMA_STREAM, DMA_IT_TC, ENABLE);
-	DMA_Cmd(IAP_TX_DMA_STREAM, DISABLE);
+	DMA_Init(IAP_TxDma->Stream, &DMA_InitStructure);
+	DMA_ITConfig(IAP_TxDma->Stream, DMA_IT_TC, ENABLE);
+	DMA_Cmd(IAP_TxDma->Stream, DISABLE);
 	
 	NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 1;
 	NVIC_InitStructure.NVIC_IRQChannelSubPriority = 1;
 	NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
-	NVIC_InitStructure.NVIC_IRQChannel = IAP_TX_DMA_RX_IRQn;
+	NVIC_InitStructure.NVIC_IRQChannel = IAP_TxDma->IRQn;
+	NVIC_Init(&NVIC_InitStructure);
+	
+	/* RX stream: circular double buffer, one TC interrupt per block */
+	DMA_DeInit(IAP_RxDma->Stream);
+	DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralToMemory;
+	DMA_InitStructure.DMA_Mode = DMA_Mode_Circular;
+	DMA_InitStructure.DMA_Memory0BaseAddr = (uint32_t)IAP_Rx.Block[0];
+	DMA_InitStructure.DMA_Channel = IAP_RxDma->Channel;
+	DMA_InitStructure.DMA_BufferSize = IAP_DL_BLOCK_SIZE;
+	DMA_Init(IAP_RxDma->Stream, &DMA_InitStructure);
+	DMA_DoubleBufferModeConfig(IAP_RxDma->Stream, (uint32_t)IAP_Rx.Block[1], DMA_Memory_0);
+	DMA_DoubleBufferModeCmd(IAP_RxDma->Stream, ENABLE);
+	DMA_ITConfig(IAP_RxDma->Stream, DMA_IT_TC, ENABLE);
+	DMA_Cmd(IAP_RxDma->Stream, DISABLE);
+	
+	NVIC_InitStructure.NVIC_IRQChannel = IAP_RxDma->IRQn;
 	NVIC_Init(&NVIC_InitStructure);
+	
+	/* End of sector erase during a download */
+	NVIC_InitStructure.NVIC_IRQChannel = FLASH_IRQn;
+	NVIC_Init(&NVIC_InitStructure);
+}
+
+/**
+ * @bref IAP_TxDma_Done
+ *       TX stream interrupt, from dma_manager.c
+ */
+static void IAP_TxDma_Done(void* context, uint32_t flags)
+{
+	(void)context;
+	PROF_BEGIN(PROF_IAP_TX_DMA_IRQ);
+	if ((flags & DMAM_FLAG_TC) != 0)
+	{
+		IAP_Reset_Check();
+	}
+	PROF_END(PROF_IAP_TX_DMA_IRQ);
 }
 
 /**
- * @bref IAP_TX_DMA_TX_IRQHandler
+ * @bref IAP_RxDma_Done
+ *       RX stream interrupt, from dma_manager.c. A block has been received
+ *       and the DMA has switched to the other buffer: program the block
+ *       while the next one is being received.
+ *       On the framed link: parse what the DMA has put in the ring, also
+ *       when the interrupt is set pending on an idle line (no flag).
+ *       Set pending as well while a delta has work left, done first.
  */
-void IAP_TX_DMA_TX_IRQHandler(void)
+static void IAP_RxDma_Done(void* context, uint32_t flags)
 {
-	if(DMA_GetITStatus(IAP_TX_DMA_STREAM,IAP_TX_IT_TCIF))    
+	uint32_t *block;
+	
+	(void)context;
+	PROF_BEGIN(PROF_IAP_RX_DMA_IRQ);
+	
+	if (IAP_Delta_Pending() != 0) {
+		IAP_Download_Data(0, 0);
+		/* The host holds its window back as long as FRAME_ACKs come */
+		if ((IAP_Framed != 0) && (IAP_Delta_Pending() != 0) &&
+				((++IAP_DeltaCalls % IAP_DELTA_ACK_CALLS) == 0)) {
+			FRAME_Ack(&IAP_Frame);
+		}
+	}
+	
+	if (IAP_Framed != 0) {
+		IAP_Frame_Poll();
+	}
+	else if ((flags & DMAM_FLAG_TC) != 0)
 	{
-		DMA_ClearITPendingBit(IAP_TX_DMA_STREAM,IAP_TX_IT_TCIF);
+		if (IAP_DlState == IAP_DL_DATA) {
+			block = IAP_Rx.Block[IAP_DlBlock & 1];
+			IAP_DlBlock++;
+			
+			/* The next block completed while this one was programmed: the DMA is
+			   already refilling this buffer, the image can not be trusted */
+			if ((IAP_Download_Data(block, IAP_DL_BLOCK_SIZE) == 0) &&
+					((DMAM_GetFlags(IAP_RxDma) & DMAM_FLAG_TC) != 0)) {
+				IAP_Download_Stop(CMD_NACK);
+			}
+		}
 	}
+	
+	PROF_END(PROF_IAP_RX_DMA_IRQ);
 }
@@ -0,0 +1,686 @@
+/**
+  ******************************************************************************
+  * @file    aead.c
+  * @brief   AES-GCM and AES-CCM of aead.h.
+  *
+  *          The CRYP takes the blocks in memory order (8-bit data), the key
+  *          and IV registers big-endian words. GHASH keeps its value in
+  *          big-endian words, Table[n] being n times H with the bits of n
+  *          in GCM order; the reduction of the four bits shifted out is
+  *          Last4[], as in the 4-bit method of the GCM specification.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "cryp_engine.h"
+#include "aead.h"
+
+/* Private define ------------------------------------------------------------*/
+#define AEAD_BLOCK            16
+/* Blocks written to the CRYP before reading, the depth of its FIFOs */
+#define AEAD_FIFO_BLOCKS      2
+/* Reads of the OFNE flag per word, as AESBUSY_TIMEOUT of the library */
+#define AEAD_BUSY_COUNT       0x00010000
+
+/* Private variables ---------------------------------------------------------*/
+static const uint16_t Last4[16] =
+{
+  0x0000, 0x1C20, 0x3840, 0x2460, 0x7080, 0x6CA0, 0x48C0, 0x54E0,
+  0xE100, 0xFD20, 0xD940, 0xC560, 0x9180, 0x8DA0, 0xA9C0, 0xB5E0,
+};
+
+/* Private function prototypes -----------------------------------------------*/
+static uint32_t AEAD_Gcm(const AEAD_Key* Key, const uint8_t* Iv, uint32_t IvLength,
+                         const uint8_t* Aad, uint32_t AadLength,
+                         const uint8_t* Input, uint8_t* Output, uint32_t Length,
+                         uint32_t Decrypt, uint8_t* Tag);
+static uint32_t AEAD_Ccm(const AEAD_Key* Key, const uint8_t* Nonce, uint32_t NonceLength,
+                         const uint8_t* Aad, uint32_t AadLength,
+                         const uint8_t* Input, uint8_t* Output, uint32_t Length,
+                         uint32_t Decrypt, uint8_t* Tag, uint32_t TagLength);
+static uint32_t AEAD_CcmMac(uint32_t* Mac, uint32_t* Fill, const uint8_t* Data, uint32_t Length);
+static void AEAD_GhashTable(uint32_t Table[16][4], const uint32_t* H);
+static void AEAD_Ghash(const uint32_t Table[16][4], uint32_t* Y, const uint8_t* Data, uint32_t Length);
+static void AEAD_GhashLengths(const uint32_t Table[16][4], uint32_t* Y, uint32_t First, uint32_t Second);
+static uint32_t AEAD_Start(const AEAD_Key* Key, uint32_t AlgoMode, const uint32_t* Iv);
+static void AEAD_Write(const uint32_t* Input, uint32_t Blocks);
+static uint32_t AEAD_Read(uint32_t* Output, uint32_t Blocks);
+static uint32_t AEAD_Equal(const uint8_t* First, const uint8_t* Second, uint32_t Length);
+static uint32_t AEAD_Load(const uint8_t* Bytes);
+static void AEAD_Store(uint8_t* Bytes, uint32_t Word);
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Takes an AES key and makes the GHASH table from H, the cipher of
+  *         the zero block
+  * @param  Key: filled
+  * @param  Bytes: key bytes
+  * @param  KeyBits: 128, 192 or 256
+  * @retval AEAD_OK, AEAD_BUSY, AEAD_TIMEOUT or AEAD_LENGTH
+  */
+uint32_t AEAD_SetKey(AEAD_Key* Key, const uint8_t* Bytes, uint32_t KeyBits)
+{
+  uint32_t h[4];
+  uint32_t i = 0, first = 0, status = AEAD_OK;
+
+  if ((KeyBits != 128) && (KeyBits != 192) && (KeyBits != 256))
+  {
+    return AEAD_LENGTH;
+  }
+  RCC_AHB2PeriphClockCmd(RCC_AHB2Periph_CRYP, ENABLE);
+
+  /* The key ends in K3RR */
+  memset(Key->Key, 0, sizeof(Key->Key));
+  first = 8 - KeyBits / 32;
+  for (i = 0; i < KeyBits / 32; i++)
+  {
+    Key->Key[first + i] = AEAD_Load(&Bytes[i * 4]);
+  }
+  Key->KeySize = (KeyBits == 128) ? CRYP_KeySize_128b :
+                 (KeyBits == 192) ? CRYP_KeySize_192b : CRYP_KeySize_256b;
+
+  status = AEAD_Start(Key, CRYP_AlgoMode_AES_ECB, 0);
+  if (status != AEAD_OK)
+  {
+    return status;
+  }
+  memset(h, 0, sizeof(h));
+  AEAD_Write(h, 1);
+  status = AEAD_Read(h, 1);
+  CENG_Unlock();
+  if (status == AEAD_OK)
+  {
+    AEAD_GhashTable(Key->Table, h);
+  }
+  return status;
+}
+
+/**
+  * @brief  GCM encryption
+  * @param  Key: from AEAD_SetKey()
+  * @param  Iv: IV bytes, 12 bytes is the fast case
+  * @param  IvLength: bytes, not 0
+  * @param  Aad: additional data, authenticated only; may be 0 with AadLength 0
+  * @param  AadLength: bytes
+  * @param  Input: plaintext
+  * @param  Output: ciphertext, may be Input
+  * @param  Length: bytes
+  * @param  Tag: filled
+  * @param  TagLength: 4 to 16 bytes, the first bytes of the tag
+  * @retval AEAD_OK, AEAD_BUSY, AEAD_TIMEOUT or AEAD_LENGTH
+  */
+uint32_t AEAD_GcmEncrypt(const AEAD_Key* Key, const uint8_t* Iv, uint32_t IvLength,
+                         const uint8_t* Aad, uint32_t AadLength,
+                         const uint8_t* Input, uint8_t* Output, uint32_t Length,
+                         uint8_t* Tag, uint32_t TagLength)
+{
+  uint8_t tag[AEAD_TAG_SIZE];
+  uint32_t status = AEAD_OK;
+
+  if ((TagLength < 4) || (TagLength > AEAD_TAG_SIZE))
+  {
+    return AEAD_LENGTH;
+  }
+  status = AEAD_Gcm(Key, Iv, IvLength, Aad, AadLength, Input, Output, Length, 0, tag);
+  if (status == AEAD_OK)
+  {
+    memcpy(Tag, tag, TagLength);
+  }
+  return status;
+}
+
+/**
+  * @brief  GCM decryption and check of the tag
+  * @param  Key, Iv, IvLength, Aad, AadLength: as AEAD_GcmEncrypt()
+  * @param  Input: ciphertext
+  * @param  Output: plaintext, may be Input; cleared if the tag does not
+  *         match
+  * @param  Length: bytes
+  * @param  Tag: tag received
+  * @param  TagLength: 4 to 16 bytes
+  * @retval AEAD_OK, AEAD_AUTH, AEAD_BUSY, AEAD_TIMEOUT or AEAD_LENGTH
+  */
+uint32_t AEAD_GcmDecrypt(const AEAD_Key* Key, const uint8_t* Iv, uint32_t IvLength,
+                         const uint8_t* Aad, uint32_t AadLength,
+                         const uint8_t* Input, uint8_t* Output, uint32_t Length,
+                         const uint8_t* Tag, uint32_t TagLength)
+{
+  uint8_t tag[AEAD_TAG_SIZE];
+  uint32_t status = AEAD_OK;
+
+  if ((TagLength < 4) || (TagLength > AEAD_TAG_SIZE))
+  {
+    return AEAD_LENGTH;
+  }
+  status = AEAD_Gcm(Key, Iv, IvLength, Aad, AadLength, Input, Output, Length, 1, tag);
+  if ((status == AEAD_OK) && (AEAD_Equal(tag, Tag, TagLength) == 0))
+  {
+    memset(Output, 0, Length);
+    status = AEAD_AUTH;
+  }
+  return status;
+}
+
+/**
+  * @brief  CCM encryption
+  * @param  Key: from AEAD_SetKey()
+  * @param  Nonce: nonce bytes
+  * @param  NonceLength: 7 to 13 bytes; 15 minus it is the size of the
+  *         length field, a 7-byte nonce for 4 GB
+  * @param  Aad: additional data, authenticated only; may be 0 with AadLength 0
+  * @param  AadLength: bytes
+  * @param  Input: plaintext
+  * @param  Output: ciphertext, may be Input
+  * @param  Length: bytes
+  * @param  Tag: filled
+  * @param  TagLength: 4, 6, 8, 10, 12, 14 or 16 bytes
+  * @retval AEAD_OK, AEAD_BUSY, AEAD_TIMEOUT or AEAD_LENGTH
+  */
+uint32_t AEAD_CcmEncrypt(const AEAD_Key* Key, const uint8_t* Nonce, uint32_t NonceLength,
+                         const uint8_t* Aad, uint32_t AadLength,
+                         const uint8_t* Input, uint8_t* Output, uint32_t Length,
+                         uint8_t* Tag, uint32_t TagLength)
+{
+  return AEAD_Ccm(Key, Nonce, NonceLength, Aad, AadLength, Input, Output, Length, 0, Tag, TagLength);
+}
+
+/**
+  * @brief  CCM decryption and check of the tag
+  * @param  Key, Nonce, NonceLength, Aad, AadLength: as AEAD_CcmEncrypt()
+  * @param  Input: ciphertext
+  * @param  Output: plaintext, may be Input; cleared if the tag does not
+  *         match
+  * @param  Length: bytes
+  * @param  Tag: tag received
+  * @param  TagLength: as AEAD_CcmEncrypt()
+  * @retval AEAD_OK, AEAD_AUTH, AEAD_BUSY, AEAD_TIMEOUT or AEAD_LENGTH
+  */
+uint32_t AEAD_CcmDecrypt(const AEAD_Key* Key, const uint8_t* Nonce, uint32_t NonceLength,
+                         const uint8_t* Aad, uint32_t AadLength,
+                         const uint8_t* Input, uint8_t* Output, uint32_t Length,
+                         const uint8_t* Tag, uint32_t TagLength)
+{
+  uint8_t tag[AEAD_TAG_SIZE];
+  uint32_t status = AEAD_OK;
+
+  status = AEAD_Ccm(Key, Nonce, NonceLength, Aad, AadLength, Input, Output, Length, 1, tag, TagLength);
+  if ((status == AEAD_OK) && (AEAD_Equal(tag, Tag, TagLength) == 0))
+  {
+    memset(Output, 0, Length);
+    status = AEAD_AUTH;
+  }
+  return status;
+}
+
+/**
+  * @brief  GCM in one pass: the CRYP ciphers a pair of blocks while the
+  *         previous ones, or the ciphertext given, go through GHASH
+  * @param  Key, Iv, IvLength, Aad, AadLength, Input, Output, Length: as
+  *         AEAD_GcmEncrypt()
+  * @param  Decrypt: 0 to encrypt, 1 to decrypt
+  * @param  Tag: the 16 bytes of the tag
+  * @retval AEAD_OK, AEAD_BUSY, AEAD_TIMEOUT or AEAD_LENGTH
+  */
+static uint32_t AEAD_Gcm(const AEAD_Key* Key, const uint8_t* Iv, uint32_t IvLength,
+                         const uint8_t* Aad, uint32_t AadLength,
+                         const uint8_t* Input, uint8_t* Output, uint32_t Length,
+                         uint32_t Decrypt, uint8_t* Tag)
+{
+  uint32_t block[AEAD_FIFO_BLOCKS * 4];
+  uint32_t y[4], j0[4], mask[4];
+  uint32_t i = 0, done = 0, size = 0, status = AEAD_OK;
+
+  if (IvLength == 0)
+  {
+    return AEAD_LENGTH;
+  }
+
+  /* J0: the IV and a counter of 1, or the GHASH of a longer IV */
+  if (IvLength == 12)
+  {
+    j0[0] = AEAD_Load(&Iv[0]);
+    j0[1] = AEAD_Load(&Iv[4]);
+    j0[2] = AEAD_Load(&Iv[8]);
+    j0[3] = 1;
+  }
+  else
+  {
+    memset(j0, 0, sizeof(j0));
+    for (done = 0; done < IvLength; done += AEAD_BLOCK)
+    {
+      AEAD_Ghash(Key->Table, j0, &Iv[done], IvLength - done);
+    }
+    AEAD_GhashLengths(Key->Table, j0, 0, IvLength);
+  }
+
+  /* CTR from J0: its block masks the tag, the message starts at J0 + 1 */
+  status = AEAD_Start(Key, CRYP_AlgoMode_AES_CTR, j0);
+  if (status != AEAD_OK)
+  {
+    return status;
+  }
+  memset(mask, 0, sizeof(mask));
+  AEAD_Write(mask, 1);
+
+  memset(y, 0, sizeof(y));
+  for (done = 0; done < AadLength; done += AEAD_BLOCK)
+  {
+    AEAD_Ghash(Key->Table, y, &Aad[done], AadLength - done);
+  }
+  status = AEAD_Read(mask, 1);
+
+  for (done = 0; (status == AEAD_OK) && (done < Length); done += size)
+  {
+    size = ((Length - done) < sizeof(block)) ? (Length - done) : sizeof(block);
+    memcpy(block, &Input[done], size);
+    AEAD_Write(block, (size + AEAD_BLOCK - 1) / AEAD_BLOCK);
+    if (Decrypt != 0)
+    {
+      for (i = 0; i < size; i += AEAD_BLOCK)
+      {
+        AEAD_Ghash(Key->Table, y, &Input[done + i], size - i);
+      }
+    }
+    status = AEAD_Read(block, (size + AEAD_BLOCK - 1) / AEAD_BLOCK);
+    memcpy(&Output[done], block, size);
+    if (Decrypt == 0)
+    {
+      for (i = 0; i < size; i += AEAD_BLOCK)
+      {
+        AEAD_Ghash(Key->Table, y, &Output[done + i], size - i);
+      }
+    }
+  }
+  CENG_Unlock();
+  if (status != AEAD_OK)
+  {
+    return status;
+  }
+
+  AEAD_GhashLengths(Key->Table, y, AadLength, Length);
+  for (i = 0; i < 4; i++)
+  {
+    AEAD_Store(&Tag[i * 4], y[i] ^ AEAD_Load((const uint8_t*)&mask[i]));
+  }
+  return AEAD_OK;
+}
+
+/**
+  * @brief  CCM in one pass. Each step takes the CBC-MAC of the previous
+  *         block and the next counter block through the CRYP together:
+  *         the MAC of a decrypted block needs its plaintext first.
+  * @param  Key, Nonce, NonceLength, Aad, AadLength, Input, Output, Length:
+  *         as AEAD_CcmEncrypt()
+  * @param  Decrypt: 0 to encrypt, 1 to decrypt
+  * @param  Tag: TagLength bytes
+  * @param  TagLength: as AEAD_CcmEncrypt()
+  * @retval AEAD_OK, AEAD_BUSY, AEAD_TIMEOUT or AEAD_LENGTH
+  */
+static uint32_t AEAD_Ccm(const AEAD_Key* Key, const uint8_t* Nonce, uint32_t NonceLength,
+                         const uint8_t* Aad, uint32_t AadLength,
+                         const uint8_t* Input, uint8_t* Output, uint32_t Length,
+                         uint32_t Decrypt, uint8_t* Tag, uint32_t TagLength)
+{
+  /* MAC block then counter block, as they go through the FIFO */
+  uint32_t pair[8];
+  uint32_t counter[4], mask[4];
+  uint8_t* mac = (uint8_t*)&pair[0];
+  uint8_t* stream = (uint8_t*)&pair[4];
+  uint8_t* bytes = (uint8_t*)counter;
+  uint8_t header[6];
+  uint8_t data = 0;
+  uint32_t q = 15 - NonceLength;
+  uint32_t i = 0, done = 0, size = 0, fill = 0, status = AEAD_OK;
+
+  if ((NonceLength < 7) || (NonceLength > 13) ||
+      (TagLength < 4) || (TagLength > AEAD_TAG_SIZE) || ((TagLength & 1) != 0) ||
+      ((q < 4) && ((Length >> (8 * q)) != 0)))
+  {
+    return AEAD_LENGTH;
+  }
+
+  /* B0: flags, nonce and message length; Ctr0: flags, nonce and 0 */
+  mac[0] = ((AadLength != 0) ? 0x40 : 0) | (((TagLength - 2) / 2) << 3) | (q - 1);
+  memcpy(&mac[1], Nonce, NonceLength);
+  for (i = 0; i < q; i++)
+  {
+    mac[15 - i] = (i < 4) ? (uint8_t)(Length >> (8 * i)) : 0;
+  }
+  memset(counter, 0, sizeof(counter));
+  bytes[0] = q - 1;
+  memcpy(&bytes[1], Nonce, NonceLength);
+  memcpy(&pair[4], counter, sizeof(counter));
+
+  status = AEAD_Start(Key, CRYP_AlgoMode_AES_ECB, 0);
+  if (status != AEAD_OK)
+  {
+    return status;
+  }
+  AEAD_Write(pair, 2);
+  status = AEAD_Read(pair, 2);
+  memcpy(mask, &pair[4], sizeof(mask));
+
+  /* Additional data after its length, zero padded */
+  if ((status == AEAD_OK) && (AadLength != 0))
+  {
+    if (AadLength < 0xFF00)
+    {
+      header[0] = (uint8_t)(AadLength >> 8);
+      header[1] = (uint8_t)AadLength;
+      size = 2;
+    }
+    else
+    {
+      header[0] = 0xFF;
+      header[1] = 0xFE;
+      AEAD_Store(&header[2], AadLength);
+      size = 6;
+    }
+    status = AEAD_CcmMac(pair, &fill, header, size);
+    if (status == AEAD_OK)
+    {
+      status = AEAD_CcmMac(pair, &fill, Aad, AadLength);
+    }
+    if ((status == AEAD_OK) && (fill != 0))
+    {
+      AEAD_Write(pair, 1);
+      status = AEAD_Read(pair, 1);
+    }
+  }
+
+  /* The plaintext of a block is added to the MAC, ciphered with the next
+     counter block */
+  for (done = 0; (status == AEAD_OK) && (done < Length); done += size)
+  {
+    size = ((Length - done) < AEAD_BLOCK) ? (Length - done) : AEAD_BLOCK;
+    AEAD_Store(&bytes[12], AEAD_Load(&bytes[12]) + 1);
+    memcpy(&pair[4], counter, sizeof(counter));
+    if (done != 0)
+    {
+      AEAD_Write(pair, 2);
+      status = AEAD_Read(pair, 2);
+    }
+    else
+    {
+      AEAD_Write(&pair[4], 1);
+      status = AEAD_Read(&pair[4], 1);
+    }
+    for (i = 0; i < size; i++)
+    {
+      data = Input[done + i] ^ stream[i];
+      mac[i] ^= (Decrypt != 0) ? data : Input[done + i];
+      Output[done + i] = data;
+    }
+  }
+  if ((status == AEAD_OK) && (Length != 0))
+  {
+    AEAD_Write(pair, 1);
+    status = AEAD_Read(pair, 1);
+  }
+  CENG_Unlock();
+
+  for (i = 0; (status == AEAD_OK) && (i < TagLength); i++)
+  {
+    Tag[i] = mac[i] ^ ((const uint8_t*)mask)[i];
+  }
+  return status;
+}
+
+/**
+  * @brief  Adds bytes to the CBC-MAC, ciphering each block once full
+  * @param  Mac: MAC block, the CRYP in AES-ECB
+  * @param  Fill: bytes of the block added, updated
+  * @param  Data: bytes
+  * @param  Length: bytes
+  * @retval AEAD_OK or AEAD_TIMEOUT
+  */
+static uint32_t AEAD_CcmMac(uint32_t* Mac, uint32_t* Fill, const uint8_t* Data, uint32_t Length)
+{
+  uint8_t* mac = (uint8_t*)Mac;
+  uint32_t status = AEAD_OK;
+
+  while ((status == AEAD_OK) && (Length-- > 0))
+  {
+    mac[(*Fill)++] ^= *Data++;
+    if (*Fill == AEAD_BLOCK)
+    {
+      AEAD_Write(Mac, 1);
+      status = AEAD_Read(Mac, 1);
+      *Fill = 0;
+    }
+  }
+  return status;
+}
+
+/**
+  * @brief  Multiples of H by the 16 values of four bits. Table[8] is H,
+  *         Table[4], [2] and [1] H times x, x^2 and x^3; the others their
+  *         sums.
+  * @param  Table: filled
+  * @param  H: cipher of the zero block, in memory order
+  * @retval None
+  */
+static void AEAD_GhashTable(uint32_t Table[16][4], const uint32_t* H)
+{
+  uint32_t v[4];
+  uint32_t i = 0, j = 0, k = 0, carry = 0;
+
+  for (k = 0; k < 4; k++)
+  {
+    v[k] = AEAD_Load((const uint8_t*)&H[k]);
+  }
+  memset(Table[0], 0, sizeof(Table[0]));
+  memcpy(Table[8], v, sizeof(v));
+  for (i = 4; i > 0; i >>= 1)
+  {
+    carry = v[3] & 1;
+    v[3] = (v[3] >> 1) | (v[2] << 31);
+    v[2] = (v[2] >> 1) | (v[1] << 31);
+    v[1] = (v[1] >> 1) | (v[0] << 31);
+    v[0] = (v[0] >> 1) ^ ((carry != 0) ? 0xE1000000 : 0);
+    memcpy(Table[i], v, sizeof(v));
+  }
+  for (i = 2; i <= 8; i <<= 1)
+  {
+    for (j = 1; j < i; j++)
+    {
+      for (k = 0; k < 4; k++)
+      {
+        Table[i + j][k] = Table[i][k] ^ Table[j][k];
+      }
+    }
+  }
+}
+
+/**
+  * @brief  Adds a block to GHASH and multiplies by H, four bits at a time
+  *         from the last byte
+  * @param  Table: from AEAD_GhashTable()
+  * @param  Y: GHASH value, updated
+  * @param  Data: bytes of the block
+  * @param  Length: bytes left from Data, the block is zero padded under 16
+  * @retval None
+  */
+static void AEAD_Ghash(const uint32_t Table[16][4], uint32_t* Y, const uint8_t* Data, uint32_t Length)
+{
+  const uint32_t* row = 0;
+  uint32_t z0 = 0, z1 = 0, z2 = 0, z3 = 0;
+  uint32_t i = 0, byte = 0, shift = 0, rem = 0;
+
+  if (Length >= AEAD_BLOCK)
+  {
+    Y[0] ^= AEAD_Load(&Data[0]);
+    Y[1] ^= AEAD_Load(&Data[4]);
+    Y[2] ^= AEAD_Load(&Data[8]);
+    Y[3] ^= AEAD_Load(&Data[12]);
+  }
+  else
+  {
+    for (i = 0; i < Length; i++)
+    {
+      Y[i >> 2] ^= (uint32_t)Data[i] << (24 - 8 * (i & 3));
+    }
+  }
+
+  for (i = AEAD_BLOCK; i-- > 0;)
+  {
+    byte = Y[i >> 2] >> (24 - 8 * (i & 3));
+    for (shift = 0; shift <= 4; shift += 4)
+    {
+      rem = z3 & 0x0F;
+      z3 = (z3 >> 4) | (z2 << 28);
+      z2 = (z2 >> 4) | (z1 << 28);
+      z1 = (z1 >> 4) | (z0 << 28);
+      z0 = (z0 >> 4) ^ ((uint32_t)Last4[rem] << 16);
+      row = Table[(byte >> shift) & 0x0F];
+      z0 ^= row[0];
+      z1 ^= row[1];
+      z2 ^= row[2];
+      z3 ^= row[3];
+    }
+  }
+  Y[0] = z0;
+  Y[1] = z1;
+  Y[2] = z2;
+  Y[3] = z3;
+}
+
+/**
+  * @brief  Adds the block of two lengths in bits to GHASH
+  * @param  Table: from AEAD_GhashTable()
+  * @param  Y: GHASH value, updated
+  * @param  First, Second: lengths in bytes
+  * @retval None
+  */
+static void AEAD_GhashLengths(const uint32_t Table[16][4], uint32_t* Y, uint32_t First, uint32_t Second)
+{
+  uint8_t block[AEAD_BLOCK];
+
+  AEAD_Store(&block[0], First >> 29);
+  AEAD_Store(&block[4], First << 3);
+  AEAD_Store(&block[8], Second >> 29);
+  AEAD_Store(&block[12], Second << 3);
+  AEAD_Ghash(Table, Y, block, AEAD_BLOCK);
+}
+
+/**
+  * @brief  Borrows the CRYP and starts an AES encryption mode on a key
+  * @param  Key: from AEAD_SetKey()
+  * @param  AlgoMode: CRYP_AlgoMode_AES_ECB or CRYP_AlgoMode_AES_CTR
+  * @param  Iv: four words of the first counter block for CTR, else 0
+  * @retval AEAD_OK or AEAD_BUSY
+  */
+static uint32_t AEAD_Start(const AEAD_Key* Key, uint32_t AlgoMode, const uint32_t* Iv)
+{
+  if (CENG_Lock() != CENG_OK)
+  {
+    return AEAD_BUSY;
+  }
+  CRYP->CR = 0;
+  CRYP->K0LR = Key->Key[0];
+  CRYP->K0RR = Key->Key[1];
+  CRYP->K1LR = Key->Key[2];
+  CRYP->K1RR = Key->Key[3];
+  CRYP->K2LR = Key->Key[4];
+  CRYP->K2RR = Key->Key[5];
+  CRYP->K3LR = Key->Key[6];
+  CRYP->K3RR = Key->Key[7];
+  CRYP->CR = Key->KeySize | CRYP_DataType_8b | AlgoMode | CRYP_AlgoDir_Encrypt;
+  if (Iv != 0)
+  {
+    CRYP->IV0LR = Iv[0];
+    CRYP->IV0RR = Iv[1];
+    CRYP->IV1LR = Iv[2];
+    CRYP->IV1RR = Iv[3];
+  }
+  CRYP_FIFOFlush();
+  CRYP->CR |= CRYP_CR_CRYPEN;
+  return AEAD_OK;
+}
+
+/**
+  * @brief  Writes blocks to the input FIFO, which has room for them
+  * @param  Input: blocks in memory order
+  * @param  Blocks: 1 to AEAD_FIFO_BLOCKS
+  * @retval None
+  */
+static void AEAD_Write(const uint32_t* Input, uint32_t Blocks)
+{
+  uint32_t i = 0;
+
+  for (i = 0; i < Blocks * 4; i++)
+  {
+    CRYP->DR = Input[i];
+  }
+}
+
+/**
+  * @brief  Reads the blocks of the last AEAD_Write()
+  * @param  Output: blocks in memory order, may be the input
+  * @param  Blocks: as written
+  * @retval AEAD_OK or AEAD_TIMEOUT
+  */
+static uint32_t AEAD_Read(uint32_t* Output, uint32_t Blocks)
+{
+  uint32_t i = 0, counter = 0;
+
+  for (i = 0; i < Blocks * 4; i++)
+  {
+    counter = 0;
+    while ((CRYP->SR & CRYP_SR_OFNE) == 0)
+    {
+      if (++counter == AEAD_BUSY_COUNT)
+      {
+        return AEAD_TIMEOUT;
+      }
+    }
+    Output[i] = CRYP->DOUT;
+  }
+  return AEAD_OK;
+}
+
+/**
+  * @brief  Compares two tags in a time that does not depend on where they
+  *         differ
+  * @param  First, Second: tags
+  * @param  Length: bytes
+  * @retval 1 if equal, 0 if not
+  */
+static uint32_t AEAD_Equal(const uint8_t* First, const uint8_t* Second, uint32_t Length)
+{
+  uint32_t i = 0;
+  uint8_t diff = 0;
+
+  for (i = 0; i < Length; i++)
+  {
+    diff |= First[i] ^ Second[i];
+  }
+  return (diff == 0) ? 1 : 0;
+}
+
+/**
+  * @brief  Big-endian word of four bytes, at any alignment
+  * @param  Bytes: four bytes
+  * @retval Word
+  */
+static uint32_t AEAD_Load(const uint8_t* Bytes)
+{
+  return ((uint32_t)Bytes[0] << 24) | ((uint32_t)Bytes[1] << 16) |
+         ((uint32_t)Bytes[2] << 8) | Bytes[3];
+}
+
+/**
+  * @brief  Stores a word big-endian, at any alignment
+  * @param  Bytes: four bytes
+  * @param  Word: word
+  * @retval None
+  */
+static void AEAD_Store(uint8_t* Bytes, uint32_t Word)
+{
+  Bytes[0] = (uint8_t)(Word >> 24);
+  Bytes[1] = (uint8_t)(Word >> 16);
+  Bytes[2] = (uint8_t)(Word >> 8);
+  Bytes[3] = (uint8_t)Word;
+}
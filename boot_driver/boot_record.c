@@ -0,0 +1,198 @@
+/**
+  ******************************************************************************
+  * @file    boot_record.c
+  * @brief   Boot selection record of the dual slot (A/B) layout, shared by
+  *          the boot selector and the IAP shim.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "boot_record.h"
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+#define RECORD_WORDS          (sizeof(BOOT_Record) / 4)
+#define RECORD_COUNT          (BOOT_RECORD_SIZE / sizeof(BOOT_Record))
+
+/* Private macro -------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+static const uint32_t RecordAddress[2] = {BOOT_RECORD_ADDRESS_0, BOOT_RECORD_ADDRESS_1};
+static const uint32_t RecordSector[2] = {FLASH_Sector_2, FLASH_Sector_3};
+
+/* Private function prototypes -----------------------------------------------*/
+static uint32_t RecordCheck(const BOOT_Record* Record);
+static const BOOT_Record* FindRecord(const BOOT_Record** Free);
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Reads the current boot selection record
+  * @note   The CRC unit clock must be enabled.
+  * @param  Record: filled with the current record
+  * @retval 0: record found
+  *         1: no valid record, the record sectors are blank
+  */
+uint32_t BOOT_ReadRecord(BOOT_Record* Record)
+{
+  const BOOT_Record* free = 0;
+  const BOOT_Record* current = FindRecord(&free);
+
+  if (current == 0)
+  {
+    return (1);
+  }
+
+  *Record = *current;
+  return (0);
+}
+
+/**
+  * @brief  Appends a new boot selection record. When the record sector in
+  *         use is full the other one is erased and used, the current record
+  *         stays valid until the new one is completely written.
+  * @note   The flash must be unlocked and the CRC unit clock enabled.
+  * @param  Record: record to write, Magic, Sequence and Check are filled in
+  * @retval 0: record written
+  *         1: error occurred
+  */
+uint32_t BOOT_WriteRecord(BOOT_Record* Record)
+{
+  const BOOT_Record* entry = 0;
+  const BOOT_Record* current = FindRecord(&entry);
+  uint32_t sector = 0, i = 0;
+
+  Record->Magic = BOOT_RECORD_MAGIC;
+  Record->Sequence = (current != 0) ? (current->Sequence + 1) : 1;
+  Record->Check = RecordCheck(Record);
+
+  if (entry == 0)
+  {
+    sector = ((current != 0) && ((uint32_t)current < BOOT_RECORD_ADDRESS_1)) ? 1 : 0;
+    if (FLASH_EraseSector(RecordSector[sector], VoltageRange_3) != FLASH_COMPLETE)
+    {
+      return (1);
+    }
+
+    /* Lines of the erased sector may still be in the data cache */
+    if ((FLASH->ACR & FLASH_ACR_DCEN) != 0)
+    {
+      FLASH_DataCacheCmd(DISABLE);
+      FLASH_DataCacheReset();
+      FLASH_DataCacheCmd(ENABLE);
+    }
+    entry = (const BOOT_Record*)RecordAddress[sector];
+  }
+
+  /* Magic is written first: an entry cut by a reset is not blank anymore
+     and fails its Check */
+  for (i = 0; i < RECORD_WORDS; i++)
+  {
+    if (FLASH_ProgramWord((uint32_t)entry + i * 4, ((uint32_t*)Record)[i]) != FLASH_COMPLETE)
+    {
+      return (1);
+    }
+  }
+
+  return (RecordCheck(entry) == Record->Check) ? 0 : 1;
+}
+
+/**
+  * @brief  Gets the start address of an application slot
+  * @param  Slot: BOOT_SLOT_A or BOOT_SLOT_B
+  * @retval Slot address
+  */
+uint32_t BOOT_SlotAddress(uint32_t Slot)
+{
+  return (Slot == BOOT_SLOT_A) ? SLOT_A_ADDRESS : SLOT_B_ADDRESS;
+}
+
+/**
+  * @brief  Checks that a slot holds a vector table linked for this slot:
+  *         initial stack pointer in SRAM, reset handler inside the slot.
+  * @param  Slot: BOOT_SLOT_A or BOOT_SLOT_B
+  * @retval 1: the slot looks bootable, 0: otherwise
+  */
+uint32_t BOOT_IsValidImage(uint32_t Slot)
+{
+  uint32_t *vectors = (uint32_t *)BOOT_SlotAddress(Slot);
+
+  if ((vectors[0] <= SRAM_BASE) || (vectors[0] > (SRAM_BASE + 0x20000)))
+  {
+    return 0;
+  }
+  if ((vectors[1] < (uint32_t)vectors) || (vectors[1] >= ((uint32_t)vectors + SLOT_SIZE)))
+  {
+    return 0;
+  }
+  return 1;
+}
+
+/**
+  * @brief  Computes the CRC unit value over the image of a slot
+  * @note   The CRC unit clock must be enabled.
+  * @param  Slot: BOOT_SLOT_A or BOOT_SLOT_B
+  * @param  Size: image length in bytes, the last word is taken whole
+  * @retval CRC value
+  */
+uint32_t BOOT_ImageCrc(uint32_t Slot, uint32_t Size)
+{
+  CRC_ResetDR();
+  return CRC_CalcBlockCRC((uint32_t *)BOOT_SlotAddress(Slot), (Size + 3) / 4);
+}
+
+/**
+  * @brief  Computes the Check word of a record
+  * @param  Record: record to check
+  * @retval CRC unit value over all the words but Check
+  */
+static uint32_t RecordCheck(const BOOT_Record* Record)
+{
+  CRC_ResetDR();
+  return CRC_CalcBlockCRC((uint32_t *)Record, RECORD_WORDS - 1);
+}
+
+/**
+  * @brief  Scans both record sectors
+  * @param  Free: set to the first blank entry of the sector holding the
+  *         current record (of sector 0 if there is none), 0 if that sector
+  *         is full
+  * @retval Current record, 0 if there is none
+  */
+static const BOOT_Record* FindRecord(const BOOT_Record** Free)
+{
+  const BOOT_Record* current = 0;
+  const BOOT_Record* blank[2] = {0, 0};
+  const BOOT_Record* entry = 0;
+  uint32_t sector = 0, i = 0;
+
+  for (sector = 0; sector < 2; sector++)
+  {
+    entry = (const BOOT_Record*)RecordAddress[sector];
+    for (i = 0; i < RECORD_COUNT; i++, entry++)
+    {
+      if (entry->Magic == 0xFFFFFFFF)
+      {
+        blank[sector] = entry;
+        break;
+      }
+      if ((entry->Magic != BOOT_RECORD_MAGIC) || (entry->Check != RecordCheck(entry)))
+      {
+        continue;
+      }
+      if ((current == 0) || ((int32_t)(entry->Sequence - current->Sequence) > 0))
+      {
+        current = entry;
+      }
+    }
+  }
+
+  if ((current != 0) && ((uint32_t)current >= BOOT_RECORD_ADDRESS_1))
+  {
+    *Free = blank[1];
+  }
+  else
+  {
+    *Free = blank[0];
+  }
+  return current;
+}
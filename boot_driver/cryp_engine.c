@@ -0,0 +1,498 @@
+/**
+  ******************************************************************************
+  * @file    cryp_engine.c
+  * @brief   Streams, sessions and scheduler of the CRYP engine of
+  *          cryp_engine.h.
+  *
+  *          The context of a session is saved at the end of each slice:
+  *          the FIFOs are empty once CRYP_OUT is done, the IV registers are
+  *          read back into the session. CENG_Load() restores it, with the
+  *          key preparation CRYP_RestoreContext() leaves out for the AES
+  *          ECB and CBC decryption.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "dma_manager.h"
+#include "cryp_engine.h"
+
+/* Private define ------------------------------------------------------------*/
+/* Reads of the BUSY flag during the key preparation, as AESBUSY_TIMEOUT
+   of the library */
+#define CENG_BUSY_COUNT       0x00010000
+#define CENG_CR_CONFIG        (CRYP_CR_KEYSIZE | CRYP_CR_DATATYPE | CRYP_CR_ALGOMODE | CRYP_CR_ALGODIR)
+
+/* Private variables ---------------------------------------------------------*/
+static const DMAM_Stream* StreamIn = 0;
+static const DMAM_Stream* StreamOut = 0;
+/* Session the registers hold, session of the slice under way */
+static CENG_Session* Loaded = 0;
+static CENG_Session* Running = 0;
+/* Sessions waiting, by priority */
+static CENG_Session* Head = 0;
+/* Peripheral lent by CENG_Lock() */
+static uint32_t Locked = 0;
+
+/* Private function prototypes -----------------------------------------------*/
+static void CENG_Insert(CENG_Session* Session);
+static void CENG_Next(void);
+static void CENG_Slice(CENG_Session* Session);
+static uint32_t CENG_Load(CENG_Session* Session);
+static void CENG_End(uint32_t Status);
+static void CENG_Complete(CENG_Session* Session, uint32_t Status);
+static void CENG_DmaDone(void* Context, uint32_t Flags);
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Enables the CRYP and takes its two streams
+  * @param  None
+  * @retval CENG_OK or CENG_NO_STREAM
+  */
+uint32_t CENG_Init(void)
+{
+  NVIC_InitTypeDef NVIC_InitStructure;
+
+  RCC_AHB2PeriphClockCmd(RCC_AHB2Periph_CRYP, ENABLE);
+  if (StreamIn == 0)
+  {
+    StreamIn = DMAM_Alloc(DMAM_CRYP_IN, CENG_DmaDone, 0);
+  }
+  if (StreamOut == 0)
+  {
+    StreamOut = DMAM_Alloc(DMAM_CRYP_OUT, CENG_DmaDone, 0);
+  }
+  if ((StreamIn == 0) || (StreamOut == 0))
+  {
+    return CENG_NO_STREAM;
+  }
+
+  NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 1;
+  NVIC_InitStructure.NVIC_IRQChannelSubPriority = 2;
+  NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+  NVIC_InitStructure.NVIC_IRQChannel = StreamIn->IRQn;
+  NVIC_Init(&NVIC_InitStructure);
+  NVIC_InitStructure.NVIC_IRQChannel = StreamOut->IRQn;
+  NVIC_Init(&NVIC_InitStructure);
+  return CENG_OK;
+}
+
+/**
+  * @brief  Sets the mode, key and IV of a session that is not queued,
+  *         clears its statistics and gives it CENG_PRIORITY_BULK. Keys and
+  *         IV are big endian bytes, as for CRYP_AES_CBC().
+  * @param  Session: filled
+  * @param  AlgoMode: CRYP_AlgoMode_ of a cipher, not CRYP_AlgoMode_AES_Key
+  * @param  AlgoDir: CRYP_AlgoDir_Encrypt or CRYP_AlgoDir_Decrypt
+  * @param  Key: KeyBits / 8 bytes
+  * @param  KeyBits: 128, 192 or 256 for AES, 64 for DES, 192 for TDES
+  * @param  InitVector: block of the IV, 0 for ECB
+  * @retval CENG_OK or CENG_LENGTH for a key size the mode does not take
+  */
+uint32_t CENG_Setup(CENG_Session* Session, uint16_t AlgoMode, uint16_t AlgoDir,
+                    const uint8_t* Key, uint32_t KeyBits, const uint8_t* InitVector)
+{
+  uint32_t* key = &Session->Saved.CRYP_K0LR;
+  uint32_t* iv = &Session->Saved.CRYP_IV0LR;
+  uint32_t aes = (AlgoMode >= CRYP_AlgoMode_AES_ECB) ? 1 : 0;
+  uint32_t keysize = 0, first = 0, i = 0, word = 0;
+
+  if (aes != 0)
+  {
+    if ((KeyBits != 128) && (KeyBits != 192) && (KeyBits != 256))
+    {
+      return CENG_LENGTH;
+    }
+    keysize = (KeyBits == 128) ? CRYP_KeySize_128b : (KeyBits == 192) ? CRYP_KeySize_192b : CRYP_KeySize_256b;
+    first = 8 - KeyBits / 32;
+  }
+  else if (KeyBits != ((AlgoMode >= CRYP_AlgoMode_DES_ECB) ? 64u : 192u))
+  {
+    return CENG_LENGTH;
+  }
+  else
+  {
+    /* DES key in K1, TDES keys in K1 to K3 */
+    first = 2;
+  }
+
+  if (Loaded == Session)
+  {
+    Loaded = 0;
+  }
+  memset(Session, 0, sizeof(*Session));
+  Session->Saved.CR_bits9to2 = AlgoMode | AlgoDir | CRYP_DataType_8b | keysize;
+  Session->BlockBytes = (aes != 0) ? 16 : 8;
+  Session->Priority = CENG_PRIORITY_BULK;
+  for (i = 0; i < KeyBits / 32; i++)
+  {
+    memcpy(&word, &Key[i * 4], 4);
+    key[first + i] = __REV(word);
+  }
+  for (i = 0; (InitVector != 0) && (i < Session->BlockBytes / 4); i++)
+  {
+    memcpy(&word, &InitVector[i * 4], 4);
+    iv[i] = __REV(word);
+  }
+  return CENG_OK;
+}
+
+/**
+  * @brief  Queues a buffer of a session, the session goes on from the IV
+  *         of its last buffer
+  * @param  Session: from CENG_Setup()
+  * @param  Input: word aligned, kept until Done
+  * @param  Output: word aligned, may be Input
+  * @param  Length: bytes, whole blocks
+  * @param  Done: called from the CRYP_OUT interrupt, or before CENG_Run()
+  *         returns if the key preparation fails; may be 0
+  * @param  Context: given to Done
+  * @retval CENG_OK: queued, CENG_BUSY: the session has a buffer queued,
+  *         CENG_LENGTH or CENG_NO_STREAM
+  */
+uint32_t CENG_Run(CENG_Session* Session, const void* Input, void* Output, uint32_t Length,
+                  CENG_Callback Done, void* Context)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  if ((StreamIn == 0) || (StreamOut == 0))
+  {
+    return CENG_NO_STREAM;
+  }
+  if ((Length == 0) || ((Length % Session->BlockBytes) != 0) ||
+      ((((uint32_t)Input | (uint32_t)Output) & 3) != 0))
+  {
+    return CENG_LENGTH;
+  }
+
+  __disable_irq();
+  if (Session->Queued != 0)
+  {
+    __set_PRIMASK(primask);
+    return CENG_BUSY;
+  }
+  Session->Queued = 1;
+  Session->Input = (const uint8_t*)Input;
+  Session->Output = (uint8_t*)Output;
+  Session->Length = Length;
+  Session->Done = Done;
+  Session->DoneContext = Context;
+  Session->First = 1;
+  Session->Started = DWT->CYCCNT;
+  CENG_Insert(Session);
+  if ((Running == 0) && (Locked == 0))
+  {
+    CENG_Next();
+  }
+  __set_PRIMASK(primask);
+  return CENG_OK;
+}
+
+/**
+  * @brief  Whether a buffer of a session is queued or under way
+  * @param  Session: from CENG_Setup()
+  * @retval 0: idle, 1: busy
+  */
+uint32_t CENG_Busy(const CENG_Session* Session)
+{
+  return Session->Queued;
+}
+
+/**
+  * @brief  Sets the priority of a session, for its next CENG_Run()
+  * @param  Session: from CENG_Setup()
+  * @param  Priority: CENG_PRIORITY_COMMAND, CENG_PRIORITY_BULK or any
+  *         value, the lowest runs first
+  * @retval None
+  */
+void CENG_SetPriority(CENG_Session* Session, uint32_t Priority)
+{
+  Session->Priority = Priority;
+}
+
+/**
+  * @brief  Statistics of a session since CENG_Setup(). Bytes over Cycles
+  *         times SystemClocks.HCLK_Frequency is the throughput.
+  * @param  Session: from CENG_Setup()
+  * @param  Stats: filled
+  * @retval None
+  */
+void CENG_GetStats(const CENG_Session* Session, CENG_Stats* Stats)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  memcpy(Stats, &Session->Stats, sizeof(*Stats));
+  __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Lends the peripheral when no session is queued. The registers
+  *         are left to the caller until CENG_Unlock(), the next session
+  *         loads them again.
+  * @param  None
+  * @retval CENG_OK: peripheral lent, CENG_BUSY: a session is queued or it
+  *         is lent
+  */
+uint32_t CENG_Lock(void)
+{
+  uint32_t primask = __get_PRIMASK();
+  uint32_t status = CENG_BUSY;
+
+  __disable_irq();
+  if ((Head == 0) && (Running == 0) && (Locked == 0))
+  {
+    Loaded = 0;
+    Locked = 1;
+    status = CENG_OK;
+  }
+  __set_PRIMASK(primask);
+  return status;
+}
+
+/**
+  * @brief  Gives back the peripheral lent by CENG_Lock(), the sessions
+  *         queued meanwhile start
+  * @param  None
+  * @retval None
+  */
+void CENG_Unlock(void)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  CRYP->CR &= ~CRYP_CR_CRYPEN;
+  Locked = 0;
+  CENG_Next();
+  __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Puts a session in the queue after the sessions of its priority
+  *         and of the higher ones
+  * @param  Session: to queue
+  * @retval None
+  */
+static void CENG_Insert(CENG_Session* Session)
+{
+  CENG_Session** link = &Head;
+
+  while ((*link != 0) && ((*link)->Priority <= Session->Priority))
+  {
+    link = &(*link)->Next;
+  }
+  Session->Next = *link;
+  *link = Session;
+}
+
+/**
+  * @brief  Runs a slice of the first session of the queue, the peripheral
+  *         being idle
+  * @param  None
+  * @retval None
+  */
+static void CENG_Next(void)
+{
+  CENG_Session* session = 0;
+
+  while ((Head != 0) && (Running == 0) && (Locked == 0))
+  {
+    session = Head;
+    Head = session->Next;
+    session->Next = 0;
+    if ((Loaded == session) || (CENG_Load(session) == CENG_OK))
+    {
+      CENG_Slice(session);
+      return;
+    }
+    CENG_Complete(session, CENG_ERROR);
+  }
+}
+
+/**
+  * @brief  Starts the streams on the next slice of a loaded session
+  * @param  Session: session to run
+  * @retval None
+  */
+static void CENG_Slice(CENG_Session* Session)
+{
+  DMA_Stream_TypeDef* in = StreamIn->Stream;
+  DMA_Stream_TypeDef* out = StreamOut->Stream;
+  uint32_t now = DWT->CYCCNT;
+  uint32_t words = 0;
+
+  if (Session->First != 0)
+  {
+    Session->Stats.Waiting += now - Session->Started;
+    Session->First = 0;
+  }
+  Session->Started = now;
+  Session->Slice = (Session->Length < CENG_SLICE_BYTES) ? Session->Length : CENG_SLICE_BYTES;
+  words = Session->Slice / 4;
+  Running = Session;
+
+  DMAM_ClearFlags(StreamIn, DMAM_FLAG_ALL);
+  DMAM_ClearFlags(StreamOut, DMAM_FLAG_ALL);
+
+  out->CR = 0;
+  out->PAR = (uint32_t)&CRYP->DOUT;
+  out->M0AR = (uint32_t)Session->Output;
+  out->NDTR = words;
+  out->FCR = 0;
+  out->CR = StreamOut->Channel | DMA_DIR_PeripheralToMemory | DMA_MemoryInc_Enable |
+            DMA_PeripheralDataSize_Word | DMA_MemoryDataSize_Word | DMA_Priority_High |
+            DMA_SxCR_TCIE | DMA_SxCR_TEIE | DMA_SxCR_EN;
+
+  in->CR = 0;
+  in->PAR = (uint32_t)&CRYP->DR;
+  in->M0AR = (uint32_t)Session->Input;
+  in->NDTR = words;
+  in->FCR = 0;
+  in->CR = StreamIn->Channel | DMA_DIR_MemoryToPeripheral | DMA_MemoryInc_Enable |
+           DMA_PeripheralDataSize_Word | DMA_MemoryDataSize_Word | DMA_Priority_High |
+           DMA_SxCR_TEIE | DMA_SxCR_EN;
+
+  CRYP_DMACmd(CRYP_DMAReq_DataIN | CRYP_DMAReq_DataOUT, ENABLE);
+}
+
+/**
+  * @brief  Writes a session to the registers. An AES ECB or CBC decryption
+  *         prepares the decryption key from the key first.
+  * @param  Session: to load
+  * @retval CENG_OK or CENG_ERROR: the key preparation did not end
+  */
+static uint32_t CENG_Load(CENG_Session* Session)
+{
+  const CRYP_Context* saved = &Session->Saved;
+  uint32_t mode = saved->CR_bits9to2 & CRYP_CR_ALGOMODE;
+  uint32_t counter = 0;
+
+  Loaded = 0;
+  CRYP->CR &= ~CRYP_CR_CRYPEN;
+  CRYP->K0LR = saved->CRYP_K0LR;
+  CRYP->K0RR = saved->CRYP_K0RR;
+  CRYP->K1LR = saved->CRYP_K1LR;
+  CRYP->K1RR = saved->CRYP_K1RR;
+  CRYP->K2LR = saved->CRYP_K2LR;
+  CRYP->K2RR = saved->CRYP_K2RR;
+  CRYP->K3LR = saved->CRYP_K3LR;
+  CRYP->K3RR = saved->CRYP_K3RR;
+
+  if (((saved->CR_bits9to2 & CRYP_CR_ALGODIR) == CRYP_AlgoDir_Decrypt) &&
+      ((mode == CRYP_AlgoMode_AES_ECB) || (mode == CRYP_AlgoMode_AES_CBC)))
+  {
+    CRYP->CR = (saved->CR_bits9to2 & (CRYP_CR_KEYSIZE | CRYP_CR_DATATYPE)) |
+               CRYP_AlgoMode_AES_Key | CRYP_AlgoDir_Decrypt;
+    CRYP->CR |= CRYP_CR_CRYPEN;
+    while ((CRYP->SR & CRYP_SR_BUSY) != 0)
+    {
+      if (++counter == CENG_BUSY_COUNT)
+      {
+        CRYP->CR &= ~CRYP_CR_CRYPEN;
+        return CENG_ERROR;
+      }
+    }
+    CRYP->CR &= ~CRYP_CR_CRYPEN;
+  }
+
+  CRYP->CR = saved->CR_bits9to2 & CENG_CR_CONFIG;
+  CRYP->IV0LR = saved->CRYP_IV0LR;
+  CRYP->IV0RR = saved->CRYP_IV0RR;
+  CRYP->IV1LR = saved->CRYP_IV1LR;
+  CRYP->IV1RR = saved->CRYP_IV1RR;
+  CRYP_FIFOFlush();
+  CRYP->CR |= CRYP_CR_CRYPEN;
+  Loaded = Session;
+  return CENG_OK;
+}
+
+/**
+  * @brief  Ends the slice under way: saves the context of the session,
+  *         queues it again if some of its buffer is left and runs the
+  *         first session of the queue
+  * @param  Status: CENG_OK or CENG_ERROR
+  * @retval None
+  */
+static void CENG_End(uint32_t Status)
+{
+  CENG_Session* session = Running;
+
+  CRYP_DMACmd(CRYP_DMAReq_DataIN | CRYP_DMAReq_DataOUT, DISABLE);
+  Running = 0;
+  if (Status != CENG_OK)
+  {
+    /* Blocks of the slice may be left in the FIFOs */
+    DMA_Cmd(StreamIn->Stream, DISABLE);
+    DMA_Cmd(StreamOut->Stream, DISABLE);
+    CRYP->CR &= ~CRYP_CR_CRYPEN;
+    Loaded = 0;
+    CENG_Complete(session, Status);
+  }
+  else
+  {
+    session->Saved.CRYP_IV0LR = CRYP->IV0LR;
+    session->Saved.CRYP_IV0RR = CRYP->IV0RR;
+    session->Saved.CRYP_IV1LR = CRYP->IV1LR;
+    session->Saved.CRYP_IV1RR = CRYP->IV1RR;
+    session->Stats.Cycles += DWT->CYCCNT - session->Started;
+    session->Stats.Bytes += session->Slice;
+    session->Stats.Slices++;
+    session->Input += session->Slice;
+    session->Output += session->Slice;
+    session->Length -= session->Slice;
+    if (session->Length != 0)
+    {
+      CENG_Insert(session);
+    }
+    else
+    {
+      session->Stats.Runs++;
+      CENG_Complete(session, CENG_OK);
+    }
+  }
+  if (Running == 0)
+  {
+    CENG_Next();
+  }
+}
+
+/**
+  * @brief  Takes the buffer of a session as done and calls back. A buffer
+  *         queued by the callback may start a slice.
+  * @param  Session: out of the queue
+  * @param  Status: CENG_OK or CENG_ERROR
+  * @retval None
+  */
+static void CENG_Complete(CENG_Session* Session, uint32_t Status)
+{
+  Session->Queued = 0;
+  if (Session->Done != 0)
+  {
+    Session->Done(Session->DoneContext, Status);
+  }
+}
+
+/**
+  * @brief  CRYP_IN and CRYP_OUT stream interrupts: the end of CRYP_OUT ends
+  *         the run, a transfer error on either one too
+  * @param  Context: not used
+  * @param  Flags: DMAM_FLAG_ bits
+  * @retval None
+  */
+static void CENG_DmaDone(void* Context, uint32_t Flags)
+{
+  (void)Context;
+  if (Running == 0)
+  {
+    return;
+  }
+  if ((Flags & DMAM_FLAG_TE) != 0)
+  {
+    CENG_End(CENG_ERROR);
+  }
+  else if ((Flags & DMAM_FLAG_TC) != 0)
+  {
+    CENG_End(CENG_OK);
+  }
+}
@@ -0,0 +1,373 @@
+/**
+  ******************************************************************************
+  * @file    delta_flash.c
+  * @brief   Streaming patcher rebuilding a new image in flash from the
+  *          resident image and a delta stream made by tools/delta_diff.py.
+  *
+  *          The new image is written to the download slot while the
+  *          resident image is read from the running one, so a reset during
+  *          the update leaves the running image untouched. The stream can be
+  *          fed in pieces of any length. The flash area must be erased and
+  *          unlocked. tools/sim/delta_check runs this file on the host.
+  *
+  *          A COPY of a few stream bytes may stand for the whole image: it
+  *          is expanded DELTA_COPY_MAX bytes per call, so that a call
+  *          programs about as much as an IAP_DL_BLOCK_SIZE block of a plain
+  *          download. The caller calls again with no data while
+  *          DELTA_Pending() says there is work left.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "delta_flash.h"
+#include "flash_if.h"
+
+/* Private typedef -----------------------------------------------------------*/
+enum
+{
+  DELTA_OP = 0,
+  DELTA_LEN,
+  DELTA_SEEK,
+  DELTA_BYTES,
+  DELTA_COPY,
+};
+
+/* Private define ------------------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+#define WINDOW_BYTES(p)       ((uint8_t*)(p)->Window)
+
+/* Private variables ---------------------------------------------------------*/
+/* Private function prototypes -----------------------------------------------*/
+static uint32_t DELTA_Run(DELTA_Patch* Patch, const uint8_t* In, uint32_t Length, uint32_t* Budget);
+static uint32_t DELTA_Varint(DELTA_Patch* Patch, uint32_t* Value, uint8_t Data);
+static void DELTA_Start(DELTA_Patch* Patch);
+static void DELTA_Copy(DELTA_Patch* Patch, uint32_t* Budget);
+static void DELTA_Put(DELTA_Patch* Patch, uint8_t Data);
+static void DELTA_Flush(DELTA_Patch* Patch);
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Prepares a patcher
+  * @param  Patch: patcher
+  * @param  Base: flash address the new image is written to
+  * @param  Size: new image length in bytes
+  * @param  Old: flash address of the resident image
+  * @param  OldSize: resident image length in bytes
+  * @param  Output: called with the new bytes before they are programmed,
+  *         0 if not needed
+  * @retval None
+  */
+void DELTA_Init(DELTA_Patch* Patch, uint32_t Base, uint32_t Size, uint32_t Old, uint32_t OldSize,
+                FLASH_If_Output Output)
+{
+  Patch->State = DELTA_OP;
+  Patch->Op = 0;
+  Patch->Len = 0;
+  Patch->Seek = 0;
+  Patch->Shift = 0;
+  Patch->Old = Old;
+  Patch->OldSize = OldSize;
+  Patch->OldPos = 0;
+  Patch->Size = Size;
+  Patch->Out = 0;
+  Patch->Flushed = 0;
+  Patch->Error = 0;
+  Patch->Held = 0;
+  Patch->Output = Output;
+  Patch->Address = Base;
+}
+
+/**
+  * @brief  Applies a piece of the delta stream: the bytes held first, then
+  *         In. What follows a COPY left unfinished is held.
+  * @param  Patch: patcher
+  * @param  In: delta bytes
+  * @param  Length: number of delta bytes, 0 to go on with the work left
+  * @retval 0: no error so far, 1: corrupted stream, flash error or more
+  *         than DELTA_HOLD_SIZE bytes to hold
+  */
+uint32_t DELTA_Apply(DELTA_Patch* Patch, const uint8_t* In, uint32_t Length)
+{
+  uint32_t budget = DELTA_COPY_MAX;
+  uint32_t used = 0;
+
+  if (Patch->Held != 0)
+  {
+    used = DELTA_Run(Patch, Patch->Hold, Patch->Held, &budget);
+    Patch->Held -= used;
+    memmove(Patch->Hold, Patch->Hold + used, Patch->Held);
+  }
+  if (Patch->Held == 0)
+  {
+    used = DELTA_Run(Patch, In, Length, &budget);
+    In += used;
+    Length -= used;
+  }
+
+  if (Length > DELTA_HOLD_SIZE - Patch->Held)
+  {
+    Patch->Error = 1;
+  }
+  if (Patch->Error == 0)
+  {
+    memcpy(Patch->Hold + Patch->Held, In, Length);
+    Patch->Held += Length;
+  }
+
+  return Patch->Error;
+}
+
+/**
+  * @brief  Tells whether DELTA_Apply() has work left without new data
+  * @param  Patch: patcher
+  * @retval 1: a COPY is unfinished or stream bytes are held, 0: otherwise
+  */
+uint32_t DELTA_Pending(const DELTA_Patch* Patch)
+{
+  return ((Patch->Error == 0) && ((Patch->Held != 0) || (Patch->State == DELTA_COPY))) ? 1 : 0;
+}
+
+/**
+  * @brief  Ends the stream: checks it stopped between two operations with
+  *         the expected length, and programs the rest of the window (the
+  *         last word is padded with 0xFF)
+  * @param  Patch: patcher
+  * @retval 0: image completely rebuilt, 1: error
+  */
+uint32_t DELTA_Finish(DELTA_Patch* Patch)
+{
+  if ((Patch->Error == 0) && (Patch->Out == Patch->Size) && (Patch->State == DELTA_OP) &&
+      (Patch->Held == 0))
+  {
+    DELTA_Flush(Patch);
+    return Patch->Error;
+  }
+  return (1);
+}
+
+/**
+  * @brief  Parses delta bytes until they are all used or a COPY is left
+  *         unfinished
+  * @param  Patch: patcher
+  * @param  In: delta bytes
+  * @param  Length: number of delta bytes
+  * @param  Budget: COPY bytes that may still be expanded, updated
+  * @retval Number of delta bytes used
+  */
+static uint32_t DELTA_Run(DELTA_Patch* Patch, const uint8_t* In, uint32_t Length, uint32_t* Budget)
+{
+  uint32_t i = 0;
+  uint8_t c = 0;
+
+  while (Patch->Error == 0)
+  {
+    if (Patch->State == DELTA_COPY)
+    {
+      DELTA_Copy(Patch, Budget);
+      if (Patch->Len != 0)
+      {
+        break;
+      }
+      Patch->State = DELTA_OP;
+    }
+    if (i == Length)
+    {
+      break;
+    }
+    c = In[i++];
+
+    switch (Patch->State)
+    {
+      case DELTA_OP:
+        if (c > DELTA_OP_DATA)
+        {
+          Patch->Error = 1;
+          break;
+        }
+        Patch->Op = c;
+        Patch->Len = 0;
+        Patch->Seek = 0;
+        Patch->Shift = 0;
+        Patch->State = DELTA_LEN;
+        break;
+
+      case DELTA_LEN:
+        if (DELTA_Varint(Patch, &Patch->Len, c) == 0)
+        {
+          break;
+        }
+        if (Patch->Op == DELTA_OP_DATA)
+        {
+          Patch->State = (Patch->Len != 0) ? DELTA_BYTES : DELTA_OP;
+        }
+        else
+        {
+          Patch->State = DELTA_SEEK;
+        }
+        break;
+
+      case DELTA_SEEK:
+        if (DELTA_Varint(Patch, &Patch->Seek, c) != 0)
+        {
+          DELTA_Start(Patch);
+        }
+        break;
+
+      case DELTA_BYTES:
+        if (Patch->Op == DELTA_OP_ADD)
+        {
+          c += *(__IO uint8_t*)(Patch->Old + Patch->OldPos);
+          Patch->OldPos++;
+        }
+        DELTA_Put(Patch, c);
+        if (--Patch->Len == 0)
+        {
+          Patch->State = DELTA_OP;
+        }
+        break;
+
+      default:
+        Patch->Error = 1;
+        break;
+    }
+  }
+
+  return i;
+}
+
+/**
+  * @brief  Adds a byte to a varint being received
+  * @param  Patch: patcher
+  * @param  Value: varint
+  * @param  Data: received byte
+  * @retval 1: the varint is complete, 0: more bytes follow
+  */
+static uint32_t DELTA_Varint(DELTA_Patch* Patch, uint32_t* Value, uint8_t Data)
+{
+  if (Patch->Shift > 28)
+  {
+    Patch->Error = 1;
+    return (0);
+  }
+
+  *Value |= (uint32_t)(Data & 0x7F) << Patch->Shift;
+  Patch->Shift += 7;
+  if ((Data & 0x80) != 0)
+  {
+    return (0);
+  }
+
+  Patch->Shift = 0;
+  return (1);
+}
+
+/**
+  * @brief  Moves the old image position and checks the range an ADD or
+  *         COPY operation reads
+  * @param  Patch: patcher
+  * @retval None
+  */
+static void DELTA_Start(DELTA_Patch* Patch)
+{
+  /* Zigzag: 0, -1, 1, -2, ... */
+  int32_t seek = (int32_t)(Patch->Seek >> 1) ^ -(int32_t)(Patch->Seek & 1);
+  uint32_t pos = Patch->OldPos + (uint32_t)seek;
+
+  if ((pos > Patch->OldSize) || (Patch->Len > (Patch->OldSize - pos)))
+  {
+    Patch->Error = 1;
+    return;
+  }
+  Patch->OldPos = pos;
+
+  if (Patch->Len == 0)
+  {
+    Patch->State = DELTA_OP;
+  }
+  else if (Patch->Op == DELTA_OP_ADD)
+  {
+    Patch->State = DELTA_BYTES;
+  }
+  else
+  {
+    Patch->State = DELTA_COPY;
+  }
+}
+
+/**
+  * @brief  Copies bytes of the resident image, Len of them or what the
+  *         budget allows
+  * @param  Patch: patcher
+  * @param  Budget: COPY bytes that may still be expanded, updated
+  * @retval None
+  */
+static void DELTA_Copy(DELTA_Patch* Patch, uint32_t* Budget)
+{
+  const __IO uint8_t* src = (const __IO uint8_t*)(Patch->Old + Patch->OldPos);
+  uint32_t length = (Patch->Len < *Budget) ? Patch->Len : *Budget;
+
+  Patch->OldPos += length;
+  Patch->Len -= length;
+  *Budget -= length;
+  while ((length != 0) && (Patch->Error == 0))
+  {
+    DELTA_Put(Patch, *src++);
+    length--;
+  }
+}
+
+/**
+  * @brief  Appends a new byte, programs the window when it is full
+  * @param  Patch: patcher
+  * @param  Data: new byte
+  * @retval None
+  */
+static void DELTA_Put(DELTA_Patch* Patch, uint8_t Data)
+{
+  if (Patch->Out >= Patch->Size)
+  {
+    Patch->Error = 1;
+    return;
+  }
+
+  WINDOW_BYTES(Patch)[Patch->Out - Patch->Flushed] = Data;
+  Patch->Out++;
+
+  if ((Patch->Out - Patch->Flushed) == DELTA_WINDOW_SIZE)
+  {
+    DELTA_Flush(Patch);
+  }
+}
+
+/**
+  * @brief  Programs the bytes gathered in the window
+  * @param  Patch: patcher
+  * @retval None
+  */
+static void DELTA_Flush(DELTA_Patch* Patch)
+{
+  uint32_t length = Patch->Out - Patch->Flushed;
+
+  if (length == 0)
+  {
+    return;
+  }
+
+  if (Patch->Output != 0)
+  {
+    Patch->Output(WINDOW_BYTES(Patch), length);
+  }
+
+  while ((length & 3) != 0)
+  {
+    WINDOW_BYTES(Patch)[length++] = 0xFF;
+  }
+
+  if (FLASH_If_WriteBlock(&Patch->Address, Patch->Window, length / 4) != 0)
+  {
+    Patch->Error = 1;
+  }
+  Patch->Flushed = Patch->Out;
+}
@@ -0,0 +1,231 @@
+/**
+  ******************************************************************************
+  * @file    dma_manager.c
+  * @brief   Stream allocation and interrupt dispatch of dma_manager.h.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "dma_manager.h"
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  DMAM_Stream Public;
+  DMAM_Callback Callback;
+  void* Context;
+} DMAM_Owner;
+
+/* Private define ------------------------------------------------------------*/
+#define DMAM_STREAMS          16
+#define DMAM_CANDIDATES       8
+/* Stream index 0 to 15 and channel of a request mapping entry */
+#define DMAM_MAP(Dma, Stream, Channel)  ((uint8_t)(((((Dma) - 1) * 8 + (Stream)) << 3) | (Channel)))
+#define DMAM_END              0xFF
+
+/* Private variables ---------------------------------------------------------*/
+/* RM0033 tables 22 and 23, the streams tried in order. USART1_RX takes
+   stream 2 first: stream 5 is the only one of CRYP_OUT. */
+static const uint8_t Mapping[DMAM_REQUEST_COUNT][DMAM_CANDIDATES] =
+{
+  {DMAM_MAP(2, 2, 4), DMAM_MAP(2, 5, 4), DMAM_END},     /* DMAM_USART1_RX */
+  {DMAM_MAP(2, 7, 4), DMAM_END},                        /* DMAM_USART1_TX */
+  {DMAM_MAP(1, 5, 4), DMAM_END},                        /* DMAM_USART2_RX */
+  {DMAM_MAP(1, 6, 4), DMAM_END},                        /* DMAM_USART2_TX */
+  {DMAM_MAP(1, 1, 4), DMAM_END},                        /* DMAM_USART3_RX */
+  {DMAM_MAP(1, 3, 4), DMAM_MAP(1, 4, 7), DMAM_END},     /* DMAM_USART3_TX */
+  {DMAM_MAP(2, 1, 5), DMAM_MAP(2, 2, 5), DMAM_END},     /* DMAM_USART6_RX */
+  {DMAM_MAP(2, 6, 5), DMAM_MAP(2, 7, 5), DMAM_END},     /* DMAM_USART6_TX */
+  {DMAM_MAP(2, 0, 3), DMAM_MAP(2, 2, 3), DMAM_END},     /* DMAM_SPI1_RX */
+  {DMAM_MAP(2, 3, 3), DMAM_MAP(2, 5, 3), DMAM_END},     /* DMAM_SPI1_TX */
+  {DMAM_MAP(1, 3, 0), DMAM_END},                        /* DMAM_SPI2_RX */
+  {DMAM_MAP(1, 4, 0), DMAM_END},                        /* DMAM_SPI2_TX */
+  {DMAM_MAP(2, 0, 0), DMAM_MAP(2, 4, 0), DMAM_END},     /* DMAM_ADC1 */
+  {DMAM_MAP(2, 7, 2), DMAM_END},                        /* DMAM_HASH_IN */
+  {DMAM_MAP(2, 6, 2), DMAM_END},                        /* DMAM_CRYP_IN */
+  {DMAM_MAP(2, 5, 2), DMAM_END},                        /* DMAM_CRYP_OUT */
+  /* DMAM_MEM: the streams wanted by the fewest requests above first */
+  {DMAM_MAP(2, 1, 0), DMAM_MAP(2, 4, 0), DMAM_MAP(2, 3, 0), DMAM_MAP(2, 0, 0),
+   DMAM_MAP(2, 6, 0), DMAM_MAP(2, 2, 0), DMAM_MAP(2, 5, 0), DMAM_MAP(2, 7, 0)},
+};
+
+static DMA_Stream_TypeDef* const Streams[DMAM_STREAMS] =
+{
+  DMA1_Stream0, DMA1_Stream1, DMA1_Stream2, DMA1_Stream3,
+  DMA1_Stream4, DMA1_Stream5, DMA1_Stream6, DMA1_Stream7,
+  DMA2_Stream0, DMA2_Stream1, DMA2_Stream2, DMA2_Stream3,
+  DMA2_Stream4, DMA2_Stream5, DMA2_Stream6, DMA2_Stream7,
+};
+
+static const IRQn_Type StreamIRQn[DMAM_STREAMS] =
+{
+  DMA1_Stream0_IRQn, DMA1_Stream1_IRQn, DMA1_Stream2_IRQn, DMA1_Stream3_IRQn,
+  DMA1_Stream4_IRQn, DMA1_Stream5_IRQn, DMA1_Stream6_IRQn, DMA1_Stream7_IRQn,
+  DMA2_Stream0_IRQn, DMA2_Stream1_IRQn, DMA2_Stream2_IRQn, DMA2_Stream3_IRQn,
+  DMA2_Stream4_IRQn, DMA2_Stream5_IRQn, DMA2_Stream6_IRQn, DMA2_Stream7_IRQn,
+};
+
+/* Place of the flags of streams 0 to 3 in LISR, 4 to 7 in HISR */
+static const uint8_t FlagShift[4] = {0, 6, 16, 22};
+
+static DMAM_Owner Owners[DMAM_STREAMS];
+static DMAM_Usage Stats;
+
+/* Private function prototypes -----------------------------------------------*/
+static void DMAM_Dispatch(uint32_t Index);
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Takes the first free stream able to serve a request and enables
+  *         the clock of its controller. The stream is left as it was:
+  *         DMA_DeInit() and DMA_Init() it with DMAM_Stream.Channel.
+  * @param  Request: peripheral and direction
+  * @param  Callback: called from the stream interrupt, may be 0
+  * @param  Context: given to the callback
+  * @retval The stream, 0 if every stream of the request is taken
+  */
+const DMAM_Stream* DMAM_Alloc(DMAM_Request Request, DMAM_Callback Callback, void* Context)
+{
+  const uint8_t* map = Mapping[Request];
+  DMAM_Owner* owner = 0;
+  uint32_t primask = __get_PRIMASK();
+  uint32_t i = 0, index = 0;
+
+  __disable_irq();
+  for (i = 0; (i < DMAM_CANDIDATES) && (map[i] != DMAM_END); i++)
+  {
+    index = map[i] >> 3;
+    if ((Stats.Allocated & (1u << index)) == 0)
+    {
+      Stats.Allocated |= 1u << index;
+      owner = &Owners[index];
+      break;
+    }
+  }
+  if (owner == 0)
+  {
+    Stats.Refused++;
+  }
+  __set_PRIMASK(primask);
+
+  if (owner == 0)
+  {
+    return 0;
+  }
+  owner->Public.Stream = Streams[index];
+  owner->Public.Channel = (uint32_t)(map[i] & 7) << 25;
+  owner->Public.IRQn = StreamIRQn[index];
+  owner->Public.Request = Request;
+  owner->Callback = Callback;
+  owner->Context = Context;
+  RCC_AHB1PeriphClockCmd((index < 8) ? RCC_AHB1Periph_DMA1 : RCC_AHB1Periph_DMA2, ENABLE);
+  return &owner->Public;
+}
+
+/**
+  * @brief  Stops a stream and its interrupt and gives it back
+  * @param  Stream: from DMAM_Alloc()
+  * @retval None
+  */
+void DMAM_Free(const DMAM_Stream* Stream)
+{
+  uint32_t index = (uint32_t)((const DMAM_Owner*)Stream - Owners);
+  uint32_t primask = __get_PRIMASK();
+
+  NVIC_DisableIRQ(Stream->IRQn);
+  DMA_Cmd(Stream->Stream, DISABLE);
+  while (DMA_GetCmdStatus(Stream->Stream) != DISABLE);
+  DMAM_ClearFlags(Stream, DMAM_FLAG_ALL);
+  Owners[index].Callback = 0;
+
+  __disable_irq();
+  Stats.Allocated &= ~(1u << index);
+  __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Flags of a stream
+  * @param  Stream: from DMAM_Alloc()
+  * @retval DMAM_FLAG_ bits
+  */
+uint32_t DMAM_GetFlags(const DMAM_Stream* Stream)
+{
+  uint32_t index = (uint32_t)((const DMAM_Owner*)Stream - Owners);
+  DMA_TypeDef* dma = (index < 8) ? DMA1 : DMA2;
+  uint32_t status = ((index & 4) != 0) ? dma->HISR : dma->LISR;
+
+  return (status >> FlagShift[index & 3]) & DMAM_FLAG_ALL;
+}
+
+/**
+  * @brief  Clears flags of a stream
+  * @param  Stream: from DMAM_Alloc()
+  * @param  Flags: DMAM_FLAG_ bits
+  * @retval None
+  */
+void DMAM_ClearFlags(const DMAM_Stream* Stream, uint32_t Flags)
+{
+  uint32_t index = (uint32_t)((const DMAM_Owner*)Stream - Owners);
+  DMA_TypeDef* dma = (index < 8) ? DMA1 : DMA2;
+  uint32_t clear = (Flags & DMAM_FLAG_ALL) << FlagShift[index & 3];
+
+  if ((index & 4) != 0)
+  {
+    dma->HIFCR = clear;
+  }
+  else
+  {
+    dma->LIFCR = clear;
+  }
+}
+
+/**
+  * @brief  Streams taken, allocations refused and interrupts per stream
+  * @param  Usage: filled
+  * @retval None
+  */
+void DMAM_GetUsage(DMAM_Usage* Usage)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  memcpy(Usage, &Stats, sizeof(Stats));
+  __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Stream interrupt: clears the flags and calls the owner
+  * @param  Index: stream, DMA1 streams 0 to 7 then DMA2
+  * @retval None
+  */
+static void DMAM_Dispatch(uint32_t Index)
+{
+  DMAM_Owner* owner = &Owners[Index];
+  uint32_t flags = DMAM_GetFlags(&owner->Public);
+
+  DMAM_ClearFlags(&owner->Public, flags);
+  Stats.Interrupts[Index]++;
+  if (owner->Callback != 0)
+  {
+    owner->Callback(owner->Context, flags);
+  }
+}
+
+void DMA1_Stream0_IRQHandler(void) { DMAM_Dispatch(0); }
+void DMA1_Stream1_IRQHandler(void) { DMAM_Dispatch(1); }
+void DMA1_Stream2_IRQHandler(void) { DMAM_Dispatch(2); }
+void DMA1_Stream3_IRQHandler(void) { DMAM_Dispatch(3); }
+void DMA1_Stream4_IRQHandler(void) { DMAM_Dispatch(4); }
+void DMA1_Stream5_IRQHandler(void) { DMAM_Dispatch(5); }
+void DMA1_Stream6_IRQHandler(void) { DMAM_Dispatch(6); }
+void DMA1_Stream7_IRQHandler(void) { DMAM_Dispatch(7); }
+void DMA2_Stream0_IRQHandler(void) { DMAM_Dispatch(8); }
+void DMA2_Stream1_IRQHandler(void) { DMAM_Dispatch(9); }
+void DMA2_Stream2_IRQHandler(void) { DMAM_Dispatch(10); }
+void DMA2_Stream3_IRQHandler(void) { DMAM_Dispatch(11); }
+void DMA2_Stream4_IRQHandler(void) { DMAM_Dispatch(12); }
+void DMA2_Stream5_IRQHandler(void) { DMAM_Dispatch(13); }
+void DMA2_Stream6_IRQHandler(void) { DMAM_Dispatch(14); }
+void DMA2_Stream7_IRQHandler(void) { DMAM_Dispatch(15); }
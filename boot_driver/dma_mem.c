@@ -0,0 +1,294 @@
+/**
+  ******************************************************************************
+  * @file    dma_mem.c
+  * @brief   Copy and fill engine of dma_mem.h on the DMAM_MEM stream.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "dma_manager.h"
+#include "dma_mem.h"
+
+/* Private define ------------------------------------------------------------*/
+#define DMEM_MAX_WORDS        0xFFFF    /* NDTR */
+/* Memory to memory, words, FIFO full threshold: a burst of 4 words */
+#define DMEM_CR               (DMA_DIR_MemoryToMemory | DMA_MemoryInc_Enable | \
+                               DMA_PeripheralDataSize_Word | DMA_MemoryDataSize_Word | \
+                               DMA_Priority_Low | DMA_SxCR_TCIE | DMA_SxCR_TEIE)
+#define DMEM_BURST            (DMA_MemoryBurst_INC4 | DMA_PeripheralBurst_INC4)
+#define DMEM_FCR              (DMA_SxFCR_DMDIS | DMA_FIFOThreshold_Full)
+/* Words the processor copies for the measure of the threshold */
+#define DMEM_CAL_WORDS        32
+/* Reads of the stream flags before the measure gives up */
+#define DMEM_CAL_TIMEOUT      0x1000
+
+/* Private variables ---------------------------------------------------------*/
+static const DMAM_Stream* Stream = 0;
+static uint32_t Threshold = DMEM_THRESHOLD;
+static volatile DMEM_Callback Pending = 0;
+static void* PendingContext = 0;
+/* Source of DMEM_Fill(), read again for every word */
+static uint32_t FillWord = 0;
+/* Blocks of the measure of the threshold */
+static uint32_t CalSource[DMEM_CAL_WORDS];
+static uint32_t CalDestination[DMEM_CAL_WORDS];
+
+/* Private function prototypes -----------------------------------------------*/
+static void DMEM_Start(uint32_t Source, uint32_t Inc, uint8_t* Destination, uint32_t Words,
+                       DMEM_Callback Callback, void* Context);
+static void DMEM_Finished(void* Context, uint32_t Flags);
+static uint32_t DMEM_Calibrate(void);
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Takes a DMA2 stream for the copies, measures the threshold on it
+  *         and enables its interrupt. Without it the copies are done by the
+  *         processor.
+  * @param  None
+  * @retval 0: stream taken, 1: no stream free
+  */
+uint32_t DMEM_Init(void)
+{
+  NVIC_InitTypeDef NVIC_InitStructure;
+
+  if (Stream != 0)
+  {
+    return 0;
+  }
+  Stream = DMAM_Alloc(DMAM_MEM, DMEM_Finished, 0);
+  if (Stream == 0)
+  {
+    return 1;
+  }
+  Threshold = DMEM_Calibrate();
+
+  /* The measure ended with TCIF set, the line may be pending */
+  NVIC_ClearPendingIRQ(Stream->IRQn);
+  NVIC_InitStructure.NVIC_IRQChannel = Stream->IRQn;
+  NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 1;
+  NVIC_InitStructure.NVIC_IRQChannelSubPriority = 2;
+  NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+  NVIC_Init(&NVIC_InitStructure);
+  return 0;
+}
+
+/**
+  * @brief  Copies a block, the two may not overlap. Neither may be used
+  *         before the callback.
+  * @param  Destination: first byte written
+  * @param  Source: first byte read
+  * @param  Length: bytes
+  * @param  Done: called at the end, may be 0
+  * @param  Context: given to Done
+  * @retval 0: started or done, 1: busy with the last transfer, nothing done
+  */
+uint32_t DMEM_Copy(void* Destination, const void* Source, uint32_t Length,
+                   DMEM_Callback Done, void* Context)
+{
+  uint8_t* destination = (uint8_t*)Destination;
+  const uint8_t* source = (const uint8_t*)Source;
+  uint32_t head = (0u - (uint32_t)destination) & 3;
+
+  if ((Stream == 0) || (Length < Threshold) || (Length < head + 4) ||
+      ((((uint32_t)destination ^ (uint32_t)source) & 3) != 0) ||
+      ((Length - head) / 4 > DMEM_MAX_WORDS))
+  {
+    memcpy(destination, source, Length);
+    if (Done != 0)
+    {
+      Done(Context, 0);
+    }
+    return 0;
+  }
+  if (DMEM_Busy() != 0)
+  {
+    return 1;
+  }
+
+  memcpy(destination, source, head);
+  destination += head;
+  source += head;
+  Length -= head;
+  memcpy(destination + (Length & ~3u), source + (Length & ~3u), Length & 3);
+
+  DMEM_Start((uint32_t)source, DMA_PeripheralInc_Enable, destination, Length / 4, Done, Context);
+  return 0;
+}
+
+/**
+  * @brief  Sets every byte of a block to a value. The block may not be
+  *         used before the callback.
+  * @param  Destination: first byte written
+  * @param  Value: byte written
+  * @param  Length: bytes
+  * @param  Done: called at the end, may be 0
+  * @param  Context: given to Done
+  * @retval 0: started or done, 1: busy with the last transfer, nothing done
+  */
+uint32_t DMEM_Fill(void* Destination, uint8_t Value, uint32_t Length,
+                   DMEM_Callback Done, void* Context)
+{
+  uint8_t* destination = (uint8_t*)Destination;
+  uint32_t head = (0u - (uint32_t)destination) & 3;
+
+  if ((Stream == 0) || (Length < Threshold) || (Length < head + 4) ||
+      ((Length - head) / 4 > DMEM_MAX_WORDS))
+  {
+    memset(destination, Value, Length);
+    if (Done != 0)
+    {
+      Done(Context, 0);
+    }
+    return 0;
+  }
+  if (DMEM_Busy() != 0)
+  {
+    return 1;
+  }
+
+  memset(destination, Value, head);
+  destination += head;
+  Length -= head;
+  memset(destination + (Length & ~3u), Value, Length & 3);
+
+  FillWord = Value * 0x01010101u;
+  DMEM_Start((uint32_t)&FillWord, DMA_PeripheralInc_Disable, destination, Length / 4, Done, Context);
+  return 0;
+}
+
+/**
+  * @brief  Whether a transfer runs or its callback has not been called yet
+  * @param  None
+  * @retval 0: idle, 1: busy
+  */
+uint32_t DMEM_Busy(void)
+{
+  if (Stream == 0)
+  {
+    return 0;
+  }
+  if ((Stream->Stream->CR & DMA_SxCR_EN) != 0)
+  {
+    return 1;
+  }
+  /* Ended, the interrupt has not run: masked or of lower priority */
+  return ((DMAM_GetFlags(Stream) & (DMAM_FLAG_TC | DMAM_FLAG_TE)) != 0) ? 1 : 0;
+}
+
+/**
+  * @brief  Sets the size under which the processor copies
+  * @param  Bytes: 0 to give every block the stream can take to the stream
+  * @retval None
+  */
+void DMEM_SetThreshold(uint32_t Bytes)
+{
+  Threshold = Bytes;
+}
+
+/**
+  * @brief  Size under which the processor copies
+  * @param  None
+  * @retval Bytes, measured by DMEM_Init() or set by DMEM_SetThreshold()
+  */
+uint32_t DMEM_GetThreshold(void)
+{
+  return Threshold;
+}
+
+/**
+  * @brief  Starts the stream on aligned words
+  * @param  Source: address of the first word read
+  * @param  Inc: DMA_PeripheralInc_Enable to copy, _Disable to fill
+  * @param  Destination: first word written
+  * @param  Words: 1 to DMEM_MAX_WORDS
+  * @param  Callback: called at the end, may be 0
+  * @param  Context: given to Callback
+  * @retval None
+  */
+static void DMEM_Start(uint32_t Source, uint32_t Inc, uint8_t* Destination, uint32_t Words,
+                       DMEM_Callback Callback, void* Context)
+{
+  DMA_Stream_TypeDef* stream = Stream->Stream;
+  uint32_t burst = 0;
+
+  /* A burst may not cross a 1 KB boundary: both ends on 16 bytes, whole
+     bursts only */
+  if ((((Source | (uint32_t)Destination) & 15) == 0) && ((Words & 3) == 0))
+  {
+    burst = DMEM_BURST;
+  }
+
+  Pending = Callback;
+  PendingContext = Context;
+  DMAM_ClearFlags(Stream, DMAM_FLAG_ALL);
+  stream->CR = 0;
+  stream->PAR = Source;
+  stream->M0AR = (uint32_t)Destination;
+  stream->NDTR = Words;
+  stream->FCR = DMEM_FCR;
+  stream->CR = Stream->Channel | DMEM_CR | Inc | burst | DMA_SxCR_EN;
+}
+
+/**
+  * @brief  Stream interrupt, from dma_manager.c
+  * @param  Context: not used
+  * @param  Flags: DMAM_FLAG_ bits
+  * @retval None
+  */
+static void DMEM_Finished(void* Context, uint32_t Flags)
+{
+  DMEM_Callback callback = Pending;
+
+  (void)Context;
+  if ((Flags & (DMAM_FLAG_TC | DMAM_FLAG_TE)) == 0)
+  {
+    return;
+  }
+  Pending = 0;
+  if (callback != 0)
+  {
+    callback(PendingContext, ((Flags & DMAM_FLAG_TE) != 0) ? 1 : 0);
+  }
+}
+
+/**
+  * @brief  Measures the threshold: the cycles of a processor copy of
+  *         DMEM_CAL_WORDS, and of one word on the stream from its setup to
+  *         TCIF, its interrupt not enabled yet
+  * @param  None
+  * @retval Bytes, rounded up to a word, DMEM_THRESHOLD if the stream did
+  *         not end or the counter does not run
+  */
+static uint32_t DMEM_Calibrate(void)
+{
+  uint32_t start = 0, copy = 0, stream = 0, counter = 0;
+
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+  start = DWT->CYCCNT;
+  memcpy(CalDestination, CalSource, sizeof(CalDestination));
+  copy = DWT->CYCCNT - start;
+
+  start = DWT->CYCCNT;
+  DMEM_Start((uint32_t)CalSource, DMA_PeripheralInc_Enable, (uint8_t*)CalDestination, 1, 0, 0);
+  while ((DMAM_GetFlags(Stream) & (DMAM_FLAG_TC | DMAM_FLAG_TE)) == 0)
+  {
+    if (++counter == DMEM_CAL_TIMEOUT)
+    {
+      Stream->Stream->CR = 0;
+      DMAM_ClearFlags(Stream, DMAM_FLAG_ALL);
+      return DMEM_THRESHOLD;
+    }
+  }
+  stream = DWT->CYCCNT - start;
+  DMAM_ClearFlags(Stream, DMAM_FLAG_ALL);
+
+  if (copy == 0)
+  {
+    return DMEM_THRESHOLD;
+  }
+  return ((stream * sizeof(CalSource)) / copy + 3) & ~3u;
+}
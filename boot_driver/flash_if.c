@@ -25,13 +25,42 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "flash_if.h"
+#include "profile.h"
+#include "ramfunc.h"
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
+#define CR_PSIZE_MASK              ((uint32_t)0xFFFFFCFF)
+#define SECTOR_MASK                ((uint32_t)0xFFFFFF07)
+/* Bytes of a sector checked blank per FLASH interrupt */
+#define BLANK_CHUNK                ((uint32_t)0x1000)
+
 /* Private macro -------------------------------------------------------------*/
 /* Private variables ---------------------------------------------------------*/
+/* Asynchronous erase plan: sectors [EraseSector, EraseLastSector] */
+static __IO uint32_t EraseSector = 0;
+static __IO uint32_t EraseLastSector = 0;
+static __IO uint32_t EraseBusy = 0;
+/* Next word of EraseSector to check blank, 0 before the check starts */
+static uint32_t BlankAddress = 0;
+static FLASH_If_Callback EraseDone = 0;
+
+/* Base address of each sector, followed by the end of the flash */
+static const uint32_t SectorAddress[13] =
+{
+  ADDR_FLASH_SECTOR_0, ADDR_FLASH_SECTOR_1, ADDR_FLASH_SECTOR_2,
+  ADDR_FLASH_SECTOR_3, ADDR_FLASH_SECTOR_4, ADDR_FLASH_SECTOR_5,
+  ADDR_FLASH_SECTOR_6, ADDR_FLASH_SECTOR_7, ADDR_FLASH_SECTOR_8,
+  ADDR_FLASH_SECTOR_9, ADDR_FLASH_SECTOR_10, ADDR_FLASH_SECTOR_11,
+  USER_FLASH_END_ADDRESS + 1
+};
+
 /* Private function prototypes -----------------------------------------------*/
 static uint32_t GetSector(uint32_t Address);
+static uint32_t CheckBlank(void);
+static void EraseNextSector(void);
+static void EraseFinish(uint32_t Status);
+static RAMFUNC void ProgramWords(__IO uint32_t* Destination, const uint32_t* Data, uint32_t Words);
 
 /* Private functions ---------------------------------------------------------*/
 
@@ -44,14 +73,18 @@ void FLASH_If_Init(void)
 { 
   FLASH_Unlock(); 
 
+  /* The CRC unit verifies the blocks written by FLASH_If_WriteBlock() */
+  RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_CRC, ENABLE);
+
   /* Clear pending flags (if any) */  
   FLASH_ClearFlag(FLASH_FLAG_EOP | FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR | 
                   FLASH_FLAG_PGAERR | FLASH_FLAG_PGPERR|FLASH_FLAG_PGSERR);
 }
 
 /**
-  * @brief  This function does an erase of all user flash area
-  * @param  StartSector: start of user flash area
+  * @brief  This function does an erase of the user flash area from the
+  *         sector containing StartSector up to the end of the flash
+  * @param  StartSector: start address of the area to erase
   * @retval 0: user flash area successfully erased
   *         1: error occurred
   */
@@ -60,7 +93,7 @@ uint32_t FLASH_If_Erase(uint32_t StartSector)
   uint32_t UserStartSector = FLASH_Sector_1, i = 0;
 
   /* Get the sector where start the user flash area */
-  UserStartSector = GetSector(APPLICATION_ADDRESS);
+  UserStartSector = GetSector(StartSector);
 
   for(i = UserStartSector; i <= FLASH_Sector_11; i += 8)
   {
@@ -76,6 +109,90 @@ uint32_t FLASH_If_Erase(uint32_t StartSector)
   return (0);
 }
 
+/**
+  * @brief  Starts an interrupt driven erase of the sectors covering
+  *         [Address, Address + Length). Sectors already blank are skipped;
+  *         they are read BLANK_CHUNK bytes per FLASH interrupt, pended by
+  *         software between chunks.
+  * @note   FLASH_IRQn must be enabled in the NVIC and the flash unlocked.
+  *         While a sector is being erased any read of the flash stalls the
+  *         bus, DMA transfers to and from SRAM keep running.
+  * @param  Address: start address of the area to erase
+  * @param  Length: length of the area in bytes
+  * @param  Done: called from the FLASH interrupt when the erase is over,
+  *         or directly if there is nothing to erase
+  * @retval 0: erase started (or nothing to erase)
+  *         1: bad area or an erase is already running
+  */
+uint32_t FLASH_If_EraseStart(uint32_t Address, uint32_t Length, FLASH_If_Callback Done)
+{
+  if ((EraseBusy != 0) || (Length == 0) || (Address < ADDR_FLASH_SECTOR_0) ||
+      ((Address + Length - 1) > USER_FLASH_END_ADDRESS))
+  {
+    return (1);
+  }
+
+  EraseSector = GetSector(Address);
+  EraseLastSector = GetSector(Address + Length - 1);
+  EraseDone = Done;
+  BlankAddress = 0;
+  EraseBusy = 1;
+
+  FLASH_ClearFlag(FLASH_FLAG_EOP | FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR | 
+                  FLASH_FLAG_PGAERR | FLASH_FLAG_PGPERR|FLASH_FLAG_PGSERR);
+  FLASH_ITConfig(FLASH_IT_EOP | FLASH_IT_ERR, ENABLE);
+
+  EraseNextSector();
+
+  return (0);
+}
+
+/**
+  * @brief  Returns whether an asynchronous erase is in progress
+  * @param  None
+  * @retval 0: no erase running, 1: erase running
+  */
+uint32_t FLASH_If_EraseBusy(void)
+{
+  return EraseBusy;
+}
+
+/**
+  * @brief  This function handles the FLASH interrupt: an asynchronous
+  *         sector erase is over, start the next one of the plan. Without
+  *         EOP the interrupt was pended to check the next chunk.
+  * @param  None
+  * @retval None
+  */
+void FLASH_IRQHandler(void)
+{
+  PROF_BEGIN(PROF_FLASH_IRQ);
+
+  if (FLASH_GetFlagStatus(FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR | FLASH_FLAG_PGAERR |
+                          FLASH_FLAG_PGPERR | FLASH_FLAG_PGSERR) != RESET)
+  {
+    FLASH_ClearFlag(FLASH_FLAG_EOP | FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR | 
+                    FLASH_FLAG_PGAERR | FLASH_FLAG_PGPERR|FLASH_FLAG_PGSERR);
+    EraseFinish(1);
+  }
+  else if (FLASH_GetFlagStatus(FLASH_FLAG_EOP) != RESET)
+  {
+    FLASH_ClearFlag(FLASH_FLAG_EOP);
+
+    if (EraseBusy != 0)
+    {
+      EraseSector += 8;
+      EraseNextSector();
+    }
+  }
+  else if ((EraseBusy != 0) && (BlankAddress != 0))
+  {
+    EraseNextSector();
+  }
+
+  PROF_END(PROF_FLASH_IRQ);
+}
+
 /**
   * @brief  This function writes a data buffer in flash (data are 32-bit aligned).
   * @note   After writing data buffer, the flash content is checked.
@@ -115,6 +232,92 @@ uint32_t FLASH_If_Write(__IO uint32_t* FlashAddress, uint32_t* Data ,uint16_t Da
   return (0);
 }
 
+/**
+  * @brief  This function writes a data buffer in flash (data are 32-bit aligned)
+  *         in a single programming sequence.
+  * @note   PSIZE and PG are set once for the whole buffer and only BSY is
+  *         polled between words. x64 parallelism needs an external VPP, so
+  *         the buffer is programmed by word (voltage range [2.7V to 3.6V]).
+  *         The written range is checked once at the end by comparing the
+  *         CRC unit result of the flash range and of the buffer.
+  * @param  FlashAddress: start address for writing data buffer, updated
+  *         to the word following the last one written
+  * @param  Data: pointer on data buffer
+  * @param  DataLength: length of data buffer (unit is 32-bit word)
+  * @retval 0: Data successfully written to Flash memory
+  *         1: Error occurred while writing data in Flash memory
+  *         2: Written Data in flash memory is different from expected one
+  */
+uint32_t FLASH_If_WriteBlock(__IO uint32_t* FlashAddress, uint32_t* Data, uint32_t DataLength)
+{
+  __IO uint32_t* dst = (__IO uint32_t*)*FlashAddress;
+  uint32_t crc = 0;
+
+  if ((DataLength == 0) || ((*FlashAddress + DataLength * 4 - 1) > USER_FLASH_END_ADDRESS))
+  {
+    return (1);
+  }
+
+  if (FLASH_WaitForLastOperation() != FLASH_COMPLETE)
+  {
+    FLASH_ClearFlag(FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR | FLASH_FLAG_PGAERR |
+                    FLASH_FLAG_PGPERR | FLASH_FLAG_PGSERR);
+    return (1);
+  }
+
+  ProgramWords(dst, Data, DataLength);
+
+  /* The error flags are sticky, one check covers the whole buffer. They
+     are cleared, or they would block the next programming. */
+  if ((FLASH->SR & (FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR | FLASH_FLAG_PGAERR |
+                    FLASH_FLAG_PGPERR | FLASH_FLAG_PGSERR)) != 0)
+  {
+    FLASH_ClearFlag(FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR | FLASH_FLAG_PGAERR |
+                    FLASH_FLAG_PGPERR | FLASH_FLAG_PGSERR);
+    return (1);
+  }
+
+  CRC_ResetDR();
+  crc = CRC_CalcBlockCRC((uint32_t*)dst, DataLength);
+  CRC_ResetDR();
+  if (CRC_CalcBlockCRC(Data, DataLength) != crc)
+  {
+    /* Flash content doesn't match SRAM content */
+    return (2);
+  }
+
+  *FlashAddress += DataLength * 4;
+
+  return (0);
+}
+
+/**
+  * @brief  Programming loop of FLASH_If_WriteBlock(), run from SRAM: the
+  *         core does not fetch from the flash while it waits for BSY
+  * @param  Destination: first flash word
+  * @param  Data: words to program
+  * @param  Words: number of words
+  * @retval None
+  */
+static RAMFUNC void ProgramWords(__IO uint32_t* Destination, const uint32_t* Data, uint32_t Words)
+{
+  uint32_t i = 0;
+
+  FLASH->CR &= CR_PSIZE_MASK;
+  FLASH->CR |= FLASH_PSIZE_WORD;
+  FLASH->CR |= FLASH_CR_PG;
+
+  for (i = 0; i < Words; i++)
+  {
+    Destination[i] = Data[i];
+    while ((FLASH->SR & FLASH_FLAG_BSY) != 0)
+    {
+    }
+  }
+
+  FLASH->CR &= (~FLASH_CR_PG);
+}
+
 /**
   * @brief  Returns the write protection status of user flash area.
   * @param  None
@@ -172,6 +375,107 @@ uint32_t FLASH_If_DisableWriteProtection(void)
   return (1);
 }
 
+/**
+  * @brief  Starts the erase of the next sector of the plan which is not
+  *         already blank, or ends the plan. Returns with the FLASH
+  *         interrupt pended when a chunk was checked blank.
+  * @param  None
+  * @retval None
+  */
+static void EraseNextSector(void)
+{
+  uint32_t blank = 0;
+
+  while (EraseSector <= EraseLastSector)
+  {
+    blank = CheckBlank();
+    if (blank == 2)
+    {
+      NVIC_SetPendingIRQ(FLASH_IRQn);
+      return;
+    }
+    BlankAddress = 0;
+    if (blank == 0)
+    {
+      break;
+    }
+    EraseSector += 8;
+  }
+
+  if (EraseSector > EraseLastSector)
+  {
+    EraseFinish(0);
+    return;
+  }
+
+  /* Same sequence as FLASH_EraseSector() with VoltageRange_3, without
+     waiting for the end of the operation */
+  FLASH->CR &= CR_PSIZE_MASK;
+  FLASH->CR |= FLASH_PSIZE_WORD;
+  FLASH->CR &= SECTOR_MASK;
+  FLASH->CR |= FLASH_CR_SER | EraseSector;
+  FLASH->CR |= FLASH_CR_STRT;
+}
+
+/**
+  * @brief  Ends the asynchronous erase and reports the status
+  * @param  Status: 0 on success, 1 on error
+  * @retval None
+  */
+static void EraseFinish(uint32_t Status)
+{
+  FLASH_ITConfig(FLASH_IT_EOP | FLASH_IT_ERR, DISABLE);
+  NVIC_ClearPendingIRQ(FLASH_IRQn);
+  BlankAddress = 0;
+  FLASH->CR &= (~FLASH_CR_SER);
+  FLASH->CR &= SECTOR_MASK;
+
+  /* Lines read by CheckBlank() may still be in the data cache */
+  if ((FLASH->ACR & FLASH_ACR_DCEN) != 0)
+  {
+    FLASH_DataCacheCmd(DISABLE);
+    FLASH_DataCacheReset();
+    FLASH_DataCacheCmd(ENABLE);
+  }
+
+  EraseBusy = 0;
+  if (EraseDone != 0)
+  {
+    EraseDone(Status);
+  }
+}
+
+/**
+  * @brief  Checks the next BLANK_CHUNK bytes of EraseSector from
+  *         BlankAddress, which is moved on
+  * @param  None
+  * @retval 1: every word of the sector reads 0xFFFFFFFF, 0: a word does
+  *         not, 2: blank so far, the rest of the sector is left to check
+  */
+static uint32_t CheckBlank(void)
+{
+  uint32_t *p = 0;
+  uint32_t *end = (uint32_t *)SectorAddress[EraseSector / 8 + 1];
+  uint32_t *stop = 0;
+
+  if (BlankAddress == 0)
+  {
+    BlankAddress = SectorAddress[EraseSector / 8];
+  }
+  p = (uint32_t *)BlankAddress;
+  stop = ((uint32_t)(end - p) > BLANK_CHUNK / 4) ? p + BLANK_CHUNK / 4 : end;
+
+  for (; p < stop; p++)
+  {
+    if (*p != 0xFFFFFFFF)
+    {
+      return 0;
+    }
+  }
+  BlankAddress = (uint32_t)p;
+  return (p == end) ? 1 : 2;
+}
+
 /**
   * @brief  Gets the sector of a given address
   * @param  Address: Flash address
@@ -0,0 +1,463 @@
+/**
+  ******************************************************************************
+  * @file    hash_engine.c
+  * @brief   Queue and interrupt of the HASH engine of hash_engine.h.
+  *
+  *          The input FIFO takes 16 words; the 17th word written starts the
+  *          processing of the block and stays for the next one. DINIS is
+  *          set once the block is done. The engine writes up to the 17th
+  *          word, waits for DINIS and goes on; a piece with no more whole
+  *          words leaves the core idle, where the context can be saved.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "hash_engine.h"
+
+/* Private define ------------------------------------------------------------*/
+#define HENG_BLOCK_WORDS      16
+/* Blocks a context hashes before the next context in the queue runs */
+#define HENG_SLICE_BLOCKS     16
+
+/* Private variables ---------------------------------------------------------*/
+/* The queue, its head owns the peripheral */
+static HENG_Context* Head = 0;
+static HENG_Context* Tail = 0;
+/* Context whose state the peripheral holds */
+static HENG_Context* Loaded = 0;
+static uint32_t SliceBlocks = 0;
+/* Peripheral lent by HENG_Lock() */
+static uint32_t Locked = 0;
+
+/* Private function prototypes -----------------------------------------------*/
+static uint32_t HENG_Queue(HENG_Context* Context, const void* Data, uint32_t Length,
+                           uint32_t Final, HENG_Callback Done, void* DoneContext);
+static void HENG_Run(void);
+static void HENG_Feed(HENG_Context* Context);
+static void HENG_Digest(HENG_Context* Context);
+static void HENG_Finish(HENG_Context* Context, uint32_t Status);
+static void HENG_Interrupt(void);
+
+/* The RNG shares the vector: rng_pool.c, when it is linked */
+extern void RNGP_IRQHandler(void) __attribute__((weak));
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Enables the HASH and its interrupt
+  * @param  None
+  * @retval None
+  */
+void HENG_Init(void)
+{
+  NVIC_InitTypeDef NVIC_InitStructure;
+
+  RCC_AHB2PeriphClockCmd(RCC_AHB2Periph_HASH, ENABLE);
+
+  NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 1;
+  NVIC_InitStructure.NVIC_IRQChannelSubPriority = 3;
+  NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+  NVIC_InitStructure.NVIC_IRQChannel = HASH_RNG_IRQn;
+  NVIC_Init(&NVIC_InitStructure);
+}
+
+/**
+  * @brief  Starts a message in a context that is not busy
+  * @param  Context: context of the message
+  * @param  Algorithm: HASH_AlgoSelection_SHA1 or HASH_AlgoSelection_MD5
+  * @retval None
+  */
+void HENG_Begin(HENG_Context* Context, uint32_t Algorithm)
+{
+  Context->Algorithm = Algorithm;
+  Context->Started = 0;
+  Context->Queued = 0;
+  Context->Words = 0;
+  Context->LeadBytes = 0;
+}
+
+/**
+  * @brief  Queues a piece of the message. Done may be called before
+  *         HENG_Update() returns.
+  * @param  Context: context of the message
+  * @param  Data: bytes of the piece, kept until Done
+  * @param  Length: bytes
+  * @param  Done: called when the piece is taken, may be 0
+  * @param  DoneContext: given to Done
+  * @retval 0: queued, 1: the context is busy with the last piece
+  */
+uint32_t HENG_Update(HENG_Context* Context, const void* Data, uint32_t Length,
+                     HENG_Callback Done, void* DoneContext)
+{
+  return HENG_Queue(Context, Data, Length, 0, Done, DoneContext);
+}
+
+/**
+  * @brief  Queues the last piece of the message and the digest. The
+  *         context can be given to HENG_Begin() again after Done.
+  * @param  Context: context of the message
+  * @param  Data: bytes of the piece, kept until Done, may be 0 if Length
+  *         is 0
+  * @param  Length: bytes
+  * @param  Digest: HENG_SHA1_SIZE or HENG_MD5_SIZE bytes, written before Done
+  * @param  Done: called at the end, may be 0
+  * @param  DoneContext: given to Done
+  * @retval 0: queued, 1: the context is busy with the last piece
+  */
+uint32_t HENG_Final(HENG_Context* Context, const void* Data, uint32_t Length, uint8_t* Digest,
+                    HENG_Callback Done, void* DoneContext)
+{
+  if (Context->Queued != 0)
+  {
+    return 1;
+  }
+  Context->Digest = Digest;
+  return HENG_Queue(Context, Data, Length, 1, Done, DoneContext);
+}
+
+/**
+  * @brief  Whether a piece of a context is queued or under way
+  * @param  Context: context of the message
+  * @retval 0: idle, 1: busy
+  */
+uint32_t HENG_Busy(const HENG_Context* Context)
+{
+  return Context->Queued;
+}
+
+/**
+  * @brief  Lends the peripheral when no piece is under way. The state of
+  *         the last context is saved, the peripheral is left to the caller
+  *         until HENG_Unlock().
+  * @param  None
+  * @retval 0: peripheral lent, 1: a piece is under way or it is lent
+  */
+uint32_t HENG_Lock(void)
+{
+  uint32_t primask = __get_PRIMASK();
+  uint32_t status = 1;
+
+  __disable_irq();
+  if ((Head == 0) && (Locked == 0))
+  {
+    if ((Loaded != 0) && (Loaded->Started != 0))
+    {
+      HASH_SaveContext(&Loaded->Saved);
+    }
+    Loaded = 0;
+    Locked = 1;
+    status = 0;
+  }
+  __set_PRIMASK(primask);
+  return status;
+}
+
+/**
+  * @brief  Takes the peripheral back and runs the pieces queued meanwhile
+  * @param  None
+  * @retval None
+  */
+void HENG_Unlock(void)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  Locked = 0;
+  HASH->IMR = 0;
+  if (Head != 0)
+  {
+    HENG_Run();
+  }
+  __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Writes whole words of a byte string to DIN
+  * @note   The word goes through a variable used for nothing else. One
+  *         also filled by a memcpy() of variable length, as the last word
+  *         is, has its address taken and lives in memory; GCC's loop store
+  *         motion (-ftree-loop-im) then holds it in a register in the loop
+  *         and stores it back at the exit, and to keep that store ordered
+  *         after the volatile DIN write it writes DIN again there: the FIFO
+  *         takes the last whole word twice. GCC 12 does so at -O2 for the
+  *         loop of hmac_key.c when it shared its variable with the last
+  *         word.
+  * @param  Data: bytes, any alignment
+  * @param  Words: words to write
+  * @retval None
+  */
+void HENG_Write(const uint8_t* Data, uint32_t Words)
+{
+  uint32_t i = 0, word = 0;
+
+  for (i = 0; i < Words; i++)
+  {
+    memcpy(&word, &Data[i * 4], 4);
+    HASH->DIN = word;
+  }
+}
+
+/**
+  * @brief  Writes the last bytes of a message to DIN, padded with zeros.
+  *         The valid bits of the word are set apart.
+  * @param  Data: bytes
+  * @param  Bytes: 1 to 3
+  * @retval None
+  */
+void HENG_WriteLast(const uint8_t* Data, uint32_t Bytes)
+{
+  uint32_t last = 0;
+
+  memcpy(&last, Data, Bytes);
+  HASH->DIN = last;
+}
+
+/**
+  * @brief  HASH and RNG interrupt
+  * @param  None
+  * @retval None
+  */
+void HASH_RNG_IRQHandler(void)
+{
+  if (RNGP_IRQHandler != 0)
+  {
+    RNGP_IRQHandler();
+  }
+  HENG_Interrupt();
+}
+
+/**
+  * @brief  HASH interrupt: next words of the head of the queue, or its
+  *         digest
+  * @param  None
+  * @retval None
+  */
+static void HENG_Interrupt(void)
+{
+  HENG_Context* context = Head;
+  uint32_t status = HASH->SR & HASH->IMR;
+
+  if ((context == 0) || (status == 0))
+  {
+    return;
+  }
+  HASH->IMR = 0;
+
+  if ((status & HASH_SR_DCIS) != 0)
+  {
+    HENG_Digest(context);
+  }
+  else if ((SliceBlocks >= HENG_SLICE_BLOCKS) && (context->Next != 0))
+  {
+    /* Block done, the core is idle: the next context runs */
+    Head = context->Next;
+    Tail->Next = context;
+    Tail = context;
+    context->Next = 0;
+    HENG_Run();
+  }
+  else
+  {
+    HENG_Feed(context);
+  }
+}
+
+/**
+  * @brief  Adds a piece to the queue, runs it if the queue was empty and
+  *         the peripheral is not lent
+  * @param  Context: context of the message
+  * @param  Data, Length: piece
+  * @param  Final: 1 for the last piece
+  * @param  Done, DoneContext: callback
+  * @retval 0: queued, 1: busy
+  */
+static uint32_t HENG_Queue(HENG_Context* Context, const void* Data, uint32_t Length,
+                           uint32_t Final, HENG_Callback Done, void* DoneContext)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  if (Context->Queued != 0)
+  {
+    return 1;
+  }
+  Context->Data = (const uint8_t*)Data;
+  Context->Length = Length;
+  Context->Final = Final;
+  Context->Done = Done;
+  Context->DoneContext = DoneContext;
+  Context->Next = 0;
+  Context->Queued = 1;
+
+  __disable_irq();
+  if (Tail != 0)
+  {
+    Tail->Next = Context;
+  }
+  else
+  {
+    Head = Context;
+  }
+  Tail = Context;
+  if ((Head == Context) && (Locked == 0))
+  {
+    HENG_Run();
+  }
+  __set_PRIMASK(primask);
+  return 0;
+}
+
+/**
+  * @brief  Gives the idle peripheral to the head of the queue: the state
+  *         of the last context is saved, the one of the head restored
+  * @param  None
+  * @retval None
+  */
+static void HENG_Run(void)
+{
+  HENG_Context* context = Head;
+  HASH_InitTypeDef HASH_InitStructure;
+
+  if (Loaded != context)
+  {
+    if ((Loaded != 0) && (Loaded->Started != 0))
+    {
+      HASH_SaveContext(&Loaded->Saved);
+    }
+    if (context->Started != 0)
+    {
+      HASH_RestoreContext(&context->Saved);
+      HASH->IMR = 0;
+    }
+    Loaded = context;
+  }
+  if (context->Started == 0)
+  {
+    HASH_InitStructure.HASH_AlgoSelection = context->Algorithm;
+    HASH_InitStructure.HASH_AlgoMode = HASH_AlgoMode_HASH;
+    HASH_InitStructure.HASH_DataType = HASH_DataType_8b;
+    HASH_InitStructure.HASH_HMACKeyType = HASH_HMACKeyType_ShortKey;
+    HASH_Init(&HASH_InitStructure);
+    context->Started = 1;
+  }
+  SliceBlocks = 0;
+  HENG_Feed(context);
+}
+
+/**
+  * @brief  Writes the words of the piece up to the start of a block and
+  *         waits for DINIS, or ends the piece. The core is idle.
+  * @param  Context: head of the queue
+  * @retval None
+  */
+static void HENG_Feed(HENG_Context* Context)
+{
+  uint32_t pending = 0, room = 0, take = 0;
+
+  /* Words in the FIFO, not processed yet */
+  if (Context->Words != 0)
+  {
+    pending = Context->Words - HENG_BLOCK_WORDS * ((Context->Words - 1) / HENG_BLOCK_WORDS);
+  }
+  room = HENG_BLOCK_WORDS + 1 - pending;
+  HASH_ClearFlag(HASH_FLAG_DINIS);
+
+  if ((Context->LeadBytes != 0) && (Context->LeadBytes + Context->Length >= 4))
+  {
+    take = 4 - Context->LeadBytes;
+    memcpy(&Context->Lead[Context->LeadBytes], Context->Data, take);
+    HENG_Write(Context->Lead, 1);
+    Context->Data += take;
+    Context->Length -= take;
+    Context->LeadBytes = 0;
+    Context->Words++;
+    room--;
+  }
+  take = Context->Length / 4;
+  if (take > room)
+  {
+    take = room;
+  }
+  HENG_Write(Context->Data, take);
+  Context->Data += take * 4;
+  Context->Length -= take * 4;
+  Context->Words += take;
+  room -= take;
+
+  if (room == 0)
+  {
+    /* A block is processed */
+    SliceBlocks++;
+    HASH->IMR = HASH_IMR_DINIM;
+    return;
+  }
+
+  /* No whole word left */
+  memcpy(&Context->Lead[Context->LeadBytes], Context->Data, Context->Length);
+  Context->LeadBytes += Context->Length;
+  Context->Length = 0;
+  if (Context->Final == 0)
+  {
+    HENG_Finish(Context, 0);
+    return;
+  }
+  if (Context->LeadBytes != 0)
+  {
+    HENG_WriteLast(Context->Lead, Context->LeadBytes);
+    Context->Words++;
+  }
+  HASH_SetLastWordValidBitsNbr(8 * Context->LeadBytes);
+  HASH_ClearFlag(HASH_FLAG_DCIS);
+  HASH->IMR = HASH_IMR_DCIM;
+  HASH_StartDigest();
+}
+
+/**
+  * @brief  DCIS: reads the digest and ends the message
+  * @param  Context: head of the queue
+  * @retval None
+  */
+static void HENG_Digest(HENG_Context* Context)
+{
+  uint32_t words = (Context->Algorithm == HASH_AlgoSelection_MD5) ? HENG_MD5_SIZE / 4 : HENG_SHA1_SIZE / 4;
+  uint32_t i = 0, word = 0;
+
+  for (i = 0; i < words; i++)
+  {
+    word = __REV(HASH->HR[i]);
+    memcpy(Context->Digest + i * 4, &word, 4);
+  }
+  Context->Started = 0;
+  Loaded = 0;
+  HENG_Finish(Context, 0);
+}
+
+/**
+  * @brief  Takes the head out of the queue, calls back and runs the next
+  *         context. A piece queued by the callback into the empty queue
+  *         is run by HENG_Queue().
+  * @param  Context: head of the queue
+  * @param  Status: given to the callback
+  * @retval None
+  */
+static void HENG_Finish(HENG_Context* Context, uint32_t Status)
+{
+  HENG_Context* next = Context->Next;
+
+  Head = next;
+  if (Head == 0)
+  {
+    Tail = 0;
+  }
+  Context->Next = 0;
+  Context->Queued = 0;
+
+  if (Context->Done != 0)
+  {
+    Context->Done(Context->DoneContext, Status);
+  }
+  if (next != 0)
+  {
+    HENG_Run();
+  }
+}
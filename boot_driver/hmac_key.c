@@ -0,0 +1,194 @@
+/**
+  ******************************************************************************
+  * @file    hmac_key.c
+  * @brief   Prepared key HMAC of hmac_key.h.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "hash_engine.h"
+#include "hmac_key.h"
+
+/* Private define ------------------------------------------------------------*/
+#define HKEY_BLOCK            64
+#define HKEY_IPAD             0x36363636
+#define HKEY_OPAD             0x5C5C5C5C
+/* Reads of the DCIS flag, as SHA1BUSY_TIMEOUT of the library */
+#define HKEY_BUSY_COUNT       0x00010000
+
+/* Private function prototypes -----------------------------------------------*/
+static void HKEY_Start(uint32_t Algorithm);
+static void HKEY_Absorb(uint32_t Algorithm, const uint8_t* Block, uint32_t Pad, HASH_Context* Saved);
+static uint32_t HKEY_Hash(const uint8_t* Data, uint32_t Length, uint32_t Words, uint32_t* Digest);
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Hashes the key blocks and saves the HASH states. A key longer
+  *         than a block is hashed first, as RFC 2104 asks.
+  * @param  Context: filled
+  * @param  Algorithm: HASH_AlgoSelection_SHA1 or HASH_AlgoSelection_MD5
+  * @param  Key: key bytes
+  * @param  KeyLength: bytes
+  * @retval HKEY_OK, HKEY_BUSY or HKEY_TIMEOUT
+  */
+uint32_t HKEY_Init(HKEY_Context* Context, uint32_t Algorithm, const uint8_t* Key, uint32_t KeyLength)
+{
+  uint8_t block[HKEY_BLOCK];
+  uint32_t words = ((Algorithm == HASH_AlgoSelection_MD5) ? HENG_MD5_SIZE : HENG_SHA1_SIZE) / 4;
+  uint32_t digest[HENG_SHA1_SIZE / 4];
+  uint32_t i = 0, word = 0;
+
+  RCC_AHB2PeriphClockCmd(RCC_AHB2Periph_HASH, ENABLE);
+  Context->Algorithm = Algorithm;
+  memset(block, 0, sizeof(block));
+
+  if (HENG_Lock() != 0)
+  {
+    return HKEY_BUSY;
+  }
+  if (KeyLength > HKEY_BLOCK)
+  {
+    HKEY_Start(Algorithm);
+    if (HKEY_Hash(Key, KeyLength, words, digest) != HKEY_OK)
+    {
+      HENG_Unlock();
+      return HKEY_TIMEOUT;
+    }
+    for (i = 0; i < words; i++)
+    {
+      word = __REV(digest[i]);
+      memcpy(&block[i * 4], &word, 4);
+    }
+  }
+  else
+  {
+    memcpy(block, Key, KeyLength);
+  }
+
+  HKEY_Absorb(Algorithm, block, HKEY_IPAD, &Context->Inner);
+  HKEY_Absorb(Algorithm, block, HKEY_OPAD, &Context->Outer);
+  HENG_Unlock();
+  return HKEY_OK;
+}
+
+/**
+  * @brief  HMAC of a message
+  * @param  Context: from HKEY_Init()
+  * @param  Message: bytes
+  * @param  Length: bytes
+  * @param  Mac: HENG_SHA1_SIZE or HENG_MD5_SIZE bytes
+  * @retval HKEY_OK, HKEY_BUSY or HKEY_TIMEOUT
+  */
+uint32_t HKEY_Mac(const HKEY_Context* Context, const uint8_t* Message, uint32_t Length, uint8_t* Mac)
+{
+  uint32_t words = ((Context->Algorithm == HASH_AlgoSelection_MD5) ? HENG_MD5_SIZE : HENG_SHA1_SIZE) / 4;
+  uint32_t digest[HENG_SHA1_SIZE / 4];
+  uint32_t i = 0, status = HKEY_OK;
+
+  if (HENG_Lock() != 0)
+  {
+    return HKEY_BUSY;
+  }
+  /* The library takes no const context, it only reads it */
+  HASH_RestoreContext((HASH_Context*)&Context->Inner);
+  status = HKEY_Hash(Message, Length, words, digest);
+  if (status == HKEY_OK)
+  {
+    /* The inner digest as bytes, read back as words for DIN */
+    for (i = 0; i < words; i++)
+    {
+      digest[i] = __REV(digest[i]);
+    }
+    HASH_RestoreContext((HASH_Context*)&Context->Outer);
+    status = HKEY_Hash((const uint8_t*)digest, words * 4, words, digest);
+  }
+  HENG_Unlock();
+
+  if (status == HKEY_OK)
+  {
+    for (i = 0; i < words; i++)
+    {
+      digest[i] = __REV(digest[i]);
+    }
+    memcpy(Mac, digest, words * 4);
+  }
+  return status;
+}
+
+/**
+  * @brief  Starts a plain hash of bytes, the HASH lent by HENG_Lock()
+  * @param  Algorithm: HASH_AlgoSelection_SHA1 or HASH_AlgoSelection_MD5
+  * @retval None
+  */
+static void HKEY_Start(uint32_t Algorithm)
+{
+  HASH_InitTypeDef HASH_InitStructure;
+
+  HASH_InitStructure.HASH_AlgoSelection = Algorithm;
+  HASH_InitStructure.HASH_AlgoMode = HASH_AlgoMode_HASH;
+  HASH_InitStructure.HASH_DataType = HASH_DataType_8b;
+  HASH_InitStructure.HASH_HMACKeyType = HASH_HMACKeyType_ShortKey;
+  HASH_Init(&HASH_InitStructure);
+}
+
+/**
+  * @brief  Writes the key block XORed with a pad and saves the state. The
+  *         16 words stay in the FIFO, and so in the saved CSR registers,
+  *         until the first word of a message starts the block.
+  * @param  Algorithm: HASH_AlgoSelection_SHA1 or HASH_AlgoSelection_MD5
+  * @param  Block: HKEY_BLOCK bytes of key
+  * @param  Pad: HKEY_IPAD or HKEY_OPAD
+  * @param  Saved: filled
+  * @retval None
+  */
+static void HKEY_Absorb(uint32_t Algorithm, const uint8_t* Block, uint32_t Pad, HASH_Context* Saved)
+{
+  uint32_t i = 0, word = 0;
+
+  HKEY_Start(Algorithm);
+  for (i = 0; i < HKEY_BLOCK / 4; i++)
+  {
+    memcpy(&word, &Block[i * 4], 4);
+    HASH->DIN = word ^ Pad;
+  }
+  HASH_SaveContext(Saved);
+}
+
+/**
+  * @brief  Writes the rest of a message to the HASH and reads the digest.
+  *         DIN holds the writes while the core is busy.
+  * @param  Data: bytes
+  * @param  Length: bytes
+  * @param  Words: of the digest, 5 for SHA-1 and 4 for MD5
+  * @param  Digest: HR words
+  * @retval HKEY_OK or HKEY_TIMEOUT
+  */
+static uint32_t HKEY_Hash(const uint8_t* Data, uint32_t Length, uint32_t Words, uint32_t* Digest)
+{
+  uint32_t i = 0, counter = 0;
+
+  HENG_Write(Data, Length / 4);
+  if ((Length & 3) != 0)
+  {
+    HENG_WriteLast(&Data[Length & ~3u], Length & 3);
+  }
+  HASH_SetLastWordValidBitsNbr(8 * (Length & 3));
+  HASH_StartDigest();
+
+  /* BUSY may still be clear right after DCAL, DCIS tells the digest is in HR */
+  while ((HASH->SR & HASH_SR_DCIS) == 0)
+  {
+    if (++counter == HKEY_BUSY_COUNT)
+    {
+      return HKEY_TIMEOUT;
+    }
+  }
+  for (i = 0; i < Words; i++)
+  {
+    Digest[i] = HASH->HR[i];
+  }
+  HASH_ClearFlag(HASH_FLAG_DCIS);
+  return HKEY_OK;
+}
@@ -0,0 +1,283 @@
+/**
+  ******************************************************************************
+  * @file    iap_frame.c
+  * @brief   Framed IAP link: sequence numbered frames checked by a CRC, a
+  *          window of FRAME_WINDOW frames in flight and selective
+  *          acknowledgements.
+  *
+  *          The received bytes can be fed in pieces of any length. A frame
+  *          received before the ones preceding it is kept in the window
+  *          until they come, the payloads are handed over in order.
+  *          tools/iap_frame.py is the host side.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "iap_frame.h"
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+#define FRAME_BITMAP_SIZE     4
+
+/* Private macro -------------------------------------------------------------*/
+#define FRAME_BYTES(frame)    ((uint8_t*)(frame))
+#define FRAME_FIELD(frame, offset) \
+  ((uint16_t)(FRAME_BYTES(frame)[offset] | (FRAME_BYTES(frame)[(offset) + 1] << 8)))
+#define FRAME_TYPE(frame)     (FRAME_BYTES(frame)[1])
+#define FRAME_SEQ(frame)      FRAME_FIELD(frame, 2)
+#define FRAME_LENGTH(frame)   FRAME_FIELD(frame, 4)
+#define FRAME_ACKED(frame)    FRAME_FIELD(frame, 6)
+#define FRAME_SLOT(seq)       ((seq) % FRAME_WINDOW)
+
+/* Private variables ---------------------------------------------------------*/
+/* Private function prototypes -----------------------------------------------*/
+static uint32_t FRAME_Build(FRAME_Link* Link, uint32_t* Frame, uint8_t Type,
+                            uint16_t Seq, uint16_t Ack, uint32_t Length);
+static void FRAME_Handle(FRAME_Link* Link);
+static void FRAME_Hand(FRAME_Link* Link, const uint32_t* Frame);
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Prepares a link, the first frame expected is number 0
+  * @param  Link: link
+  * @param  Crc: computes the CRC unit value of a frame
+  * @param  Send: sends the FRAME_ACK frames
+  * @param  Deliver: called with the payloads in sequence order
+  * @retval None
+  */
+void FRAME_Init(FRAME_Link* Link, FRAME_Crc Crc, FRAME_Send Send, FRAME_Deliver Deliver)
+{
+  Link->Crc = Crc;
+  Link->Send = Send;
+  Link->Deliver = Deliver;
+  Link->Count = 0;
+  Link->Size = 0;
+  Link->Held = 0;
+  Link->Busy = 0;
+  Link->Next = 0;
+  Link->Replied = 0;
+  Link->Confirmed = 0;
+}
+
+/**
+  * @brief  Takes bytes received from the host. Bytes outside a frame are
+  *         skipped up to the next FRAME_MAGIC.
+  * @param  Link: link
+  * @param  Data: received bytes
+  * @param  Length: number of received bytes
+  * @retval None
+  */
+void FRAME_Receive(FRAME_Link* Link, const uint8_t* Data, uint32_t Length)
+{
+  uint32_t length = 0;
+
+  while (Length > 0)
+  {
+    if (Link->Count < FRAME_HEADER_SIZE)
+    {
+      if ((Link->Count == 0) && (*Data != FRAME_MAGIC))
+      {
+        Data++;
+        Length--;
+        continue;
+      }
+
+      FRAME_BYTES(Link->Rx)[Link->Count++] = *Data++;
+      Length--;
+      if (Link->Count < FRAME_HEADER_SIZE)
+      {
+        continue;
+      }
+
+      if (FRAME_LENGTH(Link->Rx) > FRAME_PAYLOAD_MAX)
+      {
+        /* Not a header: look for the next magic */
+        Link->Count = 0;
+        continue;
+      }
+      Link->Size = FRAME_HEADER_SIZE + ((FRAME_LENGTH(Link->Rx) + 3) & ~3u) + 4;
+    }
+
+    length = Link->Size - Link->Count;
+    if (length > Length)
+    {
+      length = Length;
+    }
+    memcpy(FRAME_BYTES(Link->Rx) + Link->Count, Data, length);
+    Link->Count += length;
+    Data += length;
+    Length -= length;
+
+    if (Link->Count == Link->Size)
+    {
+      Link->Count = 0;
+      FRAME_Handle(Link);
+    }
+  }
+}
+
+/**
+  * @brief  Queues a reply byte for the host. It is sent with the FRAME_ACK
+  *         of the frame being handled, or right away outside of
+  *         FRAME_Receive(), and again until the host confirms it.
+  * @param  Link: link
+  * @param  Data: reply byte
+  * @retval None
+  */
+void FRAME_Reply(FRAME_Link* Link, uint8_t Data)
+{
+  Link->Reply[Link->Replied % FRAME_REPLY_SIZE] = Data;
+  Link->Replied++;
+
+  if (Link->Busy == 0)
+  {
+    FRAME_Ack(Link);
+  }
+}
+
+/**
+  * @brief  Sends a FRAME_ACK: next frame expected, frames held after it
+  *         and the reply bytes not confirmed yet
+  * @param  Link: link
+  * @retval None
+  */
+void FRAME_Ack(FRAME_Link* Link)
+{
+  uint8_t* payload = FRAME_BYTES(Link->Tx) + FRAME_HEADER_SIZE;
+  uint32_t bitmap = 0, pending = 0, i = 0;
+
+  for (i = 1; i < FRAME_WINDOW; i++)
+  {
+    if ((Link->Held & (1u << FRAME_SLOT((uint16_t)(Link->Next + i)))) != 0)
+    {
+      bitmap |= 1u << (i - 1);
+    }
+  }
+  for (i = 0; i < FRAME_BITMAP_SIZE; i++)
+  {
+    *payload++ = (uint8_t)(bitmap >> (i * 8));
+  }
+
+  /* The oldest bytes are lost if the host is that far behind, it sees it
+     from the Ack count */
+  pending = (uint16_t)(Link->Replied - Link->Confirmed);
+  if (pending > FRAME_REPLY_SIZE)
+  {
+    pending = FRAME_REPLY_SIZE;
+  }
+  for (i = 0; i < pending; i++)
+  {
+    *payload++ = Link->Reply[(uint16_t)(Link->Replied - pending + i) % FRAME_REPLY_SIZE];
+  }
+
+  Link->Send(FRAME_BYTES(Link->Tx),
+             FRAME_Build(Link, Link->Tx, FRAME_ACK, Link->Next, Link->Replied,
+                         FRAME_BITMAP_SIZE + pending));
+}
+
+/**
+  * @brief  Fills the header, the padding and the CRC of a frame
+  * @param  Link: link
+  * @param  Frame: frame, the payload already in place
+  * @param  Type: frame type
+  * @param  Seq: sequence number
+  * @param  Ack: reply byte count
+  * @param  Length: payload length
+  * @retval Frame length in bytes
+  */
+static uint32_t FRAME_Build(FRAME_Link* Link, uint32_t* Frame, uint8_t Type,
+                            uint16_t Seq, uint16_t Ack, uint32_t Length)
+{
+  uint8_t* header = FRAME_BYTES(Frame);
+  uint32_t words = (FRAME_HEADER_SIZE + Length + 3) / 4;
+
+  header[0] = FRAME_MAGIC;
+  header[1] = Type;
+  header[2] = (uint8_t)Seq;
+  header[3] = (uint8_t)(Seq >> 8);
+  header[4] = (uint8_t)Length;
+  header[5] = (uint8_t)(Length >> 8);
+  header[6] = (uint8_t)Ack;
+  header[7] = (uint8_t)(Ack >> 8);
+  memset(header + FRAME_HEADER_SIZE + Length, 0xFF, words * 4 - FRAME_HEADER_SIZE - Length);
+
+  Frame[words] = Link->Crc(Frame, words);
+  return (words + 1) * 4;
+}
+
+/**
+  * @brief  Checks the frame received in Rx and hands it over, keeps it in
+  *         the window or drops it
+  * @param  Link: link
+  * @retval None
+  */
+static void FRAME_Handle(FRAME_Link* Link)
+{
+  uint32_t words = Link->Size / 4 - 1;
+  uint16_t seq = FRAME_SEQ(Link->Rx);
+  uint16_t distance = (uint16_t)(seq - Link->Next);
+  uint16_t acked = FRAME_ACKED(Link->Rx);
+
+  if (Link->Crc(Link->Rx, words) != Link->Rx[words])
+  {
+    return;
+  }
+
+  /* Reply bytes received by the host, the count only goes forward */
+  if (((int16_t)(acked - Link->Confirmed) > 0) &&
+      ((int16_t)(Link->Replied - acked) >= 0))
+  {
+    Link->Confirmed = acked;
+  }
+
+  switch (FRAME_TYPE(Link->Rx))
+  {
+    case FRAME_CMD:
+    case FRAME_DATA:
+      Link->Busy = 1;
+      if (distance == 0)
+      {
+        FRAME_Hand(Link, Link->Rx);
+
+        /* Then the frames that came early */
+        while ((Link->Held & (1u << FRAME_SLOT(Link->Next))) != 0)
+        {
+          Link->Held &= ~(1u << FRAME_SLOT(Link->Next));
+          FRAME_Hand(Link, Link->Window[FRAME_SLOT(Link->Next)]);
+        }
+      }
+      else if (distance < FRAME_WINDOW)
+      {
+        if ((Link->Held & (1u << FRAME_SLOT(seq))) == 0)
+        {
+          memcpy(Link->Window[FRAME_SLOT(seq)], Link->Rx, Link->Size);
+          Link->Held |= 1u << FRAME_SLOT(seq);
+        }
+      }
+      /* Otherwise handed over already: the FRAME_ACK got lost */
+      Link->Busy = 0;
+      FRAME_Ack(Link);
+      break;
+
+    case FRAME_POLL:
+      FRAME_Ack(Link);
+      break;
+
+    default:
+      break;
+  }
+}
+
+/**
+  * @brief  Hands the payload of the next frame over
+  * @param  Link: link
+  * @param  Frame: frame numbered Next
+  * @retval None
+  */
+static void FRAME_Hand(FRAME_Link* Link, const uint32_t* Frame)
+{
+  Link->Next++;
+  Link->Deliver(FRAME_TYPE(Frame), Frame + FRAME_HEADER_SIZE / 4, FRAME_LENGTH(Frame));
+}
@@ -0,0 +1,100 @@
+/**
+  ******************************************************************************
+  * @file    image_verify.c
+  * @brief   SHA-256 of a downloaded image computed while it is programmed,
+  *          and check of its ECDSA signature.
+  *
+  *          The download pipeline hands every piece of image to
+  *          VERIFY_Update() just before it is programmed, so the digest
+  *          costs no second read of the slot. The signature is checked
+  *          against the public key of image_key.h on curve sect163r2 by
+  *          ecdsa_verify() of lib/libikv.a.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "image_verify.h"
+#include "image_key.h"
+#include "ikv_crypto.h"
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+#define CURVE_DEGREE          163
+
+/* Private macro -------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+/* sect163r2 (NIST B-163), least significant word first */
+static dwordvec_t CurveA = {0x00000001};
+static dwordvec_t CurveSqrtB = {0x69F34DA5, 0xDA89C039, 0x3D21C366, 0xDF892759, 0xC25B85BA, 0x00000002};
+static dwordvec_t CurveGx = {0xE8343E36, 0xD4994637, 0xA0991168, 0x86A2D57E, 0xF0EBA162, 0x00000003};
+static dwordvec_t CurveGy = {0x797324F1, 0xB11C5C0C, 0xA2CDD545, 0x71A0094F, 0xD51FBC6C, 0x00000000};
+static dwordvec_t CurveOrder = {0xA4234C33, 0x77E70C12, 0x000292FE, 0x00000000, 0x00000000, 0x00000004};
+
+static curve_parameter_t Curve = {CURVE_DEGREE, CurveA, CurveSqrtB, CurveGx, CurveGy, CurveOrder};
+static eccpoint_t PublicKey = {IMAGE_KEY_X, IMAGE_KEY_Y};
+
+static sha256_context_t Sha;
+static uint8_t Digest[SHA256_DIGEST_SIZE];
+static uint32_t DigestValid = 0;
+
+/* Private function prototypes -----------------------------------------------*/
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Starts the digest of a new image
+  * @param  None
+  * @retval None
+  */
+void VERIFY_Start(void)
+{
+  DigestValid = 0;
+  sha256_init(&Sha);
+}
+
+/**
+  * @brief  Adds the next bytes of the image to the digest
+  * @param  Data: image bytes, in image order
+  * @param  Length: number of bytes, padding excluded
+  * @retval None
+  */
+void VERIFY_Update(const uint8_t* Data, uint32_t Length)
+{
+  sha256_update(Data, Length, &Sha);
+}
+
+/**
+  * @brief  Ends the digest, the whole image has been given
+  * @param  None
+  * @retval None
+  */
+void VERIFY_Finish(void)
+{
+  sha256_final(Digest, &Sha);
+  DigestValid = 1;
+}
+
+/**
+  * @brief  Checks the signature of the last image digested
+  * @note   Takes a few hundred milliseconds of CPU.
+  * @param  Signature: r then s, VERIFY_SIGNATURE_WORDS words each
+  * @retval 0: valid signature, 1: invalid or no complete image
+  */
+uint32_t VERIFY_Signature(const uint32_t* Signature)
+{
+  dwordvec_t r = {0};
+  dwordvec_t s = {0};
+  uint32_t i = 0;
+
+  if (DigestValid == 0)
+  {
+    return (1);
+  }
+
+  for (i = 0; i < VERIFY_SIGNATURE_WORDS; i++)
+  {
+    r[i] = Signature[i];
+    s[i] = Signature[VERIFY_SIGNATURE_WORDS + i];
+  }
+
+  return (ecdsa_verify(r, s, Digest, &PublicKey, &Curve) != 0) ? 0 : 1;
+}
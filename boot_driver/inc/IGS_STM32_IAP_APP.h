@@ -21,6 +21,7 @@
 #ifdef IAP_COM_USART1
 	#define IAP_COM										 USART1
 	#define IAP_CLK                    RCC_APB2Periph_USART1
+	#define IAP_PCLK(clocks)           ((clocks).PCLK2_Frequency)
 	#define IAP_TX_PIN                 GPIO_Pin_9
 	#define IAP_TX_GPIO_PORT           GPIOA
 	#define IAP_TX_GPIO_CLK            RCC_AHB1Periph_GPIOA
@@ -34,19 +35,15 @@
 	#define IAP_IRQn                   USART1_IRQn
 	#define IAP_COM_IRQHandler				 USART1_IRQHandler
 	
-	#define IAP_DMA                    DMA2
-	#define IAP_DMA_CLK                RCC_AHB1Periph_DMA2
-	#define IAP_TX_DMA_CHANNEL         DMA_Channel_4
-	#define IAP_TX_DMA_STREAM          DMA2_Stream7
-	
-	#define IAP_TX_IT_TCIF             DMA_IT_TCIF7
-	#define IAP_TX_DMA_RX_IRQn         DMA2_Stream7_IRQn
-	#define IAP_TX_DMA_TX_IRQHandler   DMA2_Stream7_IRQHandler
+	/* Streams from dma_manager.h */
+	#define IAP_TX_DMA_REQUEST         DMAM_USART1_TX
+	#define IAP_RX_DMA_REQUEST         DMAM_USART1_RX
 #endif
 
 #ifdef  IAP_COM_USART2
 	#define IAP_COM										 USART2
 	#define IAP_CLK                    RCC_APB1Periph_USART2
+	#define IAP_PCLK(clocks)           ((clocks).PCLK1_Frequency)
 	#define IAP_TX_PIN                 GPIO_Pin_2
 	#define IAP_TX_GPIO_PORT           GPIOA
 	#define IAP_TX_GPIO_CLK            RCC_AHB1Periph_GPIOA
@@ -60,19 +57,15 @@
 	#define IAP_IRQn                   USART2_IRQn
 	#define IAP_COM_IRQHandler				 USART2_IRQHandler
 	
-	#define IAP_DMA                    DMA1
-	#define IAP_DMA_CLK                RCC_AHB1Periph_DMA1
-	#define IAP_TX_DMA_CHANNEL         DMA_Channel_4
-	#define IAP_TX_DMA_STREAM          DMA1_Stream5
-	
-	#define IAP_TX_IT_TCIF             DMA_IT_TCIF5
-	#define IAP_TX_DMA_RX_IRQn         DMA1_Stream5_IRQn
-	#define IAP_TX_DMA_TX_IRQHandler   DMA1_Stream5_IRQHandler
+	/* Streams from dma_manager.h */
+	#define IAP_TX_DMA_REQUEST         DMAM_USART2_TX
+	#define IAP_RX_DMA_REQUEST         DMAM_USART2_RX
 #endif
 
 #ifdef  IAP_COM_USART3
 	#define IAP_COM										 USART3
 	#define IAP_CLK                    RCC_APB1Periph_USART3
+	#define IAP_PCLK(clocks)           ((clocks).PCLK1_Frequency)
 	#define IAP_TX_PIN                 GPIO_Pin_10
 	#define IAP_TX_GPIO_PORT           GPIOB
 	#define IAP_TX_GPIO_CLK            RCC_AHB1Periph_GPIOB
@@ -86,19 +79,84 @@
 	#define IAP_IRQn                   USART3_IRQn
 	#define IAP_COM_IRQHandler				 USART3_IRQHandler
 	
-	#define IAP_DMA                    DMA1
-	#define IAP_DMA_CLK                RCC_AHB1Periph_DMA1
-	#define IAP_TX_DMA_CHANNEL         DMA_Channel_4
-	#define IAP_TX_DMA_STREAM          DMA1_Stream3
-	
-	#define IAP_TX_IT_TCIF             DMA_IT_TCIF3
-	#define IAP_TX_DMA_RX_IRQn         DMA1_Stream3_IRQn
-	#define IAP_TX_DMA_TX_IRQHandler   DMA1_Stream3_IRQHandler
+	/* Streams from dma_manager.h */
+	#define IAP_TX_DMA_REQUEST         DMAM_USART3_TX
+	#define IAP_RX_DMA_REQUEST         DMAM_USART3_RX
 #endif
 
+/* Download: the image is streamed in blocks of IAP_DL_BLOCK_SIZE bytes into
+   two DMA buffers. The host pads the last block with 0xFF, only the length
+   given in the header is programmed.
+   Header: image length, CRC unit value over the image (0xFF padded to a
+   word), both 32-bit little endian. The image goes to the slot that is not
+   running (CMD_Return_Slot) and must be linked for that slot.
+   CMD_Download_LZ streams the image compressed by tools/lz4_pack.py, its
+   header is the 'IKVZ' magic, image length, image CRC and compressed
+   length.
+   CMD_Download_Delta streams a patch made by tools/delta_diff.py against
+   the running image, its header is the 'IKVD' magic, image length, image
+   CRC, patch length, running image length and running image CRC.
+   The image is hashed (SHA-256) while it is programmed. CMD_Activate needs
+   its signature first: CMD_Signature followed by the VERIFY_SIGNATURE_SIZE
+   bytes made by tools/image_sign.py. */
+#define IAP_DL_BLOCK_SIZE          2048
+#define IAP_DL_HEADER_SIZE         8
+#define IAP_DL_LZ_HEADER_SIZE      16
+#define IAP_DL_LZ_MAGIC            0x5A564B49  /* "IKVZ" */
+#define IAP_DL_DELTA_HEADER_SIZE   24
+#define IAP_DL_DELTA_MAGIC         0x44564B49  /* "IKVD" */
+
+/* Baud rate: the link starts at IAP_BAUD_DEFAULT. CMD_Baud and the new rate
+   (32-bit little endian) are answered CMD_ACK at the current rate, then the
+   host sends the IAP_BAUD_PATTERN_SIZE bytes 0x00..0xFF at the new rate,
+   the board echoes them, the host confirms with CMD_ACK and the board
+   answers CMD_ACK. Any other byte, or a framing, noise or overrun error,
+   goes back to the previous rate and ignores everything until the host
+   sends IAP_BAUD_SYNC at that rate, answered CMD_ACK.
+   Divisors below 16 use the 8x oversampling and the one sample bit method.
+   Bytes received with an error are never taken as commands. */
+#define IAP_BAUD_DEFAULT           115200
+#define IAP_BAUD_MAX               3750000
+#define IAP_BAUD_HEADER_SIZE       4
+#define IAP_BAUD_PATTERN_SIZE      256
+#define IAP_BAUD_TOLERANCE         15      /* per mille */
+#define IAP_BAUD_SYNC              {'S', 'Y', 'N', 'C'}
+#define IAP_BAUD_SYNC_SIZE         4
+
+/* Framed link: CMD_Frame is answered CMD_ACK, then the link carries the
+   frames of iap_frame.h until the next reset. The commands are sent in
+   FRAME_CMD frames, the download stream in FRAME_DATA frames (a multiple
+   of 4 bytes but the last one, no padding to IAP_DL_BLOCK_SIZE) and the
+   answers come back in the FRAME_ACK frames. CMD_Baud is refused there,
+   the rate is set before. The RX DMA fills a ring of IAP_FRAME_RING_SIZE
+   bytes, enough for the FRAME_WINDOW frames the host may have in flight. */
+#define IAP_FRAME_RING_SIZE        10240
+/* Ring bytes handed to the frame link at a time, less than a data frame */
+#define IAP_FRAME_POLL_SIZE        256
+
+/* Delta download: DELTA_Apply() is called again from the RX DMA interrupt,
+   set pending, while it has work left. The ring is not parsed meanwhile;
+   on the framed link a FRAME_ACK every IAP_DELTA_ACK_CALLS calls keeps the
+   host from sending its window again. */
+#define IAP_DELTA_ACK_CALLS        8
+
+/* Profile: CMD_Profile is answered with the PROF_DUMP_SIZE bytes of the
+   probe table of profile.h (tools/iap_profile.py). Raw link only, it is
+   refused on the framed link. */
+
 enum {
 	CMD_Return_Ver	= 0xC1,
 	CMD_RunPROG			=0xC2,
+	CMD_Download		=0xC3,
+	CMD_Activate		=0xC4,
+	CMD_Rollback		=0xC5,
+	CMD_Return_Slot	=0xC6,
+	CMD_Download_LZ	=0xC7,
+	CMD_Download_Delta	=0xC8,
+	CMD_Signature		=0xC9,
+	CMD_Baud				=0xCA,
+	CMD_Frame				=0xCB,
+	CMD_Profile			=0xCC,
 	
 	CMD_ACK		= 0xA3,
 	CMD_NACK	= 0xA4,
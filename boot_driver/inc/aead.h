@@ -0,0 +1,68 @@
+/**
+  ******************************************************************************
+  * @file    aead.h
+  * @brief   AES-GCM and AES-CCM authenticated encryption on the CRYP: the
+  *          block cipher runs on the peripheral, the authentication in the
+  *          same pass over the data.
+  *
+  *          GCM    the CRYP ciphers in AES-CTR from J0, whose first block
+  *                 gives the key stream of the tag. GHASH is done by the
+  *                 processor with a table of the 16 multiples of H by a
+  *                 4-bit value, made once per key: 32 table reads and
+  *                 shifts of four words per block.
+  *          CCM    the CRYP runs in AES-ECB. Each block of the message
+  *                 takes two blocks through the FIFO, the CBC-MAC of the
+  *                 previous block and the next counter, so that both go
+  *                 through the core in one wait.
+  *
+  *          The functions wait for the CRYP; they borrow the peripheral
+  *          from cryp_engine.c and fail while a session is queued there.
+  *          A decryption whose tag does not match clears the output.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __AEAD_H
+#define __AEAD_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f2xx.h"
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint32_t KeySize;         /* CRYP_KeySize_128b, _192b or _256b */
+  uint32_t Key[8];          /* K0LR to K3RR as written to the registers */
+  uint32_t Table[16][4];    /* multiples of H for GHASH, first word highest */
+} AEAD_Key;
+
+/* Exported constants --------------------------------------------------------*/
+/* Status of the functions */
+#define AEAD_OK               0
+#define AEAD_BUSY             1     /* cryp_engine.c has a session queued */
+#define AEAD_TIMEOUT          2     /* the CRYP did not give a block */
+#define AEAD_LENGTH           3     /* key, IV, nonce or tag length */
+#define AEAD_AUTH             4     /* the tag does not match */
+
+#define AEAD_TAG_SIZE         16
+
+/* Exported functions ------------------------------------------------------- */
+uint32_t AEAD_SetKey(AEAD_Key* Key, const uint8_t* Bytes, uint32_t KeyBits);
+uint32_t AEAD_GcmEncrypt(const AEAD_Key* Key, const uint8_t* Iv, uint32_t IvLength,
+                         const uint8_t* Aad, uint32_t AadLength,
+                         const uint8_t* Input, uint8_t* Output, uint32_t Length,
+                         uint8_t* Tag, uint32_t TagLength);
+uint32_t AEAD_GcmDecrypt(const AEAD_Key* Key, const uint8_t* Iv, uint32_t IvLength,
+                         const uint8_t* Aad, uint32_t AadLength,
+                         const uint8_t* Input, uint8_t* Output, uint32_t Length,
+                         const uint8_t* Tag, uint32_t TagLength);
+uint32_t AEAD_CcmEncrypt(const AEAD_Key* Key, const uint8_t* Nonce, uint32_t NonceLength,
+                         const uint8_t* Aad, uint32_t AadLength,
+                         const uint8_t* Input, uint8_t* Output, uint32_t Length,
+                         uint8_t* Tag, uint32_t TagLength);
+uint32_t AEAD_CcmDecrypt(const AEAD_Key* Key, const uint8_t* Nonce, uint32_t NonceLength,
+                         const uint8_t* Aad, uint32_t AadLength,
+                         const uint8_t* Input, uint8_t* Output, uint32_t Length,
+                         const uint8_t* Tag, uint32_t TagLength);
+
+#endif  /* __AEAD_H */
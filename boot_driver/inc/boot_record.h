@@ -0,0 +1,55 @@
+/**
+  ******************************************************************************
+  * @file    boot_record.h
+  * @brief   Boot selection record of the dual slot (A/B) layout, shared by
+  *          the boot selector and the IAP shim.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __BOOT_RECORD_H
+#define __BOOT_RECORD_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f2xx.h"
+#include "flash_if.h"
+
+/* Exported types ------------------------------------------------------------*/
+/* One record is 8 words. Records are appended to the record sectors, the
+   valid record with the highest Sequence is the current one. A record cut by
+   a reset fails its Check and is ignored, so switching slot is atomic. */
+typedef struct
+{
+  uint32_t Magic;       /* BOOT_RECORD_MAGIC */
+  uint32_t Sequence;    /* incremented for each record written */
+  uint32_t Active;      /* BOOT_SLOT_A or BOOT_SLOT_B */
+  uint32_t State;       /* BOOT_STATE_CONFIRMED or BOOT_STATE_TRIAL */
+  uint32_t Attempts;    /* boots of a BOOT_STATE_TRIAL image */
+  uint32_t Size;        /* length of the active image in bytes, 0 if unknown */
+  uint32_t Crc;         /* CRC unit value over the active image */
+  uint32_t Check;       /* CRC unit value over the previous words */
+} BOOT_Record;
+
+/* Exported constants --------------------------------------------------------*/
+#define BOOT_RECORD_MAGIC     ((uint32_t)0x424F4F54)  /* "BOOT" */
+
+#define BOOT_SLOT_A           0
+#define BOOT_SLOT_B           1
+
+/* A new image boots in TRIAL state until the IAP shim confirms it. After
+   BOOT_TRIAL_MAX unconfirmed boots the selector goes back to the other slot. */
+#define BOOT_STATE_CONFIRMED  ((uint32_t)0x00000000)
+#define BOOT_STATE_TRIAL      ((uint32_t)0x54524941)  /* "TRIA" */
+#define BOOT_TRIAL_MAX        3
+
+/* Exported macro ------------------------------------------------------------*/
+#define BOOT_OTHER_SLOT(slot) ((slot) ^ 1)
+
+/* Exported functions ------------------------------------------------------- */
+uint32_t BOOT_ReadRecord(BOOT_Record* Record);
+uint32_t BOOT_WriteRecord(BOOT_Record* Record);
+uint32_t BOOT_SlotAddress(uint32_t Slot);
+uint32_t BOOT_IsValidImage(uint32_t Slot);
+uint32_t BOOT_ImageCrc(uint32_t Slot, uint32_t Size);
+
+#endif  /* __BOOT_RECORD_H */
@@ -0,0 +1,94 @@
+/**
+  ******************************************************************************
+  * @file    cryp_engine.h
+  * @brief   AES, DES and TDES on the CRYP peripheral fed by two DMA2
+  *          streams, CRYP_IN and CRYP_OUT. CENG_Run() starts the streams and
+  *          returns; the end of the CRYP_OUT stream calls back.
+  *
+  *          A session holds the mode, the key and the IV in the layout of
+  *          CRYP_Context. The IV the peripheral ends with is kept in it, a
+  *          message can be given in several calls. The peripheral is loaded
+  *          again only when another session runs.
+  *
+  *          Several sessions share the peripheral. CENG_Run() queues the
+  *          buffer of a session; the engine ciphers it in slices of
+  *          CENG_SLICE_BYTES, and at the end of each slice the first session
+  *          of the queue runs: the lowest priority value, sessions of the
+  *          same priority in turn. A command session waits for one slice of
+  *          a bulk session at most.
+  *
+  *          CENG_Lock() lends the peripheral to code that drives the
+  *          registers itself, as aead.c does.
+  *
+  *          The output may be the input: CRYP_OUT writes a block once
+  *          CRYP_IN has read it. Lengths are whole blocks, 16 bytes for AES
+  *          and 8 for DES and TDES, and both buffers word aligned.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CRYP_ENGINE_H
+#define __CRYP_ENGINE_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f2xx.h"
+
+/* Exported types ------------------------------------------------------------*/
+/* Status: CENG_OK, or CENG_ERROR for a DMA transfer error or a key
+   preparation that did not end */
+typedef void (*CENG_Callback)(void* Context, uint32_t Status);
+
+typedef struct
+{
+  uint32_t Runs;        /* buffers done */
+  uint32_t Bytes;
+  uint32_t Slices;
+  uint32_t Cycles;      /* processor cycles with the peripheral busy on it */
+  uint32_t Waiting;     /* cycles from CENG_Run() to the first slice */
+} CENG_Stats;
+
+typedef struct CENG_Session_s
+{
+  CRYP_Context Saved;   /* CR bits, IV and key as written to the registers */
+  uint32_t BlockBytes;
+  uint32_t Priority;    /* CENG_PRIORITY_, the lowest value runs first */
+  struct CENG_Session_s* Next;
+  uint32_t Queued;
+  const uint8_t* Input; /* left of the buffer */
+  uint8_t* Output;
+  uint32_t Length;
+  uint32_t Slice;       /* bytes of the slice under way */
+  uint32_t Started;     /* DWT cycle count of CENG_Run() or of the slice */
+  uint32_t First;       /* no slice run yet */
+  CENG_Callback Done;
+  void* DoneContext;
+  CENG_Stats Stats;
+} CENG_Session;
+
+/* Exported constants --------------------------------------------------------*/
+/* Status of the functions and of the callback */
+#define CENG_OK               0
+#define CENG_ERROR            1     /* DMA transfer error or key preparation */
+#define CENG_BUSY             2     /* a run is under way */
+#define CENG_LENGTH           3     /* not whole blocks or not aligned */
+#define CENG_NO_STREAM        4     /* CRYP_IN or CRYP_OUT is taken */
+
+#define CENG_PRIORITY_COMMAND 0
+#define CENG_PRIORITY_BULK    1     /* set by CENG_Setup() */
+
+/* Bytes ciphered before the next session may run, whole AES blocks */
+#define CENG_SLICE_BYTES      512
+
+/* Exported functions ------------------------------------------------------- */
+uint32_t CENG_Init(void);
+uint32_t CENG_Setup(CENG_Session* Session, uint16_t AlgoMode, uint16_t AlgoDir,
+                    const uint8_t* Key, uint32_t KeyBits, const uint8_t* InitVector);
+uint32_t CENG_Run(CENG_Session* Session, const void* Input, void* Output, uint32_t Length,
+                  CENG_Callback Done, void* Context);
+uint32_t CENG_Busy(const CENG_Session* Session);
+void CENG_SetPriority(CENG_Session* Session, uint32_t Priority);
+void CENG_GetStats(const CENG_Session* Session, CENG_Stats* Stats);
+uint32_t CENG_Lock(void);
+void CENG_Unlock(void);
+
+#endif  /* __CRYP_ENGINE_H */
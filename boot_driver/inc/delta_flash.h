@@ -0,0 +1,70 @@
+/**
+  ******************************************************************************
+  * @file    delta_flash.h
+  * @brief   Streaming patcher rebuilding a new image in flash from the
+  *          resident image and a delta stream made by tools/delta_diff.py.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __DELTA_FLASH_H
+#define __DELTA_FLASH_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f2xx.h"
+#include "flash_if.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* The stream is a list of operations, each an op byte followed by varints
+   (7 bits per byte, least significant first, bit 7 set on all but the last
+   byte). Len is a byte count, Seek a signed zigzag coded move of the old
+   image position done before the operation.
+     DELTA_OP_COPY  Len Seek          new = old
+     DELTA_OP_ADD   Len Seek bytes[]  new = old + byte (modulo 256)
+     DELTA_OP_DATA  Len bytes[]       new = byte, the old position stays
+   COPY and ADD advance the old image position by Len. */
+#define DELTA_OP_COPY         0x00
+#define DELTA_OP_ADD          0x01
+#define DELTA_OP_DATA         0x02
+
+/* New bytes are gathered in a window of DELTA_WINDOW_SIZE bytes and
+   programmed when it is full */
+#define DELTA_WINDOW_SIZE     1024
+
+/* A COPY is expanded by at most DELTA_COPY_MAX bytes per DELTA_Apply()
+   call, the rest at the next calls. The stream received meanwhile is held,
+   up to DELTA_HOLD_SIZE bytes: a window of frames of the framed link, four
+   blocks of the raw one. */
+#define DELTA_COPY_MAX        DELTA_WINDOW_SIZE
+#define DELTA_HOLD_SIZE       8192
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint32_t State;
+  uint32_t Op;
+  uint32_t Len;
+  uint32_t Seek;
+  uint32_t Shift;       /* of the next varint byte */
+  uint32_t Old;         /* flash address of the resident image */
+  uint32_t OldSize;     /* resident image length */
+  uint32_t OldPos;      /* position in the resident image */
+  uint32_t Size;        /* expected new image length */
+  uint32_t Out;         /* new bytes so far */
+  uint32_t Flushed;     /* bytes programmed so far */
+  uint32_t Error;
+  uint32_t Held;        /* stream bytes in Hold, not parsed yet */
+  FLASH_If_Output Output;   /* given each piece before it is programmed, or 0 */
+  __IO uint32_t Address;
+  uint32_t Window[DELTA_WINDOW_SIZE / 4];
+  uint8_t Hold[DELTA_HOLD_SIZE];
+} DELTA_Patch;
+
+/* Exported functions ------------------------------------------------------- */
+void DELTA_Init(DELTA_Patch* Patch, uint32_t Base, uint32_t Size, uint32_t Old, uint32_t OldSize,
+                FLASH_If_Output Output);
+uint32_t DELTA_Apply(DELTA_Patch* Patch, const uint8_t* In, uint32_t Length);
+uint32_t DELTA_Pending(const DELTA_Patch* Patch);
+uint32_t DELTA_Finish(DELTA_Patch* Patch);
+
+#endif  /* __DELTA_FLASH_H */
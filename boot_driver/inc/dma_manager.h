@@ -0,0 +1,82 @@
+/**
+  ******************************************************************************
+  * @file    dma_manager.h
+  * @brief   Owner of the 16 DMA streams. A driver asks for a request (a
+  *          peripheral and a direction) and gets a free stream of the
+  *          request mapping of RM0033 with its channel; two drivers can no
+  *          longer take the same stream unnoticed, DMAM_Alloc() fails
+  *          instead.
+  *
+  *          The stream interrupts are handled here: the flags of the stream
+  *          are read, cleared and given to the callback of the owner. A
+  *          stream interrupt set pending by software calls it with no flag.
+  *          The owner sets the NVIC priority and enables DMAM_Stream.IRQn.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __DMA_MANAGER_H
+#define __DMA_MANAGER_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f2xx.h"
+
+/* Exported types ------------------------------------------------------------*/
+/* Requests, the streams able to serve them are in dma_manager.c */
+typedef enum
+{
+  DMAM_USART1_RX = 0,
+  DMAM_USART1_TX,
+  DMAM_USART2_RX,
+  DMAM_USART2_TX,
+  DMAM_USART3_RX,
+  DMAM_USART3_TX,
+  DMAM_USART6_RX,
+  DMAM_USART6_TX,
+  DMAM_SPI1_RX,
+  DMAM_SPI1_TX,
+  DMAM_SPI2_RX,
+  DMAM_SPI2_TX,
+  DMAM_ADC1,
+  DMAM_HASH_IN,
+  DMAM_CRYP_IN,
+  DMAM_CRYP_OUT,
+  DMAM_MEM,             /* memory to memory, DMA2 only */
+  DMAM_REQUEST_COUNT
+} DMAM_Request;
+
+/* Flags: DMAM_FLAG_ bits, cleared already */
+typedef void (*DMAM_Callback)(void* Context, uint32_t Flags);
+
+typedef struct
+{
+  DMA_Stream_TypeDef* Stream;
+  uint32_t Channel;     /* DMA_Channel_x, for DMA_InitTypeDef */
+  IRQn_Type IRQn;
+  DMAM_Request Request;
+} DMAM_Stream;
+
+typedef struct
+{
+  uint32_t Allocated;   /* bit n: stream n taken, DMA1 streams 0 to 7 then DMA2 */
+  uint32_t Refused;     /* DMAM_Alloc() calls without a free stream */
+  uint32_t Interrupts[16];
+} DMAM_Usage;
+
+/* Exported constants --------------------------------------------------------*/
+/* Flags of a stream, at the place of the stream 0 flags in LISR */
+#define DMAM_FLAG_FE          0x01    /* FIFO error */
+#define DMAM_FLAG_DME         0x04    /* direct mode error */
+#define DMAM_FLAG_TE          0x08    /* transfer error */
+#define DMAM_FLAG_HT          0x10    /* half transfer */
+#define DMAM_FLAG_TC          0x20    /* transfer complete */
+#define DMAM_FLAG_ALL         0x3D
+
+/* Exported functions ------------------------------------------------------- */
+const DMAM_Stream* DMAM_Alloc(DMAM_Request Request, DMAM_Callback Callback, void* Context);
+void DMAM_Free(const DMAM_Stream* Stream);
+uint32_t DMAM_GetFlags(const DMAM_Stream* Stream);
+void DMAM_ClearFlags(const DMAM_Stream* Stream, uint32_t Flags);
+void DMAM_GetUsage(DMAM_Usage* Usage);
+
+#endif  /* __DMA_MANAGER_H */
@@ -0,0 +1,57 @@
+/**
+  ******************************************************************************
+  * @file    dma_mem.h
+  * @brief   Memory to memory copy and fill on a DMA2 stream. The caller
+  *          goes on while the stream moves the words and is told the end by
+  *          a callback from the stream interrupt.
+  *
+  *          The stream reads and writes whole words through its FIFO, in
+  *          bursts of 4 words when both ends are on 16 bytes. The bytes
+  *          before the first word and after the last one are copied by the
+  *          processor before the stream is started. Blocks under the
+  *          threshold, blocks the stream can not take (source and
+  *          destination not aligned alike, more than 65535 words) and every
+  *          block when no stream was free are copied by the processor and
+  *          the callback is called before DMEM_Copy() returns.
+  *
+  *          The threshold is measured by DMEM_Init() on the DWT cycle
+  *          counter: the bytes the processor copies in the time the stream
+  *          takes to set up and move one word. It follows the clock, the
+  *          wait states and the bus load of the board at init.
+  *
+  *          One transfer runs at a time. The stream has the low priority:
+  *          the peripheral streams go first.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __DMA_MEM_H
+#define __DMA_MEM_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f2xx.h"
+
+/* Exported types ------------------------------------------------------------*/
+/* Status: 0 done, 1 transfer error. Called from the stream interrupt or
+   from DMEM_Copy()/DMEM_Fill() */
+typedef void (*DMEM_Callback)(void* Context, uint32_t Status);
+
+/* Exported constants --------------------------------------------------------*/
+/* Bytes under which the processor copies when DMEM_Init() can not measure
+   it: the stream did not end, as under QEMU, or the cycle counter does not
+   run */
+#ifndef DMEM_THRESHOLD
+#define DMEM_THRESHOLD        256
+#endif
+
+/* Exported functions ------------------------------------------------------- */
+uint32_t DMEM_Init(void);
+uint32_t DMEM_Copy(void* Destination, const void* Source, uint32_t Length,
+                   DMEM_Callback Done, void* Context);
+uint32_t DMEM_Fill(void* Destination, uint8_t Value, uint32_t Length,
+                   DMEM_Callback Done, void* Context);
+uint32_t DMEM_Busy(void);
+void DMEM_SetThreshold(uint32_t Bytes);
+uint32_t DMEM_GetThreshold(void);
+
+#endif  /* __DMA_MEM_H */
@@ -27,6 +27,12 @@
 #include "stm32f2xx.h"
 
 /* Exported types ------------------------------------------------------------*/
+/* Called from the FLASH interrupt when an asynchronous erase is over,
+   Status is 0 on success and 1 on error */
+typedef void (*FLASH_If_Callback)(uint32_t Status);
+/* Given the bytes of an image before they are programmed */
+typedef void (*FLASH_If_Output)(const uint8_t* Data, uint32_t Length);
+
 /* Exported constants --------------------------------------------------------*/
 /* Base address of the Flash sectors */
 #define ADDR_FLASH_SECTOR_0     ((uint32_t)0x08000000) /* Base @ of Sector 0, 16 Kbyte */
@@ -51,11 +57,31 @@
    Note: the 1st sector 0x08000000-0x08003FFF is reserved for the IAP code */
 #define APPLICATION_ADDRESS   (uint32_t)0x08005000
 
+/* Flash map of the dual slot (A/B) layout:
+   0x08000000 - 0x08004FFF  IGS boot loader
+   0x08005000 - 0x08007FFF  boot selector, at APPLICATION_ADDRESS
+   sectors 2 and 3          boot selection records (boot_record.h)
+   sector 4                 reserved
+   sectors 5 to 7           application slot A
+   sectors 8 to 10          application slot B
+   sector 11                scratch sector */
+#define BOOT_SELECT_ADDRESS   APPLICATION_ADDRESS
+#define BOOT_RECORD_ADDRESS_0 ADDR_FLASH_SECTOR_2
+#define BOOT_RECORD_ADDRESS_1 ADDR_FLASH_SECTOR_3
+#define BOOT_RECORD_SIZE      (ADDR_FLASH_SECTOR_3 - ADDR_FLASH_SECTOR_2)
+#define SLOT_A_ADDRESS        ADDR_FLASH_SECTOR_5
+#define SLOT_B_ADDRESS        ADDR_FLASH_SECTOR_8
+#define SLOT_SIZE             (ADDR_FLASH_SECTOR_8 - ADDR_FLASH_SECTOR_5)
+#define SCRATCH_ADDRESS       ADDR_FLASH_SECTOR_11
+
 /* Exported macro ------------------------------------------------------------*/
 /* Exported functions ------------------------------------------------------- */
 void FLASH_If_Init(void);
 uint32_t FLASH_If_Erase(uint32_t StartSector);
+uint32_t FLASH_If_EraseStart(uint32_t Address, uint32_t Length, FLASH_If_Callback Done);
+uint32_t FLASH_If_EraseBusy(void);
 uint32_t FLASH_If_Write(__IO uint32_t* FlashAddress, uint32_t* Data, uint16_t DataLength);
+uint32_t FLASH_If_WriteBlock(__IO uint32_t* FlashAddress, uint32_t* Data, uint32_t DataLength);
 uint16_t FLASH_If_GetWriteProtectionStatus(void);
 uint32_t FLASH_If_DisableWriteProtection(void);
 
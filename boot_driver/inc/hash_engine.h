@@ -0,0 +1,72 @@
+/**
+  ******************************************************************************
+  * @file    hash_engine.h
+  * @brief   SHA-1 and MD5 of messages given in pieces, on the HASH
+  *          peripheral, without waiting for it. HENG_Update() and
+  *          HENG_Final() queue the piece and return; the HASH interrupt
+  *          feeds it a block at a time and calls back at the end.
+  *
+  *          Several messages can be under way: the peripheral state of a
+  *          context is kept in it with HASH_SaveContext() while another
+  *          context runs, and a context gives the peripheral to the next
+  *          one after HENG_SLICE_BLOCKS blocks.
+  *
+  *          Every piece is fed by the interrupt. The HASH of the STM32F2
+  *          starts the final digest at the end of a DMA transfer, so only
+  *          the last piece could go on the DMAM_HASH_IN stream, and that is
+  *          DMA2 stream 7, held by the IAP for USART1_TX.
+  *
+  *          A driver using the peripheral itself, hmac_key.c, takes it with
+  *          HENG_Lock() between two pieces; the queued pieces wait for
+  *          HENG_Unlock().
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __HASH_ENGINE_H
+#define __HASH_ENGINE_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f2xx.h"
+
+/* Exported types ------------------------------------------------------------*/
+/* Status: 0 done */
+typedef void (*HENG_Callback)(void* Context, uint32_t Status);
+
+typedef struct HENG_Context_s
+{
+  struct HENG_Context_s* Next;  /* queue of the engine */
+  HASH_Context Saved;           /* peripheral state while another context runs */
+  uint32_t Algorithm;           /* HASH_AlgoSelection_SHA1 or _MD5 */
+  uint32_t Started;             /* the peripheral or Saved holds the message */
+  uint32_t Queued;
+  uint32_t Words;               /* words of the message written */
+  uint8_t Lead[4];              /* bytes left by the last update */
+  uint32_t LeadBytes;
+  const uint8_t* Data;          /* piece under way */
+  uint32_t Length;
+  uint32_t Final;
+  uint8_t* Digest;
+  HENG_Callback Done;
+  void* DoneContext;
+} HENG_Context;
+
+/* Exported constants --------------------------------------------------------*/
+#define HENG_SHA1_SIZE        20
+#define HENG_MD5_SIZE         16
+
+/* Exported functions ------------------------------------------------------- */
+void HENG_Init(void);
+void HENG_Begin(HENG_Context* Context, uint32_t Algorithm);
+uint32_t HENG_Update(HENG_Context* Context, const void* Data, uint32_t Length,
+                     HENG_Callback Done, void* DoneContext);
+uint32_t HENG_Final(HENG_Context* Context, const void* Data, uint32_t Length, uint8_t* Digest,
+                    HENG_Callback Done, void* DoneContext);
+uint32_t HENG_Busy(const HENG_Context* Context);
+uint32_t HENG_Lock(void);
+void HENG_Unlock(void);
+/* DIN writes, for hmac_key.c */
+void HENG_Write(const uint8_t* Data, uint32_t Words);
+void HENG_WriteLast(const uint8_t* Data, uint32_t Bytes);
+
+#endif  /* __HASH_ENGINE_H */
@@ -0,0 +1,42 @@
+/**
+  ******************************************************************************
+  * @file    hmac_key.h
+  * @brief   HMAC-SHA1 and HMAC-MD5 of short messages with a key prepared
+  *          once. HMAC_SHA1() and HMAC_MD5() of the library reset the HASH
+  *          and write the key twice per message; here HKEY_Init() writes
+  *          the key blocks XORed with ipad and opad, a long key hashed
+  *          first, and keeps the two HASH states with HASH_SaveContext().
+  *          A message restores each state and finishes a plain hash from
+  *          it.
+  *
+  *          HKEY_Mac() waits for the HASH; it borrows the peripheral from
+  *          hash_engine.c and fails while a piece is under way there.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __HMAC_KEY_H
+#define __HMAC_KEY_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f2xx.h"
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint32_t Algorithm;   /* HASH_AlgoSelection_SHA1 or _MD5 */
+  HASH_Context Inner;   /* HASH state after the key XOR ipad */
+  HASH_Context Outer;   /* and after the key XOR opad */
+} HKEY_Context;
+
+/* Exported constants --------------------------------------------------------*/
+/* Status of HKEY_Init() and HKEY_Mac() */
+#define HKEY_OK               0
+#define HKEY_BUSY             1     /* hash_engine.c has a piece under way */
+#define HKEY_TIMEOUT          2     /* the HASH did not end */
+
+/* Exported functions ------------------------------------------------------- */
+uint32_t HKEY_Init(HKEY_Context* Context, uint32_t Algorithm, const uint8_t* Key, uint32_t KeyLength);
+uint32_t HKEY_Mac(const HKEY_Context* Context, const uint8_t* Message, uint32_t Length, uint8_t* Mac);
+
+#endif  /* __HMAC_KEY_H */
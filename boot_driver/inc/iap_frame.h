@@ -0,0 +1,82 @@
+/**
+  ******************************************************************************
+  * @file    iap_frame.h
+  * @brief   Framed IAP link: sequence numbered frames checked by a CRC, a
+  *          window of FRAME_WINDOW frames in flight and selective
+  *          acknowledgements, so that only the frames lost are sent again.
+  *          Independent of the hardware: the CRC and the port are given by
+  *          the caller, tools/frame_sim.c builds it for the host.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __IAP_FRAME_H
+#define __IAP_FRAME_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+/* Frame: header, Length payload bytes, 0xFF up to a word, then the CRC unit
+   value over the previous words. Header fields are little endian:
+     Magic   FRAME_MAGIC
+     Type    FRAME_CMD, FRAME_DATA, FRAME_POLL from the host, FRAME_ACK
+     Seq     16-bit sequence number of the frame
+     Length  16-bit payload length, at most FRAME_PAYLOAD_MAX
+     Ack     16-bit count of reply bytes
+   The host numbers its FRAME_CMD and FRAME_DATA frames and may send
+   FRAME_WINDOW of them before the first one is acknowledged. The board
+   hands their payloads over in sequence order and answers every frame with
+   a FRAME_ACK: Seq is the next frame it waits for, the payload is a 32-bit
+   bitmap of the frames after Seq it already holds (bit 0: Seq + 1)
+   followed by the reply bytes the host has not confirmed. Ack counts all
+   the reply bytes of the board; the host frames give back the count it
+   has received. FRAME_POLL is not numbered, it only asks for a FRAME_ACK.
+   Frames with a wrong CRC are dropped: the host sends again the frames
+   missing in the bitmap, or the oldest one after a timeout. */
+#define FRAME_MAGIC           0x7E
+#define FRAME_HEADER_SIZE     8
+#define FRAME_PAYLOAD_MAX     1024
+#define FRAME_SIZE_MAX        (FRAME_HEADER_SIZE + FRAME_PAYLOAD_MAX + 4)
+#define FRAME_WINDOW          8
+#define FRAME_REPLY_SIZE      64      /* reply bytes kept until confirmed, power of 2 */
+
+#define FRAME_CMD             0x01    /* command bytes, as sent on the raw link */
+#define FRAME_DATA            0x02    /* download stream bytes */
+#define FRAME_POLL            0x03
+#define FRAME_ACK             0x81
+
+/* Exported types ------------------------------------------------------------*/
+/* CRC unit value over Words words */
+typedef uint32_t (*FRAME_Crc)(const uint32_t* Data, uint32_t Words);
+/* Sends bytes to the host */
+typedef void (*FRAME_Send)(const uint8_t* Data, uint32_t Length);
+/* Payload of a FRAME_CMD or FRAME_DATA frame, in sequence order. Data is
+   word aligned. */
+typedef void (*FRAME_Deliver)(uint32_t Type, const uint32_t* Data, uint32_t Length);
+
+typedef struct
+{
+  FRAME_Crc Crc;
+  FRAME_Send Send;
+  FRAME_Deliver Deliver;
+  uint32_t Count;       /* bytes of the frame being received */
+  uint32_t Size;        /* its length, known once the header is in */
+  uint32_t Held;        /* Window slots holding a frame received early */
+  uint32_t Busy;        /* a frame is being handled, its FRAME_ACK follows */
+  uint16_t Next;        /* sequence number of the next frame to hand over */
+  uint16_t Replied;     /* reply bytes queued so far */
+  uint16_t Confirmed;   /* reply bytes the host has received */
+  uint8_t Reply[FRAME_REPLY_SIZE];
+  uint32_t Tx[(FRAME_HEADER_SIZE + 4 + FRAME_REPLY_SIZE + 4) / 4];
+  uint32_t Rx[FRAME_SIZE_MAX / 4];
+  uint32_t Window[FRAME_WINDOW][FRAME_SIZE_MAX / 4];
+} FRAME_Link;
+
+/* Exported functions ------------------------------------------------------- */
+void FRAME_Init(FRAME_Link* Link, FRAME_Crc Crc, FRAME_Send Send, FRAME_Deliver Deliver);
+void FRAME_Receive(FRAME_Link* Link, const uint8_t* Data, uint32_t Length);
+void FRAME_Reply(FRAME_Link* Link, uint8_t Data);
+void FRAME_Ack(FRAME_Link* Link);
+
+#endif  /* __IAP_FRAME_H */
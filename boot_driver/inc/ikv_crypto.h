@@ -0,0 +1,74 @@
+/**
+  ******************************************************************************
+  * @file    ikv_crypto.h
+  * @brief   Prototypes of the SHA-256, ECDSA and GF(2^163) routines of
+  *          lib/libikv.a.
+  *          The library comes without a header, the declarations follow the
+  *          debug information of its objects.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __IKV_CRYPTO_H
+#define __IKV_CRYPTO_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define SHA256_DIGEST_SIZE    32
+/* Field elements and integers modulo the order: least significant word
+   first, binary fields up to GF(2^193) */
+#define DWORDVEC_WORDS        7
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint32_t H[8];
+  uint32_t length;
+  unsigned int next;
+  uint8_t M[64];
+} sha256_context_t;
+
+typedef uint32_t dwordvec_t[DWORDVEC_WORDS];
+
+typedef struct
+{
+  dwordvec_t x_coord;
+  dwordvec_t y_coord;
+} eccpoint_t;
+
+/* Binary curve y^2 + xy = x^3 + a x^2 + b over GF(2^degree), degree 131,
+   163 or 193 */
+typedef struct
+{
+  unsigned int degree;
+  uint32_t* coeff_a;
+  uint32_t* coeff_sqrt_b;   /* square root of b */
+  uint32_t* base_point_x;
+  uint32_t* base_point_y;
+  uint32_t* order;
+} curve_parameter_t;
+
+/* Curve and field of ecc_init(), a single context inside the library */
+typedef struct ikv_crypto_ecc_context ikv_crypto_ecc_context;
+
+/* Exported functions ------------------------------------------------------- */
+void sha256_init(sha256_context_t* context);
+void sha256_update(const uint8_t* input_data, const uint32_t input_length, sha256_context_t* context);
+void sha256_final(uint8_t* hash_value, sha256_context_t* context);
+void sha256(uint8_t* hash_value, const uint8_t* input_data, const uint32_t input_length);
+
+/* Returns non zero for a valid signature. The hash is taken big endian and
+   truncated to the leftmost degree bits. */
+int ecdsa_verify(uint32_t* r_value, uint32_t* s_value, const uint8_t* hash_data,
+                 eccpoint_t* pub_key, curve_parameter_t* curve);
+
+/* Building blocks of ecdsa_verify(), timed by bench/bench.c */
+void gf2n_163_mul(uint32_t* out, const uint32_t* op1, const uint32_t* op2);
+ikv_crypto_ecc_context* ecc_init(const curve_parameter_t* p);
+/* Projective (X, Y, Z) of scalar times p, ecc_init() called before */
+void ecc_mul_projective(ikv_crypto_ecc_context* c, uint32_t* X, uint32_t* Y, uint32_t* Z,
+                        const eccpoint_t* p, const uint32_t* scalar);
+
+#endif  /* __IKV_CRYPTO_H */
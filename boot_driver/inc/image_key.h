@@ -0,0 +1,16 @@
+/**
+  ******************************************************************************
+  * @file    image_key.h
+  * @brief   Public key of the image signatures, made by
+  *          tools/image_sign.py genkey. Least significant word first.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __IMAGE_KEY_H
+#define __IMAGE_KEY_H
+
+#define IMAGE_KEY_X           {0xB62530AE, 0x6AF34FFD, 0xBF1F647C, 0x60FB754F, 0x3417FEDE, 0x00000002}
+#define IMAGE_KEY_Y           {0x74A2A76B, 0xFFF61E24, 0x88DA7477, 0x083F48BF, 0x13D9C2A8, 0x00000007}
+
+#endif  /* __IMAGE_KEY_H */
@@ -0,0 +1,28 @@
+/**
+  ******************************************************************************
+  * @file    image_verify.h
+  * @brief   SHA-256 of a downloaded image computed while it is programmed,
+  *          and check of its ECDSA signature.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __IMAGE_VERIFY_H
+#define __IMAGE_VERIFY_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f2xx.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* Signature: r then s, VERIFY_SIGNATURE_WORDS little endian words each,
+   least significant word first (tools/image_sign.py) */
+#define VERIFY_SIGNATURE_WORDS  6
+#define VERIFY_SIGNATURE_SIZE   (2 * 4 * VERIFY_SIGNATURE_WORDS)
+
+/* Exported functions ------------------------------------------------------- */
+void VERIFY_Start(void);
+void VERIFY_Update(const uint8_t* Data, uint32_t Length);
+void VERIFY_Finish(void);
+uint32_t VERIFY_Signature(const uint32_t* Signature);
+
+#endif  /* __IMAGE_VERIFY_H */
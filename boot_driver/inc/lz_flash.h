@@ -0,0 +1,46 @@
+/**
+  ******************************************************************************
+  * @file    lz_flash.h
+  * @brief   Streaming decoder of LZ4 block format sequences writing the
+  *          decoded image straight into flash.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __LZ_FLASH_H
+#define __LZ_FLASH_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f2xx.h"
+#include "flash_if.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* Decoded bytes are gathered in a window of LZ_WINDOW_SIZE bytes and
+   programmed when it is full. Matches older than the window are copied back
+   from the flash, so the match distance is not limited by the RAM. */
+#define LZ_WINDOW_SIZE        1024
+#define LZ_MIN_MATCH          4
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint32_t State;
+  uint32_t LitLen;
+  uint32_t MatchLen;
+  uint32_t Offset;
+  uint32_t Base;        /* flash address of the first decoded byte */
+  uint32_t Size;        /* expected decoded length */
+  uint32_t Out;         /* bytes decoded so far */
+  uint32_t Flushed;     /* bytes programmed so far */
+  uint32_t Error;
+  FLASH_If_Output Output;   /* given each piece before it is programmed, or 0 */
+  __IO uint32_t Address;
+  uint32_t Window[LZ_WINDOW_SIZE / 4];
+} LZ_Decoder;
+
+/* Exported functions ------------------------------------------------------- */
+void LZ_Init(LZ_Decoder* Lz, uint32_t Base, uint32_t Size, FLASH_If_Output Output);
+uint32_t LZ_Decode(LZ_Decoder* Lz, const uint8_t* In, uint32_t Length);
+uint32_t LZ_Finish(LZ_Decoder* Lz);
+
+#endif  /* __LZ_FLASH_H */
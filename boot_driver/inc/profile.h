@@ -0,0 +1,72 @@
+/**
+  ******************************************************************************
+  * @file    profile.h
+  * @brief   Named probe points timed by the DWT cycle counter. Each probe
+  *          keeps its count, minimum, maximum, total and a histogram of its
+  *          durations in a RAM table, sent to the host by CMD_Profile
+  *          (tools/iap_profile.py) without a debugger attached.
+  *
+  *          PROF_BEGIN(Probe) ... PROF_END(Probe) around the code to time.
+  *          The time includes the interrupts taken in between. A probe
+  *          must not be entered again before its PROF_END, so one probe
+  *          per interrupt handler or task. Without PROFILE defined the
+  *          macros are empty and only PROF_BOOT is filled, by PROF_Init().
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __PROFILE_H
+#define __PROFILE_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f2xx.h"
+
+/* Exported types ------------------------------------------------------------*/
+/* Probe points, the names sent to the host are in profile.c. The probes of
+   the application go before PROF_COUNT. */
+typedef enum
+{
+  PROF_IAP_COM_IRQ = 0,
+  PROF_IAP_RX_DMA_IRQ,
+  PROF_IAP_TX_DMA_IRQ,
+  PROF_FLASH_IRQ,
+  PROF_SIGNATURE,
+  PROF_BOOT,            /* Reset_Handler to main(), one pass per start */
+  PROF_COUNT
+} PROF_Probe;
+
+/* Exported constants --------------------------------------------------------*/
+/* Histogram: bucket 0 counts the durations below 2^(PROF_BUCKET_SHIFT + 1)
+   cycles, bucket n those from 2^(PROF_BUCKET_SHIFT + n) and the last one
+   everything above */
+#define PROF_BUCKETS          16
+#define PROF_BUCKET_SHIFT     5
+#define PROF_NAME_SIZE        12
+
+/* CMD_Profile answer, 32-bit fields little endian: a PROF_HEADER_SIZE
+   header (PROF_COUNT, PROF_BUCKETS, PROF_BUCKET_SHIFT, 0, core clock in
+   Hz) then for each probe PROF_NAME_SIZE bytes of NUL padded name, count,
+   minimum, maximum and mean in cycles and the PROF_BUCKETS counts */
+#define PROF_HEADER_SIZE      8
+#define PROF_RECORD_SIZE      (PROF_NAME_SIZE + 4 * (4 + PROF_BUCKETS))
+#define PROF_DUMP_SIZE        (PROF_HEADER_SIZE + PROF_COUNT * PROF_RECORD_SIZE)
+
+/* Exported macro ------------------------------------------------------------*/
+#ifdef PROFILE
+#define PROF_BEGIN(Probe)     (PROF_Start[(Probe)] = DWT->CYCCNT)
+#define PROF_END(Probe)       PROF_Record((Probe), DWT->CYCCNT - PROF_Start[(Probe)])
+#else
+#define PROF_BEGIN(Probe)     ((void)0)
+#define PROF_END(Probe)       ((void)0)
+#endif
+
+/* Exported variables --------------------------------------------------------*/
+extern uint32_t PROF_Start[PROF_COUNT];
+
+/* Exported functions ------------------------------------------------------- */
+void PROF_Init(void);
+void PROF_Record(PROF_Probe Probe, uint32_t Cycles);
+void PROF_Clear(void);
+const uint8_t* PROF_Dump(void);
+
+#endif  /* __PROFILE_H */
@@ -0,0 +1,60 @@
+/**
+  ******************************************************************************
+  * @file    rng_pool.h
+  * @brief   Pool of random words filled in the background by the RNG
+  *          interrupt. RNGP_GetBytes() takes words from the pool and never
+  *          waits for the RNG, which a new word takes 40 periods of its
+  *          48 MHz clock to make. Once the pool is full the interrupt is
+  *          masked; a take starts the refill.
+  *
+  *          Health checks: the first word after the RNG is enabled is only
+  *          kept to compare, and a word equal to the one before is dropped,
+  *          the continuous test the reference manual asks for. A seed error
+  *          restarts the RNG. Both are counted with the clock errors in
+  *          RNGP_Stats, with the time the refills take.
+  *
+  *          The RNG runs on PLL48CLK: SYSCLK_PROFILE_HSI stops the PLL, the
+  *          pool then stops filling until a PLL profile is back.
+  *
+  *          The RNG shares its vector with the HASH: HASH_RNG_IRQHandler()
+  *          of hash_engine.c calls RNGP_IRQHandler().
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __RNG_POOL_H
+#define __RNG_POOL_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f2xx.h"
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint32_t Words;         /* words put in the pool */
+  uint32_t Taken;         /* words taken, a part of a word is a word */
+  uint32_t Empty;         /* takes refused, the pool had too few words */
+  uint32_t Refills;       /* times the pool got full */
+  uint32_t RefillWords;   /* words of those refills */
+  uint32_t RefillCycles;  /* processor cycles of those refills */
+  uint32_t Repeats;       /* words equal to the previous one, dropped */
+  uint32_t SeedErrors;
+  uint32_t ClockErrors;
+} RNGP_Stats;
+
+/* Exported constants --------------------------------------------------------*/
+/* Words of the pool, a power of 2 */
+#define RNGP_POOL_WORDS       64
+
+/* Status of RNGP_GetBytes() */
+#define RNGP_OK               0
+#define RNGP_EMPTY            1     /* too few words in the pool, none taken */
+
+/* Exported functions ------------------------------------------------------- */
+void RNGP_Init(void);
+uint32_t RNGP_GetBytes(void* Buffer, uint32_t Length);
+uint32_t RNGP_Available(void);
+void RNGP_GetStats(RNGP_Stats* Stats);
+void RNGP_IRQHandler(void);
+
+#endif  /* __RNG_POOL_H */
@@ -0,0 +1,252 @@
+/**
+  ******************************************************************************
+  * @file    lz_flash.c
+  * @brief   Streaming decoder of LZ4 block format sequences writing the
+  *          decoded image straight into flash.
+  *
+  *          The compressed stream can be fed in pieces of any length, a
+  *          sequence may span several calls to LZ_Decode(). The flash area
+  *          must be erased and unlocked. tools/lz4_pack.py is the encoder.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "lz_flash.h"
+#include "flash_if.h"
+
+/* Private typedef -----------------------------------------------------------*/
+enum
+{
+  LZ_TOKEN = 0,
+  LZ_LIT_LEN,
+  LZ_LITERALS,
+  LZ_OFFSET_LO,
+  LZ_OFFSET_HI,
+  LZ_MATCH_LEN,
+};
+
+/* Private define ------------------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+#define WINDOW_BYTES(lz)      ((uint8_t*)(lz)->Window)
+
+/* Private variables ---------------------------------------------------------*/
+/* Private function prototypes -----------------------------------------------*/
+static void LZ_Put(LZ_Decoder* Lz, uint8_t Data);
+static void LZ_Copy(LZ_Decoder* Lz);
+static void LZ_Flush(LZ_Decoder* Lz);
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Prepares a decoder
+  * @param  Lz: decoder
+  * @param  Base: flash address the image is decoded to
+  * @param  Size: decoded image length in bytes
+  * @param  Output: called with the decoded bytes before they are
+  *         programmed, 0 if not needed
+  * @retval None
+  */
+void LZ_Init(LZ_Decoder* Lz, uint32_t Base, uint32_t Size, FLASH_If_Output Output)
+{
+  Lz->State = LZ_TOKEN;
+  Lz->LitLen = 0;
+  Lz->MatchLen = 0;
+  Lz->Offset = 0;
+  Lz->Base = Base;
+  Lz->Size = Size;
+  Lz->Out = 0;
+  Lz->Flushed = 0;
+  Lz->Error = 0;
+  Lz->Output = Output;
+  Lz->Address = Base;
+}
+
+/**
+  * @brief  Decodes a piece of the compressed stream
+  * @param  Lz: decoder
+  * @param  In: compressed bytes
+  * @param  Length: number of compressed bytes
+  * @retval 0: no error so far, 1: corrupted stream or flash error
+  */
+uint32_t LZ_Decode(LZ_Decoder* Lz, const uint8_t* In, uint32_t Length)
+{
+  uint32_t i = 0;
+  uint8_t c = 0;
+
+  for (i = 0; (i < Length) && (Lz->Error == 0); i++)
+  {
+    c = In[i];
+
+    switch (Lz->State)
+    {
+      case LZ_TOKEN:
+        Lz->LitLen = c >> 4;
+        Lz->MatchLen = (c & 0x0F) + LZ_MIN_MATCH;
+        if (Lz->LitLen == 15)
+        {
+          Lz->State = LZ_LIT_LEN;
+        }
+        else
+        {
+          Lz->State = (Lz->LitLen != 0) ? LZ_LITERALS : LZ_OFFSET_LO;
+        }
+        break;
+
+      case LZ_LIT_LEN:
+        Lz->LitLen += c;
+        if (c != 255)
+        {
+          Lz->State = LZ_LITERALS;
+        }
+        break;
+
+      case LZ_LITERALS:
+        LZ_Put(Lz, c);
+        if (--Lz->LitLen == 0)
+        {
+          Lz->State = LZ_OFFSET_LO;
+        }
+        break;
+
+      case LZ_OFFSET_LO:
+        Lz->Offset = c;
+        Lz->State = LZ_OFFSET_HI;
+        break;
+
+      case LZ_OFFSET_HI:
+        Lz->Offset |= (uint32_t)c << 8;
+        if (Lz->MatchLen == 15 + LZ_MIN_MATCH)
+        {
+          Lz->State = LZ_MATCH_LEN;
+        }
+        else
+        {
+          LZ_Copy(Lz);
+          Lz->State = LZ_TOKEN;
+        }
+        break;
+
+      case LZ_MATCH_LEN:
+        Lz->MatchLen += c;
+        if (c != 255)
+        {
+          LZ_Copy(Lz);
+          Lz->State = LZ_TOKEN;
+        }
+        break;
+
+      default:
+        Lz->Error = 1;
+        break;
+    }
+  }
+
+  return Lz->Error;
+}
+
+/**
+  * @brief  Ends the stream: checks it stopped after the literals of the last
+  *         sequence with the expected length, and programs the rest of the
+  *         window (the last word is padded with 0xFF)
+  * @param  Lz: decoder
+  * @retval 0: image completely decoded, 1: error
+  */
+uint32_t LZ_Finish(LZ_Decoder* Lz)
+{
+  if ((Lz->Error == 0) && (Lz->Out == Lz->Size) &&
+      ((Lz->State == LZ_OFFSET_LO) || (Lz->State == LZ_TOKEN)))
+  {
+    LZ_Flush(Lz);
+    return Lz->Error;
+  }
+  return (1);
+}
+
+/**
+  * @brief  Appends a decoded byte, programs the window when it is full
+  * @param  Lz: decoder
+  * @param  Data: decoded byte
+  * @retval None
+  */
+static void LZ_Put(LZ_Decoder* Lz, uint8_t Data)
+{
+  if (Lz->Out >= Lz->Size)
+  {
+    Lz->Error = 1;
+    return;
+  }
+
+  WINDOW_BYTES(Lz)[Lz->Out - Lz->Flushed] = Data;
+  Lz->Out++;
+
+  if ((Lz->Out - Lz->Flushed) == LZ_WINDOW_SIZE)
+  {
+    LZ_Flush(Lz);
+  }
+}
+
+/**
+  * @brief  Copies MatchLen bytes from Offset bytes back. The source may
+  *         overlap the bytes being produced, so the copy goes byte by byte.
+  * @param  Lz: decoder
+  * @retval None
+  */
+static void LZ_Copy(LZ_Decoder* Lz)
+{
+  uint32_t src = 0;
+  uint8_t c = 0;
+
+  if ((Lz->Offset == 0) || (Lz->Offset > Lz->Out))
+  {
+    Lz->Error = 1;
+    return;
+  }
+
+  src = Lz->Out - Lz->Offset;
+  while ((Lz->MatchLen != 0) && (Lz->Error == 0))
+  {
+    if (src >= Lz->Flushed)
+    {
+      c = WINDOW_BYTES(Lz)[src - Lz->Flushed];
+    }
+    else
+    {
+      /* Already programmed */
+      c = *(__IO uint8_t*)(Lz->Base + src);
+    }
+    LZ_Put(Lz, c);
+    src++;
+    Lz->MatchLen--;
+  }
+}
+
+/**
+  * @brief  Programs the bytes gathered in the window
+  * @param  Lz: decoder
+  * @retval None
+  */
+static void LZ_Flush(LZ_Decoder* Lz)
+{
+  uint32_t length = Lz->Out - Lz->Flushed;
+
+  if (length == 0)
+  {
+    return;
+  }
+
+  if (Lz->Output != 0)
+  {
+    Lz->Output(WINDOW_BYTES(Lz), length);
+  }
+
+  while ((length & 3) != 0)
+  {
+    WINDOW_BYTES(Lz)[length++] = 0xFF;
+  }
+
+  if (FLASH_If_WriteBlock(&Lz->Address, Lz->Window, length / 4) != 0)
+  {
+    Lz->Error = 1;
+  }
+  Lz->Flushed = Lz->Out;
+}
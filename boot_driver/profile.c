@@ -0,0 +1,134 @@
+/**
+  ******************************************************************************
+  * @file    profile.c
+  * @brief   Probe table of profile.h, timed by the DWT cycle counter.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "profile.h"
+#include "startup.h"
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  uint32_t Count;
+  uint32_t Min;
+  uint32_t Max;
+  uint64_t Total;
+  uint32_t Histogram[PROF_BUCKETS];
+} PROF_Entry;
+
+/* Private variables ---------------------------------------------------------*/
+uint32_t PROF_Start[PROF_COUNT];
+
+static PROF_Entry Table[PROF_COUNT];
+static uint32_t Dump[PROF_DUMP_SIZE / 4];
+
+static const char Names[PROF_COUNT][PROF_NAME_SIZE] =
+{
+  "iap_com",
+  "iap_rx_dma",
+  "iap_tx_dma",
+  "flash",
+  "signature",
+  "boot",
+};
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Starts the cycle counter, clears the table and records the
+  *         start of the firmware in PROF_BOOT
+  * @param  None
+  * @retval None
+  */
+void PROF_Init(void)
+{
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  PROF_Clear();
+  PROF_Record(PROF_BOOT, STARTUP_Cycles.Main);
+}
+
+/**
+  * @brief  Adds a duration to a probe, from PROF_END()
+  * @param  Probe: probe point
+  * @param  Cycles: duration in core clock cycles
+  * @retval None
+  */
+void PROF_Record(PROF_Probe Probe, uint32_t Cycles)
+{
+  PROF_Entry* entry = &Table[Probe];
+  int32_t bucket = (int32_t)(31 - __CLZ(Cycles | 1)) - PROF_BUCKET_SHIFT;
+
+  if (bucket < 0)
+  {
+    bucket = 0;
+  }
+  else if (bucket >= PROF_BUCKETS)
+  {
+    bucket = PROF_BUCKETS - 1;
+  }
+
+  if ((entry->Count == 0) || (Cycles < entry->Min))
+  {
+    entry->Min = Cycles;
+  }
+  if (Cycles > entry->Max)
+  {
+    entry->Max = Cycles;
+  }
+  entry->Count++;
+  entry->Total += Cycles;
+  entry->Histogram[bucket]++;
+}
+
+/**
+  * @brief  Clears the table
+  * @param  None
+  * @retval None
+  */
+void PROF_Clear(void)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  memset(Table, 0, sizeof(Table));
+  __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Copies the table in the CMD_Profile format of profile.h, with
+  *         the interrupts masked so that no probe is half updated
+  * @param  None
+  * @retval PROF_DUMP_SIZE bytes, valid until the next call
+  */
+const uint8_t* PROF_Dump(void)
+{
+  uint32_t primask = __get_PRIMASK();
+  uint32_t* word = Dump;
+  uint32_t i = 0;
+
+  word[0] = PROF_COUNT | (PROF_BUCKETS << 8) | (PROF_BUCKET_SHIFT << 16);
+  word[1] = SystemClocks.HCLK_Frequency;
+  word += PROF_HEADER_SIZE / 4;
+
+  __disable_irq();
+  for (i = 0; i < PROF_COUNT; i++)
+  {
+    memcpy(word, Names[i], PROF_NAME_SIZE);
+    word += PROF_NAME_SIZE / 4;
+    word[0] = Table[i].Count;
+    word[1] = Table[i].Min;
+    word[2] = Table[i].Max;
+    word[3] = (Table[i].Count != 0) ? (uint32_t)(Table[i].Total / Table[i].Count) : 0;
+    memcpy(&word[4], Table[i].Histogram, sizeof(Table[i].Histogram));
+    word += 4 + PROF_BUCKETS;
+  }
+  __set_PRIMASK(primask);
+
+  return (const uint8_t*)Dump;
+}
@@ -0,0 +1,219 @@
+/**
+  ******************************************************************************
+  * @file    rng_pool.c
+  * @brief   Random word pool of rng_pool.h.
+  *
+  *          Head and Tail count the words put and taken: the interrupt
+  *          only moves Head, RNGP_GetBytes() moves Tail with the
+  *          interrupts masked, as it also unmasks the RNG interrupt. A
+  *          word taken is cleared in the pool.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "rng_pool.h"
+
+/* Private define ------------------------------------------------------------*/
+#define RNGP_POOL_MASK        (RNGP_POOL_WORDS - 1)
+
+/* Private variables ---------------------------------------------------------*/
+static uint32_t Pool[RNGP_POOL_WORDS];
+static volatile uint32_t Head = 0;
+static volatile uint32_t Tail = 0;
+/* Previous word of the RNG, for the continuous test */
+static uint32_t Last = 0;
+static uint32_t HaveLast = 0;
+/* Cycle count and word count at the start of the refill under way */
+static uint32_t FillStart = 0;
+static uint32_t FillWords = 0;
+static RNGP_Stats Totals;
+
+/* Private function prototypes -----------------------------------------------*/
+static void RNGP_Clock(void);
+static void RNGP_Refill(void);
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Enables the RNG and its interrupt and starts filling the pool
+  * @param  None
+  * @retval None
+  */
+void RNGP_Init(void)
+{
+  NVIC_InitTypeDef NVIC_InitStructure;
+
+  RCC_AHB2PeriphClockCmd(RCC_AHB2Periph_RNG, ENABLE);
+  SystemClockRegister(RNGP_Clock);
+
+  /* The setting of HENG_Init() for the shared vector */
+  NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 1;
+  NVIC_InitStructure.NVIC_IRQChannelSubPriority = 3;
+  NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+  NVIC_InitStructure.NVIC_IRQChannel = HASH_RNG_IRQn;
+  NVIC_Init(&NVIC_InitStructure);
+
+  RNGP_Clock();
+}
+
+/**
+  * @brief  Takes random bytes from the pool, without waiting
+  * @param  Buffer: filled
+  * @param  Length: bytes, up to RNGP_POOL_WORDS * 4
+  * @retval RNGP_OK or RNGP_EMPTY: the pool holds fewer bytes, none taken
+  */
+uint32_t RNGP_GetBytes(void* Buffer, uint32_t Length)
+{
+  uint8_t* bytes = (uint8_t*)Buffer;
+  uint32_t primask = __get_PRIMASK();
+  uint32_t words = (Length + 3) / 4;
+  uint32_t size = 0;
+
+  __disable_irq();
+  if (Head - Tail < words)
+  {
+    Totals.Empty++;
+    __set_PRIMASK(primask);
+    return RNGP_EMPTY;
+  }
+  while (Length > 0)
+  {
+    size = (Length < 4) ? Length : 4;
+    memcpy(bytes, &Pool[Tail & RNGP_POOL_MASK], size);
+    Pool[Tail & RNGP_POOL_MASK] = 0;
+    Tail++;
+    bytes += size;
+    Length -= size;
+  }
+  Totals.Taken += words;
+  RNGP_Refill();
+  __set_PRIMASK(primask);
+  return RNGP_OK;
+}
+
+/**
+  * @brief  Bytes RNGP_GetBytes() can take now
+  * @param  None
+  * @retval Bytes
+  */
+uint32_t RNGP_Available(void)
+{
+  return (Head - Tail) * 4;
+}
+
+/**
+  * @brief  Health and refill statistics since RNGP_Init(). RefillWords
+  *         over RefillCycles times SystemClocks.HCLK_Frequency is the
+  *         refill rate, in words per second.
+  * @param  Stats: filled
+  * @retval None
+  */
+void RNGP_GetStats(RNGP_Stats* Stats)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  memcpy(Stats, &Totals, sizeof(*Stats));
+  __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  RNG part of the HASH_RNG interrupt: errors, then a new word to
+  *         the pool. Nothing is done while the pool is full, the HASH may
+  *         be the source.
+  * @param  None
+  * @retval None
+  */
+void RNGP_IRQHandler(void)
+{
+  uint32_t status = RNG->SR;
+  uint32_t word = 0;
+
+  if ((RNG->CR & RNG_CR_IE) == 0)
+  {
+    return;
+  }
+
+  if ((status & RNG_SR_SEIS) != 0)
+  {
+    /* The RNG starts again, its first word is kept to compare only */
+    RNG->SR = ~RNG_SR_SEIS;
+    RNG->CR &= ~RNG_CR_RNGEN;
+    RNG->CR |= RNG_CR_RNGEN;
+    HaveLast = 0;
+    Totals.SeedErrors++;
+    return;
+  }
+  if ((status & RNG_SR_CEIS) != 0)
+  {
+    RNG->SR = ~RNG_SR_CEIS;
+    Totals.ClockErrors++;
+  }
+  if ((status & (RNG_SR_DRDY | RNG_SR_SECS)) != RNG_SR_DRDY)
+  {
+    return;
+  }
+
+  word = RNG->DR;
+  if (HaveLast == 0)
+  {
+    HaveLast = 1;
+  }
+  else if (word == Last)
+  {
+    Totals.Repeats++;
+  }
+  else
+  {
+    Pool[Head & RNGP_POOL_MASK] = word;
+    Head++;
+    Totals.Words++;
+    if (Head - Tail == RNGP_POOL_WORDS)
+    {
+      RNG->CR &= ~RNG_CR_IE;
+      Totals.Refills++;
+      Totals.RefillWords += Totals.Words - FillWords;
+      Totals.RefillCycles += DWT->CYCCNT - FillStart;
+    }
+  }
+  Last = word;
+}
+
+/**
+  * @brief  Clock switch: the RNG runs while the PLL does. It is started
+  *         again from its first word.
+  * @param  None
+  * @retval None
+  */
+static void RNGP_Clock(void)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  RNG->CR = 0;
+  if ((RCC->CR & RCC_CR_PLLRDY) != 0)
+  {
+    HaveLast = 0;
+    RNG->CR = RNG_CR_RNGEN;
+    RNGP_Refill();
+  }
+  __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Unmasks the RNG interrupt if the RNG runs and the pool is not
+  *         full, the refill starts. Interrupts masked.
+  * @param  None
+  * @retval None
+  */
+static void RNGP_Refill(void)
+{
+  if (((RNG->CR & (RNG_CR_RNGEN | RNG_CR_IE)) == RNG_CR_RNGEN) &&
+      (Head - Tail < RNGP_POOL_WORDS))
+  {
+    FillStart = DWT->CYCCNT;
+    FillWords = Totals.Words;
+    RNG->CR |= RNG_CR_IE;
+  }
+}
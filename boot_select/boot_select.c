@@ -0,0 +1,126 @@
+/**
+  ******************************************************************************
+  * @file    boot_select.c
+  * @brief   Boot selector of the dual slot (A/B) layout. Linked at
+  *          APPLICATION_ADDRESS, it is started by the IGS boot loader in
+  *          place of the application and jumps to the active slot.
+  *
+  *          A slot in TRIAL state gets BOOT_TRIAL_MAX boots to be confirmed
+  *          by the IAP shim and must match the CRC of its record, otherwise
+  *          the other slot becomes active again. If no slot can be started
+  *          the selector invalidates itself so that the IGS boot loader
+  *          stays in loader mode after the reset.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f2xx.h"
+#include "flash_if.h"
+#include "boot_record.h"
+
+/* Private function prototypes -----------------------------------------------*/
+static uint32_t SelectSlot(void);
+static void JumpToSlot(uint32_t Slot);
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Called by Reset_Handler. The selector runs on the HSI, the
+  *         application configures the clocks in its own SystemInit().
+  * @param  None
+  * @retval None
+  */
+void SystemInit(void)
+{
+}
+
+/**
+  * @brief  Main program
+  * @param  None
+  * @retval None
+  */
+int main(void)
+{
+  uint32_t slot = 0;
+
+  RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_CRC, ENABLE);
+
+  slot = SelectSlot();
+  if (BOOT_IsValidImage(slot) == 0)
+  {
+    slot = BOOT_OTHER_SLOT(slot);
+  }
+
+  if (BOOT_IsValidImage(slot) != 0)
+  {
+    JumpToSlot(slot);
+  }
+
+  /* Nothing to start: hand over to the IGS boot loader */
+  FLASH_Unlock();
+  FLASH_ProgramWord(BOOT_SELECT_ADDRESS, 0x00000000);
+  NVIC_SystemReset();
+
+  while (1)
+  {
+  }
+}
+
+/**
+  * @brief  Reads the boot selection record and updates it for an image
+  *         in TRIAL state
+  * @param  None
+  * @retval Slot to start
+  */
+static uint32_t SelectSlot(void)
+{
+  BOOT_Record record;
+
+  if (BOOT_ReadRecord(&record) != 0)
+  {
+    /* Blank record sectors: first boot after the slots were programmed */
+    return (BOOT_IsValidImage(BOOT_SLOT_A) != 0) ? BOOT_SLOT_A : BOOT_SLOT_B;
+  }
+
+  if (record.State != BOOT_STATE_TRIAL)
+  {
+    return record.Active;
+  }
+
+  if ((record.Attempts >= BOOT_TRIAL_MAX) ||
+      (BOOT_ImageCrc(record.Active, record.Size) != record.Crc))
+  {
+    /* Roll back to the image that was running before */
+    record.Active = BOOT_OTHER_SLOT(record.Active);
+    record.State = BOOT_STATE_CONFIRMED;
+    record.Attempts = 0;
+    record.Size = 0;
+    record.Crc = 0;
+  }
+  else
+  {
+    record.Attempts++;
+  }
+
+  FLASH_Unlock();
+  BOOT_WriteRecord(&record);
+  FLASH_Lock();
+
+  return record.Active;
+}
+
+/**
+  * @brief  Starts the image of a slot
+  * @param  Slot: BOOT_SLOT_A or BOOT_SLOT_B
+  * @retval None
+  */
+static void JumpToSlot(uint32_t Slot)
+{
+  uint32_t *vectors = (uint32_t *)BOOT_SlotAddress(Slot);
+
+  RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_CRC, DISABLE);
+
+  SCB->VTOR = (uint32_t)vectors;
+  __set_MSP(vectors[0]);
+  ((void (*)(void))vectors[1])();
+}
@@ -0,0 +1,31 @@
+/**
+  ******************************************************************************
+  * @file    ramfunc.h
+  * @brief   Functions and tables run from SRAM, at zero wait states and
+  *          away from the flash while it is programmed.
+  *
+  *          RAMFUNC puts a function in the .ramfunc output section and
+  *          FASTDATA a constant table in .fastdata, both copied from flash
+  *          by Reset_Handler before SystemInit(). Their SRAM use is in the
+  *          map file, at the .ramfunc and .fastdata lines.
+  *          A RAMFUNC is called with a long call: the flash is out of the
+  *          range of BL. What it calls runs where it is linked, a function
+  *          that must not fetch from the flash calls RAMFUNCs only.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __RAMFUNC_H
+#define __RAMFUNC_H
+
+/* Exported macro ------------------------------------------------------------*/
+#ifdef __arm__
+#define RAMFUNC               __attribute__((section(".ramfunc"), long_call, noinline))
+#define FASTDATA              __attribute__((section(".fastdata")))
+#else
+/* Host builds (tools/sim): one memory */
+#define RAMFUNC
+#define FASTDATA
+#endif
+
+#endif  /* __RAMFUNC_H */
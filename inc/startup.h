@@ -0,0 +1,45 @@
+/**
+  ******************************************************************************
+  * @file    startup.h
+  * @brief   What Reset_Handler (src/startup_stm32f2xx.s) leaves to the
+  *          application: the cycles the start took and the zeroing of the
+  *          .deferred_bss section.
+  *
+  *          Reset_Handler copies .data, .ramfunc and .fastdata and zeroes
+  *          .bss four words per LDM/STM. A large buffer marked DEFERRED_BSS
+  *          is skipped and holds garbage until STARTUP_ZeroDeferred(), or
+  *          for good when its owner fills it before use.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __STARTUP_H
+#define __STARTUP_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported types ------------------------------------------------------------*/
+/* DWT cycle counter, started by the first instruction of Reset_Handler */
+typedef struct
+{
+  uint32_t Copy;        /* .data, .ramfunc and .fastdata copied */
+  uint32_t Zero;        /* .bss zeroed */
+  uint32_t Main;        /* SystemInit() done, main() called */
+} STARTUP_Time;
+
+/* Exported macro ------------------------------------------------------------*/
+#ifdef __arm__
+#define DEFERRED_BSS          __attribute__((section(".deferred_bss")))
+#else
+/* Host builds (tools/sim): zeroed by the C runtime */
+#define DEFERRED_BSS
+#endif
+
+/* Exported variables --------------------------------------------------------*/
+extern STARTUP_Time STARTUP_Cycles;
+
+/* Exported functions ------------------------------------------------------- */
+void STARTUP_ZeroDeferred(void);
+
+#endif  /* __STARTUP_H */
@@ -52,6 +52,31 @@
 
 extern uint32_t SystemCoreClock;          /*!< System Clock Frequency (Core Clock) */
 
+/* Clock tree kept by SystemCoreClockUpdate(), the fields of RCC_ClocksTypeDef
+   and the PLLI2S output */
+typedef struct
+{
+  uint32_t SYSCLK_Frequency;
+  uint32_t HCLK_Frequency;
+  uint32_t PCLK1_Frequency;
+  uint32_t PCLK2_Frequency;
+  uint32_t PLLI2SCLK_Frequency;         /*!< I2S clock on PLLI2S, set after RCC_PLLI2SConfig() */
+} SystemClockTree;
+
+extern SystemClockTree SystemClocks;      /*!< Clock tree, read instead of RCC_GetClocksFreq() */
+
+/* Settings of SystemClockSwitch(), HCLK / PCLK1 / PCLK2 in MHz */
+typedef enum
+{
+  SYSCLK_PROFILE_FULL = 0,              /*!< 120 / 30 / 60, PLL (HSE) */
+  SYSCLK_PROFILE_60MHZ,                 /*!< 60 / 30 / 60, PLL (HSE) */
+  SYSCLK_PROFILE_30MHZ,                 /*!< 30 / 30 / 30, PLL (HSE) */
+  SYSCLK_PROFILE_HSI,                   /*!< 16 / 16 / 16, HSI, PLL and HSE off */
+  SYSCLK_PROFILE_COUNT
+} SystemClockProfile;
+
+typedef void (*SystemClockCallback)(void);
+
 
 /**
   * @}
@@ -79,6 +104,8 @@ extern uint32_t SystemCoreClock;          /*!< System Clock Frequency (Core Cloc
   
 extern void SystemInit(void);
 extern void SystemCoreClockUpdate(void);
+extern uint32_t SystemClockSwitch(SystemClockProfile Profile);
+extern uint32_t SystemClockRegister(SystemClockCallback Callback);
 /**
   * @}
   */
@@ -166,6 +166,8 @@ void I2C_DeInit(I2C_TypeDef* I2Cx)
   *           
   * @note   To use the I2C at 400 KHz (in fast mode), the PCLK1 frequency 
   *         (I2C peripheral input clock) must be a multiple of 10 MHz.  
+  *
+  * @note   PCLK1 is read from SystemClocks, kept by SystemCoreClockUpdate().
   *           
   * @param  I2Cx: where x can be 1, 2 or 3 to select the I2C peripheral.
   * @param  I2C_InitStruct: pointer to a I2C_InitTypeDef structure that contains 
@@ -177,7 +179,6 @@ void I2C_Init(I2C_TypeDef* I2Cx, I2C_InitTypeDef* I2C_InitStruct)
   uint16_t tmpreg = 0, freqrange = 0;
   uint16_t result = 0x04;
   uint32_t pclk1 = 8000000;
-  RCC_ClocksTypeDef  rcc_clocks;
   /* Check the parameters */
   assert_param(IS_I2C_ALL_PERIPH(I2Cx));
   assert_param(IS_I2C_CLOCK_SPEED(I2C_InitStruct->I2C_ClockSpeed));
@@ -192,9 +193,8 @@ void I2C_Init(I2C_TypeDef* I2Cx, I2C_InitTypeDef* I2C_InitStruct)
   tmpreg = I2Cx->CR2;
   /* Clear frequency FREQ[5:0] bits */
   tmpreg &= (uint16_t)~((uint16_t)I2C_CR2_FREQ);
-  /* Get pclk1 frequency value */
-  RCC_GetClocksFreq(&rcc_clocks);
-  pclk1 = rcc_clocks.PCLK1_Frequency;
+  /* Get pclk1 frequency value, kept by SystemCoreClockUpdate() */
+  pclk1 = SystemClocks.PCLK1_Frequency;
   /* Set frequency bits depending on pclk1 value */
   freqrange = (uint16_t)(pclk1 / 1000000);
   tmpreg |= freqrange;
@@ -268,6 +268,9 @@ void SPI_Init(SPI_TypeDef* SPIx, SPI_InitTypeDef* SPI_InitStruct)
   * @note   if an external clock is used as source clock for the I2S, then the define
   *         I2S_EXTERNAL_CLOCK_VAL in file stm32f2xx_conf.h should be enabled and set
   *         to the value of the the source clock frequency (in Hz).
+  *
+  * @note   The PLLI2S clock is read from SystemClocks: call SystemCoreClockUpdate()
+  *         after RCC_PLLI2SConfig().
   *  
   * @retval None
   */
@@ -275,9 +278,6 @@ void I2S_Init(SPI_TypeDef* SPIx, I2S_InitTypeDef* I2S_InitStruct)
 {
   uint16_t tmpreg = 0, i2sdiv = 2, i2sodd = 0, packetlength = 1;
   uint32_t tmp = 0, i2sclk = 0;
-#ifndef I2S_EXTERNAL_CLOCK_VAL
-  uint32_t pllm = 0, plln = 0, pllr = 0;
-#endif /* I2S_EXTERNAL_CLOCK_VAL */
   
   /* Check the I2S parameters */
   assert_param(IS_SPI_23_PERIPH(SPIx));
@@ -338,19 +338,8 @@ void I2S_Init(SPI_TypeDef* SPIx, I2S_InitTypeDef* I2S_InitStruct)
       RCC->CFGR &= ~(uint32_t)RCC_CFGR_I2SSRC;
     }    
     
-    /* Get the PLLI2SN value */
-    plln = (uint32_t)(((RCC->PLLI2SCFGR & RCC_PLLI2SCFGR_PLLI2SN) >> 6) & \
-                      (RCC_PLLI2SCFGR_PLLI2SN >> 6));
-    
-    /* Get the PLLI2SR value */
-    pllr = (uint32_t)(((RCC->PLLI2SCFGR & RCC_PLLI2SCFGR_PLLI2SR) >> 28) & \
-                      (RCC_PLLI2SCFGR_PLLI2SR >> 28));
-    
-    /* Get the PLLM value */
-    pllm = (uint32_t)(RCC->PLLCFGR & RCC_PLLCFGR_PLLM);      
-    
-    /* Get the I2S source clock value */
-    i2sclk = (uint32_t)(((HSE_VALUE / pllm) * plln) / pllr);
+    /* Get the I2S source clock value, kept by SystemCoreClockUpdate() */
+    i2sclk = SystemClocks.PLLI2SCLK_Frequency;
   #endif /* I2S_EXTERNAL_CLOCK_VAL */
     
     /* Compute the Real divider depending on the MCLK output state, with a floating point */
@@ -222,6 +222,7 @@ void USART_DeInit(USART_TypeDef* USARTx)
   *         UART peripheral.
   * @param  USART_InitStruct: pointer to a USART_InitTypeDef structure that contains
   *         the configuration information for the specified USART peripheral.
+  * @note   The APB clock is read from SystemClocks, kept by SystemCoreClockUpdate().
   * @retval None
   */
 void USART_Init(USART_TypeDef* USARTx, USART_InitTypeDef* USART_InitStruct)
@@ -229,7 +230,6 @@ void USART_Init(USART_TypeDef* USARTx, USART_InitTypeDef* USART_InitStruct)
   uint32_t tmpreg = 0x00, apbclock = 0x00;
   uint32_t integerdivider = 0x00;
   uint32_t fractionaldivider = 0x00;
-  RCC_ClocksTypeDef RCC_ClocksStatus;
 
   /* Check the parameters */
   assert_param(IS_USART_ALL_PERIPH(USARTx));
@@ -289,16 +289,14 @@ void USART_Init(USART_TypeDef* USARTx, USART_InitTypeDef* USART_InitStruct)
   USARTx->CR3 = (uint16_t)tmpreg;
 
 /*---------------------------- USART BRR Configuration -----------------------*/
-  /* Configure the USART Baud Rate */
-  RCC_GetClocksFreq(&RCC_ClocksStatus);
-
+  /* Configure the USART Baud Rate, on the clocks of SystemCoreClockUpdate() */
   if ((USARTx == USART1) || (USARTx == USART6))
   {
-    apbclock = RCC_ClocksStatus.PCLK2_Frequency;
+    apbclock = SystemClocks.PCLK2_Frequency;
   }
   else
   {
-    apbclock = RCC_ClocksStatus.PCLK1_Frequency;
+    apbclock = SystemClocks.PCLK1_Frequency;
   }
   
   /* Determine the integer part */
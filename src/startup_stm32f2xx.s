@@ -65,40 +65,145 @@ defined in linker script */
   .type  Reset_Handler, %function
 Reset_Handler:  
 
-/* Copy the data segment initializers from flash to SRAM */  
+/* Start the cycle counter for STARTUP_Cycles (inc/startup.h) */
+  ldr  r0, =0xE000EDFC        /* CoreDebug->DEMCR */
+  ldr  r1, [r0]
+  orr  r1, r1, #0x01000000    /* TRCENA */
+  str  r1, [r0]
+  ldr  r0, =0xE0001000        /* DWT->CTRL */
   movs  r1, #0
-  b  LoopCopyDataInit
+  str  r1, [r0, #4]           /* DWT->CYCCNT */
+  ldr  r1, [r0]
+  orr  r1, r1, #1             /* CYCCNTENA */
+  str  r1, [r0]
 
-CopyDataInit:
-  ldr  r3, =_sidata
-  ldr  r3, [r3, r1]
-  str  r3, [r0, r1]
-  adds  r1, r1, #4
-    
-LoopCopyDataInit:
+/* Copy the data segment initializers from flash to SRAM */  
   ldr  r0, =_sdata
-  ldr  r3, =_edata
-  adds  r2, r0, r1
-  cmp  r2, r3
-  bcc  CopyDataInit
-  ldr  r2, =_sbss
-  b  LoopFillZerobss
-/* Zero fill the bss segment. */  
-FillZerobss:
-  movs  r3, #0
-  str  r3, [r2], #4
-    
-LoopFillZerobss:
-  ldr  r3, = _ebss
-  cmp  r2, r3
-  bcc  FillZerobss
+  ldr  r1, =_sidata
+  ldr  r2, =_edata
+  bl  CopyWords
+
+/* Copy the code and tables run from SRAM (inc/ramfunc.h) */
+  ldr  r0, =_sramfunc
+  ldr  r1, =_siramfunc
+  ldr  r2, =_eramfunc
+  bl  CopyWords
+
+  ldr  r0, =_sfastdata
+  ldr  r1, =_sifastdata
+  ldr  r2, =_efastdata
+  bl  CopyWords
+  ldr  r0, =0xE0001004
+  ldr  r8, [r0]
+
+/* Zero fill the bss segment. .deferred_bss is left to STARTUP_ZeroDeferred() */  
+  ldr  r0, =_sbss
+  ldr  r1, =_ebss
+  bl  ZeroWords
+  ldr  r0, =0xE0001004
+  ldr  r9, [r0]
+
 /* Call the clock system intitialization function.*/
   bl  SystemInit   
+  ldr  r0, =0xE0001004
+  ldr  r10, [r0]
+  ldr  r0, =STARTUP_Cycles
+  stmia  r0, {r8, r9, r10}
 /* Call the application's entry point.*/
   bl  main
   bx  lr    
 .size  Reset_Handler, .-Reset_Handler
 
+/**
+ * @brief  Copies words from r1 to r0 until r0 reaches r2, four per
+ *         LDM/STM pair then one by one. The addresses are word aligned.
+ * @param  r0: destination, r1: source, r2: end of the destination
+ * @retval None
+*/
+    .section  .text.CopyWords
+  .type  CopyWords, %function
+CopyWords:
+  push  {r4, r5, r6, lr}
+  b  LoopCopyBurst
+
+CopyBurst:
+  ldmia  r1!, {r3, r4, r5, r6}
+  stmia  r0!, {r3, r4, r5, r6}
+
+LoopCopyBurst:
+  subs  r3, r2, r0
+  cmp  r3, #16
+  bhs  CopyBurst
+  b  LoopCopyWord
+
+CopyWord:
+  ldr  r3, [r1], #4
+  str  r3, [r0], #4
+
+LoopCopyWord:
+  cmp  r0, r2
+  bcc  CopyWord
+  pop  {r4, r5, r6, pc}
+.size  CopyWords, .-CopyWords
+
+/**
+ * @brief  Zeroes the words from r0 up to r1, four per STM then one by one.
+ *         The addresses are word aligned.
+ * @param  r0: start, r1: end
+ * @retval None
+*/
+    .section  .text.ZeroWords
+  .type  ZeroWords, %function
+ZeroWords:
+  push  {r4, r5, lr}
+  movs  r2, #0
+  movs  r3, #0
+  movs  r4, #0
+  mov  r12, r2
+  b  LoopZeroBurst
+
+ZeroBurst:
+  stmia  r0!, {r2, r3, r4, r12}
+
+LoopZeroBurst:
+  subs  r5, r1, r0
+  cmp  r5, #16
+  bhs  ZeroBurst
+  b  LoopZeroWord
+
+ZeroWord:
+  str  r2, [r0], #4
+
+LoopZeroWord:
+  cmp  r0, r1
+  bcc  ZeroWord
+  pop  {r4, r5, pc}
+.size  ZeroWords, .-ZeroWords
+
+/**
+ * @brief  Zeroes the .deferred_bss section (inc/startup.h), called by the
+ *         application once it has answered what cannot wait.
+ * @param  None
+ * @retval None
+*/
+    .section  .text.STARTUP_ZeroDeferred
+  .global  STARTUP_ZeroDeferred
+  .type  STARTUP_ZeroDeferred, %function
+STARTUP_ZeroDeferred:
+  ldr  r0, =_sdeferred
+  ldr  r1, =_edeferred
+  b  ZeroWords
+.size  STARTUP_ZeroDeferred, .-STARTUP_ZeroDeferred
+
+/* Cycles of the start, stored by Reset_Handler before main() */
+    .section  .bss.STARTUP_Cycles
+  .align  2
+  .global  STARTUP_Cycles
+  .type  STARTUP_Cycles, %object
+STARTUP_Cycles:
+  .space  12
+.size  STARTUP_Cycles, .-STARTUP_Cycles
+
 /**
  * @brief  This is the code that gets called when the processor receives an 
  *         unexpected interrupt.  This simply enters an infinite loop, preserving
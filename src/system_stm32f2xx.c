@@ -22,7 +22,13 @@
   *                                  by the user application to setup the SysTick 
   *                                  timer or configure other parameters.
   *                                     
-  *      - SystemCoreClockUpdate(): Updates the variable SystemCoreClock and must
+  *      - SystemClocks variable: SYSCLK, HCLK, PCLK1, PCLK2 and the PLLI2S
+  *                               output, read by the drivers, USART_Init(),
+  *                               I2C_Init() and I2S_Init() included, in place
+  *                               of RCC_GetClocksFreq() and the RCC registers.
+  *
+  *      - SystemCoreClockUpdate(): Updates the variables SystemCoreClock and
+  *                                 SystemClocks and must
   *                                 be called whenever the core clock is changed
   *                                 during program execution.
   *
@@ -32,7 +38,7 @@
   *
   * 3. If the system clock source selected by user fails to startup, the SystemInit()
   *    function will do nothing and HSI still used as system clock source. User can 
-  *    add some code to deal with this issue inside the SetSysClock() function.
+  *    add some code to deal with this issue inside the SystemClockSwitch() function.
   *
   * 4. The default value of HSE crystal is set to 25MHz, refer to "HSE_VALUE" define
   *    in "stm32f2xx.h" file. When HSE is used as system clock source, directly or
@@ -86,6 +92,15 @@
   *        SDIO and RNG clock                     |
   *-----------------------------------------------------------------------------
   *=============================================================================
+  *
+  * 6. SystemClockSwitch() changes to one of the SystemClockProfile settings at
+  *    run time: SYSCLK_PROFILE_FULL above, SYSCLK_PROFILE_60MHZ and
+  *    SYSCLK_PROFILE_30MHZ through the AHB prescaler with the PLL kept, and
+  *    SYSCLK_PROFILE_HSI at 16 MHz with the PLL and the HSE stopped (no 48 MHz
+  *    for USB OTG FS, SDIO and RNG). The flash wait states and the APB
+  *    prescalers follow HCLK, then the functions given to SystemClockRegister()
+  *    are called to set up again what depends on the clocks (USART BRR, timer
+  *    prescalers).
   ****************************************************************************** 
   * @attention
   *
@@ -121,6 +136,12 @@
 /** @addtogroup STM32F2xx_System_Private_TypesDefinitions
   * @{
   */
+typedef struct
+{
+  uint32_t Source;      /* RCC_CFGR_SW_PLL or RCC_CFGR_SW_HSI */
+  uint32_t Hpre;        /* RCC_CFGR_HPRE_DIVx */
+  uint32_t Hclk;
+} SystemClockSetting;
 
 /**
   * @}
@@ -150,6 +171,14 @@
 
 /* USB OTG FS, SDIO and RNG Clock =  PLL_VCO / PLLQ */
 #define PLL_Q      5
+#define PLL_SYSCLK (HSE_VALUE / PLL_M * PLL_N / PLL_P)
+
+/* One flash wait state per 30 MHz of HCLK (VDD 2.7 V to 3.6 V) */
+#define HCLK_PER_WAIT_STATE   30000000
+#define PCLK1_MAX             30000000
+#define PCLK2_MAX             60000000
+/* Functions called by SystemClockSwitch() */
+#define SYSCLK_NOTIFY_MAX     4
 
 /**
   * @}
@@ -169,7 +198,20 @@
 
   uint32_t SystemCoreClock = 120000000;
 
+  SystemClockTree SystemClocks = {120000000, 120000000, 30000000, 60000000, 76800000};
+
   __I uint8_t AHBPrescTable[16] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 3, 4, 6, 7, 8, 9};
+static __I uint8_t APBPrescTable[8] = {0, 0, 0, 0, 1, 2, 3, 4};
+
+static const SystemClockSetting SystemClockSettings[SYSCLK_PROFILE_COUNT] =
+{
+  { RCC_CFGR_SW_PLL, RCC_CFGR_HPRE_DIV1, PLL_SYSCLK },       /* SYSCLK_PROFILE_FULL */
+  { RCC_CFGR_SW_PLL, RCC_CFGR_HPRE_DIV2, PLL_SYSCLK / 2 },   /* SYSCLK_PROFILE_60MHZ */
+  { RCC_CFGR_SW_PLL, RCC_CFGR_HPRE_DIV4, PLL_SYSCLK / 4 },   /* SYSCLK_PROFILE_30MHZ */
+  { RCC_CFGR_SW_HSI, RCC_CFGR_HPRE_DIV1, HSI_VALUE },        /* SYSCLK_PROFILE_HSI */
+};
+static SystemClockCallback SystemClockNotify[SYSCLK_NOTIFY_MAX];
+static uint32_t SystemClockNotifyCount;
 
 /**
   * @}
@@ -179,7 +221,7 @@
   * @{
   */
 
-static void SetSysClock(void);
+static uint32_t SystemClockPpre(uint32_t hclk, uint32_t max);
 #ifdef DATA_IN_ExtSRAM
   static void SystemInit_ExtMemCtl(void); 
 #endif /* DATA_IN_ExtSRAM */
@@ -195,11 +237,12 @@ static void SetSysClock(void);
 /**
   * @brief  Setup the microcontroller system
   *         Initialize the Embedded Flash Interface, the PLL and update the 
-  *         SystemFrequency variable.
+  *         SystemFrequency variable. Weak: a program that keeps the reset
+  *         clocks gives its own.
   * @param  None
   * @retval None
   */
-void SystemInit(void)
+__attribute__((weak)) void SystemInit(void)
 {
   /* Reset the RCC clock configuration to the default reset state ------------*/
   /* Set HSION bit */
@@ -226,7 +269,11 @@ void SystemInit(void)
          
   /* Configure the System clock source, PLL Multiplier and Divider factors, 
      AHB/APBx prescalers and Flash settings ----------------------------------*/
-  SetSysClock();
+  if (SystemClockSwitch(SYSCLK_PROFILE_FULL) != 0)
+  {
+    /* Still on HSI */
+    SystemCoreClockUpdate();
+  }
 
   /* Configure the Vector Table location add offset address ------------------*/
 #ifdef VECT_TAB_SRAM
@@ -240,7 +287,8 @@ void SystemInit(void)
   * @brief  Update SystemCoreClock variable according to Clock Register Values.
   *         The SystemCoreClock variable contains the core clock (HCLK), it can
   *         be used by the user application to setup the SysTick timer or configure
-  *         other parameters.
+  *         other parameters. SystemClocks gets the whole clock tree; call it
+  *         also after RCC_PLLI2SConfig() for the I2S clock.
   *           
   * @note   Each time the core clock (HCLK) changes, this function must be called
   *         to update SystemCoreClock variable value. Otherwise, any configuration
@@ -274,8 +322,18 @@ void SystemInit(void)
   */
 void SystemCoreClockUpdate(void)
 {
-  uint32_t tmp = 0, pllvco = 0, pllp = 2, pllsource = 0, pllm = 2;
+  uint32_t tmp = 0, pllvco = 0, pllp = 2, pllsource = 0, pllm = 2, pllin = 0;
   
+  /* PLL and PLLI2S input: (HSE_VALUE or HSI_VALUE) / PLL_M */
+  pllsource = (RCC->PLLCFGR & RCC_PLLCFGR_PLLSRC) >> 22;
+  pllm = RCC->PLLCFGR & RCC_PLLCFGR_PLLM;
+  pllin = ((pllsource != 0) ? HSE_VALUE : HSI_VALUE) / pllm;
+
+  /* PLLI2S output: PLL input * PLLI2S_N / PLLI2S_R */
+  tmp = (RCC->PLLI2SCFGR & RCC_PLLI2SCFGR_PLLI2SR) >> 28;
+  SystemClocks.PLLI2SCLK_Frequency = (tmp == 0) ? 0 :
+                                     (pllin * ((RCC->PLLI2SCFGR & RCC_PLLI2SCFGR_PLLI2SN) >> 6)) / tmp;
+
   /* Get SYSCLK source -------------------------------------------------------*/
   tmp = RCC->CFGR & RCC_CFGR_SWS;
 
@@ -292,19 +350,7 @@ void SystemCoreClockUpdate(void)
       /* PLL_VCO = (HSE_VALUE or HSI_VALUE / PLL_M) * PLL_N
          SYSCLK = PLL_VCO / PLL_P
          */    
-      pllsource = (RCC->PLLCFGR & RCC_PLLCFGR_PLLSRC) >> 22;
-      pllm = RCC->PLLCFGR & RCC_PLLCFGR_PLLM;
-      
-      if (pllsource != 0)
-      {
-        /* HSE used as PLL clock source */
-        pllvco = (HSE_VALUE / pllm) * ((RCC->PLLCFGR & RCC_PLLCFGR_PLLN) >> 6);
-      }
-      else
-      {
-        /* HSI used as PLL clock source */
-        pllvco = (HSI_VALUE / pllm) * ((RCC->PLLCFGR & RCC_PLLCFGR_PLLN) >> 6);      
-      }
+      pllvco = pllin * ((RCC->PLLCFGR & RCC_PLLCFGR_PLLN) >> 6);
 
       pllp = (((RCC->PLLCFGR & RCC_PLLCFGR_PLLP) >>16) + 1 ) *2;
       SystemCoreClock = pllvco/pllp;
@@ -313,87 +359,144 @@ void SystemCoreClockUpdate(void)
       SystemCoreClock = HSI_VALUE;
       break;
   }
+  SystemClocks.SYSCLK_Frequency = SystemCoreClock;
   /* Compute HCLK frequency --------------------------------------------------*/
   /* Get HCLK prescaler */
   tmp = AHBPrescTable[((RCC->CFGR & RCC_CFGR_HPRE) >> 4)];
   /* HCLK frequency */
   SystemCoreClock >>= tmp;
+  SystemClocks.HCLK_Frequency = SystemCoreClock;
+  /* PCLK1 and PCLK2 frequencies ---------------------------------------------*/
+  tmp = APBPrescTable[((RCC->CFGR & RCC_CFGR_PPRE1) >> 10)];
+  SystemClocks.PCLK1_Frequency = SystemCoreClock >> tmp;
+  tmp = APBPrescTable[((RCC->CFGR & RCC_CFGR_PPRE2) >> 13)];
+  SystemClocks.PCLK2_Frequency = SystemCoreClock >> tmp;
 }
 
 /**
   * @brief  Configures the System clock source, PLL Multiplier and Divider factors, 
-  *         AHB/APBx prescalers and Flash settings
-  * @Note   This function should be called only once the RCC clock configuration  
-  *         is reset to the default reset state (done in SystemInit() function).   
-  * @param  None
-  * @retval None
+  *         AHB/APBx prescalers and Flash settings of a profile, then calls the
+  *         functions given to SystemClockRegister()
+  * @note   The USART and timers run at the wrong rate from the switch until
+  *         their function has set them up again: switch when they are idle.
+  * @param  Profile: setting to use
+  * @retval 0: clocks switched, 1: unknown profile, flash erase or program
+  *         running, or HSE not started (clocks unchanged)
   */
-static void SetSysClock(void)
+uint32_t SystemClockSwitch(SystemClockProfile Profile)
 {
-/******************************************************************************/
-/*            PLL (clocked by HSE) used as System clock source                */
-/******************************************************************************/
-  __IO uint32_t StartUpCounter = 0, HSEStatus = 0;
-  
-  /* Enable HSE */
-  RCC->CR |= ((uint32_t)RCC_CR_HSEON);
- 
-  /* Wait till HSE is ready and if Time out is reached exit */
-  do
-  {
-    HSEStatus = RCC->CR & RCC_CR_HSERDY;
-    StartUpCounter++;
-  } while((HSEStatus == 0) && (StartUpCounter != HSE_STARTUP_TIMEOUT));
+  const SystemClockSetting* setting = 0;
+  __IO uint32_t StartUpCounter = 0;
+  uint32_t latency = 0, ppre = 0, cfgr = 0, primask = 0, i = 0;
 
-  if ((RCC->CR & RCC_CR_HSERDY) != RESET)
+  if ((Profile >= SYSCLK_PROFILE_COUNT) || ((FLASH->SR & FLASH_SR_BSY) != 0))
   {
-    HSEStatus = (uint32_t)0x01;
+    return 1;
   }
-  else
+  setting = &SystemClockSettings[Profile];
+
+  if (setting->Source == RCC_CFGR_SW_PLL)
   {
-    HSEStatus = (uint32_t)0x00;
+    if ((RCC->CR & RCC_CR_PLLRDY) == 0)
+    {
+      /* Enable HSE and wait till it is ready, up to HSE_STARTUP_TIMEOUT */
+      RCC->CR |= ((uint32_t)RCC_CR_HSEON);
+      do
+      {
+        StartUpCounter++;
+      } while(((RCC->CR & RCC_CR_HSERDY) == 0) && (StartUpCounter != HSE_STARTUP_TIMEOUT));
+      if ((RCC->CR & RCC_CR_HSERDY) == 0)
+      {
+        RCC->CR &= ~RCC_CR_HSEON;
+        return 1;
+      }
+      /* Configure the main PLL, enable it and wait till it is ready */
+      RCC->CR &= ~RCC_CR_PLLON;
+      RCC->PLLCFGR = PLL_M | (PLL_N << 6) | (((PLL_P >> 1) -1) << 16) |
+                     (RCC_PLLCFGR_PLLSRC_HSE) | (PLL_Q << 24);
+      RCC->CR |= RCC_CR_PLLON;
+      while((RCC->CR & RCC_CR_PLLRDY) == 0)
+      {
+      }
+    }
   }
-
-  if (HSEStatus == (uint32_t)0x01)
+  else
   {
-    /* HCLK = SYSCLK / 1*/
-    RCC->CFGR |= RCC_CFGR_HPRE_DIV1;
-      
-    /* PCLK2 = HCLK / 2*/
-    RCC->CFGR |= RCC_CFGR_PPRE2_DIV2;
-    
-    /* PCLK1 = HCLK / 4*/
-    RCC->CFGR |= RCC_CFGR_PPRE1_DIV4;
-
-    /* Configure the main PLL */
-    RCC->PLLCFGR = PLL_M | (PLL_N << 6) | (((PLL_P >> 1) -1) << 16) |
-                   (RCC_PLLCFGR_PLLSRC_HSE) | (PLL_Q << 24);
-
-    /* Enable the main PLL */
-    RCC->CR |= RCC_CR_PLLON;
-
-    /* Wait till the main PLL is ready */
-    while((RCC->CR & RCC_CR_PLLRDY) == 0)
+    RCC->CR |= RCC_CR_HSION;
+    while((RCC->CR & RCC_CR_HSIRDY) == 0)
     {
     }
-   
-    /* Configure Flash prefetch, Instruction cache, Data cache and wait state */
-    FLASH->ACR = FLASH_ACR_PRFTEN | FLASH_ACR_ICEN | FLASH_ACR_DCEN | FLASH_ACR_LATENCY_3WS;
+  }
 
-    /* Select the main PLL as system clock source */
-    RCC->CFGR &= (uint32_t)((uint32_t)~(RCC_CFGR_SW));
-    RCC->CFGR |= RCC_CFGR_SW_PLL;
+  latency = (setting->Hclk - 1) / HCLK_PER_WAIT_STATE;
+  ppre = (SystemClockPpre(setting->Hclk, PCLK1_MAX) << 10) |
+         (SystemClockPpre(setting->Hclk, PCLK2_MAX) << 13);
 
-    /* Wait till the main PLL is used as system clock source */
-    while ((RCC->CFGR & (uint32_t)RCC_CFGR_SWS ) != RCC_CFGR_SWS_PLL);
+  primask = __get_PRIMASK();
+  __disable_irq();
+  /* Wait states for the faster of the two clocks while HCLK changes */
+  if (latency > (FLASH->ACR & FLASH_ACR_LATENCY))
+  {
+    FLASH->ACR = FLASH_ACR_PRFTEN | FLASH_ACR_ICEN | FLASH_ACR_DCEN | latency;
+    while ((FLASH->ACR & FLASH_ACR_LATENCY) != latency)
     {
     }
   }
-  else
-  { /* If HSE fails to start-up, the application will have wrong clock
-         configuration. User can add here some code to deal with this error */
+  /* PCLK1 and PCLK2 = HCLK / 16 meanwhile: within their limits either way */
+  cfgr = RCC->CFGR | RCC_CFGR_PPRE1 | RCC_CFGR_PPRE2;
+  RCC->CFGR = cfgr;
+  cfgr = (cfgr & ~(RCC_CFGR_SW | RCC_CFGR_HPRE)) | setting->Source | setting->Hpre;
+  RCC->CFGR = cfgr;
+  while ((RCC->CFGR & (uint32_t)RCC_CFGR_SWS) != (setting->Source << 2))
+  {
+  }
+  RCC->CFGR = (cfgr & ~(RCC_CFGR_PPRE1 | RCC_CFGR_PPRE2)) | ppre;
+  FLASH->ACR = FLASH_ACR_PRFTEN | FLASH_ACR_ICEN | FLASH_ACR_DCEN | latency;
+  if (setting->Source != RCC_CFGR_SW_PLL)
+  {
+    RCC->CR &= ~(RCC_CR_PLLON | RCC_CR_HSEON);
+  }
+  __set_PRIMASK(primask);
+
+  SystemCoreClockUpdate();
+  for (i = 0; i < SystemClockNotifyCount; i++)
+  {
+    SystemClockNotify[i]();
+  }
+  return 0;
+}
+
+/**
+  * @brief  Adds a function called after each SystemClockSwitch(), with the
+  *         new clocks in SystemClocks and SystemCoreClock
+  * @param  Callback: sets up again what depends on the clocks
+  * @retval 0: added, 1: SYSCLK_NOTIFY_MAX functions given already
+  */
+uint32_t SystemClockRegister(SystemClockCallback Callback)
+{
+  if (SystemClockNotifyCount == SYSCLK_NOTIFY_MAX)
+  {
+    return 1;
   }
+  SystemClockNotify[SystemClockNotifyCount++] = Callback;
+  return 0;
+}
 
+/**
+  * @brief  APB prescaler keeping a PCLK within its limit
+  * @param  hclk: HCLK in Hz
+  * @param  max: highest PCLK in Hz
+  * @retval PPREx field, unshifted
+  */
+static uint32_t SystemClockPpre(uint32_t hclk, uint32_t max)
+{
+  uint32_t shift = 0;
+
+  while ((hclk >> shift) > max)
+  {
+    shift++;
+  }
+  return (shift == 0) ? 0 : (0x4 | (shift - 1));
 }
 
 /**
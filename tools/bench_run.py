@@ -0,0 +1,102 @@
+#!/usr/bin/env python
+# Runs the benchmark image (bench/bench.c) under QEMU and compares the cycle
+# counts with a baseline.
+#
+#   bench_run.py [-t PERCENT] [-b BASELINE] [-o REPORT] [-u] [--qemu QEMU] ELF
+#
+# The image runs on the netduino2 machine (STM32F205, Cortex-M3) with
+# -icount: QEMU then advances time by instruction and the counts are the
+# same at every run of the same image. They follow the instructions
+# executed, not the wait states and bus cycles of the board. QEMU does not
+# model the FLASH interface, the CRC, the DMA nor the HASH: the kernels that
+# use them come with "board": 1, their counts are the instructions of the
+# driver code only. With -icount shift=3 those are as steady as the others,
+# so they are in the baseline and the comparison too; the report marks them.
+#
+# The report holds every kernel with its baseline and the ratio to it.
+# The exit status is 1 when a kernel takes more than PERCENT (default 5)
+# above its baseline, or is missing. -u writes the results as the new
+# baseline; without a baseline file the results are only reported.
+
+import argparse
+import json
+import subprocess
+import sys
+
+QEMU_ARGS = ['-M', 'netduino2', '-nographic', '-monitor', 'none', '-serial', 'null',
+             '-semihosting-config', 'enable=on,target=native', '-icount', 'shift=3']
+
+
+def run(qemu, elf, timeout):
+  """Cycle counts of the image, {name: {'bytes': n, 'cycles': n, 'board': 0 or 1}}."""
+  out = subprocess.run([qemu] + QEMU_ARGS + ['-kernel', elf], stdout=subprocess.PIPE,
+                       timeout=timeout, check=True).stdout.decode('ascii', 'replace')
+  start = out.find('{')
+  if start < 0:
+    raise RuntimeError('no report in the output of %s: %r' % (qemu, out))
+  report = json.loads(out[start:])
+  return dict((k['name'], {'bytes': k['bytes'], 'cycles': k['cycles'], 'board': k.get('board', 0)})
+              for k in report['kernels'])
+
+
+def compare(results, baseline, threshold):
+  """Adds baseline and ratio to the results, gives the names that regress."""
+  failed = []
+  for name, base in sorted(baseline.items()):
+    if name not in results:
+      failed.append(name)
+      continue
+    result = results[name]
+    result['baseline'] = base['cycles']
+    result['ratio'] = float(result['cycles']) / max(base['cycles'], 1)
+    if result['ratio'] > 1 + threshold / 100.0:
+      failed.append(name)
+  return failed
+
+
+def main(argv):
+  parser = argparse.ArgumentParser()
+  parser.add_argument('-t', '--threshold', type=float, default=5.0,
+                      help='regression limit in percent of the baseline')
+  parser.add_argument('-b', '--baseline', default='bench_baseline.json')
+  parser.add_argument('-o', '--report', help='JSON report file')
+  parser.add_argument('-u', '--update', action='store_true',
+                      help='write the results as the new baseline')
+  parser.add_argument('--qemu', default='qemu-system-arm')
+  parser.add_argument('--timeout', type=float, default=600)
+  parser.add_argument('elf')
+  args = parser.parse_args(argv[1:])
+
+  results = run(args.qemu, args.elf, args.timeout)
+  try:
+    baseline = json.load(open(args.baseline))
+  except IOError:
+    baseline = {}
+  failed = compare(results, baseline, args.threshold)
+
+  print('%-20s  %8s  %12s  %12s  %8s  %s' % ('kernel', 'bytes', 'cycles', 'baseline', 'ratio', 'cycles/byte'))
+  for name, result in sorted(results.items()):
+    print('%-20s  %8d  %12d  %12s  %8s  %s' % (
+      name, result['bytes'], result['cycles'], result.get('baseline', '-'),
+      '%.3f' % result['ratio'] if 'ratio' in result else '-',
+      '%.2f' % (float(result['cycles']) / result['bytes']) if result['bytes'] else '-')
+      + ('  (instructions only, time it on the board)' if result['board'] else ''))
+  for name in failed:
+    print('%s: %s' % (name, 'missing' if name not in results else
+                      'more than %g%% above the baseline' % args.threshold))
+  if not baseline:
+    print('no baseline in %s' % args.baseline)
+
+  if args.report:
+    json.dump({'threshold': args.threshold, 'failed': failed, 'kernels': results},
+              open(args.report, 'w'), indent=2, sort_keys=True)
+  if args.update:
+    json.dump(dict((name, {'bytes': r['bytes'], 'cycles': r['cycles']})
+                   for name, r in results.items()),
+              open(args.baseline, 'w'), indent=2, sort_keys=True)
+    return 0
+  return 1 if failed else 0
+
+
+if __name__ == '__main__':
+  sys.exit(main(sys.argv))
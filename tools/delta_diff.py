@@ -0,0 +1,166 @@
+#!/usr/bin/env python
+# Delta image for CMD_Download_Delta.
+#
+#   delta_diff.py OLD.bin NEW.bin IMAGE.delta
+#
+# OLD.bin is the image resident in the running slot, NEW.bin the image
+# linked for the other slot. Like bsdiff, the new image is cut into regions
+# aligned on the old image, and within a region into COPY runs (identical
+# bytes) and ADD runs (byte differences, which catch the shifted addresses
+# and branch offsets of a rebuilt image); what matches nothing is sent as
+# DATA. See boot_driver/inc/delta_flash.h for the stream format.
+#
+# The output starts with the CMD_Download_Delta header (HEADER). The scons
+# build replays it through boot_driver/delta_flash.c with the host program
+# tools/sim/delta_check.
+
+import struct
+import sys
+
+from stm32_crc import stm32_crc
+
+MAGIC = b'IKVD'
+# magic, image length, image CRC, patch length, resident length, resident CRC
+HEADER = struct.Struct('<4sIIIII')
+
+OP_COPY = 0x00
+OP_ADD = 0x01
+OP_DATA = 0x02
+
+BLOCK = 8             # length of the hashed seeds
+MAX_CANDIDATES = 32   # old positions tried per seed
+SLACK = 64            # extension stops this far past the best score
+MIN_COPY = 6          # shorter identical runs stay in an ADD run
+
+
+def _varint(out, n):
+  while n >= 0x80:
+    out.append((n & 0x7F) | 0x80)
+    n >>= 7
+  out.append(n)
+
+
+def _zigzag(n):
+  return (n << 1) if n >= 0 else ((-n << 1) - 1)
+
+
+def _index(old):
+  index = {}
+  for i in range(len(old) - BLOCK + 1):
+    index.setdefault(old[i:i + BLOCK], []).append(i)
+  return index
+
+
+def _exact(old, new, i, j):
+  n = 0
+  while i + n < len(new) and j + n < len(old) and new[i + n] == old[j + n]:
+    n += 1
+  return n
+
+
+def _extend(old, new, i, j):
+  """bsdiff forward extension: length maximising 2 * matches - length."""
+  best, best_len, score, n = 0, 0, 0, 0
+  while i + n < len(new) and j + n < len(old) and n - best_len < SLACK:
+    if new[i + n] == old[j + n]:
+      score += 1
+    n += 1
+    if score * 2 - n > best * 2 - best_len:
+      best, best_len = score, n
+  return best_len
+
+
+def _match(old, new, index, i, expected):
+  """Best old position for new[i:], None when nothing is worth a region."""
+  seed = new[i:i + BLOCK]
+  candidates = index.get(seed, [])[-MAX_CANDIDATES:]
+  if 0 <= expected <= len(old) - BLOCK and old[expected:expected + BLOCK] == seed:
+    candidates = [expected] + candidates
+  best, best_len = None, BLOCK - 1
+  for j in candidates:
+    n = _exact(old, new, i, j)
+    if n > best_len:
+      best, best_len = j, n
+  return best
+
+
+def _region(out, old, new, i, j, length, seek):
+  """COPY and ADD runs for new[i:i+length] against old[j:j+length]."""
+  diff = bytearray((new[i + k] - old[j + k]) & 0xFF for k in range(length))
+  k = 0
+  while k < length:
+    # identical run long enough for a COPY
+    n = 0
+    while k + n < length and diff[k + n] == 0:
+      n += 1
+    if n >= MIN_COPY or k + n == length:
+      out.append(OP_COPY)
+      _varint(out, n)
+      _varint(out, _zigzag(seek))
+      seek = 0
+      k += n
+      continue
+    # ADD up to the next identical run worth a COPY
+    start = k
+    zeros = 0
+    while k < length:
+      zeros = zeros + 1 if diff[k] == 0 else 0
+      k += 1
+      if zeros == MIN_COPY:
+        k -= zeros
+        break
+    out.append(OP_ADD)
+    _varint(out, k - start)
+    _varint(out, _zigzag(seek))
+    seek = 0
+    out += diff[start:k]
+
+
+def diff(old, new):
+  index = _index(old)
+  out = bytearray()
+  old_pos = 0       # old position after the last region
+  literal = 0       # start of the new bytes not covered yet
+  i = 0
+  while i < len(new):
+    j = _match(old, new, index, i, old_pos + (i - literal))
+    if j is None:
+      i += 1
+      continue
+    if i > literal:
+      out.append(OP_DATA)
+      _varint(out, i - literal)
+      out += new[literal:i]
+    length = max(_extend(old, new, i, j), _exact(old, new, i, j))
+    _region(out, old, new, i, j, length, j - old_pos)
+    old_pos = j + length
+    i += length
+    literal = i
+  if literal < len(new):
+    out.append(OP_DATA)
+    _varint(out, len(new) - literal)
+    out += new[literal:]
+  return bytes(out)
+
+
+def pack(old, new):
+  stream = diff(old, new)
+  patch = HEADER.pack(MAGIC, len(new), stm32_crc(new), len(stream),
+                      len(old), stm32_crc(old)) + stream
+  return patch
+
+
+def main(argv):
+  if len(argv) != 4:
+    sys.stderr.write('usage: %s OLD.bin NEW.bin IMAGE.delta\n' % argv[0])
+    return 2
+  old = open(argv[1], 'rb').read()
+  new = open(argv[2], 'rb').read()
+  patch = pack(old, new)
+  open(argv[3], 'wb').write(patch)
+  print('%s: %d -> %d bytes' % (argv[3], len(new), len(patch)))
+  return 0
+
+
+if __name__ == '__main__':
+  sys.exit(main(sys.argv))
@@ -0,0 +1,415 @@
+/**
+  ******************************************************************************
+  * @file    frame_sim.c
+  * @brief   Board side of the framed IAP link built for a Linux host, to run
+  *          tools/iap_frame.py against boot_driver/iap_frame.c without a
+  *          board: scons frame_sim
+  *
+  *          frame_sim [-e ERRORS] [-s SEED] OUT
+  *
+  *          Opens a pseudo terminal and prints the name of its slave, the
+  *          port given to tools/iap_download.py --framed. Answers
+  *          CMD_Return_Slot and CMD_Frame on the raw link, then CMD_Download,
+  *          CMD_Signature, CMD_Return_Ver and CMD_Activate in FRAME_CMD
+  *          frames. A downloaded image whose CRC matches its header is
+  *          written to OUT. CMD_Activate resets the link to raw, the
+  *          program ends once it has answered CMD_Return_Slot again.
+  *          -e corrupts about ERRORS bytes per million in both directions,
+  *          so that frames get lost and sent again.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#define _DEFAULT_SOURCE
+#define _XOPEN_SOURCE 600
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include "iap_frame.h"
+
+/* Private define ------------------------------------------------------------*/
+/* Commands of boot_driver/inc/IGS_STM32_IAP_APP.h */
+#define CMD_Return_Ver        0xC1
+#define CMD_Download          0xC3
+#define CMD_Activate          0xC4
+#define CMD_Return_Slot       0xC6
+#define CMD_Signature         0xC9
+#define CMD_Frame             0xCB
+#define CMD_ACK               0xA3
+#define CMD_NACK              0xA4
+
+#define SIM_HEADER_SIZE       8
+#define SIM_SIGNATURE_SIZE    48
+#define SIM_IMAGE_MAX         (384 * 1024)
+
+/* Private variables ---------------------------------------------------------*/
+static int Master = -1;
+static const char* OutName;
+static uint32_t Errors;               /* corrupted bytes per million */
+static FRAME_Link Link;
+static uint32_t Framed;
+static uint32_t Reset;               /* CMD_Activate answered */
+static uint32_t Done;
+
+static uint8_t Command;               /* command whose header is received */
+static uint8_t Header[SIM_SIGNATURE_SIZE];
+static uint32_t HeaderCount;
+static uint32_t HeaderSize;
+
+static uint32_t Image[SIM_IMAGE_MAX / 4 + 1];
+static uint32_t ImageSize;
+static uint32_t ImageCrc;
+static uint32_t Received;
+static uint32_t Downloading;
+static const uint8_t Version[20] = "FRAME_SIM";
+
+/* Private function prototypes -----------------------------------------------*/
+static uint32_t SIM_Crc(const uint32_t* Data, uint32_t Words);
+static void SIM_Send(const uint8_t* Data, uint32_t Length);
+static void SIM_Deliver(uint32_t Type, const uint32_t* Data, uint32_t Length);
+static void SIM_Reply(uint8_t Data);
+static void SIM_Command(uint8_t Data);
+static void SIM_Header(void);
+static void SIM_Corrupt(uint8_t* Data, uint32_t Length);
+static uint32_t SIM_Field(const uint8_t* Data);
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Main program
+  * @param  argc, argv: [-e ERRORS] [-s SEED] OUT
+  * @retval 0 after CMD_Activate, 1 on an error
+  */
+int main(int argc, char** argv)
+{
+  struct termios tio;
+  uint8_t buffer[4096];
+  ssize_t length = 0;
+  int slave = -1, option = 0;
+  ssize_t i = 0;
+
+  srand(1);
+  while ((option = getopt(argc, argv, "e:s:")) != -1)
+  {
+    switch (option)
+    {
+      case 'e':
+        Errors = (uint32_t)strtoul(optarg, 0, 0);
+        break;
+      case 's':
+        srand((unsigned)strtoul(optarg, 0, 0));
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-e ERRORS] [-s SEED] OUT\n", argv[0]);
+        return 1;
+    }
+  }
+  if (optind + 1 != argc)
+  {
+    fprintf(stderr, "usage: %s [-e ERRORS] [-s SEED] OUT\n", argv[0]);
+    return 1;
+  }
+  OutName = argv[optind];
+
+  Master = posix_openpt(O_RDWR | O_NOCTTY);
+  if ((Master < 0) || (grantpt(Master) != 0) || (unlockpt(Master) != 0))
+  {
+    perror("posix_openpt");
+    return 1;
+  }
+
+  /* Raw bytes on the slave side, kept open so that the master does not
+     see a hang up between two host programs */
+  slave = open(ptsname(Master), O_RDWR | O_NOCTTY);
+  if ((slave < 0) || (tcgetattr(slave, &tio) != 0))
+  {
+    perror(ptsname(Master));
+    return 1;
+  }
+  cfmakeraw(&tio);
+  tcsetattr(slave, TCSANOW, &tio);
+
+  printf("%s\n", ptsname(Master));
+  fflush(stdout);
+
+  while (Done == 0)
+  {
+    length = read(Master, buffer, sizeof(buffer));
+    if (length <= 0)
+    {
+      perror("read");
+      return 1;
+    }
+    SIM_Corrupt(buffer, (uint32_t)length);
+
+    if (Framed != 0)
+    {
+      FRAME_Receive(&Link, buffer, (uint32_t)length);
+      continue;
+    }
+    for (i = 0; (i < length) && (Framed == 0); i++)
+    {
+      SIM_Command(buffer[i]);
+    }
+    if (i < length)
+    {
+      FRAME_Receive(&Link, buffer + i, (uint32_t)(length - i));
+    }
+  }
+
+  /* Let the host read the last answer */
+  tcdrain(Master);
+  sleep(1);
+  return 0;
+}
+
+/**
+  * @brief  CRC unit value: CRC-32 polynomial 0x04C11DB7, initial value
+  *         0xFFFFFFFF, one 32-bit word at a time, most significant bit first
+  * @param  Data: words
+  * @param  Words: number of words
+  * @retval CRC value
+  */
+static uint32_t SIM_Crc(const uint32_t* Data, uint32_t Words)
+{
+  uint32_t crc = 0xFFFFFFFF, i = 0, bit = 0;
+
+  for (i = 0; i < Words; i++)
+  {
+    crc ^= Data[i];
+    for (bit = 0; bit < 32; bit++)
+    {
+      crc = (crc & 0x80000000) ? ((crc << 1) ^ 0x04C11DB7) : (crc << 1);
+    }
+  }
+  return crc;
+}
+
+/**
+  * @brief  Sends bytes to the host
+  * @param  Data: bytes
+  * @param  Length: number of bytes
+  * @retval None
+  */
+static void SIM_Send(const uint8_t* Data, uint32_t Length)
+{
+  uint8_t buffer[FRAME_SIZE_MAX];
+
+  memcpy(buffer, Data, Length);
+  SIM_Corrupt(buffer, Length);
+  if (write(Master, buffer, Length) != (ssize_t)Length)
+  {
+    perror("write");
+    exit(1);
+  }
+}
+
+/**
+  * @brief  Payload of a frame, in sequence order
+  * @param  Type: FRAME_CMD or FRAME_DATA
+  * @param  Data: payload
+  * @param  Length: payload length
+  * @retval None
+  */
+static void SIM_Deliver(uint32_t Type, const uint32_t* Data, uint32_t Length)
+{
+  const uint8_t* data = (const uint8_t*)Data;
+  FILE* out = 0;
+  uint32_t i = 0;
+
+  if (Type == FRAME_CMD)
+  {
+    for (i = 0; i < Length; i++)
+    {
+      SIM_Command(data[i]);
+    }
+    return;
+  }
+
+  if (Downloading == 0)
+  {
+    return;
+  }
+  if (Length > ImageSize - Received)
+  {
+    Length = ImageSize - Received;
+  }
+  memcpy((uint8_t*)Image + Received, data, Length);
+  Received += Length;
+  if (Received < ImageSize)
+  {
+    return;
+  }
+
+  Downloading = 0;
+  memset((uint8_t*)Image + ImageSize, 0xFF, 4);
+  if (SIM_Crc(Image, (ImageSize + 3) / 4) != ImageCrc)
+  {
+    SIM_Reply(CMD_NACK);
+    return;
+  }
+  out = fopen(OutName, "wb");
+  if ((out == 0) || (fwrite(Image, 1, ImageSize, out) != ImageSize))
+  {
+    perror(OutName);
+    exit(1);
+  }
+  fclose(out);
+  SIM_Reply(CMD_ACK);
+}
+
+/**
+  * @brief  Answers the host, in a FRAME_ACK once the link is framed
+  * @param  Data: reply byte
+  * @retval None
+  */
+static void SIM_Reply(uint8_t Data)
+{
+  if (Framed != 0)
+  {
+    FRAME_Reply(&Link, Data);
+  }
+  else
+  {
+    SIM_Send(&Data, 1);
+  }
+}
+
+/**
+  * @brief  Command byte, as IAP_Command() of the board
+  * @param  Data: received byte
+  * @retval None
+  */
+static void SIM_Command(uint8_t Data)
+{
+  uint32_t i = 0;
+
+  if (HeaderSize != 0)
+  {
+    Header[HeaderCount++] = Data;
+    if (HeaderCount == HeaderSize)
+    {
+      HeaderSize = 0;
+      SIM_Header();
+    }
+    return;
+  }
+
+  switch (Data)
+  {
+    case CMD_Return_Slot:
+      SIM_Reply(0);
+      Done = Reset;
+      break;
+
+    case CMD_Frame:
+      if (Framed == 0)
+      {
+        SIM_Reply(CMD_ACK);
+        FRAME_Init(&Link, SIM_Crc, SIM_Send, SIM_Deliver);
+        Framed = 1;
+      }
+      else
+      {
+        SIM_Reply(CMD_NACK);
+      }
+      break;
+
+    case CMD_Return_Ver:
+      for (i = 0; i < sizeof(Version); i++)
+      {
+        SIM_Reply(Version[i]);
+      }
+      break;
+
+    case CMD_Download:
+    case CMD_Signature:
+      if ((Framed != 0) && (Downloading == 0))
+      {
+        Command = Data;
+        HeaderCount = 0;
+        HeaderSize = (Data == CMD_Download) ? SIM_HEADER_SIZE : SIM_SIGNATURE_SIZE;
+      }
+      else
+      {
+        SIM_Reply(CMD_NACK);
+      }
+      break;
+
+    case CMD_Activate:
+      SIM_Reply(CMD_ACK);
+      if (Framed != 0)
+      {
+        FRAME_Ack(&Link);
+      }
+      Framed = 0;
+      Reset = 1;
+      break;
+
+    default:
+      SIM_Reply(CMD_NACK);
+      break;
+  }
+}
+
+/**
+  * @brief  Header of CMD_Download or CMD_Signature received. The
+  *         signature is not checked.
+  * @param  None
+  * @retval None
+  */
+static void SIM_Header(void)
+{
+  if (Command == CMD_Signature)
+  {
+    SIM_Reply(CMD_ACK);
+    return;
+  }
+
+  ImageSize = SIM_Field(Header);
+  ImageCrc = SIM_Field(Header + 4);
+  if ((ImageSize == 0) || (ImageSize > SIM_IMAGE_MAX))
+  {
+    SIM_Reply(CMD_NACK);
+    return;
+  }
+  Received = 0;
+  Downloading = 1;
+  SIM_Reply(CMD_ACK);
+}
+
+/**
+  * @brief  Changes bytes at random, about Errors per million
+  * @param  Data: bytes
+  * @param  Length: number of bytes
+  * @retval None
+  */
+static void SIM_Corrupt(uint8_t* Data, uint32_t Length)
+{
+  uint32_t i = 0;
+
+  if (Errors == 0)
+  {
+    return;
+  }
+  for (i = 0; i < Length; i++)
+  {
+    if ((uint32_t)(rand() % 1000000) < Errors)
+    {
+      Data[i] ^= (uint8_t)(1 + rand() % 255);
+    }
+  }
+}
+
+/**
+  * @brief  Reads a 32-bit little endian field
+  * @param  Data: field bytes
+  * @retval Field value
+  */
+static uint32_t SIM_Field(const uint8_t* Data)
+{
+  return Data[0] | (Data[1] << 8) | (Data[2] << 16) | ((uint32_t)Data[3] << 24);
+}
@@ -0,0 +1,249 @@
+#!/usr/bin/env python
+# Host side of the IAP download commands (CMD_Download, CMD_Download_LZ,
+# CMD_Download_Delta).
+#
+#   iap_download.py [-b BAUD] [--fast[=MAX]] [--framed] [--activate] PORT IMAGE_A [IMAGE_B]
+#   iap_download.py [-b BAUD] --rollback PORT
+#
+# --fast first moves the link to the highest rate up to MAX (3.75 Mbit/s by
+# default) that passes the CMD_Baud test in both directions. Without
+# --framed the rate is kept to RAW_BAUD_MAX: the raw link has no flow
+# control, a block must not arrive faster than the board programs one.
+# --framed then switches the board to the framed link (CMD_Frame,
+# iap_frame.py): every command and piece of the image is checked and the
+# frames lost are sent again, the image is not padded.
+#
+# Asks the board which slot it downloads to (CMD_Return_Slot) and picks the
+# image linked for that slot (ikv_a.bin or ikv_b.bin). Sends CMD_Download
+# with the image length and CRC, waits for the board to erase the sectors
+# the image needs (CMD_ACK), then streams the image padded with 0xFF to a
+# multiple of IAP_DL_BLOCK_SIZE and waits for the final CMD_ACK.
+# Images made by lz4_pack.py (ikv_a.lz4, ikv_b.lz4) are sent compressed
+# with CMD_Download_LZ, the header of the file is the command header.
+# Patches made by delta_diff.py (ikv_a.delta, ikv_b.delta) are sent the same
+# way with CMD_Download_Delta; the board refuses a patch made against
+# another image than the one running.
+# The signature made by image_sign.py (ikv_a.sig next to ikv_a.bin,
+# ikv_a.lz4 or ikv_a.delta) is sent with CMD_Signature after the image.
+# With --activate the board then switches to the new slot and resets, it
+# refuses to without a valid signature.
+# After --activate or --rollback the time from the answer until the new
+# image answers CMD_Return_Slot (at BAUD, on the raw link) is reported.
+
+import argparse
+import os
+import struct
+import sys
+import time
+
+import serial
+
+from stm32_crc import stm32_crc
+from lz4_pack import MAGIC as LZ_MAGIC, HEADER as LZ_HEADER
+from delta_diff import MAGIC as DELTA_MAGIC, HEADER as DELTA_HEADER
+from iap_frame import FrameLink
+
+CMD_DOWNLOAD = 0xC3
+CMD_ACTIVATE = 0xC4
+CMD_ROLLBACK = 0xC5
+CMD_RETURN_SLOT = 0xC6
+CMD_DOWNLOAD_LZ = 0xC7
+CMD_DOWNLOAD_DELTA = 0xC8
+CMD_SIGNATURE = 0xC9
+CMD_BAUD = 0xCA
+CMD_FRAME = 0xCB
+CMD_ACK = 0xA3
+CMD_NACK = 0xA4
+
+IAP_DL_BLOCK_SIZE = 2048
+
+ERASE_TIMEOUT = 30.0
+SIGNATURE_TIMEOUT = 5.0
+
+# Rates tried by negotiate(), highest first
+BAUD_RATES = [3750000, 3000000, 2000000, 1500000, 1000000, 921600, 460800, 230400]
+# Raw link: the board programs a block of 512 words in 8.2 ms at the
+# typical 16 us per word, plus the CRC check, while the next one comes in.
+# At 1 Mbit/s a block takes 20 ms, room for slower words and for the LZ and
+# delta decoders; at 3.75 Mbit/s it takes 5.5 ms and the board answers
+# CMD_NACK on the RX DMA overrun.
+RAW_BAUD_MAX = 1000000
+BAUD_PATTERN = bytes(range(256))
+BAUD_SYNC = b'SYNC'
+
+
+def wait_status(port, timeout):
+  port.timeout = timeout
+  status = port.read(1)
+  if not status:
+    raise RuntimeError('timeout waiting for the board')
+  if ord(status) != CMD_ACK:
+    raise RuntimeError('board answered 0x%02X' % ord(status))
+
+
+class RawLink(object):
+  """Commands and stream straight on the port."""
+
+  def __init__(self, port):
+    self.port = port
+
+  def reply(self, length=1, timeout=1.0):
+    self.port.timeout = timeout
+    reply = self.port.read(length)
+    if len(reply) < length:
+      raise RuntimeError('timeout waiting for the board')
+    return reply
+
+  def request(self, data, length=1, timeout=1.0):
+    self.port.reset_input_buffer()
+    self.port.write(data)
+    return self.reply(length, timeout)
+
+  def stream(self, data):
+    self.port.write(data + b'\xff' * (-len(data) % IAP_DL_BLOCK_SIZE))
+
+
+def check(reply):
+  if reply[0] != CMD_ACK:
+    raise RuntimeError('board answered 0x%02X' % reply[0])
+
+
+def download_slot(link):
+  return link.request(bytes([CMD_RETURN_SLOT]))[0]
+
+
+def set_baud(port, baud):
+  """Tries the CMD_Baud handshake, True when the link runs at baud."""
+  previous = port.baudrate
+  port.reset_input_buffer()
+  port.write(struct.pack('<BI', CMD_BAUD, baud))
+  try:
+    wait_status(port, 1.0)
+  except RuntimeError:
+    return False
+
+  try:
+    port.flush()
+    port.baudrate = baud
+    time.sleep(0.01)
+    port.reset_input_buffer()
+    port.write(BAUD_PATTERN)
+    port.timeout = 1.0
+    if port.read(len(BAUD_PATTERN)) == BAUD_PATTERN:
+      port.write(bytes([CMD_ACK]))
+      wait_status(port, 1.0)
+      return True
+  except (RuntimeError, ValueError, serial.SerialException):
+    pass
+
+  # The board went back to the previous rate: make it drop what it may
+  # have received since and listen again
+  port.baudrate = previous
+  time.sleep(0.01)
+  port.write(b'\xff')
+  time.sleep(0.05)
+  port.reset_input_buffer()
+  port.write(BAUD_SYNC)
+  wait_status(port, 1.0)
+  return False
+
+
+def negotiate(port, maximum=BAUD_RATES[0]):
+  """Moves the link to the highest rate of BAUD_RATES up to maximum."""
+  for baud in BAUD_RATES:
+    if baud <= maximum and set_baud(port, baud):
+      return baud
+  return port.baudrate
+
+
+def wait_ready(port, baud, timeout=10.0):
+  """Time from now until the board answers CMD_Return_Slot after a reset."""
+  start = time.time()
+  port.baudrate = baud
+  while time.time() - start < timeout:
+    port.reset_input_buffer()
+    port.write(bytes([CMD_RETURN_SLOT]))
+    port.timeout = 0.005
+    # Not the end of an answer sent before the reset
+    if port.read(1) in (b'\x00', b'\x01'):
+      return time.time() - start
+  raise RuntimeError('board not ready %d s after the reset' % timeout)
+
+
+def download(link, image):
+  if image.startswith(LZ_MAGIC):
+    header = bytes([CMD_DOWNLOAD_LZ]) + image[:LZ_HEADER.size]
+    image = image[LZ_HEADER.size:]
+  elif image.startswith(DELTA_MAGIC):
+    header = bytes([CMD_DOWNLOAD_DELTA]) + image[:DELTA_HEADER.size]
+    image = image[DELTA_HEADER.size:]
+  else:
+    header = struct.pack('<BII', CMD_DOWNLOAD, len(image), stm32_crc(image))
+
+  check(link.request(header, 1, ERASE_TIMEOUT))
+
+  start = time.time()
+  link.stream(image)
+  check(link.reply(1, 5.0))
+  return time.time() - start
+
+
+def main(argv):
+  parser = argparse.ArgumentParser()
+  parser.add_argument('-b', '--baud', type=int, default=115200)
+  parser.add_argument('--fast', type=int, nargs='?', const=BAUD_RATES[0], metavar='MAX',
+                      help='negotiate the highest baud rate up to MAX')
+  parser.add_argument('--framed', action='store_true',
+                      help='use the framed link (CMD_Frame)')
+  parser.add_argument('--activate', action='store_true',
+                      help='switch to the new image and reset')
+  parser.add_argument('--rollback', action='store_true',
+                      help='switch back to the other slot and reset')
+  parser.add_argument('port')
+  parser.add_argument('images', nargs='*', help='image for slot A, image for slot B')
+  args = parser.parse_args(argv[1:])
+
+  port = serial.Serial(args.port, args.baud)
+  link = RawLink(port)
+
+  if args.rollback:
+    check(link.request(bytes([CMD_ROLLBACK])))
+    print('rolled back, ready after %.0f ms' % (wait_ready(port, args.baud) * 1000))
+    return 0
+
+  if not args.images:
+    parser.error('no image')
+
+  if args.fast:
+    maximum = args.fast if args.framed else min(args.fast, RAW_BAUD_MAX)
+    print('link at %d baud' % negotiate(port, maximum))
+
+  if args.framed:
+    check(link.request(bytes([CMD_FRAME])))
+    link = FrameLink(port)
+
+  slot = download_slot(link)
+  name = args.images[min(slot, len(args.images) - 1)]
+  image = open(name, 'rb').read()
+  print('slot %s: %s' % ('AB'[slot], name))
+
+  elapsed = download(link, image)
+  print('%d bytes in %.2f s, %.1f KB/s' % (len(image), elapsed, len(image) / elapsed / 1024))
+  if args.framed:
+    print('%d frames sent again' % link.retransmitted)
+
+  sig = os.path.splitext(name)[0] + '.sig'
+  if os.path.exists(sig):
+    check(link.request(bytes([CMD_SIGNATURE]) + open(sig, 'rb').read(), 1, SIGNATURE_TIMEOUT))
+    print('signature %s accepted' % sig)
+  elif args.activate:
+    parser.error('no signature %s, the board would refuse to activate' % sig)
+
+  if args.activate:
+    check(link.request(bytes([CMD_ACTIVATE])))
+    print('activated, ready after %.0f ms' % (wait_ready(port, args.baud) * 1000))
+  return 0
+
+
+if __name__ == '__main__':
+  sys.exit(main(sys.argv))
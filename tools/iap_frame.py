@@ -0,0 +1,189 @@
+#!/usr/bin/env python
+# Host side of the framed IAP link (boot_driver/inc/iap_frame.h), entered
+# with CMD_Frame. Used by iap_download.py --framed.
+#
+# The commands go in FRAME_CMD frames, the download stream in FRAME_DATA
+# frames of FRAME_PAYLOAD_MAX bytes, up to FRAME_WINDOW of them in flight.
+# The board answers every frame with a FRAME_ACK: next frame expected and
+# bitmap of the frames it holds after it. As the port keeps the order, a
+# frame sent before one the board has is lost and sent again at once; when
+# nothing comes back for a while, all the frames not acknowledged are sent
+# again, or a FRAME_POLL if there are none. The reply bytes come in the
+# FRAME_ACK frames, each host frame gives back how many were received.
+#
+# tools/frame_sim.c is the board side built for the host, to try the link
+# on a pseudo terminal:
+#   scons frame_sim
+#   tools/frame_sim -e 100 out.bin          (prints /dev/pts/N)
+#   tools/iap_download.py --framed /dev/pts/N ikv_a.bin
+
+import struct
+import time
+
+from stm32_crc import stm32_crc
+
+MAGIC = 0x7E
+HEADER = struct.Struct('<BBHHH')   # Magic, Type, Seq, Length, Ack
+PAYLOAD_MAX = 1024
+WINDOW = 8
+
+FRAME_CMD = 0x01
+FRAME_DATA = 0x02
+FRAME_POLL = 0x03
+FRAME_ACK = 0x81
+
+FRAME_SIZE_MAX = HEADER.size + PAYLOAD_MAX + 4
+RETRY_MAX = 20
+
+
+def build(ftype, seq, ack, payload=b''):
+  """Frame bytes: header, payload, 0xFF up to a word, CRC unit value."""
+  frame = HEADER.pack(MAGIC, ftype, seq & 0xFFFF, len(payload), ack & 0xFFFF) + payload
+  frame += b'\xff' * (-len(frame) % 4)
+  return frame + struct.pack('<I', stm32_crc(frame))
+
+
+def _distance(a, b):
+  """Sequence numbers from b to a, 16-bit."""
+  return (a - b) & 0xFFFF
+
+
+class FrameLink(object):
+  """Reliable, ordered commands and stream over the framed link."""
+
+  def __init__(self, port):
+    self.port = port
+    self.seq = 0                # number of the next new frame
+    self.next = 0               # next frame the board waits for
+    self.pending = {}           # seq: [frame type, payload, transmission, retries]
+    self.sent = 0               # transmissions so far
+    self.received = 0           # reply bytes received
+    self.replies = bytearray()
+    self.rx = bytearray()
+    self.retransmitted = 0
+    # Quiet time before sending again: two full frames and some latency
+    self.timeout = 0.05 + 2 * FRAME_SIZE_MAX * 10.0 / port.baudrate
+
+  # Frames -----------------------------------------------------------------
+
+  def _transmit(self, seq):
+    entry = self.pending[seq]
+    self.sent += 1
+    entry[2] = self.sent
+    entry[3] += 1
+    if entry[3] > RETRY_MAX:
+      raise RuntimeError('frame %d not acknowledged' % seq)
+    self.port.write(build(entry[0], seq, self.received, entry[1]))
+
+  def _frames(self, timeout):
+    """FRAME_ACK frames read within timeout, as (seq, ack, payload)."""
+    self.port.timeout = timeout
+    data = self.port.read(max(1, self.port.in_waiting))
+    self.rx += data
+    frames = []
+    while True:
+      start = self.rx.find(bytes([MAGIC]))
+      if start < 0:
+        del self.rx[:]
+        break
+      del self.rx[:start]
+      if len(self.rx) < HEADER.size:
+        break
+      _, ftype, seq, length, ack = HEADER.unpack_from(self.rx)
+      size = HEADER.size + ((length + 3) & ~3) + 4
+      if length > PAYLOAD_MAX:
+        del self.rx[:1]
+        continue
+      if len(self.rx) < size:
+        break
+      frame = bytes(self.rx[:size])
+      if stm32_crc(frame[:-4]) != struct.unpack_from('<I', frame, size - 4)[0] or ftype != FRAME_ACK:
+        del self.rx[:1]
+        continue
+      del self.rx[:size]
+      frames.append((seq, ack, frame[HEADER.size:HEADER.size + length]))
+    return frames
+
+  def _acknowledged(self, seq, count, payload):
+    if len(payload) < 4:
+      return
+    bitmap, = struct.unpack_from('<I', payload)
+    replies = payload[4:]
+
+    # Reply bytes: the FRAME_ACK holds the last ones not confirmed
+    first = (count - len(replies)) & 0xFFFF
+    if _distance(count, self.received) > _distance(count, first):
+      raise RuntimeError('reply bytes lost')
+    new = _distance(count, self.received)
+    if new:
+      self.replies += replies[len(replies) - new:]
+      self.received = count
+
+    # Frames the board has: before seq, or in the bitmap
+    if _distance(seq, self.next) <= WINDOW:
+      self.next = seq
+    latest = 0
+    for s in list(self.pending):
+      d = _distance(s, seq)
+      if d >= 0x8000 or (d > 0 and bitmap & (1 << (d - 1))):
+        latest = max(latest, self.pending.pop(s)[2])
+
+    # Sent before a frame that arrived: lost
+    for s in sorted(self.pending, key=lambda s: _distance(s, self.next)):
+      if self.pending[s][2] < latest:
+        self.retransmitted += 1
+        self._transmit(s)
+
+  def _wait(self, timeout):
+    """Handles the FRAME_ACK frames, True if one came within timeout."""
+    frames = self._frames(timeout)
+    for seq, count, payload in frames:
+      self._acknowledged(seq, count, payload)
+    return bool(frames)
+
+  def _retry(self):
+    if self.pending:
+      for s in sorted(self.pending, key=lambda s: _distance(s, self.next)):
+        self.retransmitted += 1
+        self._transmit(s)
+    else:
+      self.port.write(build(FRAME_POLL, 0, self.received))
+
+  def send(self, ftype, payloads):
+    """Sends numbered frames, returns when the board has them all."""
+    payloads = list(payloads)
+    quiet = time.time()
+    while payloads or self.pending:
+      while payloads and _distance(self.seq, self.next) < WINDOW:
+        self.pending[self.seq] = [ftype, payloads.pop(0), 0, 0]
+        self._transmit(self.seq)
+        self.seq = (self.seq + 1) & 0xFFFF
+      if self._wait(self.timeout):
+        quiet = time.time()
+      elif time.time() - quiet >= self.timeout:
+        self._retry()
+        quiet = time.time()
+
+  # Interface of iap_download.RawLink ----------------------------------------
+
+  def reply(self, length=1, timeout=1.0):
+    """Waits for length reply bytes, polling the board when it is quiet."""
+    deadline = time.time() + timeout
+    while len(self.replies) < length:
+      if time.time() >= deadline:
+        raise RuntimeError('timeout waiting for the board')
+      if not self._wait(min(self.timeout, max(0.0, deadline - time.time()))):
+        self._retry()
+    reply = bytes(self.replies[:length])
+    del self.replies[:length]
+    return reply
+
+  def request(self, data, length=1, timeout=1.0):
+    """Sends command bytes and waits for length reply bytes."""
+    del self.replies[:]
+    self.send(FRAME_CMD, [data[i:i + PAYLOAD_MAX] for i in range(0, len(data), PAYLOAD_MAX)])
+    return self.reply(length, timeout)
+
+  def stream(self, data):
+    """Sends the download stream, not padded."""
+    self.send(FRAME_DATA, [data[i:i + PAYLOAD_MAX] for i in range(0, len(data), PAYLOAD_MAX)])
@@ -0,0 +1,76 @@
+#!/usr/bin/env python
+# Probe table of the board (boot_driver/inc/profile.h), read with CMD_Profile.
+#
+#   iap_profile.py [-b BAUD] [-i SECONDS] PORT
+#
+# Prints for every probe point the number of passes and the minimum, mean
+# and maximum duration in microseconds, then the histogram of the passes
+# per power of 2 cycles. With -i the table is read again every SECONDS and
+# only the passes since the previous read are shown in the histogram.
+# CMD_Profile works on the raw link only.
+
+import argparse
+import struct
+import sys
+import time
+
+import serial
+
+import iap_download
+
+CMD_PROFILE = 0xCC
+HEADER = struct.Struct('<BBBxI')
+NAME_SIZE = 12
+
+
+def read_profile(link):
+  """{name: (count, min, max, mean, histogram)}, core clock, first bucket shift."""
+  header = link.request(bytes([CMD_PROFILE]))
+  if header[0] == iap_download.CMD_NACK:
+    raise RuntimeError('board refused CMD_Profile')
+  header += link.reply(HEADER.size - 1)
+  count, buckets, shift, clock = HEADER.unpack(header)
+  record = struct.Struct('<%ds4I%dI' % (NAME_SIZE, buckets))
+  data = link.reply(count * record.size)
+  probes = {}
+  for i in range(count):
+    fields = record.unpack_from(data, i * record.size)
+    name = fields[0].rstrip(b'\0').decode('ascii')
+    probes[name] = (fields[1], fields[2], fields[3], fields[4], list(fields[5:]))
+  return probes, clock, shift
+
+
+def main(argv):
+  parser = argparse.ArgumentParser()
+  parser.add_argument('-b', '--baud', type=int, default=115200,
+                      help='rate the board listens at')
+  parser.add_argument('-i', '--interval', type=float, help='read again every INTERVAL seconds')
+  parser.add_argument('port')
+  args = parser.parse_args(argv[1:])
+
+  link = iap_download.RawLink(serial.Serial(args.port, args.baud))
+  previous = {}
+  while True:
+    probes, clock, shift = read_profile(link)
+    us = 1e6 / clock
+    print('%-12s  %10s  %10s  %10s  %10s' % ('probe', 'count', 'min us', 'mean us', 'max us'))
+    for name, (count, low, high, mean, histogram) in sorted(probes.items()):
+      print('%-12s  %10d  %10.2f  %10.2f  %10.2f' % (name, count, low * us, mean * us, high * us))
+    for name, (count, low, high, mean, histogram) in sorted(probes.items()):
+      if name in previous:
+        histogram = [a - b for a, b in zip(histogram, previous[name][4])]
+      if any(histogram):
+        print('%s:' % name)
+        for i, passes in enumerate(histogram):
+          if passes:
+            top = '' if i == len(histogram) - 1 else '%.2f' % ((1 << (shift + i + 1)) * us)
+            print('  %10s - %-10s us  %d' % ('0' if i == 0 else '%.2f' % ((1 << (shift + i)) * us), top, passes))
+    if args.interval is None:
+      return 0
+    previous = probes
+    print('')
+    time.sleep(args.interval)
+
+
+if __name__ == '__main__':
+  sys.exit(main(sys.argv))
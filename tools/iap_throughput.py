@@ -0,0 +1,51 @@
+#!/usr/bin/env python
+# Effective IAP download throughput at each baud rate.
+#
+#   iap_throughput.py [-b BAUD] PORT IMAGE_A [IMAGE_B]
+#
+# For every rate of iap_download.BAUD_RATES the link is moved to that rate
+# with the CMD_Baud handshake, then the image is downloaded (not activated)
+# and the time from the first data byte to the final CMD_ACK is measured:
+# it includes the flash programming, not only the line rate. A rate the
+# link does not pass, or a download that fails (the board programs slower
+# than the data arrives), is reported as such.
+
+import argparse
+import sys
+
+import serial
+
+import iap_download
+
+
+def main(argv):
+  parser = argparse.ArgumentParser()
+  parser.add_argument('-b', '--baud', type=int, default=115200,
+                      help='rate the board listens at')
+  parser.add_argument('port')
+  parser.add_argument('images', nargs='+', help='image for slot A, image for slot B')
+  args = parser.parse_args(argv[1:])
+
+  port = serial.Serial(args.port, args.baud)
+  link = iap_download.RawLink(port)
+  slot = iap_download.download_slot(link)
+  image = open(args.images[min(slot, len(args.images) - 1)], 'rb').read()
+
+  print('%10s  %10s  %10s  %s' % ('baud', 'line KB/s', 'KB/s', 'efficiency'))
+  for baud in [args.baud] + sorted(iap_download.BAUD_RATES):
+    if baud != port.baudrate and not iap_download.set_baud(port, baud):
+      print('%10d  %10s' % (baud, 'link test failed'))
+      continue
+    line = baud / 10.0 / 1024
+    try:
+      elapsed = iap_download.download(link, image)
+    except RuntimeError as e:
+      print('%10d  %10.1f  %10s' % (baud, line, e))
+      continue
+    rate = len(image) / elapsed / 1024
+    print('%10d  %10.1f  %10.1f  %5.1f%%' % (baud, line, rate, 100 * rate / line))
+  return 0
+
+
+if __name__ == '__main__':
+  sys.exit(main(sys.argv))
@@ -0,0 +1,182 @@
+#!/usr/bin/env python
+# ECDSA signature of a firmware image, checked by the board before
+# CMD_Activate (boot_driver/image_verify.c, ecdsa_verify of lib/libikv.a).
+#
+#   image_sign.py genkey KEY boot_driver/inc/image_key.h
+#   image_sign.py sign KEY IMAGE.bin IMAGE.sig
+#
+# Curve sect163r2 (NIST B-163) over GF(2^163), hash SHA-256 truncated to
+# the leftmost 163 bits as the board does. KEY holds the private key in hex.
+# IMAGE.sig is r then s, each as 6 little endian 32-bit words, least
+# significant word first: the layout ecdsa_verify() takes.
+
+import hashlib
+import hmac
+import os
+import struct
+import sys
+
+M = 163
+POLY = (1 << 163) | (1 << 7) | (1 << 6) | (1 << 3) | 1
+A = 1
+B = 0x20A601907B8C953CA1481EB10512F78744A3205FD
+GX = 0x3F0EBA16286A2D57EA0991168D4994637E8343E36
+GY = 0x0D51FBC6C71A0094FA2CDD545B11C5C0C797324F1
+N = 0x40000000000000000000292FE77E70C12A4234C33
+
+WORDS = (M + 31) // 32
+SIGNATURE_SIZE = 2 * 4 * WORDS
+
+
+def _mul(a, b):
+  r = 0
+  while b:
+    if b & 1:
+      r ^= a
+    b >>= 1
+    a <<= 1
+    if a >> M:
+      a ^= POLY
+  return r
+
+
+def _inv(a):
+  """Inverse in GF(2^163), extended Euclid on polynomials."""
+  u, v, g1, g2 = a, POLY, 1, 0
+  while u != 1:
+    j = u.bit_length() - v.bit_length()
+    if j < 0:
+      u, v, g1, g2 = v, u, g2, g1
+      j = -j
+    u ^= v << j
+    g1 ^= g2 << j
+  return g1
+
+
+def _add(p, q):
+  if p is None:
+    return q
+  if q is None:
+    return p
+  (x1, y1), (x2, y2) = p, q
+  if x1 == x2:
+    if y1 != y2 or x1 == 0:
+      return None
+    l = x1 ^ _mul(y1, _inv(x1))
+    x3 = _mul(l, l) ^ l ^ A
+    return (x3, _mul(x1, x1) ^ _mul(l ^ 1, x3))
+  l = _mul(y1 ^ y2, _inv(x1 ^ x2))
+  x3 = _mul(l, l) ^ l ^ x1 ^ x2 ^ A
+  return (x3, _mul(l, x1 ^ x3) ^ x3 ^ y1)
+
+
+def _scalar(k, p):
+  r = None
+  while k:
+    if k & 1:
+      r = _add(r, p)
+    p = _add(p, p)
+    k >>= 1
+  return r
+
+
+def _sqrt(a):
+  for _ in range(M - 1):
+    a = _mul(a, a)
+  return a
+
+
+def digest_value(image):
+  """SHA-256 of the image as the integer ecdsa_verify() reduces modulo N."""
+  h = int.from_bytes(hashlib.sha256(image).digest(), 'big')
+  return h >> (256 - M)
+
+
+def sign(key, image):
+  e = digest_value(image)
+  h = hashlib.sha256(image).digest()
+  counter = 0
+  while True:
+    # Deterministic nonce, a fresh one for each attempt
+    k = int.from_bytes(hmac.new(key.to_bytes(32, 'big'), h + bytes([counter]),
+                                hashlib.sha512).digest(), 'big') % N
+    counter += 1
+    if k == 0:
+      continue
+    r = _scalar(k, (GX, GY))[0] % N
+    s = pow(k, N - 2, N) * (e + r * key) % N
+    if r and s:
+      return r, s
+
+
+def verify(public, image, r, s):
+  if not (0 < r < N and 0 < s < N):
+    return False
+  w = pow(s, N - 2, N)
+  e = digest_value(image) % N
+  p = _add(_scalar(e * w % N, (GX, GY)), _scalar(r * w % N, public))
+  return p is not None and p[0] % N == r
+
+
+def public_key(key):
+  return _scalar(key, (GX, GY))
+
+
+def words(value):
+  return struct.pack('<%dI' % WORDS, *[(value >> (32 * i)) & 0xFFFFFFFF for i in range(WORDS)])
+
+
+def _c_words(value):
+  return ', '.join('0x%08X' % ((value >> (32 * i)) & 0xFFFFFFFF) for i in range(WORDS))
+
+
+def key_header(public):
+  return '\n'.join([
+    '/**',
+    '  ******************************************************************************',
+    '  * @file    image_key.h',
+    '  * @brief   Public key of the image signatures, made by',
+    '  *          tools/image_sign.py genkey. Least significant word first.',
+    '  ******************************************************************************',
+    '  */',
+    '',
+    '/* Define to prevent recursive inclusion -------------------------------------*/',
+    '#ifndef __IMAGE_KEY_H',
+    '#define __IMAGE_KEY_H',
+    '',
+    '#define IMAGE_KEY_X           {%s}' % _c_words(public[0]),
+    '#define IMAGE_KEY_Y           {%s}' % _c_words(public[1]),
+    '',
+    '#endif  /* __IMAGE_KEY_H */',
+    ''])
+
+
+def read_key(name):
+  return int(open(name).read().split()[0], 16)
+
+
+def main(argv):
+  if len(argv) == 4 and argv[1] == 'genkey':
+    key = int.from_bytes(os.urandom(32), 'big') % (N - 1) + 1
+    open(argv[2], 'w').write('%x\n' % key)
+    open(argv[3], 'w', newline='\r\n').write(key_header(public_key(key)))
+    print('%s, %s written' % (argv[2], argv[3]))
+    return 0
+
+  if len(argv) == 5 and argv[1] == 'sign':
+    key = read_key(argv[2])
+    image = open(argv[3], 'rb').read()
+    r, s = sign(key, image)
+    if not verify(public_key(key), image, r, s):
+      raise RuntimeError('signature check failed')
+    open(argv[4], 'wb').write(words(r) + words(s))
+    print('%s: signed' % argv[4])
+    return 0
+
+  sys.stderr.write('usage: %s genkey KEY image_key.h\n'
+                   '       %s sign KEY IMAGE.bin IMAGE.sig\n' % (argv[0], argv[0]))
+  return 2
+
+
+if __name__ == '__main__':
+  sys.exit(main(sys.argv))
@@ -0,0 +1,134 @@
+#!/usr/bin/env python
+# Compressed firmware image for CMD_Download_LZ.
+#
+#   lz4_pack.py IMAGE.bin IMAGE.lz4
+#
+# The image is compressed as LZ4 block format sequences (token, literals,
+# 16-bit offset, extended lengths), decoded on the board by
+# boot_driver/lz_flash.c. The output file starts with a header the download
+# tool sends as is in the CMD_Download_LZ header:
+#   magic 'IKVZ', image length, CRC unit value over the image,
+#   compressed length (32-bit little endian each)
+
+import struct
+import sys
+
+from stm32_crc import stm32_crc
+
+MAGIC = b'IKVZ'
+HEADER = struct.Struct('<4sIII')
+
+MIN_MATCH = 4
+MAX_OFFSET = 0xFFFF
+LAST_LITERALS = 5     # LZ4 block rules, kept so any LZ4 decoder reads the
+MF_LIMIT = 12         # stream too
+
+
+def _length(out, n):
+  while n >= 255:
+    out.append(255)
+    n -= 255
+  out.append(n)
+
+
+def _sequence(out, literals, offset=0, match=0):
+  lit = len(literals)
+  ml = match - MIN_MATCH
+  token = min(lit, 15) << 4
+  if offset:
+    token |= min(ml, 15)
+  out.append(token)
+  if lit >= 15:
+    _length(out, lit - 15)
+  out += literals
+  if offset:
+    out += struct.pack('<H', offset)
+    if ml >= 15:
+      _length(out, ml - 15)
+
+
+def compress(data):
+  data = bytes(data)
+  n = len(data)
+  out = bytearray()
+  last = {}
+  anchor = 0
+  i = 0
+  while i < n - MF_LIMIT:
+    key = data[i:i + MIN_MATCH]
+    cand = last.get(key)
+    last[key] = i
+    if cand is None or i - cand > MAX_OFFSET:
+      i += 1
+      continue
+
+    match = MIN_MATCH
+    limit = n - LAST_LITERALS - i
+    while match < limit and data[cand + match] == data[i + match]:
+      match += 1
+
+    _sequence(out, data[anchor:i], i - cand, match)
+    for j in range(i + 1, min(i + match, n - MF_LIMIT)):
+      last[data[j:j + MIN_MATCH]] = j
+    i += match
+    anchor = i
+
+  _sequence(out, data[anchor:])
+  return bytes(out)
+
+
+def decompress(stream, size):
+  out = bytearray()
+  i = 0
+  while i < len(stream):
+    token = stream[i]
+    i += 1
+    lit = token >> 4
+    if lit == 15:
+      while True:
+        lit += stream[i]
+        i += 1
+        if stream[i - 1] != 255:
+          break
+    out += stream[i:i + lit]
+    i += lit
+    if i >= len(stream):
+      break
+    offset = stream[i] | (stream[i + 1] << 8)
+    i += 2
+    match = (token & 0x0F) + MIN_MATCH
+    if match == 15 + MIN_MATCH:
+      while True:
+        match += stream[i]
+        i += 1
+        if stream[i - 1] != 255:
+          break
+    if offset == 0 or offset > len(out):
+      raise ValueError('bad offset')
+    for _ in range(match):
+      out.append(out[-offset])
+  if len(out) != size:
+    raise ValueError('bad length')
+  return bytes(out)
+
+
+def pack(image):
+  stream = compress(image)
+  if decompress(stream, len(image)) != image:
+    raise RuntimeError('compression check failed')
+  return HEADER.pack(MAGIC, len(image), stm32_crc(image), len(stream)) + stream
+
+
+def main(argv):
+  if len(argv) != 3:
+    sys.stderr.write('usage: %s IMAGE.bin IMAGE.lz4\n' % argv[0])
+    return 2
+  image = open(argv[1], 'rb').read()
+  packed = pack(image)
+  open(argv[2], 'wb').write(packed)
+  print('%s: %d -> %d bytes' % (argv[2], len(image), len(packed)))
+  return 0
+
+
+if __name__ == '__main__':
+  sys.exit(main(sys.argv))
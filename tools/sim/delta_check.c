@@ -0,0 +1,203 @@
+/**
+  ******************************************************************************
+  * @file    delta_check.c
+  * @brief   Replays a patch made by tools/delta_diff.py through
+  *          boot_driver/delta_flash.c on the host register model: scons host
+  *
+  *          delta_check OLD.bin PATCH.delta NEW.bin
+  *
+  *          OLD is put in slot A and the header is checked as
+  *          IAP_Download_Start() does. Slot B is erased and rebuilt from the
+  *          stream fed in IAP_DL_BLOCK_SIZE pieces, DELTA_Apply() being
+  *          called again between them as long as DELTA_Pending(), as the RX
+  *          DMA interrupt does. Slot B must then hold NEW followed by erased
+  *          flash; the exit status tells.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "sim.h"
+#include "IGS_STM32_IAP_APP.h"
+#include "boot_record.h"
+#include "delta_flash.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t Old[SLOT_SIZE];
+static uint8_t Patch[SLOT_SIZE + IAP_DL_DELTA_HEADER_SIZE];
+static uint8_t New[SLOT_SIZE];
+static DELTA_Patch Patcher;
+static volatile uint32_t Erased;
+
+/* Private function prototypes -----------------------------------------------*/
+static long SIM_Load(const char* Name, uint8_t* Buffer, uint32_t Size);
+static uint32_t SIM_Field(const uint8_t* Data);
+static void SIM_Erased(uint32_t Status);
+static const char* SIM_Rebuild(uint32_t OldLength, uint32_t PatchLength, uint32_t NewLength);
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Main program
+  * @param  argc, argv: OLD.bin PATCH.delta NEW.bin
+  * @retval 0 when the patch rebuilds NEW, 1 otherwise
+  */
+int main(int argc, char** argv)
+{
+  long old = 0, patch = 0, new = 0;
+  const char* error = 0;
+
+  if (argc != 4)
+  {
+    fprintf(stderr, "usage: %s OLD.bin PATCH.delta NEW.bin\n", argv[0]);
+    return 1;
+  }
+  old = SIM_Load(argv[1], Old, sizeof(Old));
+  patch = SIM_Load(argv[2], Patch, sizeof(Patch));
+  new = SIM_Load(argv[3], New, sizeof(New));
+  if ((old < 0) || (patch < 0) || (new < 0) || (SIM_Init() != 0))
+  {
+    return 1;
+  }
+
+  error = SIM_Rebuild((uint32_t)old, (uint32_t)patch, (uint32_t)new);
+  if (error != 0)
+  {
+    fprintf(stderr, "%s: %s\n", argv[2], error);
+    return 1;
+  }
+  printf("%s: rebuilds %s\n", argv[2], argv[3]);
+  return 0;
+}
+
+/**
+  * @brief  Rebuilds slot B from slot A and the patch, compares it with NEW
+  * @param  OldLength: bytes of OLD
+  * @param  PatchLength: bytes of the patch file, header included
+  * @param  NewLength: bytes of NEW
+  * @retval 0 on success, otherwise what went wrong
+  */
+static const char* SIM_Rebuild(uint32_t OldLength, uint32_t PatchLength, uint32_t NewLength)
+{
+  const uint8_t* slot = (const uint8_t*)SLOT_B_ADDRESS;
+  uint32_t size = SIM_Field(Patch + 4);
+  uint32_t crc = SIM_Field(Patch + 8);
+  uint32_t length = SIM_Field(Patch + 12);
+  uint32_t base = SIM_Field(Patch + 16);
+  uint32_t offset = 0, piece = 0, i = 0;
+
+  if ((PatchLength < IAP_DL_DELTA_HEADER_SIZE) || (SIM_Field(Patch) != IAP_DL_DELTA_MAGIC) ||
+      (size == 0) || (size > SLOT_SIZE) || (length == 0) ||
+      (length != PatchLength - IAP_DL_DELTA_HEADER_SIZE) ||
+      (base > OldLength))
+  {
+    return "bad header";
+  }
+
+  memcpy(SIM_Register(SLOT_A_ADDRESS), Old, OldLength);
+  if (BOOT_ImageCrc(BOOT_SLOT_A, base) != SIM_Field(Patch + 20))
+  {
+    return "resident image does not match the patch";
+  }
+
+  FLASH_If_Init();
+  NVIC_EnableIRQ(FLASH_IRQn);
+  if (FLASH_If_EraseStart(SLOT_B_ADDRESS, SLOT_SIZE, SIM_Erased) != 0)
+  {
+    return "erase refused";
+  }
+  while (Erased == 0)
+  {
+    SIM_Poll();
+  }
+  if (Erased != 1)
+  {
+    return "erase failed";
+  }
+
+  DELTA_Init(&Patcher, SLOT_B_ADDRESS, size, SLOT_A_ADDRESS, base, 0);
+  for (offset = 0; offset < length; offset += piece)
+  {
+    piece = (length - offset < IAP_DL_BLOCK_SIZE) ? (length - offset) : IAP_DL_BLOCK_SIZE;
+    if (DELTA_Apply(&Patcher, Patch + IAP_DL_DELTA_HEADER_SIZE + offset, piece) != 0)
+    {
+      return "corrupted stream or flash error";
+    }
+    while (DELTA_Pending(&Patcher) != 0)
+    {
+      if (DELTA_Apply(&Patcher, 0, 0) != 0)
+      {
+        return "corrupted stream or flash error";
+      }
+    }
+  }
+  if (DELTA_Finish(&Patcher) != 0)
+  {
+    return "stream ends in the middle of the image";
+  }
+  if (BOOT_ImageCrc(BOOT_SLOT_B, size) != crc)
+  {
+    return "CRC mismatch";
+  }
+
+  if ((NewLength != size) || (memcmp(slot, New, NewLength) != 0))
+  {
+    return "rebuilt image differs from NEW";
+  }
+  for (i = NewLength; i < SLOT_SIZE; i++)
+  {
+    if (slot[i] != 0xFF)
+    {
+      return "flash written past the image";
+    }
+  }
+  return 0;
+}
+
+/**
+  * @brief  Reads a file
+  * @param  Name: file name
+  * @param  Buffer: filled
+  * @param  Size: bytes of Buffer
+  * @retval Bytes read, -1 on an error or a file larger than Buffer
+  */
+static long SIM_Load(const char* Name, uint8_t* Buffer, uint32_t Size)
+{
+  FILE* file = fopen(Name, "rb");
+  size_t length = 0;
+
+  if (file == 0)
+  {
+    perror(Name);
+    return -1;
+  }
+  length = fread(Buffer, 1, Size, file);
+  if (fgetc(file) != EOF)
+  {
+    fprintf(stderr, "%s: larger than a slot\n", Name);
+    length = (size_t)-1;
+  }
+  fclose(file);
+  return (long)length;
+}
+
+/**
+  * @brief  Little endian word of the header
+  * @param  Data: first byte
+  * @retval Word
+  */
+static uint32_t SIM_Field(const uint8_t* Data)
+{
+  return Data[0] | (Data[1] << 8) | (Data[2] << 16) | ((uint32_t)Data[3] << 24);
+}
+
+/**
+  * @brief  End of the slot B erase, from the FLASH interrupt
+  * @param  Status: 0 on success
+  * @retval None
+  */
+static void SIM_Erased(uint32_t Status)
+{
+  Erased = (Status == 0) ? 1 : 2;
+}
@@ -0,0 +1,247 @@
+/**
+  ******************************************************************************
+  * @file    iap_sim.c
+  * @brief   boot_driver/IGS_STM32_IAP_APP.c on the host register model,
+  *          reached through a pseudo terminal: scons host
+  *
+  *          iap_sim [-a] [-t] [FLASH]
+  *
+  *          Prints the name of the slave of the pseudo terminal, the port
+  *          given to the tools/ scripts. FLASH holds the 1 MB of flash: it
+  *          is read at the start if it exists and written at each reset of
+  *          the firmware and when the program is stopped. -a takes every
+  *          image signature as valid. -t runs the host tests of
+  *          sim_test.h instead, the exit status tells whether they pass.
+  *
+  *          The firmware runs in a child process. A reset requested by the
+  *          firmware ends it and a new one starts from IAP_Init(), with the
+  *          flash kept.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "sim.h"
+#include "IGS_STM32_IAP_APP.h"
+#include "sim_test.h"
+/* After the register definitions: termios.h defines CR1 to CR3 */
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <unistd.h>
+
+/* Private variables ---------------------------------------------------------*/
+static int Master = -1;
+static const char* FlashName;
+static volatile sig_atomic_t Stop;
+
+/* Private function prototypes -----------------------------------------------*/
+static void SIM_Run(void);
+static void SIM_Send(const uint8_t* Data, uint32_t Length);
+static int SIM_Flash(const char* Mode);
+static void SIM_Stop(int Signal);
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Main program
+  * @param  argc, argv: [-a] [-t] [FLASH]
+  * @retval 0 when stopped or the tests pass, 1 on an error
+  */
+int main(int argc, char** argv)
+{
+  struct termios tio;
+  struct sigaction action;
+  pid_t child = 0;
+  int slave = -1, option = 0, status = 0, resets = 0, test = 0;
+
+  while ((option = getopt(argc, argv, "at")) != -1)
+  {
+    switch (option)
+    {
+      case 'a':
+        SIM_SignatureValid = 1;
+        break;
+      case 't':
+        test = 1;
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-a] [-t] [FLASH]\n", argv[0]);
+        return 1;
+    }
+  }
+  if (optind + 1 < argc)
+  {
+    fprintf(stderr, "usage: %s [-a] [-t] [FLASH]\n", argv[0]);
+    return 1;
+  }
+  FlashName = (optind < argc) ? argv[optind] : 0;
+
+  if ((SIM_Init() != 0) || (SIM_Flash("rb") != 0))
+  {
+    return 1;
+  }
+  if (test != 0)
+  {
+    return (SIM_Test() == 0) ? 0 : 1;
+  }
+
+  Master = posix_openpt(O_RDWR | O_NOCTTY);
+  if ((Master < 0) || (grantpt(Master) != 0) || (unlockpt(Master) != 0))
+  {
+    perror("posix_openpt");
+    return 1;
+  }
+
+  /* Raw bytes on the slave side, kept open so that the master does not
+     see a hang up between two host programs */
+  slave = open(ptsname(Master), O_RDWR | O_NOCTTY);
+  if ((slave < 0) || (tcgetattr(slave, &tio) != 0))
+  {
+    perror(ptsname(Master));
+    return 1;
+  }
+  cfmakeraw(&tio);
+  tcsetattr(slave, TCSANOW, &tio);
+
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = SIM_Stop;
+  sigaction(SIGINT, &action, 0);
+  sigaction(SIGTERM, &action, 0);
+
+  printf("%s\n", ptsname(Master));
+  fflush(stdout);
+
+  while (Stop == 0)
+  {
+    child = fork();
+    if (child == 0)
+    {
+      SIM_Run();
+    }
+    if (child < 0)
+    {
+      perror("fork");
+      return 1;
+    }
+
+    while ((waitpid(child, &status, 0) < 0) && (errno == EINTR))
+    {
+      if (Stop != 0)
+      {
+        kill(child, SIGKILL);
+      }
+    }
+    if (SIM_Flash("wb") != 0)
+    {
+      return 1;
+    }
+    if ((Stop == 0) && (!WIFEXITED(status) || (WEXITSTATUS(status) != SIM_EXIT_RESET)))
+    {
+      fprintf(stderr, "firmware stopped, status 0x%X\n", (unsigned)status);
+      return 1;
+    }
+    if (Stop == 0)
+    {
+      fprintf(stderr, "reset %d\n", ++resets);
+    }
+  }
+  return 0;
+}
+
+/**
+  * @brief  Child process: starts the firmware and hands it the received
+  *         bytes, until it requests a reset
+  * @param  None
+  * @retval None
+  */
+static void SIM_Run(void)
+{
+  uint8_t buffer[4096];
+  ssize_t length = 0;
+
+  signal(SIGINT, SIG_DFL);
+  signal(SIGTERM, SIG_DFL);
+  SIM_Reset();
+  /* No SystemInit(): the clocks of the reset, HSI */
+  SystemCoreClockUpdate();
+  SIM_UartOutput(IAP_COM, SIM_Send);
+  IAP_Init();
+
+  while (1)
+  {
+    SIM_Poll();
+    length = read(Master, buffer, sizeof(buffer));
+    if (length <= 0)
+    {
+      perror("read");
+      _exit(1);
+    }
+    SIM_UartInput(IAP_COM, buffer, (uint32_t)length);
+  }
+}
+
+/**
+  * @brief  Bytes sent by the IAP USART
+  * @param  Data: bytes
+  * @param  Length: number of bytes
+  * @retval None
+  */
+static void SIM_Send(const uint8_t* Data, uint32_t Length)
+{
+  if (write(Master, Data, Length) != (ssize_t)Length)
+  {
+    _exit(1);
+  }
+}
+
+/**
+  * @brief  Reads or writes the flash file, if one was given. A missing file
+  *         is read as erased flash.
+  * @param  Mode: "rb" or "wb"
+  * @retval 0 on success, -1 on an error
+  */
+static int SIM_Flash(const char* Mode)
+{
+  uint8_t* flash = (uint8_t*)SIM_Register(FLASH_BASE);
+  FILE* file = 0;
+  size_t length = 0;
+
+  if (FlashName == 0)
+  {
+    return 0;
+  }
+  file = fopen(FlashName, Mode);
+  if (file == 0)
+  {
+    if ((errno == ENOENT) && (Mode[0] == 'r'))
+    {
+      return 0;
+    }
+    perror(FlashName);
+    return -1;
+  }
+  length = (Mode[0] == 'r') ? fread(flash, 1, SIM_FLASH_SIZE, file) : fwrite(flash, 1, SIM_FLASH_SIZE, file);
+  fclose(file);
+  if ((Mode[0] == 'w') && (length != SIM_FLASH_SIZE))
+  {
+    perror(FlashName);
+    return -1;
+  }
+  return 0;
+}
+
+/**
+  * @brief  SIGINT, SIGTERM: stops after writing the flash file
+  * @param  Signal: signal number
+  * @retval None
+  */
+static void SIM_Stop(int Signal)
+{
+  (void)Signal;
+  Stop = 1;
+}
@@ -0,0 +1,69 @@
+/**
+  ******************************************************************************
+  * @file    sim.h
+  * @brief   Register model of the STM32F215 for the host build of the
+  *          StdPeriph drivers and boot_driver/: scons host
+  *
+  *          The flash, the peripherals and the system control space are
+  *          mapped at their addresses in the host process. The flash can be
+  *          read directly, every other access is trapped and stepped so
+  *          that the models see it: FLASH, CRC, DMA, USART, RCC, RNG, the
+  *          NVIC, the AES of the CRYP and the HASH behave, the other
+  *          registers are plain memory. Transfers take no time, the
+  *          interrupts are taken in SIM_Poll() and in __WFI(), by priority
+  *          and without nesting.
+  *
+  *          The simulation runs in a program linked without PIE, so that
+  *          static buffers have 32-bit addresses and can be given to the
+  *          DMA. Buffers on the stack or from malloc() cannot.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SIM_H
+#define __SIM_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f2xx.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define SIM_FLASH_SIZE        (1024 * 1024)
+/* Exit status of the default reset handler */
+#define SIM_EXIT_RESET        64
+
+/* Exported types ------------------------------------------------------------*/
+/* Bytes sent by a USART. Called from the trap handler, it may only use
+   async-signal-safe functions. */
+typedef void (*SIM_Output)(const uint8_t* Data, uint32_t Length);
+
+/* Exported variables --------------------------------------------------------*/
+/* Result of ecdsa_verify(): the host build has no binary field ECDSA, every
+   signature is taken as valid when set, 0 by default */
+extern int SIM_SignatureValid;
+
+/* Exported functions ------------------------------------------------------- */
+int SIM_Init(void);
+void SIM_Reset(void);
+void SIM_Poll(void);
+void SIM_OnReset(void (*Handler)(void));
+void SIM_UartOutput(USART_TypeDef* Usart, SIM_Output Output);
+void SIM_UartInput(USART_TypeDef* Usart, const uint8_t* Data, uint32_t Length);
+uint32_t SIM_UartPending(USART_TypeDef* Usart);
+
+/* Used between the parts of the model */
+uint32_t* SIM_Register(uint32_t Address);
+void SIM_Pend(IRQn_Type IRQn);
+uint32_t SIM_Feed(void);
+void SIM_PeriphReset(void);
+void SIM_PeriphRead(uint32_t Address);
+void SIM_PeriphWrite(uint32_t Address, uint32_t Old);
+void SIM_FlashWrite(uint32_t Address, uint32_t Old);
+void SIM_CrypReset(void);
+void SIM_CrypRead(uint32_t Address);
+void SIM_CrypWrite(uint32_t Address, uint32_t Old);
+void SIM_HashReset(void);
+void SIM_HashWrite(uint32_t Address, uint32_t Old);
+uint32_t SIM_HashLine(void);
+void SIM_Lines(void);
+
+#endif  /* __SIM_H */
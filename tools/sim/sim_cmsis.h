@@ -0,0 +1,61 @@
+/**
+  ******************************************************************************
+  * @file    sim_cmsis.h
+  * @brief   Core instructions of cmsis_gcc.h for the host build, included
+  *          before every source with -include. The ones with an effect on
+  *          the core are functions of sim_core.c.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SIM_CMSIS_H
+#define __SIM_CMSIS_H
+
+/* Keeps the ARM assembly of cmsis_gcc.h out */
+#define __CMSIS_GCC_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported functions ------------------------------------------------------- */
+void __enable_irq(void);
+void __disable_irq(void);
+uint32_t __get_PRIMASK(void);
+void __set_PRIMASK(uint32_t priMask);
+uint32_t __get_MSP(void);
+void __set_MSP(uint32_t topOfMainStack);
+uint32_t __get_CONTROL(void);
+void __set_CONTROL(uint32_t control);
+void __NOP(void);
+void __WFI(void);
+void __WFE(void);
+void __SEV(void);
+
+static inline void __ISB(void) { __sync_synchronize(); }
+static inline void __DSB(void) { __sync_synchronize(); }
+static inline void __DMB(void) { __sync_synchronize(); }
+static inline uint32_t __REV(uint32_t value) { return __builtin_bswap32(value); }
+static inline uint32_t __REV16(uint32_t value)
+{
+  return ((value & 0xFF00FF00u) >> 8) | ((value & 0x00FF00FFu) << 8);
+}
+static inline int32_t __REVSH(int32_t value) { return (int16_t)__builtin_bswap16((uint16_t)value); }
+static inline uint32_t __ROR(uint32_t op1, uint32_t op2)
+{
+  op2 &= 31;
+  return (op2 == 0) ? op1 : ((op1 >> op2) | (op1 << (32 - op2)));
+}
+static inline uint32_t __RBIT(uint32_t value)
+{
+  uint32_t result = 0, i = 0;
+
+  for (i = 0; i < 32; i++)
+  {
+    result = (result << 1) | ((value >> i) & 1);
+  }
+  return result;
+}
+static inline uint8_t __CLZ(uint32_t value) { return (value == 0) ? 32 : (uint8_t)__builtin_clz(value); }
+#define __BKPT(value)         __builtin_trap()
+
+#endif  /* __SIM_CMSIS_H */
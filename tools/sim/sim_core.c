@@ -0,0 +1,641 @@
+/**
+  ******************************************************************************
+  * @file    sim_core.c
+  * @brief   Memory map, access traps, NVIC and core instructions of the
+  *          host register model.
+  *
+  *          Every region is a shared memory object mapped twice: at the
+  *          address of the STM32F215, protected, and at a host address
+  *          where the models work. An access to the protected view raises
+  *          SIGSEGV: the model is told of a read before it is done, the page
+  *          is opened for one instruction stepped with the trap flag, and
+  *          SIGTRAP hands a write over to the model with the previous value
+  *          of the word.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+#include "sim.h"
+#include "startup.h"
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  uint32_t Base;
+  uint32_t Size;
+  int Prot;             /* protection of the view at Base */
+  uint8_t* Shadow;      /* view of the models */
+} SIM_Region;
+
+/* Private define ------------------------------------------------------------*/
+#define SIM_PAGE_SIZE         4096u
+#define SIM_TRAP_FLAG         0x100
+#define SIM_IRQ_COUNT         81
+#define SIM_SCS_BASE          0xE0000000u
+#define SIM_SCS_SIZE          0x00100000u   /* ITM, DWT, NVIC, SCB, DBGMCU */
+#define SIM_AHB2_BASE         (AHB2PERIPH_BASE + 0x60000)   /* CRYP, HASH, RNG */
+#define SIM_PERIPH_SIZE       0x00080000u   /* APB1, APB2, AHB1 */
+
+#define SIM_REGION_FLASH      0
+#define SIM_REGION_PERIPH     1
+#define SIM_REGION_BITBAND    2
+#define SIM_REGION_AHB2       3
+#define SIM_REGION_SCS        4
+
+/* Private variables ---------------------------------------------------------*/
+static SIM_Region Regions[] =
+{
+  { FLASH_BASE,     SIM_FLASH_SIZE,       PROT_READ, 0 },
+  { PERIPH_BASE,    SIM_PERIPH_SIZE,      PROT_NONE, 0 },
+  { PERIPH_BB_BASE, SIM_PERIPH_SIZE * 32, PROT_NONE, 0 },
+  { SIM_AHB2_BASE,  SIM_PAGE_SIZE,        PROT_NONE, 0 },
+  { SIM_SCS_BASE,   SIM_SCS_SIZE,         PROT_NONE, 0 },
+};
+#define SIM_REGION_COUNT      (sizeof(Regions) / sizeof(Regions[0]))
+
+/* Access being stepped */
+static struct
+{
+  SIM_Region* Region;
+  uint32_t Address;     /* word accessed */
+  uint32_t Write;
+  uint32_t Old;         /* value of the word before a write */
+} Trap;
+
+static uint32_t Enabled[3];
+static uint32_t Pending[3];
+static uint32_t Primask;
+static uint32_t Active;             /* a handler is running */
+static void (*ResetHandler)(void);
+
+/* Vector table of the image, only its address is used by the firmware */
+uint32_t g_pfnVectors[16 + SIM_IRQ_COUNT];
+
+/* Interrupt handlers, by IRQn */
+#define SIM_VECTOR(name)      extern void name(void) __attribute__((weak));
+#define SIM_VECTORS \
+  SIM_VECTOR(WWDG_IRQHandler) SIM_VECTOR(PVD_IRQHandler) \
+  SIM_VECTOR(TAMP_STAMP_IRQHandler) SIM_VECTOR(RTC_WKUP_IRQHandler) \
+  SIM_VECTOR(FLASH_IRQHandler) SIM_VECTOR(RCC_IRQHandler) \
+  SIM_VECTOR(EXTI0_IRQHandler) SIM_VECTOR(EXTI1_IRQHandler) \
+  SIM_VECTOR(EXTI2_IRQHandler) SIM_VECTOR(EXTI3_IRQHandler) \
+  SIM_VECTOR(EXTI4_IRQHandler) SIM_VECTOR(DMA1_Stream0_IRQHandler) \
+  SIM_VECTOR(DMA1_Stream1_IRQHandler) SIM_VECTOR(DMA1_Stream2_IRQHandler) \
+  SIM_VECTOR(DMA1_Stream3_IRQHandler) SIM_VECTOR(DMA1_Stream4_IRQHandler) \
+  SIM_VECTOR(DMA1_Stream5_IRQHandler) SIM_VECTOR(DMA1_Stream6_IRQHandler) \
+  SIM_VECTOR(ADC_IRQHandler) SIM_VECTOR(CAN1_TX_IRQHandler) \
+  SIM_VECTOR(CAN1_RX0_IRQHandler) SIM_VECTOR(CAN1_RX1_IRQHandler) \
+  SIM_VECTOR(CAN1_SCE_IRQHandler) SIM_VECTOR(EXTI9_5_IRQHandler) \
+  SIM_VECTOR(TIM1_BRK_TIM9_IRQHandler) SIM_VECTOR(TIM1_UP_TIM10_IRQHandler) \
+  SIM_VECTOR(TIM1_TRG_COM_TIM11_IRQHandler) SIM_VECTOR(TIM1_CC_IRQHandler) \
+  SIM_VECTOR(TIM2_IRQHandler) SIM_VECTOR(TIM3_IRQHandler) \
+  SIM_VECTOR(TIM4_IRQHandler) SIM_VECTOR(I2C1_EV_IRQHandler) \
+  SIM_VECTOR(I2C1_ER_IRQHandler) SIM_VECTOR(I2C2_EV_IRQHandler) \
+  SIM_VECTOR(I2C2_ER_IRQHandler) SIM_VECTOR(SPI1_IRQHandler) \
+  SIM_VECTOR(SPI2_IRQHandler) SIM_VECTOR(USART1_IRQHandler) \
+  SIM_VECTOR(USART2_IRQHandler) SIM_VECTOR(USART3_IRQHandler) \
+  SIM_VECTOR(EXTI15_10_IRQHandler) SIM_VECTOR(RTC_Alarm_IRQHandler) \
+  SIM_VECTOR(OTG_FS_WKUP_IRQHandler) SIM_VECTOR(TIM8_BRK_TIM12_IRQHandler) \
+  SIM_VECTOR(TIM8_UP_TIM13_IRQHandler) SIM_VECTOR(TIM8_TRG_COM_TIM14_IRQHandler) \
+  SIM_VECTOR(TIM8_CC_IRQHandler) SIM_VECTOR(DMA1_Stream7_IRQHandler) \
+  SIM_VECTOR(FSMC_IRQHandler) SIM_VECTOR(SDIO_IRQHandler) \
+  SIM_VECTOR(TIM5_IRQHandler) SIM_VECTOR(SPI3_IRQHandler) \
+  SIM_VECTOR(UART4_IRQHandler) SIM_VECTOR(UART5_IRQHandler) \
+  SIM_VECTOR(TIM6_DAC_IRQHandler) SIM_VECTOR(TIM7_IRQHandler) \
+  SIM_VECTOR(DMA2_Stream0_IRQHandler) SIM_VECTOR(DMA2_Stream1_IRQHandler) \
+  SIM_VECTOR(DMA2_Stream2_IRQHandler) SIM_VECTOR(DMA2_Stream3_IRQHandler) \
+  SIM_VECTOR(DMA2_Stream4_IRQHandler) SIM_VECTOR(ETH_IRQHandler) \
+  SIM_VECTOR(ETH_WKUP_IRQHandler) SIM_VECTOR(CAN2_TX_IRQHandler) \
+  SIM_VECTOR(CAN2_RX0_IRQHandler) SIM_VECTOR(CAN2_RX1_IRQHandler) \
+  SIM_VECTOR(CAN2_SCE_IRQHandler) SIM_VECTOR(OTG_FS_IRQHandler) \
+  SIM_VECTOR(DMA2_Stream5_IRQHandler) SIM_VECTOR(DMA2_Stream6_IRQHandler) \
+  SIM_VECTOR(DMA2_Stream7_IRQHandler) SIM_VECTOR(USART6_IRQHandler) \
+  SIM_VECTOR(I2C3_EV_IRQHandler) SIM_VECTOR(I2C3_ER_IRQHandler) \
+  SIM_VECTOR(OTG_HS_EP1_OUT_IRQHandler) SIM_VECTOR(OTG_HS_EP1_IN_IRQHandler) \
+  SIM_VECTOR(OTG_HS_WKUP_IRQHandler) SIM_VECTOR(OTG_HS_IRQHandler) \
+  SIM_VECTOR(DCMI_IRQHandler) SIM_VECTOR(CRYP_IRQHandler) \
+  SIM_VECTOR(HASH_RNG_IRQHandler)
+
+SIM_VECTORS
+#undef SIM_VECTOR
+#define SIM_VECTOR(name)      name,
+static void (* const Vectors[SIM_IRQ_COUNT])(void) = { SIM_VECTORS };
+
+/* Private function prototypes -----------------------------------------------*/
+static SIM_Region* SIM_Find(uintptr_t Address);
+static void SIM_Fault(int Signal, siginfo_t* Info, void* Context);
+static void SIM_Step(int Signal, siginfo_t* Info, void* Context);
+static void SIM_Read(SIM_Region* Region, uint32_t Address);
+static void SIM_CoreRead(uint32_t Address);
+static void SIM_Write(SIM_Region* Region, uint32_t Address, uint32_t Old);
+static void SIM_CoreWrite(uint32_t Address, uint32_t Old);
+static void SIM_Nvic(void);
+static int SIM_Next(void);
+static void SIM_DefaultReset(void);
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Maps the regions, erases the flash and resets the peripherals
+  * @param  None
+  * @retval 0 on success, -1 if a region cannot be mapped
+  */
+int SIM_Init(void)
+{
+  struct sigaction action;
+  uint32_t i = 0;
+  int fd = -1;
+  void* view = 0;
+
+  for (i = 0; i < SIM_REGION_COUNT; i++)
+  {
+    fd = memfd_create("stm32f215", 0);
+    if ((fd < 0) || (ftruncate(fd, Regions[i].Size) != 0))
+    {
+      perror("memfd_create");
+      return -1;
+    }
+    view = mmap((void*)(uintptr_t)Regions[i].Base, Regions[i].Size, Regions[i].Prot,
+                MAP_SHARED | MAP_FIXED_NOREPLACE, fd, 0);
+    if (view != (void*)(uintptr_t)Regions[i].Base)
+    {
+      fprintf(stderr, "cannot map 0x%08X, is the program linked with -no-pie?\n",
+              (unsigned)Regions[i].Base);
+      return -1;
+    }
+    view = mmap(0, Regions[i].Size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (view == MAP_FAILED)
+    {
+      perror("mmap");
+      return -1;
+    }
+    Regions[i].Shadow = view;
+    close(fd);
+  }
+
+  memset(Regions[SIM_REGION_FLASH].Shadow, 0xFF, SIM_FLASH_SIZE);
+
+  memset(&action, 0, sizeof(action));
+  action.sa_flags = SA_SIGINFO;
+  action.sa_sigaction = SIM_Fault;
+  sigaction(SIGSEGV, &action, 0);
+  action.sa_sigaction = SIM_Step;
+  sigaction(SIGTRAP, &action, 0);
+
+  ResetHandler = SIM_DefaultReset;
+  SIM_Reset();
+  return 0;
+}
+
+/**
+  * @brief  Reset of the core and the peripherals, the flash is kept. The
+  *          variables of the firmware are not: a program restarts it in a
+  *          new process, see iap_sim.c.
+  * @param  None
+  * @retval None
+  */
+void SIM_Reset(void)
+{
+  uint32_t i = 0;
+
+  for (i = SIM_REGION_PERIPH; i < SIM_REGION_COUNT; i++)
+  {
+    if (i != SIM_REGION_BITBAND)
+    {
+      memset(Regions[i].Shadow, 0, Regions[i].Size);
+    }
+  }
+  memset(Enabled, 0, sizeof(Enabled));
+  memset(Pending, 0, sizeof(Pending));
+  Primask = 0;
+  Active = 0;
+
+  *SIM_Register((uint32_t)&SCB->CPUID) = 0x412FC231;   /* Cortex-M3 r2p1 */
+  *SIM_Register((uint32_t)&SCB->AIRCR) = 0xFA050000;
+  SIM_PeriphReset();
+}
+
+/**
+  * @brief  Sets what a system reset requested by the firmware does, by
+  *         default the process ends with SIM_EXIT_RESET. Runs in the trap
+  *         handler.
+  * @param  Handler: reset handler
+  * @retval None
+  */
+void SIM_OnReset(void (*Handler)(void))
+{
+  ResetHandler = (Handler != 0) ? Handler : SIM_DefaultReset;
+}
+
+/**
+  * @brief  Moves the pending input and takes the interrupts until nothing
+  *         is left to do. Does nothing in a handler or with PRIMASK set.
+  * @param  None
+  * @retval None
+  */
+void SIM_Poll(void)
+{
+  uint32_t busy = 1;
+  int irq = 0;
+
+  if ((Active != 0) || (Primask != 0))
+  {
+    return;
+  }
+
+  while (busy != 0)
+  {
+    busy = SIM_Feed();
+    SIM_Lines();
+    while ((irq = SIM_Next()) >= 0)
+    {
+      Pending[irq >> 5] &= ~(1u << (irq & 31));
+      SIM_Nvic();
+      if (Vectors[irq] == 0)
+      {
+        /* Default handler of the startup file: the line is left disabled */
+        fprintf(stderr, "no handler for IRQ %d\n", irq);
+        Enabled[irq >> 5] &= ~(1u << (irq & 31));
+        SIM_Nvic();
+        continue;
+      }
+      Active = 1;
+      Vectors[irq]();
+      Active = 0;
+      busy = 1;
+      SIM_Lines();
+    }
+  }
+}
+
+/**
+  * @brief  Word of the models at an address of a region
+  * @param  Address: address in the STM32F215 map
+  * @retval Pointer to the word, 0 outside the regions
+  */
+uint32_t* SIM_Register(uint32_t Address)
+{
+  SIM_Region* region = SIM_Find(Address);
+
+  if (region == 0)
+  {
+    return 0;
+  }
+  return (uint32_t*)(region->Shadow + ((Address - region->Base) & ~3u));
+}
+
+/**
+  * @brief  Marks an interrupt pending
+  * @param  IRQn: interrupt number
+  * @retval None
+  */
+void SIM_Pend(IRQn_Type IRQn)
+{
+  Pending[IRQn >> 5] |= 1u << (IRQn & 31);
+  SIM_Nvic();
+}
+
+/**
+  * @brief  Region holding an address
+  * @param  Address: host address
+  * @retval Region, 0 if none
+  */
+static SIM_Region* SIM_Find(uintptr_t Address)
+{
+  uint32_t i = 0;
+
+  for (i = 0; i < SIM_REGION_COUNT; i++)
+  {
+    if ((Address >= Regions[i].Base) && (Address - Regions[i].Base < Regions[i].Size))
+    {
+      return &Regions[i];
+    }
+  }
+  return 0;
+}
+
+/**
+  * @brief  SIGSEGV: access to a protected region, the instruction is
+  *         stepped with the page open
+  * @param  Signal, Info, Context: signal handler arguments
+  * @retval None
+  */
+static void SIM_Fault(int Signal, siginfo_t* Info, void* Context)
+{
+  ucontext_t* context = Context;
+  uintptr_t address = (uintptr_t)Info->si_addr;
+  SIM_Region* region = SIM_Find(address);
+
+  (void)Signal;
+  if ((region == 0) || (Trap.Region != 0))
+  {
+    /* Not an access to the model: crash on the way back */
+    signal(SIGSEGV, SIG_DFL);
+    return;
+  }
+
+  Trap.Region = region;
+  Trap.Address = (uint32_t)address & ~3u;
+  Trap.Write = (context->uc_mcontext.gregs[REG_ERR] & 2) != 0;
+  if (Trap.Write == 0)
+  {
+    SIM_Read(region, Trap.Address);
+  }
+  Trap.Old = *SIM_Register(Trap.Address);
+
+  mprotect((void*)(address & ~(uintptr_t)(SIM_PAGE_SIZE - 1)), SIM_PAGE_SIZE,
+           PROT_READ | PROT_WRITE);
+  context->uc_mcontext.gregs[REG_EFL] |= SIM_TRAP_FLAG;
+}
+
+/**
+  * @brief  SIGTRAP: the access is done, the page is protected again and a
+  *         write goes to the model
+  * @param  Signal, Info, Context: signal handler arguments
+  * @retval None
+  */
+static void SIM_Step(int Signal, siginfo_t* Info, void* Context)
+{
+  ucontext_t* context = Context;
+  SIM_Region* region = Trap.Region;
+
+  (void)Signal;
+  (void)Info;
+  context->uc_mcontext.gregs[REG_EFL] &= ~SIM_TRAP_FLAG;
+  if (region == 0)
+  {
+    signal(SIGTRAP, SIG_DFL);
+    return;
+  }
+
+  Trap.Region = 0;
+  mprotect((void*)(uintptr_t)(Trap.Address & ~(SIM_PAGE_SIZE - 1)), SIM_PAGE_SIZE, region->Prot);
+  if (Trap.Write != 0)
+  {
+    SIM_Write(region, Trap.Address, Trap.Old);
+  }
+}
+
+/**
+  * @brief  Read of a word about to be done
+  * @param  Region: region of the word
+  * @param  Address: word address
+  * @retval None
+  */
+static void SIM_Read(SIM_Region* Region, uint32_t Address)
+{
+  uint32_t offset = Address - PERIPH_BB_BASE;
+  uint32_t target = 0;
+
+  switch (Region - Regions)
+  {
+    case SIM_REGION_BITBAND:
+      /* One bit of a peripheral register per word */
+      target = PERIPH_BASE + ((offset >> 5) & ~3u);
+      SIM_PeriphRead(target);
+      *SIM_Register(Address) = (*SIM_Register(target) >> ((offset >> 2) & 31)) & 1;
+      break;
+
+    case SIM_REGION_PERIPH:
+    case SIM_REGION_AHB2:
+      SIM_PeriphRead(Address);
+      break;
+
+    case SIM_REGION_SCS:
+      SIM_CoreRead(Address);
+      break;
+
+    default:
+      break;
+  }
+}
+
+/**
+  * @brief  Read of the system control space: the DWT cycle counter runs
+  *         on the host time, at the HSI the firmware starts on
+  * @param  Address: word address
+  * @retval None
+  */
+static void SIM_CoreRead(uint32_t Address)
+{
+  struct timespec now;
+
+  if ((Address == (uint32_t)&DWT->CYCCNT) && ((*SIM_Register((uint32_t)&DWT->CTRL) & DWT_CTRL_CYCCNTENA_Msk) != 0))
+  {
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    *SIM_Register(Address) = (uint32_t)(((uint64_t)now.tv_sec * 1000000000u + now.tv_nsec) *
+                                        (HSI_VALUE / 1000000) / 1000);
+  }
+}
+
+/**
+  * @brief  Write of a word done
+  * @param  Region: region of the word
+  * @param  Address: word address
+  * @param  Old: previous value of the word
+  * @retval None
+  */
+static void SIM_Write(SIM_Region* Region, uint32_t Address, uint32_t Old)
+{
+  uint32_t offset = Address - PERIPH_BB_BASE;
+  uint32_t target = 0, bit = 0, old = 0;
+
+  switch (Region - Regions)
+  {
+    case SIM_REGION_FLASH:
+      SIM_FlashWrite(Address, Old);
+      break;
+
+    case SIM_REGION_BITBAND:
+      target = PERIPH_BASE + ((offset >> 5) & ~3u);
+      bit = 1u << ((offset >> 2) & 31);
+      old = *SIM_Register(target);
+      *SIM_Register(target) = ((*SIM_Register(Address) & 1) != 0) ? (old | bit) : (old & ~bit);
+      SIM_PeriphWrite(target, old);
+      break;
+
+    case SIM_REGION_PERIPH:
+    case SIM_REGION_AHB2:
+      SIM_PeriphWrite(Address, Old);
+      break;
+
+    case SIM_REGION_SCS:
+      SIM_CoreWrite(Address, Old);
+      break;
+
+    default:
+      break;
+  }
+}
+
+/**
+  * @brief  Write to the system control space: NVIC set and clear
+  *         registers, system reset request
+  * @param  Address: word address
+  * @param  Old: previous value of the word
+  * @retval None
+  */
+static void SIM_CoreWrite(uint32_t Address, uint32_t Old)
+{
+  uint32_t value = *SIM_Register(Address);
+  uint32_t index = (Address & 0x7F) / 4;
+
+  (void)Old;
+  if (index < 3)
+  {
+    if ((Address & ~0x7Fu) == (uint32_t)NVIC->ISER)
+    {
+      Enabled[index] |= value;
+    }
+    else if ((Address & ~0x7Fu) == (uint32_t)NVIC->ICER)
+    {
+      Enabled[index] &= ~value;
+    }
+    else if ((Address & ~0x7Fu) == (uint32_t)NVIC->ISPR)
+    {
+      Pending[index] |= value;
+    }
+    else if ((Address & ~0x7Fu) == (uint32_t)NVIC->ICPR)
+    {
+      Pending[index] &= ~value;
+    }
+  }
+  SIM_Nvic();
+
+  if (Address == (uint32_t)&SCB->AIRCR)
+  {
+    *SIM_Register(Address) = 0xFA050000 | (value & SCB_AIRCR_PRIGROUP_Msk);
+    if (((value >> SCB_AIRCR_VECTKEY_Pos) == 0x05FA) && ((value & SCB_AIRCR_SYSRESETREQ_Msk) != 0))
+    {
+      ResetHandler();
+    }
+  }
+}
+
+/**
+  * @brief  Shows the enabled and pending interrupts in the NVIC registers
+  * @param  None
+  * @retval None
+  */
+static void SIM_Nvic(void)
+{
+  uint32_t i = 0;
+
+  for (i = 0; i < 3; i++)
+  {
+    *SIM_Register((uint32_t)&NVIC->ISER[i]) = Enabled[i];
+    *SIM_Register((uint32_t)&NVIC->ICER[i]) = Enabled[i];
+    *SIM_Register((uint32_t)&NVIC->ISPR[i]) = Pending[i];
+    *SIM_Register((uint32_t)&NVIC->ICPR[i]) = Pending[i];
+  }
+}
+
+/**
+  * @brief  Enabled pending interrupt of the highest priority
+  * @param  None
+  * @retval IRQn, -1 if none
+  */
+static int SIM_Next(void)
+{
+  const uint8_t* priority = (const uint8_t*)SIM_Register((uint32_t)NVIC->IP);
+  int irq = 0, next = -1;
+
+  for (irq = 0; irq < SIM_IRQ_COUNT; irq++)
+  {
+    if (((Enabled[irq >> 5] & Pending[irq >> 5]) & (1u << (irq & 31))) == 0)
+    {
+      continue;
+    }
+    if ((next < 0) || (priority[irq] < priority[next]))
+    {
+      next = irq;
+    }
+  }
+  return next;
+}
+
+/**
+  * @brief  Default reset handler: ends the process
+  * @param  None
+  * @retval None
+  */
+static void SIM_DefaultReset(void)
+{
+  _exit(SIM_EXIT_RESET);
+}
+
+/* Core instructions ---------------------------------------------------------*/
+
+void __enable_irq(void)
+{
+  Primask = 0;
+  SIM_Poll();
+}
+
+void __disable_irq(void)
+{
+  Primask = 1;
+}
+
+uint32_t __get_PRIMASK(void)
+{
+  return Primask;
+}
+
+void __set_PRIMASK(uint32_t priMask)
+{
+  Primask = priMask & 1;
+  SIM_Poll();
+}
+
+uint32_t __get_MSP(void)
+{
+  return SRAM_BASE + 0x20000;
+}
+
+void __set_MSP(uint32_t topOfMainStack)
+{
+  (void)topOfMainStack;
+}
+
+uint32_t __get_CONTROL(void)
+{
+  return 0;
+}
+
+void __set_CONTROL(uint32_t control)
+{
+  (void)control;
+}
+
+void __NOP(void)
+{
+}
+
+void __WFI(void)
+{
+  SIM_Poll();
+}
+
+void __WFE(void)
+{
+  SIM_Poll();
+}
+
+void __SEV(void)
+{
+}
+
+/* Reset_Handler of src/startup_stm32f2xx.s does not run on the host */
+STARTUP_Time STARTUP_Cycles;
+
+void STARTUP_ZeroDeferred(void)
+{
+}
@@ -0,0 +1,446 @@
+/**
+  ******************************************************************************
+  * @file    sim_cryp.c
+  * @brief   CRYP of the host register model: AES-128, AES-192 and AES-256
+  *          in ECB, CBC and CTR, both directions, with the data types of
+  *          DATATYPE.
+  *
+  *          DR fills an input FIFO of eight words; a block is ciphered as
+  *          soon as it is whole and the output FIFO has room, so BUSY is
+  *          never set. The key preparation does nothing: the model
+  *          deciphers with the key itself. The IV registers follow the
+  *          blocks of CBC and CTR, whose counter is the 32 bits of IV1RR.
+  *          DES and TDES are not modelled, their blocks stay in the input
+  *          FIFO.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "sim.h"
+
+/* Private define ------------------------------------------------------------*/
+#define SIM_CRYP_FIFO         8
+#define SIM_AES_WORDS         4
+
+/* Private macro -------------------------------------------------------------*/
+#define SIM_CRYP              ((CRYP_TypeDef*)SIM_Register(CRYP_BASE))
+#define SIM_XTIME(x)          ((uint8_t)(((x) << 1) ^ (((x) & 0x80) ? 0x1B : 0)))
+
+/* Private variables ---------------------------------------------------------*/
+static uint32_t In[SIM_CRYP_FIFO];
+static uint32_t Out[SIM_CRYP_FIFO];
+static uint32_t InCount;
+static uint32_t OutCount;
+static uint8_t Sbox[256];
+static uint8_t InvSbox[256];
+
+/* Private function prototypes -----------------------------------------------*/
+static void SIM_CrypRun(void);
+static void SIM_CrypBlock(uint32_t Mode, uint32_t Decrypt);
+static void SIM_CrypStatus(void);
+static uint32_t SIM_CrypSwap(uint32_t Word);
+static uint32_t SIM_AesKey(uint8_t* RoundKeys);
+static void SIM_AesEncrypt(const uint8_t* RoundKeys, uint32_t Rounds, uint8_t* Block);
+static void SIM_AesDecrypt(const uint8_t* RoundKeys, uint32_t Rounds, uint8_t* Block);
+static uint8_t SIM_AesMul(uint8_t a, uint8_t b);
+static void SIM_AesTables(void);
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Empty FIFOs, after the peripherals were cleared
+  * @param  None
+  * @retval None
+  */
+void SIM_CrypReset(void)
+{
+  if (Sbox[0] == 0)
+  {
+    SIM_AesTables();
+  }
+  InCount = OutCount = 0;
+  SIM_CrypStatus();
+}
+
+/**
+  * @brief  Read of a CRYP register about to be done: DOUT takes a word out
+  *         of the output FIFO
+  * @param  Address: word address
+  * @retval None
+  */
+void SIM_CrypRead(uint32_t Address)
+{
+  if (Address == (uint32_t)&CRYP->DOUT)
+  {
+    SIM_CRYP->DOUT = (OutCount != 0) ? Out[0] : 0;
+    if (OutCount != 0)
+    {
+      memmove(&Out[0], &Out[1], --OutCount * sizeof(Out[0]));
+    }
+    SIM_CrypRun();
+  }
+}
+
+/**
+  * @brief  Write of a CRYP register done
+  * @param  Address: word address
+  * @param  Old: previous value of the word
+  * @retval None
+  */
+void SIM_CrypWrite(uint32_t Address, uint32_t Old)
+{
+  uint32_t* reg = SIM_Register(Address);
+
+  if (Address == (uint32_t)&CRYP->CR)
+  {
+    if ((*reg & CRYP_CR_FFLUSH) != 0)
+    {
+      InCount = OutCount = 0;
+      *reg &= ~CRYP_CR_FFLUSH;
+    }
+  }
+  else if (Address == (uint32_t)&CRYP->DR)
+  {
+    if (InCount < SIM_CRYP_FIFO)
+    {
+      In[InCount++] = *reg;
+    }
+  }
+  else if ((Address == (uint32_t)&CRYP->SR) || (Address == (uint32_t)&CRYP->DOUT))
+  {
+    *reg = Old;
+  }
+  SIM_CrypRun();
+}
+
+/**
+  * @brief  Ciphers the whole blocks of the input FIFO that fit in the
+  *         output FIFO
+  * @param  None
+  * @retval None
+  */
+static void SIM_CrypRun(void)
+{
+  uint32_t cr = SIM_CRYP->CR;
+  uint32_t mode = cr & CRYP_CR_ALGOMODE;
+
+  while (((cr & CRYP_CR_CRYPEN) != 0) &&
+         ((mode == CRYP_AlgoMode_AES_ECB) || (mode == CRYP_AlgoMode_AES_CBC) ||
+          (mode == CRYP_AlgoMode_AES_CTR)) &&
+         (InCount >= SIM_AES_WORDS) && (OutCount + SIM_AES_WORDS <= SIM_CRYP_FIFO))
+  {
+    SIM_CrypBlock(mode, cr & CRYP_CR_ALGODIR);
+  }
+  SIM_CrypStatus();
+}
+
+/**
+  * @brief  Ciphers the first block of the input FIFO into the output FIFO
+  * @param  Mode: CRYP_AlgoMode_AES_ECB, _CBC or _CTR
+  * @param  Decrypt: CRYP_AlgoDir_Encrypt or CRYP_AlgoDir_Decrypt
+  * @retval None
+  */
+static void SIM_CrypBlock(uint32_t Mode, uint32_t Decrypt)
+{
+  CRYP_TypeDef* cryp = SIM_CRYP;
+  volatile uint32_t* iv = &cryp->IV0LR;
+  uint8_t keys[240];
+  uint8_t block[16], chain[16], result[16];
+  uint32_t rounds = SIM_AesKey(keys);
+  uint32_t i = 0, word = 0;
+
+  /* Core blocks are big-endian words */
+  for (i = 0; i < SIM_AES_WORDS; i++)
+  {
+    word = SIM_CrypSwap(In[i]);
+    block[i * 4] = (uint8_t)(word >> 24);
+    block[i * 4 + 1] = (uint8_t)(word >> 16);
+    block[i * 4 + 2] = (uint8_t)(word >> 8);
+    block[i * 4 + 3] = (uint8_t)word;
+    chain[i * 4] = (uint8_t)(iv[i] >> 24);
+    chain[i * 4 + 1] = (uint8_t)(iv[i] >> 16);
+    chain[i * 4 + 2] = (uint8_t)(iv[i] >> 8);
+    chain[i * 4 + 3] = (uint8_t)iv[i];
+  }
+  InCount -= SIM_AES_WORDS;
+  memmove(&In[0], &In[SIM_AES_WORDS], InCount * sizeof(In[0]));
+
+  switch (Mode)
+  {
+    case CRYP_AlgoMode_AES_ECB:
+      memcpy(result, block, sizeof(block));
+      if (Decrypt != 0)
+      {
+        SIM_AesDecrypt(keys, rounds, result);
+      }
+      else
+      {
+        SIM_AesEncrypt(keys, rounds, result);
+      }
+      break;
+
+    case CRYP_AlgoMode_AES_CBC:
+      if (Decrypt != 0)
+      {
+        memcpy(result, block, sizeof(block));
+        SIM_AesDecrypt(keys, rounds, result);
+        for (i = 0; i < 16; i++)
+        {
+          result[i] ^= chain[i];
+        }
+        memcpy(chain, block, sizeof(block));
+      }
+      else
+      {
+        for (i = 0; i < 16; i++)
+        {
+          result[i] = block[i] ^ chain[i];
+        }
+        SIM_AesEncrypt(keys, rounds, result);
+        memcpy(chain, result, sizeof(result));
+      }
+      break;
+
+    default:
+      memcpy(result, chain, sizeof(chain));
+      SIM_AesEncrypt(keys, rounds, result);
+      for (i = 0; i < 16; i++)
+      {
+        result[i] ^= block[i];
+      }
+      iv[3]++;
+      break;
+  }
+
+  for (i = 0; i < SIM_AES_WORDS; i++)
+  {
+    if (Mode == CRYP_AlgoMode_AES_CBC)
+    {
+      iv[i] = ((uint32_t)chain[i * 4] << 24) | ((uint32_t)chain[i * 4 + 1] << 16) |
+              ((uint32_t)chain[i * 4 + 2] << 8) | chain[i * 4 + 3];
+    }
+    word = ((uint32_t)result[i * 4] << 24) | ((uint32_t)result[i * 4 + 1] << 16) |
+           ((uint32_t)result[i * 4 + 2] << 8) | result[i * 4 + 3];
+    Out[OutCount++] = SIM_CrypSwap(word);
+  }
+}
+
+/**
+  * @brief  SR from the levels of the FIFOs
+  * @param  None
+  * @retval None
+  */
+static void SIM_CrypStatus(void)
+{
+  SIM_CRYP->SR = ((InCount == 0) ? CRYP_SR_IFEM : 0) |
+                 ((InCount < SIM_CRYP_FIFO) ? CRYP_SR_IFNF : 0) |
+                 ((OutCount != 0) ? CRYP_SR_OFNE : 0) |
+                 ((OutCount == SIM_CRYP_FIFO) ? CRYP_SR_OFFU : 0);
+}
+
+/**
+  * @brief  Swap of DATATYPE between a register word and a core word, its
+  *         own inverse
+  * @param  Word: word
+  * @retval Swapped word
+  */
+static uint32_t SIM_CrypSwap(uint32_t Word)
+{
+  uint32_t i = 0, bits = 0;
+
+  switch (SIM_CRYP->CR & CRYP_CR_DATATYPE)
+  {
+    case CRYP_DataType_16b:
+      return (Word << 16) | (Word >> 16);
+
+    case CRYP_DataType_8b:
+      return __REV(Word);
+
+    case CRYP_DataType_1b:
+      for (i = 0; i < 32; i++)
+      {
+        bits |= ((Word >> i) & 1) << (31 - i);
+      }
+      return bits;
+
+    default:
+      return Word;
+  }
+}
+
+/**
+  * @brief  Key schedule of the key registers, the key ending in K3RR
+  * @param  RoundKeys: 16 bytes per round and one
+  * @retval Number of rounds
+  */
+static uint32_t SIM_AesKey(uint8_t* RoundKeys)
+{
+  CRYP_TypeDef* cryp = SIM_CRYP;
+  volatile uint32_t* reg = &cryp->K0LR;
+  uint32_t size = cryp->CR & CRYP_CR_KEYSIZE;
+  uint32_t nk = (size == CRYP_KeySize_256b) ? 8 : (size == CRYP_KeySize_192b) ? 6 : 4;
+  uint32_t rounds = nk + 6;
+  uint32_t i = 0, j = 0;
+  uint8_t temp[4], t = 0, rcon = 1;
+
+  for (i = 0; i < nk; i++)
+  {
+    RoundKeys[i * 4] = (uint8_t)(reg[8 - nk + i] >> 24);
+    RoundKeys[i * 4 + 1] = (uint8_t)(reg[8 - nk + i] >> 16);
+    RoundKeys[i * 4 + 2] = (uint8_t)(reg[8 - nk + i] >> 8);
+    RoundKeys[i * 4 + 3] = (uint8_t)reg[8 - nk + i];
+  }
+  for (i = nk; i < 4 * (rounds + 1); i++)
+  {
+    memcpy(temp, &RoundKeys[(i - 1) * 4], 4);
+    if ((i % nk) == 0)
+    {
+      t = temp[0];
+      temp[0] = Sbox[temp[1]] ^ rcon;
+      temp[1] = Sbox[temp[2]];
+      temp[2] = Sbox[temp[3]];
+      temp[3] = Sbox[t];
+      rcon = SIM_XTIME(rcon);
+    }
+    else if ((nk > 6) && ((i % nk) == 4))
+    {
+      for (j = 0; j < 4; j++)
+      {
+        temp[j] = Sbox[temp[j]];
+      }
+    }
+    for (j = 0; j < 4; j++)
+    {
+      RoundKeys[i * 4 + j] = RoundKeys[(i - nk) * 4 + j] ^ temp[j];
+    }
+  }
+  return rounds;
+}
+
+/**
+  * @brief  AES cipher of FIPS 197, on bytes
+  * @param  RoundKeys: from SIM_AesKey()
+  * @param  Rounds: from SIM_AesKey()
+  * @param  Block: 16 bytes, ciphered in place
+  * @retval None
+  */
+static void SIM_AesEncrypt(const uint8_t* RoundKeys, uint32_t Rounds, uint8_t* Block)
+{
+  uint8_t s[16], a[4];
+  uint32_t round = 0, i = 0, c = 0;
+
+  for (i = 0; i < 16; i++)
+  {
+    Block[i] ^= RoundKeys[i];
+  }
+  for (round = 1; round <= Rounds; round++)
+  {
+    /* SubBytes and ShiftRows */
+    for (i = 0; i < 16; i++)
+    {
+      s[i] = Sbox[Block[(i + 4 * (i & 3)) & 15]];
+    }
+    for (c = 0; (round != Rounds) && (c < 4); c++)
+    {
+      memcpy(a, &s[c * 4], 4);
+      s[c * 4] = SIM_XTIME(a[0]) ^ SIM_XTIME(a[1]) ^ a[1] ^ a[2] ^ a[3];
+      s[c * 4 + 1] = a[0] ^ SIM_XTIME(a[1]) ^ SIM_XTIME(a[2]) ^ a[2] ^ a[3];
+      s[c * 4 + 2] = a[0] ^ a[1] ^ SIM_XTIME(a[2]) ^ SIM_XTIME(a[3]) ^ a[3];
+      s[c * 4 + 3] = SIM_XTIME(a[0]) ^ a[0] ^ a[1] ^ a[2] ^ SIM_XTIME(a[3]);
+    }
+    for (i = 0; i < 16; i++)
+    {
+      Block[i] = s[i] ^ RoundKeys[round * 16 + i];
+    }
+  }
+}
+
+/**
+  * @brief  AES inverse cipher of FIPS 197, on bytes
+  * @param  RoundKeys: from SIM_AesKey()
+  * @param  Rounds: from SIM_AesKey()
+  * @param  Block: 16 bytes, deciphered in place
+  * @retval None
+  */
+static void SIM_AesDecrypt(const uint8_t* RoundKeys, uint32_t Rounds, uint8_t* Block)
+{
+  uint8_t s[16], a[4];
+  uint32_t round = Rounds, i = 0, c = 0;
+
+  for (i = 0; i < 16; i++)
+  {
+    Block[i] ^= RoundKeys[Rounds * 16 + i];
+  }
+  while (round-- > 0)
+  {
+    /* InvShiftRows and InvSubBytes */
+    for (i = 0; i < 16; i++)
+    {
+      s[i] = InvSbox[Block[(i + 16 - 4 * (i & 3)) & 15]] ^ RoundKeys[round * 16 + i];
+    }
+    for (c = 0; (round != 0) && (c < 4); c++)
+    {
+      memcpy(a, &s[c * 4], 4);
+      s[c * 4] = SIM_AesMul(a[0], 14) ^ SIM_AesMul(a[1], 11) ^ SIM_AesMul(a[2], 13) ^ SIM_AesMul(a[3], 9);
+      s[c * 4 + 1] = SIM_AesMul(a[0], 9) ^ SIM_AesMul(a[1], 14) ^ SIM_AesMul(a[2], 11) ^ SIM_AesMul(a[3], 13);
+      s[c * 4 + 2] = SIM_AesMul(a[0], 13) ^ SIM_AesMul(a[1], 9) ^ SIM_AesMul(a[2], 14) ^ SIM_AesMul(a[3], 11);
+      s[c * 4 + 3] = SIM_AesMul(a[0], 11) ^ SIM_AesMul(a[1], 13) ^ SIM_AesMul(a[2], 9) ^ SIM_AesMul(a[3], 14);
+    }
+    memcpy(Block, s, sizeof(s));
+  }
+}
+
+/**
+  * @brief  Product in GF(2^8)
+  * @param  a, b: factors
+  * @retval Product
+  */
+static uint8_t SIM_AesMul(uint8_t a, uint8_t b)
+{
+  uint8_t product = 0;
+
+  while (b != 0)
+  {
+    if ((b & 1) != 0)
+    {
+      product ^= a;
+    }
+    a = SIM_XTIME(a);
+    b >>= 1;
+  }
+  return product;
+}
+
+/**
+  * @brief  S-box and inverse S-box, from the inverses in GF(2^8) walked
+  *         by powers of 3
+  * @param  None
+  * @retval None
+  */
+static void SIM_AesTables(void)
+{
+  uint8_t p = 1, q = 1, x = 0;
+  uint32_t i = 0;
+
+  do
+  {
+    p = p ^ SIM_XTIME(p);
+    q ^= q << 1;
+    q ^= q << 2;
+    q ^= q << 4;
+    if ((q & 0x80) != 0)
+    {
+      q ^= 0x09;
+    }
+    x = q ^ (uint8_t)((q << 1) | (q >> 7)) ^ (uint8_t)((q << 2) | (q >> 6)) ^
+        (uint8_t)((q << 3) | (q >> 5)) ^ (uint8_t)((q << 4) | (q >> 4));
+    Sbox[p] = x ^ 0x63;
+  } while (p != 1);
+  Sbox[0] = 0x63;
+
+  for (i = 0; i < 256; i++)
+  {
+    InvSbox[Sbox[i]] = (uint8_t)i;
+  }
+}
@@ -0,0 +1,409 @@
+/**
+  ******************************************************************************
+  * @file    sim_hash.c
+  * @brief   HASH of the host register model: SHA-1 and MD5 in HASH mode,
+  *          with the data types of DATATYPE.
+  *
+  *          DIN fills an input FIFO of sixteen words; the seventeenth word
+  *          written processes the block and stays in the FIFO, and DINIS
+  *          is set. DCAL pads and processes what the FIFO holds, NBLW
+  *          valid bits of its last word, writes the digest to HR and sets
+  *          DCIS. BUSY is never set. The state of the core is kept in the
+  *          CSR registers, so that HASH_SaveContext() and
+  *          HASH_RestoreContext() work. HMAC mode, DMA and message lengths
+  *          that are not whole bytes are not modelled.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "sim.h"
+
+/* Private define ------------------------------------------------------------*/
+#define SIM_HASH_FIFO         16
+/* CSR words: digest state, FIFO, FIFO level, blocks processed */
+#define SIM_CSR_STATE         0
+#define SIM_CSR_FIFO          5
+#define SIM_CSR_COUNT         (SIM_CSR_FIFO + SIM_HASH_FIFO)
+#define SIM_CSR_BLOCKS        (SIM_CSR_COUNT + 1)
+
+/* Private macro -------------------------------------------------------------*/
+#define SIM_HASH              ((HASH_TypeDef*)SIM_Register(HASH_BASE))
+#define SIM_ROL(x, n)         (((x) << (n)) | ((x) >> (32 - (n))))
+
+/* Private variables ---------------------------------------------------------*/
+static uint32_t State[5];
+static uint32_t Fifo[SIM_HASH_FIFO];
+static uint32_t Count;
+static uint32_t Blocks;
+
+static const uint32_t Md5Sine[64] =
+{
+  0xD76AA478, 0xE8C7B756, 0x242070DB, 0xC1BDCEEE, 0xF57C0FAF, 0x4787C62A, 0xA8304613, 0xFD469501,
+  0x698098D8, 0x8B44F7AF, 0xFFFF5BB1, 0x895CD7BE, 0x6B901122, 0xFD987193, 0xA679438E, 0x49B40821,
+  0xF61E2562, 0xC040B340, 0x265E5A51, 0xE9B6C7AA, 0xD62F105D, 0x02441453, 0xD8A1E681, 0xE7D3FBC8,
+  0x21E1CDE6, 0xC33707D6, 0xF4D50D87, 0x455A14ED, 0xA9E3E905, 0xFCEFA3F8, 0x676F02D9, 0x8D2A4C8A,
+  0xFFFA3942, 0x8771F681, 0x6D9D6122, 0xFDE5380C, 0xA4BEEA44, 0x4BDECFA9, 0xF6BB4B60, 0xBEBFBC70,
+  0x289B7EC6, 0xEAA127FA, 0xD4EF3085, 0x04881D05, 0xD9D4D039, 0xE6DB99E5, 0x1FA27CF8, 0xC4AC5665,
+  0xF4292244, 0x432AFF97, 0xAB9423A7, 0xFC93A039, 0x655B59C3, 0x8F0CCC92, 0xFFEFF47D, 0x85845DD1,
+  0x6FA87E4F, 0xFE2CE6E0, 0xA3014314, 0x4E0811A1, 0xF7537E82, 0xBD3AF235, 0x2AD7D2BB, 0xEB86D391,
+};
+static const uint8_t Md5Shift[16] = { 7, 12, 17, 22, 5, 9, 14, 20, 4, 11, 16, 23, 6, 10, 15, 21 };
+
+/* Private function prototypes -----------------------------------------------*/
+static void SIM_HashInit(void);
+static void SIM_HashDigest(void);
+static void SIM_HashBlock(const uint8_t* Block);
+static void SIM_Sha1Block(const uint8_t* Block);
+static void SIM_Md5Block(const uint8_t* Block);
+static void SIM_HashBytes(uint32_t Word, uint8_t* Bytes);
+static void SIM_HashSave(void);
+static void SIM_HashLoad(void);
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Core initialized, after the peripherals were cleared
+  * @param  None
+  * @retval None
+  */
+void SIM_HashReset(void)
+{
+  SIM_HashInit();
+}
+
+/**
+  * @brief  Write of a HASH register done
+  * @param  Address: word address
+  * @param  Old: previous value of the word
+  * @retval None
+  */
+void SIM_HashWrite(uint32_t Address, uint32_t Old)
+{
+  HASH_TypeDef* hash = SIM_HASH;
+  uint32_t* reg = SIM_Register(Address);
+  uint8_t block[64];
+  uint32_t i = 0;
+
+  if (Address == (uint32_t)&HASH->CR)
+  {
+    /* NBW and DINNE are read only, INIT reads as 0 */
+    *reg = (*reg & ~(HASH_CR_NBW | HASH_CR_DINNE)) | (Old & (HASH_CR_NBW | HASH_CR_DINNE));
+    if ((*reg & HASH_CR_INIT) != 0)
+    {
+      *reg &= ~HASH_CR_INIT;
+      SIM_HashInit();
+    }
+  }
+  else if (Address == (uint32_t)&HASH->DIN)
+  {
+    if (Count == SIM_HASH_FIFO)
+    {
+      for (i = 0; i < SIM_HASH_FIFO; i++)
+      {
+        SIM_HashBytes(Fifo[i], &block[i * 4]);
+      }
+      SIM_HashBlock(block);
+      Blocks++;
+      Count = 0;
+      hash->SR |= HASH_SR_DINIS;
+    }
+    Fifo[Count++] = *reg;
+    SIM_HashSave();
+  }
+  else if (Address == (uint32_t)&HASH->STR)
+  {
+    if ((*reg & HASH_STR_DCAL) != 0)
+    {
+      *reg &= ~HASH_STR_DCAL;
+      SIM_HashDigest();
+    }
+  }
+  else if (Address == (uint32_t)&HASH->SR)
+  {
+    /* rc_w0 flags */
+    *reg = Old & (*reg | ~(HASH_SR_DINIS | HASH_SR_DCIS));
+  }
+  else if ((Address >= (uint32_t)&HASH->CSR[0]) && (Address <= (uint32_t)&HASH->CSR[50]))
+  {
+    SIM_HashLoad();
+  }
+}
+
+/**
+  * @brief  Whether the HASH asks for its interrupt
+  * @param  None
+  * @retval Non zero if a flag and its enable bit are set
+  */
+uint32_t SIM_HashLine(void)
+{
+  HASH_TypeDef* hash = SIM_HASH;
+
+  return hash->SR & hash->IMR & (HASH_SR_DINIS | HASH_SR_DCIS);
+}
+
+/**
+  * @brief  New message: initial digest state of ALGO, empty FIFO
+  * @param  None
+  * @retval None
+  */
+static void SIM_HashInit(void)
+{
+  static const uint32_t initial[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+
+  memcpy(State, initial, sizeof(State));
+  Count = 0;
+  Blocks = 0;
+  SIM_HASH->SR = HASH_SR_DINIS;
+  SIM_HashSave();
+}
+
+/**
+  * @brief  DCAL: pads the words of the FIFO, the last one with NBLW valid
+  *         bits, and puts the digest in HR
+  * @param  None
+  * @retval None
+  */
+static void SIM_HashDigest(void)
+{
+  HASH_TypeDef* hash = SIM_HASH;
+  uint32_t md5 = (hash->CR & HASH_CR_ALGO) == HASH_AlgoSelection_MD5;
+  uint32_t valid = (hash->STR & HASH_STR_NBW) / 8;
+  uint8_t tail[128];
+  uint64_t bits = 0;
+  uint32_t length = 0, padded = 0, i = 0;
+
+  memset(tail, 0, sizeof(tail));
+  for (i = 0; i < Count; i++)
+  {
+    SIM_HashBytes(Fifo[i], &tail[i * 4]);
+  }
+  length = Count * 4;
+  if ((Count != 0) && (valid != 0))
+  {
+    length -= 4 - valid;
+  }
+  memset(&tail[length], 0, sizeof(tail) - length);
+  tail[length] = 0x80;
+  padded = (length + 1 + 8 <= 64) ? 64 : 128;
+
+  bits = ((uint64_t)Blocks * 64 + length) * 8;
+  for (i = 0; i < 8; i++)
+  {
+    /* SHA-1 ends with the length big-endian, MD5 little-endian */
+    tail[padded - 1 - i] = (uint8_t)(bits >> (md5 ? (56 - 8 * i) : (8 * i)));
+  }
+  for (i = 0; i < padded; i += 64)
+  {
+    SIM_HashBlock(&tail[i]);
+  }
+
+  /* HR holds the digest bytes as big-endian words */
+  for (i = 0; i < 5; i++)
+  {
+    hash->HR[i] = md5 ? __REV(State[i]) : State[i];
+  }
+  if (md5)
+  {
+    hash->HR[4] = 0;
+  }
+  Count = 0;
+  Blocks = 0;
+  hash->SR |= HASH_SR_DCIS;
+  SIM_HashSave();
+}
+
+/**
+  * @brief  One 64 byte block through the algorithm of ALGO
+  * @param  Block: message bytes
+  * @retval None
+  */
+static void SIM_HashBlock(const uint8_t* Block)
+{
+  if ((SIM_HASH->CR & HASH_CR_ALGO) == HASH_AlgoSelection_MD5)
+  {
+    SIM_Md5Block(Block);
+  }
+  else
+  {
+    SIM_Sha1Block(Block);
+  }
+}
+
+/**
+  * @brief  SHA-1 compression (FIPS 180-4)
+  * @param  Block: 64 message bytes
+  * @retval None
+  */
+static void SIM_Sha1Block(const uint8_t* Block)
+{
+  uint32_t w[80];
+  uint32_t a = State[0], b = State[1], c = State[2], d = State[3], e = State[4];
+  uint32_t i = 0, f = 0, k = 0, t = 0;
+
+  for (i = 0; i < 16; i++)
+  {
+    w[i] = ((uint32_t)Block[i * 4] << 24) | ((uint32_t)Block[i * 4 + 1] << 16) |
+           ((uint32_t)Block[i * 4 + 2] << 8) | Block[i * 4 + 3];
+  }
+  for (i = 16; i < 80; i++)
+  {
+    t = w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16];
+    w[i] = SIM_ROL(t, 1);
+  }
+  for (i = 0; i < 80; i++)
+  {
+    if (i < 20)
+    {
+      f = (b & c) | (~b & d);
+      k = 0x5A827999;
+    }
+    else if (i < 40)
+    {
+      f = b ^ c ^ d;
+      k = 0x6ED9EBA1;
+    }
+    else if (i < 60)
+    {
+      f = (b & c) | (b & d) | (c & d);
+      k = 0x8F1BBCDC;
+    }
+    else
+    {
+      f = b ^ c ^ d;
+      k = 0xCA62C1D6;
+    }
+    t = SIM_ROL(a, 5) + f + e + k + w[i];
+    e = d;
+    d = c;
+    c = SIM_ROL(b, 30);
+    b = a;
+    a = t;
+  }
+  State[0] += a;
+  State[1] += b;
+  State[2] += c;
+  State[3] += d;
+  State[4] += e;
+}
+
+/**
+  * @brief  MD5 compression (RFC 1321), on the first four state words
+  * @param  Block: 64 message bytes
+  * @retval None
+  */
+static void SIM_Md5Block(const uint8_t* Block)
+{
+  uint32_t m[16];
+  uint32_t a = State[0], b = State[1], c = State[2], d = State[3];
+  uint32_t i = 0, f = 0, g = 0, t = 0;
+
+  for (i = 0; i < 16; i++)
+  {
+    m[i] = Block[i * 4] | ((uint32_t)Block[i * 4 + 1] << 8) |
+           ((uint32_t)Block[i * 4 + 2] << 16) | ((uint32_t)Block[i * 4 + 3] << 24);
+  }
+  for (i = 0; i < 64; i++)
+  {
+    switch (i / 16)
+    {
+      case 0:
+        f = (b & c) | (~b & d);
+        g = i;
+        break;
+      case 1:
+        f = (d & b) | (~d & c);
+        g = (5 * i + 1) & 15;
+        break;
+      case 2:
+        f = b ^ c ^ d;
+        g = (3 * i + 5) & 15;
+        break;
+      default:
+        f = c ^ (b | ~d);
+        g = (7 * i) & 15;
+        break;
+    }
+    t = a + f + Md5Sine[i] + m[g];
+    a = d;
+    d = c;
+    c = b;
+    b += SIM_ROL(t, Md5Shift[(i / 16) * 4 + (i & 3)]);
+  }
+  State[0] += a;
+  State[1] += b;
+  State[2] += c;
+  State[3] += d;
+}
+
+/**
+  * @brief  Message bytes of a word written to DIN, after the swap of
+  *         DATATYPE the core takes big-endian words
+  * @param  Word: word written
+  * @param  Bytes: 4 bytes, filled
+  * @retval None
+  */
+static void SIM_HashBytes(uint32_t Word, uint8_t* Bytes)
+{
+  uint32_t i = 0, bits = 0;
+
+  switch (SIM_HASH->CR & HASH_CR_DATATYPE)
+  {
+    case HASH_DataType_16b:
+      Word = (Word << 16) | (Word >> 16);
+      break;
+
+    case HASH_DataType_8b:
+      Word = __REV(Word);
+      break;
+
+    case HASH_DataType_1b:
+      for (i = 0; i < 32; i++)
+      {
+        bits |= ((Word >> i) & 1) << (31 - i);
+      }
+      Word = bits;
+      break;
+
+    default:
+      break;
+  }
+  Bytes[0] = (uint8_t)(Word >> 24);
+  Bytes[1] = (uint8_t)(Word >> 16);
+  Bytes[2] = (uint8_t)(Word >> 8);
+  Bytes[3] = (uint8_t)Word;
+}
+
+/**
+  * @brief  Shows the state of the core in CSR and the FIFO level in CR
+  * @param  None
+  * @retval None
+  */
+static void SIM_HashSave(void)
+{
+  HASH_TypeDef* hash = SIM_HASH;
+
+  memcpy((uint32_t*)&hash->CSR[SIM_CSR_STATE], State, sizeof(State));
+  memcpy((uint32_t*)&hash->CSR[SIM_CSR_FIFO], Fifo, sizeof(Fifo));
+  hash->CSR[SIM_CSR_COUNT] = Count;
+  hash->CSR[SIM_CSR_BLOCKS] = Blocks;
+  hash->CR = (hash->CR & ~(HASH_CR_NBW | HASH_CR_DINNE)) |
+             (Count << 8) | ((Count != 0) ? HASH_CR_DINNE : 0);
+}
+
+/**
+  * @brief  CSR written back by HASH_RestoreContext(): the core takes the
+  *         state they hold
+  * @param  None
+  * @retval None
+  */
+static void SIM_HashLoad(void)
+{
+  HASH_TypeDef* hash = SIM_HASH;
+
+  memcpy(State, (uint32_t*)&hash->CSR[SIM_CSR_STATE], sizeof(State));
+  memcpy(Fifo, (uint32_t*)&hash->CSR[SIM_CSR_FIFO], sizeof(Fifo));
+  Count = hash->CSR[SIM_CSR_COUNT] % (SIM_HASH_FIFO + 1);
+  Blocks = hash->CSR[SIM_CSR_BLOCKS];
+  SIM_HashSave();
+}
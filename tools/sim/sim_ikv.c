@@ -0,0 +1,147 @@
+/**
+  ******************************************************************************
+  * @file    sim_ikv.c
+  * @brief   Host versions of the lib/libikv.a routines used by
+  *          boot_driver/image_verify.c. SHA-256 is computed, ECDSA is not:
+  *          ecdsa_verify() gives SIM_SignatureValid.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "ikv_crypto.h"
+#include "sim.h"
+
+/* Private macro -------------------------------------------------------------*/
+#define SHA_ROR(x, n)         (((x) >> (n)) | ((x) << (32 - (n))))
+
+/* Private variables ---------------------------------------------------------*/
+int SIM_SignatureValid;
+
+static const uint32_t ShaK[64] =
+{
+  0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+  0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+  0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+  0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+  0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+  0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+  0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+  0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2,
+};
+
+/* Private function prototypes -----------------------------------------------*/
+static void SHA_Block(sha256_context_t* context);
+
+/* Private functions ---------------------------------------------------------*/
+
+void sha256_init(sha256_context_t* context)
+{
+  static const uint32_t h[8] =
+  {
+    0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19,
+  };
+
+  memcpy(context->H, h, sizeof(h));
+  context->length = 0;
+  context->next = 0;
+}
+
+void sha256_update(const uint8_t* input_data, const uint32_t input_length, sha256_context_t* context)
+{
+  uint32_t i = 0;
+
+  for (i = 0; i < input_length; i++)
+  {
+    context->M[context->next++] = input_data[i];
+    if (context->next == sizeof(context->M))
+    {
+      SHA_Block(context);
+      context->next = 0;
+    }
+  }
+  context->length += input_length;
+}
+
+void sha256_final(uint8_t* hash_value, sha256_context_t* context)
+{
+  uint64_t bits = (uint64_t)context->length * 8;
+  uint32_t i = 0;
+
+  context->M[context->next++] = 0x80;
+  if (context->next > 56)
+  {
+    memset(context->M + context->next, 0, sizeof(context->M) - context->next);
+    SHA_Block(context);
+    context->next = 0;
+  }
+  memset(context->M + context->next, 0, 56 - context->next);
+  for (i = 0; i < 8; i++)
+  {
+    context->M[63 - i] = (uint8_t)(bits >> (i * 8));
+  }
+  SHA_Block(context);
+
+  for (i = 0; i < SHA256_DIGEST_SIZE; i++)
+  {
+    hash_value[i] = (uint8_t)(context->H[i / 4] >> (24 - (i % 4) * 8));
+  }
+}
+
+void sha256(uint8_t* hash_value, const uint8_t* input_data, const uint32_t input_length)
+{
+  sha256_context_t context;
+
+  sha256_init(&context);
+  sha256_update(input_data, input_length, &context);
+  sha256_final(hash_value, &context);
+}
+
+int ecdsa_verify(uint32_t* r_value, uint32_t* s_value, const uint8_t* hash_data,
+                 eccpoint_t* pub_key, curve_parameter_t* curve)
+{
+  (void)r_value;
+  (void)s_value;
+  (void)hash_data;
+  (void)pub_key;
+  (void)curve;
+  return SIM_SignatureValid;
+}
+
+/**
+  * @brief  Compression of the 64 bytes in M
+  * @param  context: SHA-256 context
+  * @retval None
+  */
+static void SHA_Block(sha256_context_t* context)
+{
+  uint32_t w[64], v[8], i = 0, t1 = 0, t2 = 0;
+
+  for (i = 0; i < 16; i++)
+  {
+    w[i] = ((uint32_t)context->M[i * 4] << 24) | (context->M[i * 4 + 1] << 16) |
+           (context->M[i * 4 + 2] << 8) | context->M[i * 4 + 3];
+  }
+  for (i = 16; i < 64; i++)
+  {
+    w[i] = w[i - 16] + w[i - 7] +
+           (SHA_ROR(w[i - 15], 7) ^ SHA_ROR(w[i - 15], 18) ^ (w[i - 15] >> 3)) +
+           (SHA_ROR(w[i - 2], 17) ^ SHA_ROR(w[i - 2], 19) ^ (w[i - 2] >> 10));
+  }
+
+  memcpy(v, context->H, sizeof(v));
+  for (i = 0; i < 64; i++)
+  {
+    t1 = v[7] + (SHA_ROR(v[4], 6) ^ SHA_ROR(v[4], 11) ^ SHA_ROR(v[4], 25)) +
+         ((v[4] & v[5]) ^ (~v[4] & v[6])) + ShaK[i] + w[i];
+    t2 = (SHA_ROR(v[0], 2) ^ SHA_ROR(v[0], 13) ^ SHA_ROR(v[0], 22)) +
+         ((v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]));
+    memmove(v + 1, v, 7 * sizeof(uint32_t));
+    v[4] += t1;
+    v[0] = t1 + t2;
+  }
+  for (i = 0; i < 8; i++)
+  {
+    context->H[i] += v[i];
+  }
+}
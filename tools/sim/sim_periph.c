@@ -0,0 +1,936 @@
+/**
+  ******************************************************************************
+  * @file    sim_periph.c
+  * @brief   Behavior of the peripherals of the host register model: FLASH,
+  *          CRC, DMA, USART, RNG, the ready flags of the RCC, the CRYP and
+  *          the HASH.
+  *
+  *          FLASH  KEYR and OPTKEYR sequences, programming with PG (bits
+  *                 only go from 1 to 0), sector and mass erase, write
+  *                 protection, EOP with EOPIE. Nothing is ever busy.
+  *          CRC    the CRC-32 of the unit, one word per write of DR.
+  *          DMA    memory to memory and memory to peripheral transfers
+  *                 are done when the stream is enabled. Peripheral to
+  *                 memory transfers from a USART take the received bytes
+  *                 and stop at each half and full transfer, so that the
+  *                 interrupt is taken before the next bytes come. Streams
+  *                 of the CRYP move words as its FIFOs ask for them.
+  *                 Double buffer and circular modes, HT and TC flags.
+  *          USART  transmits at once, TXE and TC stay set. Received bytes
+  *                 go one at a time in DR, or to the DMA; IDLE is set once
+  *                 all the bytes given to SIM_UartInput() are taken.
+  *          RNG    DRDY is set while RNGEN is, DR gives the words of a
+  *                 xorshift generator. No seed nor clock error.
+  *          CRYP   AES, in sim_cryp.c.
+  *          HASH   SHA-1 and MD5, in sim_hash.c.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+#include <string.h>
+#include "sim.h"
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  uint32_t Base;
+  IRQn_Type IRQn;
+  SIM_Output Output;
+  uint32_t Head;        /* next byte to receive */
+  uint32_t Tail;        /* end of the received bytes */
+  uint32_t Idle;        /* bytes taken since the last IDLE */
+  uint8_t Queue[65536];
+} SIM_Uart;
+
+/* Private define ------------------------------------------------------------*/
+#define SIM_STREAMS           16          /* DMA1 streams 0-7, DMA2 streams 0-7 */
+#define SIM_QUEUE_MASK        (sizeof(((SIM_Uart*)0)->Queue) - 1)
+
+#define SIM_FLASH_KEY1        0x45670123
+#define SIM_FLASH_KEY2        0xCDEF89AB
+#define SIM_FLASH_OPTKEY1     0x08192A3B
+#define SIM_FLASH_OPTKEY2     0x4C5D6E7F
+#define SIM_FLASH_SECTORS     12
+
+#define SIM_DMA_FEIF          0x01
+#define SIM_DMA_DMEIF         0x04
+#define SIM_DMA_TEIF          0x08
+#define SIM_DMA_HTIF          0x10
+#define SIM_DMA_TCIF          0x20
+
+/* Private macro -------------------------------------------------------------*/
+#define SIM_SHADOW(type, base)  ((type*)SIM_Register((uint32_t)(base)))
+#define SIM_FLASH             SIM_SHADOW(FLASH_TypeDef, FLASH_R_BASE)
+#define SIM_CRC               SIM_SHADOW(CRC_TypeDef, CRC_BASE)
+#define SIM_RCC               SIM_SHADOW(RCC_TypeDef, RCC_BASE)
+#define SIM_DMA(index)        SIM_SHADOW(DMA_TypeDef, ((index) < 8) ? DMA1_BASE : DMA2_BASE)
+#define SIM_USART(uart)       SIM_SHADOW(USART_TypeDef, (uart)->Base)
+#define SIM_RNG               SIM_SHADOW(RNG_TypeDef, RNG_BASE)
+#define SIM_CRYP              SIM_SHADOW(CRYP_TypeDef, CRYP_BASE)
+
+/* Private variables ---------------------------------------------------------*/
+static SIM_Uart Uarts[] =
+{
+  { USART1_BASE, USART1_IRQn },
+  { USART2_BASE, USART2_IRQn },
+  { USART3_BASE, USART3_IRQn },
+  { UART4_BASE,  UART4_IRQn  },
+  { UART5_BASE,  UART5_IRQn  },
+  { USART6_BASE, USART6_IRQn },
+};
+#define SIM_UART_COUNT        (sizeof(Uarts) / sizeof(Uarts[0]))
+
+static const IRQn_Type StreamIRQn[SIM_STREAMS] =
+{
+  DMA1_Stream0_IRQn, DMA1_Stream1_IRQn, DMA1_Stream2_IRQn, DMA1_Stream3_IRQn,
+  DMA1_Stream4_IRQn, DMA1_Stream5_IRQn, DMA1_Stream6_IRQn, DMA1_Stream7_IRQn,
+  DMA2_Stream0_IRQn, DMA2_Stream1_IRQn, DMA2_Stream2_IRQn, DMA2_Stream3_IRQn,
+  DMA2_Stream4_IRQn, DMA2_Stream5_IRQn, DMA2_Stream6_IRQn, DMA2_Stream7_IRQn,
+};
+static const uint8_t FlagShift[4] = { 0, 6, 16, 22 };
+
+/* Start and size of the flash sectors, in KB */
+static const uint16_t SectorStart[SIM_FLASH_SECTORS] =
+{
+  0, 16, 32, 48, 64, 128, 256, 384, 512, 640, 768, 896
+};
+
+static uint32_t StreamCount[SIM_STREAMS];   /* NDTR when the stream was enabled */
+static uint32_t KeyStep;
+static uint32_t OptKeyStep;
+static uint32_t CrcTable[256];
+static uint32_t RngState;
+
+/* Private function prototypes -----------------------------------------------*/
+static DMA_Stream_TypeDef* SIM_Stream(uint32_t Index);
+static uint32_t SIM_StreamAddress(uint32_t Index);
+static volatile uint32_t* SIM_StreamFlags(uint32_t Index);
+static void SIM_StreamStart(uint32_t Index);
+static void SIM_StreamDone(uint32_t Index, uint32_t Flags);
+static uint32_t SIM_StreamItem(uint32_t Index, DMA_Stream_TypeDef* Stream);
+static SIM_Uart* SIM_UartFind(uint32_t Base);
+static int SIM_UartStream(SIM_Uart* Uart);
+static uint32_t SIM_UartFeed(SIM_Uart* Uart);
+static uint32_t SIM_CrypFeed(void);
+static uint32_t SIM_CrypRequest(const DMA_Stream_TypeDef* Stream);
+static void* SIM_Memory(uint32_t Address);
+static void SIM_FlashErase(uint32_t Sector);
+static uint32_t SIM_FlashSector(uint32_t Address);
+static void SIM_FlashDone(void);
+static uint32_t SIM_Crc(uint32_t Crc, uint32_t Data);
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Reset values of the modelled registers, after the peripherals
+  *         were cleared
+  * @param  None
+  * @retval None
+  */
+void SIM_PeriphReset(void)
+{
+  uint32_t i = 0;
+
+  SIM_FLASH->CR = FLASH_CR_LOCK;
+  SIM_FLASH->OPTCR = 0x0FFFAAED;
+  KeyStep = 0;
+  OptKeyStep = 0;
+
+  SIM_CRC->DR = 0xFFFFFFFF;
+
+  SIM_RCC->CR = RCC_CR_HSION | RCC_CR_HSIRDY;
+  SIM_RCC->PLLCFGR = 0x24003010;
+  SIM_RCC->PLLI2SCFGR = 0x20003000;
+
+  for (i = 0; i < SIM_UART_COUNT; i++)
+  {
+    SIM_USART(&Uarts[i])->SR = USART_FLAG_TXE | USART_FLAG_TC;
+    Uarts[i].Head = Uarts[i].Tail = Uarts[i].Idle = 0;
+  }
+  memset(StreamCount, 0, sizeof(StreamCount));
+
+  RngState = 0x2545F491;
+
+  SIM_CrypReset();
+  SIM_HashReset();
+}
+
+/**
+  * @brief  Sets where the bytes sent by a USART go
+  * @param  Usart: USART1 to USART6
+  * @param  Output: called with the bytes, 0 to drop them
+  * @retval None
+  */
+void SIM_UartOutput(USART_TypeDef* Usart, SIM_Output Output)
+{
+  SIM_Uart* uart = SIM_UartFind((uint32_t)Usart);
+
+  if (uart != 0)
+  {
+    uart->Output = Output;
+  }
+}
+
+/**
+  * @brief  Bytes received by a USART, taken in SIM_Poll()
+  * @param  Usart: USART1 to USART6
+  * @param  Data: bytes
+  * @param  Length: number of bytes, those that do not fit are lost
+  * @retval None
+  */
+void SIM_UartInput(USART_TypeDef* Usart, const uint8_t* Data, uint32_t Length)
+{
+  SIM_Uart* uart = SIM_UartFind((uint32_t)Usart);
+
+  if (uart == 0)
+  {
+    return;
+  }
+  while ((Length-- > 0) && (uart->Tail - uart->Head <= SIM_QUEUE_MASK))
+  {
+    uart->Queue[uart->Tail++ & SIM_QUEUE_MASK] = *Data++;
+  }
+}
+
+/**
+  * @brief  Bytes given to a USART and not received yet
+  * @param  Usart: USART1 to USART6
+  * @retval Number of bytes
+  */
+uint32_t SIM_UartPending(USART_TypeDef* Usart)
+{
+  SIM_Uart* uart = SIM_UartFind((uint32_t)Usart);
+
+  return (uart != 0) ? (uart->Tail - uart->Head) : 0;
+}
+
+/**
+  * @brief  Moves received bytes into the USARTs and their DMA streams, and
+  *         the words the CRYP asks for
+  * @param  None
+  * @retval Non zero if something changed
+  */
+uint32_t SIM_Feed(void)
+{
+  uint32_t i = 0, busy = 0;
+
+  for (i = 0; i < SIM_UART_COUNT; i++)
+  {
+    busy |= SIM_UartFeed(&Uarts[i]);
+  }
+  busy |= SIM_CrypFeed();
+  return busy;
+}
+
+/**
+  * @brief  Marks pending the interrupts whose flag and enable bit are set
+  * @param  None
+  * @retval None
+  */
+void SIM_Lines(void)
+{
+  USART_TypeDef* usart = 0;
+  DMA_Stream_TypeDef* stream = 0;
+  uint32_t i = 0, flags = 0, enabled = 0;
+
+  for (i = 0; i < SIM_UART_COUNT; i++)
+  {
+    usart = SIM_USART(&Uarts[i]);
+    if ((((usart->SR & USART_FLAG_TXE) != 0) && ((usart->CR1 & USART_CR1_TXEIE) != 0)) ||
+        (((usart->SR & USART_FLAG_TC) != 0) && ((usart->CR1 & USART_CR1_TCIE) != 0)) ||
+        (((usart->SR & (USART_FLAG_RXNE | USART_FLAG_ORE)) != 0) && ((usart->CR1 & USART_CR1_RXNEIE) != 0)) ||
+        (((usart->SR & USART_FLAG_IDLE) != 0) && ((usart->CR1 & USART_CR1_IDLEIE) != 0)) ||
+        (((usart->SR & USART_FLAG_PE) != 0) && ((usart->CR1 & USART_CR1_PEIE) != 0)) ||
+        (((usart->SR & (USART_FLAG_ORE | USART_FLAG_NE | USART_FLAG_FE)) != 0) && ((usart->CR3 & USART_CR3_EIE) != 0)))
+    {
+      SIM_Pend(Uarts[i].IRQn);
+    }
+  }
+
+  for (i = 0; i < SIM_STREAMS; i++)
+  {
+    stream = SIM_Stream(i);
+    flags = (*SIM_StreamFlags(i) >> FlagShift[i & 3]) & 0x3D;
+    enabled = ((stream->CR & DMA_SxCR_TCIE) ? SIM_DMA_TCIF : 0) |
+              ((stream->CR & DMA_SxCR_HTIE) ? SIM_DMA_HTIF : 0) |
+              ((stream->CR & DMA_SxCR_TEIE) ? SIM_DMA_TEIF : 0) |
+              ((stream->CR & DMA_SxCR_DMEIE) ? SIM_DMA_DMEIF : 0) |
+              ((stream->FCR & DMA_SxFCR_FEIE) ? SIM_DMA_FEIF : 0);
+    if ((flags & enabled) != 0)
+    {
+      SIM_Pend(StreamIRQn[i]);
+    }
+  }
+
+  if ((((SIM_RNG->CR & RNG_CR_IE) != 0) &&
+       ((SIM_RNG->SR & (RNG_SR_DRDY | RNG_SR_CEIS | RNG_SR_SEIS)) != 0)) ||
+      (SIM_HashLine() != 0))
+  {
+    SIM_Pend(HASH_RNG_IRQn);
+  }
+
+  if ((((SIM_FLASH->SR & FLASH_SR_EOP) != 0) && ((SIM_FLASH->CR & FLASH_CR_EOPIE) != 0)) ||
+      (((SIM_FLASH->SR & FLASH_SR_SOP) != 0) && ((SIM_FLASH->CR & FLASH_IT_ERR) != 0)))
+  {
+    SIM_Pend(FLASH_IRQn);
+  }
+}
+
+/**
+  * @brief  Read of a peripheral register about to be done
+  * @param  Address: word address
+  * @retval None
+  */
+void SIM_PeriphRead(uint32_t Address)
+{
+  SIM_Uart* uart = SIM_UartFind(Address & ~0x3FFu);
+  USART_TypeDef* usart = 0;
+  DMA_Stream_TypeDef* stream = 0;
+  uint32_t i = 0;
+
+  if ((Address & ~0x3FFu) == CRYP_BASE)
+  {
+    SIM_CrypRead(Address);
+    return;
+  }
+  if (Address == (uint32_t)&RNG->DR)
+  {
+    RngState ^= RngState << 13;
+    RngState ^= RngState >> 17;
+    RngState ^= RngState << 5;
+    SIM_RNG->DR = RngState;
+    return;
+  }
+  if (uart != 0)
+  {
+    usart = SIM_USART(uart);
+    if (Address == uart->Base + offsetof(USART_TypeDef, SR))
+    {
+      SIM_UartFeed(uart);
+    }
+    else if (Address == uart->Base + offsetof(USART_TypeDef, DR))
+    {
+      /* Reading DR after SR clears the receive flags */
+      usart->SR &= ~(USART_FLAG_RXNE | USART_FLAG_IDLE | USART_FLAG_ORE |
+                     USART_FLAG_NE | USART_FLAG_FE | USART_FLAG_PE);
+    }
+    return;
+  }
+
+  for (i = 0; i < SIM_STREAMS; i++)
+  {
+    if (Address == SIM_StreamAddress(i) + offsetof(DMA_Stream_TypeDef, NDTR))
+    {
+      stream = SIM_Stream(i);
+      uart = SIM_UartFind(stream->PAR & ~0x3FFu);
+      if (uart != 0)
+      {
+        SIM_UartFeed(uart);
+      }
+      return;
+    }
+  }
+}
+
+/**
+  * @brief  Write of a peripheral register done
+  * @param  Address: word address
+  * @param  Old: previous value of the word
+  * @retval None
+  */
+void SIM_PeriphWrite(uint32_t Address, uint32_t Old)
+{
+  uint32_t* reg = SIM_Register(Address);
+  uint32_t value = *reg;
+  SIM_Uart* uart = SIM_UartFind(Address & ~0x3FFu);
+  DMA_Stream_TypeDef* stream = 0;
+  uint32_t i = 0;
+  uint8_t data = 0;
+
+  /* CRYP */
+  if ((Address & ~0x3FFu) == CRYP_BASE)
+  {
+    SIM_CrypWrite(Address, Old);
+  }
+
+  /* HASH */
+  else if ((Address & ~0x3FFu) == HASH_BASE)
+  {
+    SIM_HashWrite(Address, Old);
+  }
+
+  /* RNG */
+  else if (Address == (uint32_t)&RNG->CR)
+  {
+    SIM_RNG->SR = (SIM_RNG->SR & ~RNG_SR_DRDY) | (((value & RNG_CR_RNGEN) != 0) ? RNG_SR_DRDY : 0);
+  }
+  else if (Address == (uint32_t)&RNG->SR)
+  {
+    /* rc_w0 flags */
+    *reg = Old & (value | ~(RNG_SR_CEIS | RNG_SR_SEIS));
+  }
+  else if (Address == (uint32_t)&RNG->DR)
+  {
+    *reg = Old;
+  }
+
+  /* FLASH */
+  else if (Address == (uint32_t)&FLASH->KEYR)
+  {
+    if ((KeyStep != 0) && (value == SIM_FLASH_KEY2))
+    {
+      SIM_FLASH->CR &= ~FLASH_CR_LOCK;
+    }
+    KeyStep = (value == SIM_FLASH_KEY1) ? 1 : 0;
+    *reg = 0;
+  }
+  else if (Address == (uint32_t)&FLASH->OPTKEYR)
+  {
+    if ((OptKeyStep != 0) && (value == SIM_FLASH_OPTKEY2))
+    {
+      SIM_FLASH->OPTCR &= ~FLASH_OPTCR_OPTLOCK;
+    }
+    OptKeyStep = (value == SIM_FLASH_OPTKEY1) ? 1 : 0;
+    *reg = 0;
+  }
+  else if (Address == (uint32_t)&FLASH->SR)
+  {
+    *reg = Old & ~(value & (FLASH_SR_EOP | FLASH_SR_SOP | FLASH_SR_WRPERR |
+                            FLASH_SR_PGAERR | FLASH_SR_PGPERR | FLASH_SR_PGSERR));
+  }
+  else if (Address == (uint32_t)&FLASH->CR)
+  {
+    if ((Old & FLASH_CR_LOCK) != 0)
+    {
+      *reg = Old;
+      return;
+    }
+    if ((value & FLASH_CR_STRT) != 0)
+    {
+      if ((value & FLASH_CR_MER) != 0)
+      {
+        for (i = 0; i < SIM_FLASH_SECTORS; i++)
+        {
+          SIM_FlashErase(i);
+        }
+      }
+      else if ((value & FLASH_CR_SER) != 0)
+      {
+        SIM_FlashErase((value >> 3) & 0x0F);
+      }
+      *reg &= ~FLASH_CR_STRT;
+      SIM_FlashDone();
+    }
+  }
+  else if (Address == (uint32_t)&FLASH->OPTCR)
+  {
+    if ((Old & FLASH_OPTCR_OPTLOCK) != 0)
+    {
+      *reg = Old;
+      return;
+    }
+    *reg &= ~FLASH_OPTCR_OPTSTRT;
+  }
+
+  /* CRC */
+  else if (Address == (uint32_t)&CRC->DR)
+  {
+    *reg = SIM_Crc(Old, value);
+  }
+  else if (Address == (uint32_t)&CRC->CR)
+  {
+    if ((value & CRC_CR_RESET) != 0)
+    {
+      SIM_CRC->DR = 0xFFFFFFFF;
+    }
+    *reg = 0;
+  }
+
+  /* RCC: oscillators and PLLs are ready at once, the clock switch too */
+  else if (Address == (uint32_t)&RCC->CR)
+  {
+    *reg = (value & ~(RCC_CR_HSIRDY | RCC_CR_HSERDY | RCC_CR_PLLRDY | RCC_CR_PLLI2SRDY)) |
+           ((value & (RCC_CR_HSION | RCC_CR_HSEON | RCC_CR_PLLON | RCC_CR_PLLI2SON)) << 1);
+  }
+  else if (Address == (uint32_t)&RCC->CFGR)
+  {
+    *reg = (value & ~RCC_CFGR_SWS) | ((value & RCC_CFGR_SW) << 2);
+  }
+
+  /* DMA */
+  else if ((Address == (uint32_t)&DMA1->LIFCR) || (Address == (uint32_t)&DMA1->HIFCR) ||
+           (Address == (uint32_t)&DMA2->LIFCR) || (Address == (uint32_t)&DMA2->HIFCR))
+  {
+    *SIM_Register(Address - 8) &= ~value;
+    *reg = 0;
+  }
+  else if ((Address == (uint32_t)&DMA1->LISR) || (Address == (uint32_t)&DMA1->HISR) ||
+           (Address == (uint32_t)&DMA2->LISR) || (Address == (uint32_t)&DMA2->HISR))
+  {
+    *reg = Old;
+  }
+
+  /* USART */
+  else if (uart != 0)
+  {
+    if (Address == uart->Base + offsetof(USART_TypeDef, DR))
+    {
+      if (((SIM_USART(uart)->CR1 & (USART_CR1_UE | USART_CR1_TE)) == (USART_CR1_UE | USART_CR1_TE)) &&
+          (uart->Output != 0))
+      {
+        data = (uint8_t)value;
+        uart->Output(&data, 1);
+      }
+      SIM_USART(uart)->SR |= USART_FLAG_TXE | USART_FLAG_TC;
+    }
+    else if (Address == uart->Base + offsetof(USART_TypeDef, SR))
+    {
+      /* rc_w0 flags */
+      *reg = Old & (value | ~(USART_FLAG_CTS | USART_FLAG_LBD | USART_FLAG_TC | USART_FLAG_RXNE));
+    }
+  }
+
+  else
+  {
+    for (i = 0; i < SIM_STREAMS; i++)
+    {
+      stream = SIM_Stream(i);
+      if (Address == SIM_StreamAddress(i) + offsetof(DMA_Stream_TypeDef, CR))
+      {
+        if (((Old & DMA_SxCR_EN) == 0) && ((value & DMA_SxCR_EN) != 0))
+        {
+          SIM_StreamStart(i);
+        }
+        return;
+      }
+      if ((Address == SIM_StreamAddress(i) + offsetof(DMA_Stream_TypeDef, NDTR)) &&
+          ((stream->CR & DMA_SxCR_EN) != 0))
+      {
+        *reg = Old;
+        return;
+      }
+    }
+  }
+}
+
+/**
+  * @brief  Write to the flash done: programs with PG set, otherwise the
+  *         word is left as it was
+  * @param  Address: word address
+  * @param  Old: previous value of the word
+  * @retval None
+  */
+void SIM_FlashWrite(uint32_t Address, uint32_t Old)
+{
+  uint32_t* word = SIM_Register(Address);
+  uint32_t sector = SIM_FlashSector(Address);
+
+  if ((SIM_FLASH->CR & (FLASH_CR_LOCK | FLASH_CR_PG)) != FLASH_CR_PG)
+  {
+    *word = Old;
+    SIM_FLASH->SR |= FLASH_SR_PGSERR;
+    return;
+  }
+  if ((SIM_FLASH->OPTCR & (1u << (16 + sector))) == 0)
+  {
+    *word = Old;
+    SIM_FLASH->SR |= FLASH_SR_WRPERR;
+    return;
+  }
+  *word &= Old;
+  SIM_FlashDone();
+}
+
+/**
+  * @brief  Erases a sector unless it is write protected
+  * @param  Sector: sector number
+  * @retval None
+  */
+static void SIM_FlashErase(uint32_t Sector)
+{
+  uint32_t size = 0;
+
+  if (Sector >= SIM_FLASH_SECTORS)
+  {
+    SIM_FLASH->SR |= FLASH_SR_PGSERR;
+    return;
+  }
+  if ((SIM_FLASH->OPTCR & (1u << (16 + Sector))) == 0)
+  {
+    SIM_FLASH->SR |= FLASH_SR_WRPERR;
+    return;
+  }
+  size = ((Sector + 1 < SIM_FLASH_SECTORS) ? SectorStart[Sector + 1] : 1024) - SectorStart[Sector];
+  memset(SIM_Register(FLASH_BASE + SectorStart[Sector] * 1024), 0xFF, size * 1024);
+}
+
+/**
+  * @brief  Sector of a flash address
+  * @param  Address: flash address
+  * @retval Sector number
+  */
+static uint32_t SIM_FlashSector(uint32_t Address)
+{
+  uint32_t sector = SIM_FLASH_SECTORS - 1;
+
+  while ((sector > 0) && (Address - FLASH_BASE < SectorStart[sector] * 1024u))
+  {
+    sector--;
+  }
+  return sector;
+}
+
+/**
+  * @brief  End of a flash operation: EOP is set with EOPIE
+  * @param  None
+  * @retval None
+  */
+static void SIM_FlashDone(void)
+{
+  if ((SIM_FLASH->CR & FLASH_CR_EOPIE) != 0)
+  {
+    SIM_FLASH->SR |= FLASH_SR_EOP;
+  }
+}
+
+/**
+  * @brief  Registers of a DMA stream
+  * @param  Index: 0-7 DMA1, 8-15 DMA2
+  * @retval Stream registers of the models
+  */
+static DMA_Stream_TypeDef* SIM_Stream(uint32_t Index)
+{
+  return SIM_SHADOW(DMA_Stream_TypeDef, SIM_StreamAddress(Index));
+}
+
+/**
+  * @brief  Address of a DMA stream
+  * @param  Index: 0-7 DMA1, 8-15 DMA2
+  * @retval Stream address
+  */
+static uint32_t SIM_StreamAddress(uint32_t Index)
+{
+  return ((Index < 8) ? DMA1_BASE : DMA2_BASE) + 0x10 + 0x18 * (Index & 7);
+}
+
+/**
+  * @brief  LISR or HISR of a stream
+  * @param  Index: 0-7 DMA1, 8-15 DMA2
+  * @retval Flag register of the models
+  */
+static volatile uint32_t* SIM_StreamFlags(uint32_t Index)
+{
+  return ((Index & 7) < 4) ? &SIM_DMA(Index)->LISR : &SIM_DMA(Index)->HISR;
+}
+
+/**
+  * @brief  Stream enabled: the transfers that do not wait for a USART are
+  *         done at once
+  * @param  Index: 0-7 DMA1, 8-15 DMA2
+  * @retval None
+  */
+static void SIM_StreamStart(uint32_t Index)
+{
+  DMA_Stream_TypeDef* stream = SIM_Stream(Index);
+  SIM_Uart* uart = SIM_UartFind(stream->PAR & ~0x3FFu);
+
+  StreamCount[Index] = stream->NDTR;
+  if (stream->NDTR == 0)
+  {
+    stream->CR &= ~DMA_SxCR_EN;
+    return;
+  }
+
+  /* Waits for the received bytes. The bytes sent to a USART go out
+     through its DR model. */
+  if (((stream->CR & DMA_SxCR_DIR) == DMA_DIR_PeripheralToMemory) && (uart != 0))
+  {
+    return;
+  }
+  /* The CRYP asks for the words, see SIM_CrypFeed() */
+  if ((stream->PAR & ~0x3FFu) == CRYP_BASE)
+  {
+    return;
+  }
+  while (stream->NDTR != 0)
+  {
+    SIM_StreamItem(Index, stream);
+  }
+  SIM_StreamDone(Index, SIM_DMA_HTIF | SIM_DMA_TCIF);
+}
+
+/**
+  * @brief  Moves the words the CRYP asks for until it asks for none: to DR
+  *         while the input FIFO has room, from DOUT while the output FIFO
+  *         holds some
+  * @param  None
+  * @retval Non zero if something changed
+  */
+static uint32_t SIM_CrypFeed(void)
+{
+  DMA_Stream_TypeDef* stream = 0;
+  uint32_t i = 0, moved = 1, busy = 0;
+
+  while (moved != 0)
+  {
+    moved = 0;
+    for (i = 0; i < SIM_STREAMS; i++)
+    {
+      stream = SIM_Stream(i);
+      if (((stream->CR & DMA_SxCR_EN) == 0) || (stream->NDTR == 0) ||
+          (SIM_CrypRequest(stream) == 0))
+      {
+        continue;
+      }
+      SIM_StreamItem(i, stream);
+      if (stream->NDTR == 0)
+      {
+        SIM_StreamDone(i, SIM_DMA_HTIF | SIM_DMA_TCIF);
+      }
+      moved = busy = 1;
+    }
+  }
+  return busy;
+}
+
+/**
+  * @brief  Whether the CRYP asks a stream for a word
+  * @param  Stream: stream registers of the models
+  * @retval 1 if it does, 0 otherwise
+  */
+static uint32_t SIM_CrypRequest(const DMA_Stream_TypeDef* Stream)
+{
+  if (Stream->PAR == (uint32_t)&CRYP->DR)
+  {
+    return (((SIM_CRYP->DMACR & CRYP_DMACR_DIEN) != 0) && ((SIM_CRYP->SR & CRYP_SR_IFNF) != 0)) ? 1 : 0;
+  }
+  if (Stream->PAR == (uint32_t)&CRYP->DOUT)
+  {
+    return (((SIM_CRYP->DMACR & CRYP_DMACR_DOEN) != 0) && ((SIM_CRYP->SR & CRYP_SR_OFNE) != 0)) ? 1 : 0;
+  }
+  return 0;
+}
+
+/**
+  * @brief  Moves one item of a stream. The peripheral side is the
+  *         source of memory to memory transfers.
+  * @param  Index: 0-7 DMA1, 8-15 DMA2
+  * @param  Stream: stream registers of the models
+  * @retval Item moved
+  */
+static uint32_t SIM_StreamItem(uint32_t Index, DMA_Stream_TypeDef* Stream)
+{
+  uint32_t psize = 1u << ((Stream->CR & DMA_SxCR_PSIZE) >> 11);
+  uint32_t msize = 1u << ((Stream->CR & DMA_SxCR_MSIZE) >> 13);
+  uint32_t done = StreamCount[Index] - Stream->NDTR;
+  uint32_t memory = ((Stream->CR & DMA_SxCR_CT) ? Stream->M1AR : Stream->M0AR) +
+                    ((Stream->CR & DMA_SxCR_MINC) ? done * msize : 0);
+  uint32_t peripheral = Stream->PAR + ((Stream->CR & DMA_SxCR_PINC) ? done * psize : 0);
+  uint32_t item = 0, old = 0;
+
+  switch (Stream->CR & DMA_SxCR_DIR)
+  {
+    case DMA_DIR_MemoryToPeripheral:
+      memcpy(&item, SIM_Memory(memory), msize);
+      if (SIM_Register(peripheral) != 0)
+      {
+        old = *SIM_Register(peripheral);
+        *SIM_Register(peripheral) = item;
+        SIM_PeriphWrite(peripheral, old);
+      }
+      else
+      {
+        memcpy(SIM_Memory(peripheral), &item, psize);
+      }
+      break;
+
+    default:
+      if (SIM_Register(peripheral) != 0)
+      {
+        SIM_PeriphRead(peripheral);
+      }
+      memcpy(&item, SIM_Memory(peripheral), psize);
+      memcpy(SIM_Memory(memory), &item, msize);
+      break;
+  }
+  Stream->NDTR--;
+  return item;
+}
+
+/**
+  * @brief  End of a transfer or of a half
+  * @param  Index: 0-7 DMA1, 8-15 DMA2
+  * @param  Flags: SIM_DMA_HTIF, SIM_DMA_TCIF
+  * @retval None
+  */
+static void SIM_StreamDone(uint32_t Index, uint32_t Flags)
+{
+  DMA_Stream_TypeDef* stream = SIM_Stream(Index);
+
+  *SIM_StreamFlags(Index) |= Flags << FlagShift[Index & 3];
+  if ((Flags & SIM_DMA_TCIF) == 0)
+  {
+    return;
+  }
+
+  if ((stream->CR & DMA_SxCR_DBM) != 0)
+  {
+    stream->CR ^= DMA_SxCR_CT;
+    stream->NDTR = StreamCount[Index];
+  }
+  else if ((stream->CR & DMA_SxCR_CIRC) != 0)
+  {
+    stream->NDTR = StreamCount[Index];
+  }
+  else
+  {
+    stream->CR &= ~DMA_SxCR_EN;
+  }
+}
+
+/**
+  * @brief  USART of a register block
+  * @param  Base: peripheral base address
+  * @retval USART, 0 if none
+  */
+static SIM_Uart* SIM_UartFind(uint32_t Base)
+{
+  uint32_t i = 0;
+
+  for (i = 0; i < SIM_UART_COUNT; i++)
+  {
+    if (Uarts[i].Base == Base)
+    {
+      return &Uarts[i];
+    }
+  }
+  return 0;
+}
+
+/**
+  * @brief  Stream receiving from a USART
+  * @param  Uart: USART
+  * @retval Stream index, -1 if none
+  */
+static int SIM_UartStream(SIM_Uart* Uart)
+{
+  DMA_Stream_TypeDef* stream = 0;
+  uint32_t i = 0;
+
+  if ((SIM_USART(Uart)->CR3 & USART_CR3_DMAR) == 0)
+  {
+    return -1;
+  }
+  for (i = 0; i < SIM_STREAMS; i++)
+  {
+    stream = SIM_Stream(i);
+    if (((stream->CR & (DMA_SxCR_EN | DMA_SxCR_DIR)) == (DMA_SxCR_EN | DMA_DIR_PeripheralToMemory)) &&
+        (stream->PAR == Uart->Base + offsetof(USART_TypeDef, DR)))
+    {
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+/**
+  * @brief  Moves received bytes: one into DR, or to the DMA up to the end
+  *         of the half or full transfer
+  * @param  Uart: USART
+  * @retval Non zero if something changed
+  */
+static uint32_t SIM_UartFeed(SIM_Uart* Uart)
+{
+  USART_TypeDef* usart = SIM_USART(Uart);
+  DMA_Stream_TypeDef* stream = 0;
+  int index = SIM_UartStream(Uart);
+  uint32_t busy = 0, half = 0;
+
+  if ((usart->CR1 & (USART_CR1_UE | USART_CR1_RE)) != (USART_CR1_UE | USART_CR1_RE))
+  {
+    return 0;
+  }
+
+  if (index >= 0)
+  {
+    stream = SIM_Stream((uint32_t)index);
+    half = StreamCount[index] / 2;
+    while ((Uart->Head != Uart->Tail) && ((stream->CR & DMA_SxCR_EN) != 0))
+    {
+      usart->DR = Uart->Queue[Uart->Head++ & SIM_QUEUE_MASK];
+      SIM_StreamItem((uint32_t)index, stream);
+      Uart->Idle++;
+      busy = 1;
+      if (stream->NDTR == half)
+      {
+        SIM_StreamDone((uint32_t)index, SIM_DMA_HTIF);
+        break;
+      }
+      if (stream->NDTR == 0)
+      {
+        SIM_StreamDone((uint32_t)index, SIM_DMA_TCIF);
+        break;
+      }
+    }
+  }
+  else if (((usart->SR & USART_FLAG_RXNE) == 0) && (Uart->Head != Uart->Tail))
+  {
+    usart->DR = Uart->Queue[Uart->Head++ & SIM_QUEUE_MASK];
+    usart->SR |= USART_FLAG_RXNE;
+    Uart->Idle++;
+    busy = 1;
+  }
+
+  if ((Uart->Head == Uart->Tail) && (Uart->Idle != 0) && ((usart->SR & USART_FLAG_RXNE) == 0))
+  {
+    usart->SR |= USART_FLAG_IDLE;
+    Uart->Idle = 0;
+    busy = 1;
+  }
+  return busy;
+}
+
+/**
+  * @brief  Host address of memory used by the DMA
+  * @param  Address: 32-bit address
+  * @retval Pointer, into the models for the simulated regions
+  */
+static void* SIM_Memory(uint32_t Address)
+{
+  uint32_t* reg = SIM_Register(Address);
+
+  return (reg != 0) ? (void*)((uint8_t*)reg + (Address & 3)) : (void*)(uintptr_t)Address;
+}
+
+/**
+  * @brief  One word through the CRC unit: CRC-32 polynomial 0x04C11DB7,
+  *         most significant bit first
+  * @param  Crc: current value of DR
+  * @param  Data: word written
+  * @retval New value of DR
+  */
+static uint32_t SIM_Crc(uint32_t Crc, uint32_t Data)
+{
+  uint32_t i = 0, bit = 0, value = 0;
+
+  if (CrcTable[1] == 0)
+  {
+    for (i = 0; i < 256; i++)
+    {
+      value = i << 24;
+      for (bit = 0; bit < 8; bit++)
+      {
+        value = (value & 0x80000000) ? ((value << 1) ^ 0x04C11DB7) : (value << 1);
+      }
+      CrcTable[i] = value;
+    }
+  }
+
+  Crc ^= Data;
+  for (i = 0; i < 4; i++)
+  {
+    Crc = (Crc << 8) ^ CrcTable[Crc >> 24];
+  }
+  return Crc;
+}
@@ -0,0 +1,143 @@
+/**
+  ******************************************************************************
+  * @file    sim_test.c
+  * @brief   Runner of the host tests of sim_test.h. A group runs in a child
+  *          process, so that the static state of the drivers and of the
+  *          models starts from the reset each time; the exit status of the
+  *          child is its count of failed checks.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "sim_test.h"
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  const char* Name;
+  void (*Run)(void);
+} SIM_Group;
+
+/* Private variables ---------------------------------------------------------*/
+static const SIM_Group Groups[] =
+{
+  {"model", SIM_TestModel},
+  {"flash_erase", SIM_TestFlashErase},
+  {"flash_write", SIM_TestFlashWrite},
+  {"boot_record", SIM_TestRecord},
+  {"lz_flash", SIM_TestLz},
+  {"delta_flash", SIM_TestDelta},
+  {"iap_frame", SIM_TestFrame},
+  {"dma_manager", SIM_TestDmaManager},
+  {"dma_mem", SIM_TestDmaMem},
+  {"hash_engine", SIM_TestHash},
+  {"hmac_key", SIM_TestHmac},
+  {"cryp_engine", SIM_TestCryp},
+  {"cryp_sessions", SIM_TestCrypSessions},
+  {"aead", SIM_TestAead},
+  {"rng_pool", SIM_TestRng},
+};
+
+static uint32_t Failures;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Runs every group and prints its result
+  * @param  None
+  * @retval Number of groups that failed
+  */
+uint32_t SIM_Test(void)
+{
+  pid_t child = 0;
+  int status = 0;
+  uint32_t i = 0, failed = 0;
+
+  fflush(stdout);
+  for (i = 0; i < sizeof(Groups) / sizeof(Groups[0]); i++)
+  {
+    child = fork();
+    if (child == 0)
+    {
+      SIM_Reset();
+      memset(SIM_Register(FLASH_BASE), 0xFF, SIM_FLASH_SIZE);
+      SystemCoreClockUpdate();
+      Groups[i].Run();
+      fflush(stdout);
+      _exit((Failures < 255) ? (int)Failures : 255);
+    }
+    if ((child < 0) || (waitpid(child, &status, 0) < 0))
+    {
+      perror("fork");
+      return i + 1;
+    }
+    if (WIFEXITED(status) && (WEXITSTATUS(status) == 0))
+    {
+      printf("%s: pass\n", Groups[i].Name);
+    }
+    else
+    {
+      printf("%s: fail (0x%X)\n", Groups[i].Name, (unsigned)status);
+      failed++;
+    }
+    fflush(stdout);
+  }
+  return failed;
+}
+
+/**
+  * @brief  Result of a check, printed when it failed
+  * @param  Passed: 1 if the condition holds
+  * @param  File, Line: place of the check
+  * @param  Condition: text of the condition
+  * @retval Passed
+  */
+uint32_t SIM_Check(uint32_t Passed, const char* File, int Line, const char* Condition)
+{
+  if (Passed == 0)
+  {
+    printf("%s:%d: %s\n", File, Line, Condition);
+    Failures++;
+  }
+  return Passed;
+}
+
+/**
+  * @brief  Completion callback of the drivers, counts its calls
+  * @param  Context: SIM_Calls
+  * @param  Status: given by the driver
+  * @retval None
+  */
+void SIM_Done(void* Context, uint32_t Status)
+{
+  SIM_Calls* calls = (SIM_Calls*)Context;
+
+  calls->Count++;
+  calls->Status = Status;
+}
+
+/**
+  * @brief  Whether bytes are the ones given in hexadecimal
+  * @param  Data: bytes
+  * @param  Hex: lower case digits
+  * @param  Length: bytes
+  * @retval 1 if they are, 0 otherwise
+  */
+uint32_t SIM_Hex(const uint8_t* Data, const char* Hex, uint32_t Length)
+{
+  static const char digits[] = "0123456789abcdef";
+  uint32_t i = 0;
+
+  for (i = 0; i < Length; i++)
+  {
+    if ((Hex[2 * i] != digits[Data[i] >> 4]) || (Hex[2 * i + 1] != digits[Data[i] & 0x0F]))
+    {
+      return 0;
+    }
+  }
+  return (Hex[2 * Length] == 0) ? 1 : 0;
+}
@@ -0,0 +1,52 @@
+/**
+  ******************************************************************************
+  * @file    sim_test.h
+  * @brief   Host tests of boot_driver/ on the register model, run by
+  *          iap_sim -t. Each group of tests runs in a process of its own
+  *          from the reset state of the models, with the flash erased.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SIM_TEST_H
+#define __SIM_TEST_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "sim.h"
+
+/* Exported macro ------------------------------------------------------------*/
+/* Counts a failed check and prints where it is, the test goes on */
+#define SIM_CHECK(condition)  SIM_Check(((condition) != 0) ? 1 : 0, __FILE__, __LINE__, #condition)
+/* nWRP bit of a sector in OPTCR, cleared to protect it */
+#define SIM_NWRP(sector)      (1u << (16 + (sector)))
+
+/* Exported types ------------------------------------------------------------*/
+/* Calls of a completion callback counted by SIM_Done(), its Context */
+typedef struct
+{
+  volatile uint32_t Count;
+  volatile uint32_t Status;   /* given to the last call */
+} SIM_Calls;
+
+/* Exported functions ------------------------------------------------------- */
+uint32_t SIM_Test(void);
+uint32_t SIM_Check(uint32_t Passed, const char* File, int Line, const char* Condition);
+uint32_t SIM_Hex(const uint8_t* Data, const char* Hex, uint32_t Length);
+void SIM_Done(void* Context, uint32_t Status);
+void SIM_TestModel(void);
+void SIM_TestFlashErase(void);
+void SIM_TestFlashWrite(void);
+void SIM_TestRecord(void);
+void SIM_TestLz(void);
+void SIM_TestDelta(void);
+void SIM_TestFrame(void);
+void SIM_TestDmaManager(void);
+void SIM_TestDmaMem(void);
+void SIM_TestHash(void);
+void SIM_TestHmac(void);
+void SIM_TestCryp(void);
+void SIM_TestCrypSessions(void);
+void SIM_TestAead(void);
+void SIM_TestRng(void);
+
+#endif  /* __SIM_TEST_H */
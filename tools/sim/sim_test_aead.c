@@ -0,0 +1,317 @@
+/**
+  ******************************************************************************
+  * @file    sim_test_aead.c
+  * @brief   Host tests of aead.c: the examples of the GCM specification and
+  *          of NIST SP 800-38C encrypted, decrypted, and decrypted with a
+  *          wrong tag; the CRYP lent by CENG_Lock().
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "sim_test.h"
+#include "cryp_engine.h"
+#include "aead.h"
+#include <string.h>
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  uint32_t Ccm;
+  uint32_t KeyBits;
+  const uint8_t* Key;
+  const uint8_t* Iv;          /* IV or nonce */
+  uint32_t IvLength;
+  const uint8_t* Aad;
+  uint32_t AadLength;
+  const uint8_t* Plain;
+  const uint8_t* Cipher;
+  uint32_t Length;
+  const uint8_t* Tag;
+  uint32_t TagLength;
+} SIM_Vector;
+
+/* Private define ------------------------------------------------------------*/
+#define SIM_VECTORS           (sizeof(Vectors) / sizeof(Vectors[0]))
+
+/* Private variables ---------------------------------------------------------*/
+/* Static: the DMA takes 32-bit addresses */
+static uint8_t Block[16];
+static SIM_Calls Done;
+
+/* Test cases 2, 3, 4, 6, 10, 14 and 16 of "The Galois/Counter Mode of
+   Operation (GCM)", McGrew and Viega; examples 1 to 3 of NIST SP 800-38C */
+static const uint8_t Zero[64];
+static const uint8_t GcmKey[32] =
+{
+  0xFE, 0xFF, 0xE9, 0x92, 0x86, 0x65, 0x73, 0x1C, 0x6D, 0x6A, 0x8F, 0x94,
+  0x67, 0x30, 0x83, 0x08, 0xFE, 0xFF, 0xE9, 0x92, 0x86, 0x65, 0x73, 0x1C,
+  0x6D, 0x6A, 0x8F, 0x94, 0x67, 0x30, 0x83, 0x08,
+};
+static const uint8_t GcmIv[12] =
+{
+  0xCA, 0xFE, 0xBA, 0xBE, 0xFA, 0xCE, 0xDB, 0xAD, 0xDE, 0xCA, 0xF8, 0x88,
+};
+static const uint8_t GcmIv60[60] =
+{
+  0x93, 0x13, 0x22, 0x5D, 0xF8, 0x84, 0x06, 0xE5, 0x55, 0x90, 0x9C, 0x5A,
+  0xFF, 0x52, 0x69, 0xAA, 0x6A, 0x7A, 0x95, 0x38, 0x53, 0x4F, 0x7D, 0xA1,
+  0xE4, 0xC3, 0x03, 0xD2, 0xA3, 0x18, 0xA7, 0x28, 0xC3, 0xC0, 0xC9, 0x51,
+  0x56, 0x80, 0x95, 0x39, 0xFC, 0xF0, 0xE2, 0x42, 0x9A, 0x6B, 0x52, 0x54,
+  0x16, 0xAE, 0xDB, 0xF5, 0xA0, 0xDE, 0x6A, 0x57, 0xA6, 0x37, 0xB3, 0x9B,
+};
+static const uint8_t GcmPlain[64] =
+{
+  0xD9, 0x31, 0x32, 0x25, 0xF8, 0x84, 0x06, 0xE5, 0xA5, 0x59, 0x09, 0xC5,
+  0xAF, 0xF5, 0x26, 0x9A, 0x86, 0xA7, 0xA9, 0x53, 0x15, 0x34, 0xF7, 0xDA,
+  0x2E, 0x4C, 0x30, 0x3D, 0x8A, 0x31, 0x8A, 0x72, 0x1C, 0x3C, 0x0C, 0x95,
+  0x95, 0x68, 0x09, 0x53, 0x2F, 0xCF, 0x0E, 0x24, 0x49, 0xA6, 0xB5, 0x25,
+  0xB1, 0x6A, 0xED, 0xF5, 0xAA, 0x0D, 0xE6, 0x57, 0xBA, 0x63, 0x7B, 0x39,
+  0x1A, 0xAF, 0xD2, 0x55,
+};
+static const uint8_t GcmAad[20] =
+{
+  0xFE, 0xED, 0xFA, 0xCE, 0xDE, 0xAD, 0xBE, 0xEF, 0xFE, 0xED, 0xFA, 0xCE,
+  0xDE, 0xAD, 0xBE, 0xEF, 0xAB, 0xAD, 0xDA, 0xD2,
+};
+static const uint8_t GcmCipher2[16] =
+{
+  0x03, 0x88, 0xDA, 0xCE, 0x60, 0xB6, 0xA3, 0x92, 0xF3, 0x28, 0xC2, 0xB9,
+  0x71, 0xB2, 0xFE, 0x78,
+};
+static const uint8_t GcmTag2[16] =
+{
+  0xAB, 0x6E, 0x47, 0xD4, 0x2C, 0xEC, 0x13, 0xBD, 0xF5, 0x3A, 0x67, 0xB2,
+  0x12, 0x57, 0xBD, 0xDF,
+};
+static const uint8_t GcmCipher3[64] =
+{
+  0x42, 0x83, 0x1E, 0xC2, 0x21, 0x77, 0x74, 0x24, 0x4B, 0x72, 0x21, 0xB7,
+  0x84, 0xD0, 0xD4, 0x9C, 0xE3, 0xAA, 0x21, 0x2F, 0x2C, 0x02, 0xA4, 0xE0,
+  0x35, 0xC1, 0x7E, 0x23, 0x29, 0xAC, 0xA1, 0x2E, 0x21, 0xD5, 0x14, 0xB2,
+  0x54, 0x66, 0x93, 0x1C, 0x7D, 0x8F, 0x6A, 0x5A, 0xAC, 0x84, 0xAA, 0x05,
+  0x1B, 0xA3, 0x0B, 0x39, 0x6A, 0x0A, 0xAC, 0x97, 0x3D, 0x58, 0xE0, 0x91,
+  0x47, 0x3F, 0x59, 0x85,
+};
+static const uint8_t GcmTag3[16] =
+{
+  0x4D, 0x5C, 0x2A, 0xF3, 0x27, 0xCD, 0x64, 0xA6, 0x2C, 0xF3, 0x5A, 0xBD,
+  0x2B, 0xA6, 0xFA, 0xB4,
+};
+static const uint8_t GcmTag4[16] =
+{
+  0x5B, 0xC9, 0x4F, 0xBC, 0x32, 0x21, 0xA5, 0xDB, 0x94, 0xFA, 0xE9, 0x5A,
+  0xE7, 0x12, 0x1A, 0x47,
+};
+static const uint8_t GcmCipher6[60] =
+{
+  0x8C, 0xE2, 0x49, 0x98, 0x62, 0x56, 0x15, 0xB6, 0x03, 0xA0, 0x33, 0xAC,
+  0xA1, 0x3F, 0xB8, 0x94, 0xBE, 0x91, 0x12, 0xA5, 0xC3, 0xA2, 0x11, 0xA8,
+  0xBA, 0x26, 0x2A, 0x3C, 0xCA, 0x7E, 0x2C, 0xA7, 0x01, 0xE4, 0xA9, 0xA4,
+  0xFB, 0xA4, 0x3C, 0x90, 0xCC, 0xDC, 0xB2, 0x81, 0xD4, 0x8C, 0x7C, 0x6F,
+  0xD6, 0x28, 0x75, 0xD2, 0xAC, 0xA4, 0x17, 0x03, 0x4C, 0x34, 0xAE, 0xE5,
+};
+static const uint8_t GcmTag6[16] =
+{
+  0x61, 0x9C, 0xC5, 0xAE, 0xFF, 0xFE, 0x0B, 0xFA, 0x46, 0x2A, 0xF4, 0x3C,
+  0x16, 0x99, 0xD0, 0x50,
+};
+static const uint8_t GcmCipher10[60] =
+{
+  0x39, 0x80, 0xCA, 0x0B, 0x3C, 0x00, 0xE8, 0x41, 0xEB, 0x06, 0xFA, 0xC4,
+  0x87, 0x2A, 0x27, 0x57, 0x85, 0x9E, 0x1C, 0xEA, 0xA6, 0xEF, 0xD9, 0x84,
+  0x62, 0x85, 0x93, 0xB4, 0x0C, 0xA1, 0xE1, 0x9C, 0x7D, 0x77, 0x3D, 0x00,
+  0xC1, 0x44, 0xC5, 0x25, 0xAC, 0x61, 0x9D, 0x18, 0xC8, 0x4A, 0x3F, 0x47,
+  0x18, 0xE2, 0x44, 0x8B, 0x2F, 0xE3, 0x24, 0xD9, 0xCC, 0xDA, 0x27, 0x10,
+};
+static const uint8_t GcmTag10[16] =
+{
+  0x25, 0x19, 0x49, 0x8E, 0x80, 0xF1, 0x47, 0x8F, 0x37, 0xBA, 0x55, 0xBD,
+  0x6D, 0x27, 0x61, 0x8C,
+};
+static const uint8_t GcmCipher14[16] =
+{
+  0xCE, 0xA7, 0x40, 0x3D, 0x4D, 0x60, 0x6B, 0x6E, 0x07, 0x4E, 0xC5, 0xD3,
+  0xBA, 0xF3, 0x9D, 0x18,
+};
+static const uint8_t GcmTag14[16] =
+{
+  0xD0, 0xD1, 0xC8, 0xA7, 0x99, 0x99, 0x6B, 0xF0, 0x26, 0x5B, 0x98, 0xB5,
+  0xD4, 0x8A, 0xB9, 0x19,
+};
+static const uint8_t GcmCipher16[60] =
+{
+  0x52, 0x2D, 0xC1, 0xF0, 0x99, 0x56, 0x7D, 0x07, 0xF4, 0x7F, 0x37, 0xA3,
+  0x2A, 0x84, 0x42, 0x7D, 0x64, 0x3A, 0x8C, 0xDC, 0xBF, 0xE5, 0xC0, 0xC9,
+  0x75, 0x98, 0xA2, 0xBD, 0x25, 0x55, 0xD1, 0xAA, 0x8C, 0xB0, 0x8E, 0x48,
+  0x59, 0x0D, 0xBB, 0x3D, 0xA7, 0xB0, 0x8B, 0x10, 0x56, 0x82, 0x88, 0x38,
+  0xC5, 0xF6, 0x1E, 0x63, 0x93, 0xBA, 0x7A, 0x0A, 0xBC, 0xC9, 0xF6, 0x62,
+};
+static const uint8_t GcmTag16[16] =
+{
+  0x76, 0xFC, 0x6E, 0xCE, 0x0F, 0x4E, 0x17, 0x68, 0xCD, 0xDF, 0x88, 0x53,
+  0xBB, 0x2D, 0x55, 0x1B,
+};
+static const uint8_t CcmKey[16] =
+{
+  0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4A, 0x4B,
+  0x4C, 0x4D, 0x4E, 0x4F,
+};
+static const uint8_t CcmNonce[12] =
+{
+  0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x1B,
+};
+static const uint8_t CcmAad[20] =
+{
+  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B,
+  0x0C, 0x0D, 0x0E, 0x0F, 0x10, 0x11, 0x12, 0x13,
+};
+static const uint8_t CcmPlain[24] =
+{
+  0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2A, 0x2B,
+  0x2C, 0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37,
+};
+static const uint8_t CcmCipher1[4] =
+{
+  0x71, 0x62, 0x01, 0x5B,
+};
+static const uint8_t CcmTag1[4] =
+{
+  0x4D, 0xAC, 0x25, 0x5D,
+};
+static const uint8_t CcmCipher2[16] =
+{
+  0xD2, 0xA1, 0xF0, 0xE0, 0x51, 0xEA, 0x5F, 0x62, 0x08, 0x1A, 0x77, 0x92,
+  0x07, 0x3D, 0x59, 0x3D,
+};
+static const uint8_t CcmTag2[6] =
+{
+  0x1F, 0xC6, 0x4F, 0xBF, 0xAC, 0xCD,
+};
+static const uint8_t CcmCipher3[24] =
+{
+  0xE3, 0xB2, 0x01, 0xA9, 0xF5, 0xB7, 0x1A, 0x7A, 0x9B, 0x1C, 0xEA, 0xEC,
+  0xCD, 0x97, 0xE7, 0x0B, 0x61, 0x76, 0xAA, 0xD9, 0xA4, 0x42, 0x8A, 0xA5,
+};
+static const uint8_t CcmTag3[8] =
+{
+  0x48, 0x43, 0x92, 0xFB, 0xC1, 0xB0, 0x99, 0x51,
+};
+static const SIM_Vector Vectors[] =
+{
+  { 0, 128, Zero,    Zero,     12, 0,       0,  Zero,      GcmCipher2,  16, GcmTag2,  16 },
+  { 0, 128, GcmKey,  GcmIv,    12, 0,       0,  GcmPlain,  GcmCipher3,  64, GcmTag3,  16 },
+  { 0, 128, GcmKey,  GcmIv,    12, GcmAad,  20, GcmPlain,  GcmCipher3,  60, GcmTag4,  16 },
+  { 0, 128, GcmKey,  GcmIv60,  60, GcmAad,  20, GcmPlain,  GcmCipher6,  60, GcmTag6,  16 },
+  { 0, 192, GcmKey,  GcmIv,    12, GcmAad,  20, GcmPlain,  GcmCipher10, 60, GcmTag10, 16 },
+  { 0, 256, Zero,    Zero,     12, 0,       0,  Zero,      GcmCipher14, 16, GcmTag14, 16 },
+  { 0, 256, GcmKey,  GcmIv,    12, GcmAad,  20, GcmPlain,  GcmCipher16, 60, GcmTag16, 16 },
+  { 1, 128, CcmKey,  CcmNonce,  7, CcmAad,   8, CcmPlain,  CcmCipher1,   4, CcmTag1,   4 },
+  { 1, 128, CcmKey,  CcmNonce,  8, CcmAad,  16, CcmPlain,  CcmCipher2,  16, CcmTag2,   6 },
+  { 1, 128, CcmKey,  CcmNonce, 12, CcmAad,  20, CcmPlain,  CcmCipher3,  24, CcmTag3,   8 },
+};
+
+/* Private function prototypes -----------------------------------------------*/
+static uint32_t SIM_Encrypt(const AEAD_Key* Key, const SIM_Vector* Vector, uint8_t* Output,
+                            uint8_t* Tag);
+static uint32_t SIM_Decrypt(const AEAD_Key* Key, const SIM_Vector* Vector, uint8_t* Output,
+                            const uint8_t* Tag);
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  AEAD_SetKey(), AEAD_GcmEncrypt(), AEAD_GcmDecrypt(),
+  *         AEAD_CcmEncrypt() and AEAD_CcmDecrypt() on known answers, the
+  *         CRYP lent by CENG_Lock()
+  * @param  None
+  * @retval None
+  */
+void SIM_TestAead(void)
+{
+  static CENG_Session ecb;
+  AEAD_Key key;
+  const SIM_Vector* vector = 0;
+  uint8_t output[64];
+  uint8_t tag[AEAD_TAG_SIZE];
+  uint32_t i = 0;
+
+  SIM_CHECK(CENG_Init() == CENG_OK);
+
+  /* Each vector encrypted, decrypted, then decrypted with a wrong tag:
+     refused and the output cleared */
+  for (i = 0; i < SIM_VECTORS; i++)
+  {
+    vector = &Vectors[i];
+    SIM_CHECK(AEAD_SetKey(&key, vector->Key, vector->KeyBits) == AEAD_OK);
+    memset(tag, 0, sizeof(tag));
+    SIM_CHECK(SIM_Encrypt(&key, vector, output, tag) == AEAD_OK);
+    SIM_CHECK(memcmp(output, vector->Cipher, vector->Length) == 0);
+    SIM_CHECK(memcmp(tag, vector->Tag, vector->TagLength) == 0);
+    SIM_CHECK(SIM_Decrypt(&key, vector, output, vector->Tag) == AEAD_OK);
+    SIM_CHECK(memcmp(output, vector->Plain, vector->Length) == 0);
+    tag[0] ^= 0x01;
+    SIM_CHECK(SIM_Decrypt(&key, vector, output, tag) == AEAD_AUTH);
+    SIM_CHECK(memcmp(output, Zero, vector->Length) == 0);
+  }
+
+  /* CRYP lent: a run waits for CENG_Unlock(), the AEAD functions fail
+     while it is lent or a run is queued. FIPS-197 of a zero key and
+     block. */
+  SIM_CHECK(CENG_Setup(&ecb, CRYP_AlgoMode_AES_ECB, CRYP_AlgoDir_Encrypt, Zero, 128, 0) == CENG_OK);
+  SIM_CHECK(CENG_Lock() == CENG_OK);
+  SIM_CHECK(CENG_Lock() == CENG_BUSY);
+  SIM_CHECK(SIM_Encrypt(&key, &Vectors[0], output, tag) == AEAD_BUSY);
+  Done.Count = 0;
+  SIM_CHECK(CENG_Run(&ecb, Zero, Block, 16, SIM_Done, &Done) == CENG_OK);
+  SIM_CHECK(CENG_Run(&ecb, Zero, Block, 16, SIM_Done, &Done) == CENG_BUSY);
+  SIM_Poll();
+  SIM_CHECK((CENG_Busy(&ecb) == 1) && (Done.Count == 0));
+  CENG_Unlock();
+  SIM_Poll();
+  SIM_CHECK((Done.Count == 1) && (Done.Status == CENG_OK) && (CENG_Busy(&ecb) == 0));
+  SIM_CHECK(SIM_Hex(Block, "66e94bd4ef8a2c3b884cfa59ca342b2e", 16) != 0);
+
+  /* Given back: the key of the first vector is loaded again */
+  SIM_CHECK(AEAD_SetKey(&key, Vectors[0].Key, Vectors[0].KeyBits) == AEAD_OK);
+  SIM_CHECK(SIM_Encrypt(&key, &Vectors[0], output, tag) == AEAD_OK);
+  SIM_CHECK(memcmp(tag, Vectors[0].Tag, Vectors[0].TagLength) == 0);
+}
+
+/**
+  * @brief  Encrypts a vector in its mode
+  * @param  Key: key of the vector
+  * @param  Vector: vector
+  * @param  Output: Vector->Length bytes
+  * @param  Tag: Vector->TagLength bytes
+  * @retval Status of the function
+  */
+static uint32_t SIM_Encrypt(const AEAD_Key* Key, const SIM_Vector* Vector, uint8_t* Output,
+                            uint8_t* Tag)
+{
+  if (Vector->Ccm != 0)
+  {
+    return AEAD_CcmEncrypt(Key, Vector->Iv, Vector->IvLength, Vector->Aad, Vector->AadLength,
+                           Vector->Plain, Output, Vector->Length, Tag, Vector->TagLength);
+  }
+  return AEAD_GcmEncrypt(Key, Vector->Iv, Vector->IvLength, Vector->Aad, Vector->AadLength,
+                         Vector->Plain, Output, Vector->Length, Tag, Vector->TagLength);
+}
+
+/**
+  * @brief  Decrypts a vector in its mode
+  * @param  Key: key of the vector
+  * @param  Vector: vector
+  * @param  Output: Vector->Length bytes
+  * @param  Tag: Vector->TagLength bytes expected
+  * @retval Status of the function
+  */
+static uint32_t SIM_Decrypt(const AEAD_Key* Key, const SIM_Vector* Vector, uint8_t* Output,
+                            const uint8_t* Tag)
+{
+  if (Vector->Ccm != 0)
+  {
+    return AEAD_CcmDecrypt(Key, Vector->Iv, Vector->IvLength, Vector->Aad, Vector->AadLength,
+                           Vector->Cipher, Output, Vector->Length, Tag, Vector->TagLength);
+  }
+  return AEAD_GcmDecrypt(Key, Vector->Iv, Vector->IvLength, Vector->Aad, Vector->AadLength,
+                         Vector->Cipher, Output, Vector->Length, Tag, Vector->TagLength);
+}
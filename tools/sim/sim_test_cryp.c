@@ -0,0 +1,155 @@
+/**
+  ******************************************************************************
+  * @file    sim_test_cryp.c
+  * @brief   Host tests of cryp_engine.c: known answers, buffers of several
+  *          slices in one run and in pieces, decryption in place, buffers
+  *          the DMA can not take, sessions sharing the peripheral.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "sim_test.h"
+#include "cryp_engine.h"
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define SIM_CIPHER            2048
+
+/* Private variables ---------------------------------------------------------*/
+/* Static: the DMA takes 32-bit addresses */
+static uint32_t Plain[SIM_CIPHER / 4];
+static uint32_t Cipher[SIM_CIPHER / 4];
+static uint32_t Pieces[SIM_CIPHER / 4];
+static uint32_t Back[SIM_CIPHER / 4];
+static SIM_Calls Done;
+
+/* FIPS-197 C.1 */
+static const uint8_t AesKey[16] =
+{
+  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F
+};
+static const uint8_t AesPlain[16] =
+{
+  0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF
+};
+static const uint8_t AesCipher[16] =
+{
+  0x69, 0xC4, 0xE0, 0xD8, 0x6A, 0x7B, 0x04, 0x30, 0xD8, 0xCD, 0xB7, 0x80, 0x70, 0xB4, 0xC5, 0x5A
+};
+static const uint8_t AesIv[16] =
+{
+  0xF0, 0xE1, 0xD2, 0xC3, 0xB4, 0xA5, 0x96, 0x87, 0x78, 0x69, 0x5A, 0x4B, 0x3C, 0x2D, 0x1E, 0x0F
+};
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  CENG_Setup() and CENG_Run() on one session at a time
+  * @param  None
+  * @retval None
+  */
+void SIM_TestCryp(void)
+{
+  static CENG_Session encrypt, decrypt;
+  uint32_t i = 0;
+
+  SIM_CHECK(CENG_Init() == CENG_OK);
+
+  /* FIPS-197 C.1 both ways, then the same block in CBC from a zero IV */
+  SIM_CHECK(CENG_Setup(&encrypt, CRYP_AlgoMode_AES_ECB, CRYP_AlgoDir_Encrypt, AesKey, 128, 0) ==
+            CENG_OK);
+  memcpy(Plain, AesPlain, 16);
+  Done.Count = 0;
+  SIM_CHECK(CENG_Run(&encrypt, Plain, Cipher, 16, SIM_Done, &Done) == CENG_OK);
+  SIM_Poll();
+  SIM_CHECK((Done.Count == 1) && (Done.Status == CENG_OK) && (CENG_Busy(&encrypt) == 0));
+  SIM_CHECK(memcmp(Cipher, AesCipher, 16) == 0);
+  SIM_CHECK(CENG_Setup(&decrypt, CRYP_AlgoMode_AES_ECB, CRYP_AlgoDir_Decrypt, AesKey, 128, 0) ==
+            CENG_OK);
+  SIM_CHECK(CENG_Run(&decrypt, Cipher, Back, 16, 0, 0) == CENG_OK);
+  SIM_Poll();
+  SIM_CHECK(memcmp(Back, AesPlain, 16) == 0);
+  memset(Back, 0, 16);
+  SIM_CHECK(CENG_Setup(&encrypt, CRYP_AlgoMode_AES_CBC, CRYP_AlgoDir_Encrypt, AesKey, 128,
+                       (const uint8_t*)Back) == CENG_OK);
+  SIM_CHECK(CENG_Run(&encrypt, Plain, Cipher, 16, 0, 0) == CENG_OK);
+  SIM_Poll();
+  SIM_CHECK(memcmp(Cipher, AesCipher, 16) == 0);
+
+  /* Several slices, in one buffer and in two: the IV goes on */
+  for (i = 0; i < SIM_CIPHER / 4; i++)
+  {
+    Plain[i] = i * 0x9E3779B9;
+  }
+  SIM_CHECK(CENG_Setup(&encrypt, CRYP_AlgoMode_AES_CBC, CRYP_AlgoDir_Encrypt, AesKey, 128, AesIv) ==
+            CENG_OK);
+  SIM_CHECK(CENG_Run(&encrypt, Plain, Cipher, SIM_CIPHER, 0, 0) == CENG_OK);
+  SIM_Poll();
+  SIM_CHECK(CENG_Setup(&encrypt, CRYP_AlgoMode_AES_CBC, CRYP_AlgoDir_Encrypt, AesKey, 128, AesIv) ==
+            CENG_OK);
+  SIM_CHECK(CENG_Run(&encrypt, Plain, Pieces, 48, 0, 0) == CENG_OK);
+  SIM_Poll();
+  SIM_CHECK(CENG_Run(&encrypt, Plain + 12, Pieces + 12, SIM_CIPHER - 48, 0, 0) == CENG_OK);
+  SIM_Poll();
+  SIM_CHECK(memcmp(Cipher, Pieces, SIM_CIPHER) == 0);
+  SIM_CHECK(memcmp(Cipher, Plain, 16) != 0);
+
+  /* Decrypted in place */
+  SIM_CHECK(CENG_Setup(&decrypt, CRYP_AlgoMode_AES_CBC, CRYP_AlgoDir_Decrypt, AesKey, 128, AesIv) ==
+            CENG_OK);
+  SIM_CHECK(CENG_Run(&decrypt, Pieces, Pieces, SIM_CIPHER, 0, 0) == CENG_OK);
+  SIM_Poll();
+  SIM_CHECK(memcmp(Pieces, Plain, SIM_CIPHER) == 0);
+
+  /* Not whole blocks, not aligned */
+  SIM_CHECK(CENG_Run(&encrypt, Plain, Cipher, 20, 0, 0) == CENG_LENGTH);
+  SIM_CHECK(CENG_Run(&encrypt, Plain, (uint8_t*)Cipher + 2, 16, 0, 0) == CENG_LENGTH);
+  SIM_CHECK(CENG_Run(&encrypt, Plain, Cipher, 0, 0, 0) == CENG_LENGTH);
+  SIM_CHECK(CENG_Setup(&encrypt, CRYP_AlgoMode_AES_ECB, CRYP_AlgoDir_Encrypt, AesKey, 100, 0) ==
+            CENG_LENGTH);
+}
+
+/**
+  * @brief  CENG_Run() on two sessions queued together, CENG_GetStats()
+  * @param  None
+  * @retval None
+  */
+void SIM_TestCrypSessions(void)
+{
+  static CENG_Session encrypt, decrypt;
+  CENG_Stats stats;
+  uint32_t i = 0;
+
+  SIM_CHECK(CENG_Init() == CENG_OK);
+  for (i = 0; i < SIM_CIPHER / 4; i++)
+  {
+    Plain[i] = i * 0x9E3779B9;
+  }
+
+  /* One session: a run of several slices */
+  SIM_CHECK(CENG_Setup(&encrypt, CRYP_AlgoMode_AES_CBC, CRYP_AlgoDir_Encrypt, AesKey, 128, AesIv) ==
+            CENG_OK);
+  SIM_CHECK(CENG_Run(&encrypt, Plain, Cipher, SIM_CIPHER, 0, 0) == CENG_OK);
+  SIM_Poll();
+  CENG_GetStats(&encrypt, &stats);
+  SIM_CHECK((stats.Runs == 1) && (stats.Bytes == SIM_CIPHER) &&
+            (stats.Slices == SIM_CIPHER / CENG_SLICE_BYTES));
+
+  /* Two sessions queued together, their slices in turn: decrypted in place
+     while the other encrypts */
+  memcpy(Back, Cipher, SIM_CIPHER);
+  SIM_CHECK(CENG_Setup(&encrypt, CRYP_AlgoMode_AES_CBC, CRYP_AlgoDir_Encrypt, AesKey, 128, AesIv) ==
+            CENG_OK);
+  SIM_CHECK(CENG_Setup(&decrypt, CRYP_AlgoMode_AES_CBC, CRYP_AlgoDir_Decrypt, AesKey, 128, AesIv) ==
+            CENG_OK);
+  memset(Pieces, 0, SIM_CIPHER);
+  Done.Count = 0;
+  SIM_CHECK(CENG_Run(&encrypt, Plain, Pieces, SIM_CIPHER, SIM_Done, &Done) == CENG_OK);
+  SIM_CHECK(CENG_Run(&decrypt, Back, Back, SIM_CIPHER, SIM_Done, &Done) == CENG_OK);
+  SIM_Poll();
+  SIM_CHECK((Done.Count == 2) && (Done.Status == CENG_OK));
+  SIM_CHECK(memcmp(Back, Plain, SIM_CIPHER) == 0);
+  SIM_CHECK(memcmp(Pieces, Cipher, SIM_CIPHER) == 0);
+  CENG_GetStats(&decrypt, &stats);
+  SIM_CHECK((stats.Runs == 1) && (stats.Slices == SIM_CIPHER / CENG_SLICE_BYTES));
+}
@@ -0,0 +1,178 @@
+/**
+  ******************************************************************************
+  * @file    sim_test_dma.c
+  * @brief   Host tests of dma_manager.c and dma_mem.c: the streams handed
+  *          out per request and refused once taken, copies and fills by the
+  *          DMA with their unaligned ends, those left to the processor.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "sim_test.h"
+#include "dma_manager.h"
+#include "dma_mem.h"
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define SIM_BUFFER            8192
+#define SIM_MEM_STREAMS       8
+
+/* Private variables ---------------------------------------------------------*/
+/* Static: the DMA takes 32-bit addresses */
+static uint8_t Source[SIM_BUFFER] __attribute__((aligned(16)));
+static uint8_t Destination[SIM_BUFFER] __attribute__((aligned(16)));
+static SIM_Calls Done;
+
+/* Private function prototypes -----------------------------------------------*/
+static uint32_t SIM_Copied(uint32_t Offset, uint32_t Length);
+static uint32_t SIM_Filled(uint32_t Offset, uint32_t Length, uint8_t Value);
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  DMAM_Alloc(), DMAM_Free() and DMAM_GetUsage()
+  * @param  None
+  * @retval None
+  */
+void SIM_TestDmaManager(void)
+{
+  const DMAM_Stream* streams[SIM_MEM_STREAMS];
+  const DMAM_Stream* stream = 0;
+  DMAM_Usage usage;
+  uint32_t i = 0;
+
+  /* USART1_TX has one stream */
+  stream = DMAM_Alloc(DMAM_USART1_TX, 0, 0);
+  SIM_CHECK((stream != 0) && (stream->Stream == DMA2_Stream7) && (stream->Channel == DMA_Channel_4) &&
+            (stream->IRQn == DMA2_Stream7_IRQn));
+  SIM_CHECK(DMAM_Alloc(DMAM_USART1_TX, 0, 0) == 0);
+  SIM_CHECK(DMAM_Alloc(DMAM_HASH_IN, 0, 0) == 0);
+  DMAM_GetUsage(&usage);
+  SIM_CHECK((usage.Allocated == (1u << 15)) && (usage.Refused == 2));
+  DMAM_Free(stream);
+  stream = DMAM_Alloc(DMAM_HASH_IN, 0, 0);
+  SIM_CHECK((stream != 0) && (stream->Stream == DMA2_Stream7) && (stream->Channel == DMA_Channel_2));
+  DMAM_Free(stream);
+
+  /* USART1_RX leaves stream 5 to CRYP_OUT while it can */
+  stream = DMAM_Alloc(DMAM_USART1_RX, 0, 0);
+  SIM_CHECK((stream != 0) && (stream->Stream == DMA2_Stream2));
+  SIM_CHECK(DMAM_Alloc(DMAM_CRYP_OUT, 0, 0) != 0);
+  SIM_CHECK(DMAM_Alloc(DMAM_USART1_RX, 0, 0) == 0);
+
+  /* Memory to memory on any DMA2 stream left */
+  for (i = 0; i < SIM_MEM_STREAMS; i++)
+  {
+    streams[i] = DMAM_Alloc(DMAM_MEM, 0, 0);
+  }
+  SIM_CHECK((streams[0] != 0) && (streams[0]->Stream == DMA2_Stream1));
+  SIM_CHECK((streams[5] != 0) && (streams[6] == 0) && (streams[7] == 0));
+  DMAM_GetUsage(&usage);
+  SIM_CHECK(usage.Allocated == 0xFF00);
+  for (i = 0; i < SIM_MEM_STREAMS; i++)
+  {
+    if (streams[i] != 0)
+    {
+      DMAM_Free(streams[i]);
+    }
+  }
+  DMAM_GetUsage(&usage);
+  SIM_CHECK(usage.Allocated == ((1u << 10) | (1u << 13)));
+}
+
+/**
+  * @brief  DMEM_Init(), DMEM_Copy() and DMEM_Fill()
+  * @param  None
+  * @retval None
+  */
+void SIM_TestDmaMem(void)
+{
+  DMAM_Usage usage;
+  uint32_t i = 0;
+
+  for (i = 0; i < SIM_BUFFER; i++)
+  {
+    Source[i] = (uint8_t)((i * 0x9E3779B9) >> 17);
+  }
+  SIM_CHECK(DMEM_Init() == 0);
+  /* Measured on the host clock: a multiple of a word, the stream idle */
+  SIM_CHECK(((DMEM_GetThreshold() & 3) == 0) && (DMEM_Busy() == 0));
+  DMEM_SetThreshold(DMEM_THRESHOLD);
+
+  /* Whole bursts: done in the stream interrupt, busy until then */
+  Done.Count = 0;
+  SIM_CHECK(DMEM_Copy(Destination, Source, 4096, SIM_Done, &Done) == 0);
+  SIM_CHECK((DMEM_Busy() == 1) && (Done.Count == 0));
+  SIM_CHECK(DMEM_Copy(Destination, Source, 4096, SIM_Done, &Done) == 1);
+  SIM_CHECK(DMEM_Fill(Destination, 0, 4096, SIM_Done, &Done) == 1);
+  SIM_Poll();
+  SIM_CHECK((Done.Count == 1) && (Done.Status == 0) && (DMEM_Busy() == 0));
+  SIM_CHECK(SIM_Copied(0, 4096) != 0);
+
+  /* Unaligned ends around the words of the stream */
+  memset(Destination, 0, SIM_BUFFER);
+  Done.Count = 0;
+  SIM_CHECK(DMEM_Copy(Destination + 1, Source + 1, 1001, SIM_Done, &Done) == 0);
+  SIM_Poll();
+  SIM_CHECK((Done.Count == 1) && SIM_Copied(1, 1001) && SIM_Filled(0, 1, 0) && SIM_Filled(1002, 16, 0));
+
+  Done.Count = 0;
+  SIM_CHECK(DMEM_Fill(Destination + 3, 0x5A, 3001, SIM_Done, &Done) == 0);
+  SIM_CHECK(DMEM_Busy() == 1);
+  SIM_Poll();
+  SIM_CHECK((Done.Count == 1) && SIM_Filled(3, 3001, 0x5A) && SIM_Filled(3004, 16, 0));
+  SIM_CHECK(SIM_Copied(1, 2));
+
+  /* Different alignments, or under the threshold: the processor copies
+     and calls back before returning */
+  memset(Destination, 0, SIM_BUFFER);
+  Done.Count = 0;
+  SIM_CHECK(DMEM_Copy(Destination + 1, Source + 2, 2000, SIM_Done, &Done) == 0);
+  SIM_CHECK((Done.Count == 1) && (DMEM_Busy() == 0));
+  SIM_CHECK(memcmp(Destination + 1, Source + 2, 2000) == 0);
+  SIM_CHECK(DMEM_Copy(Destination, Source, DMEM_THRESHOLD - 1, SIM_Done, &Done) == 0);
+  SIM_CHECK((Done.Count == 2) && (DMEM_Busy() == 0));
+
+  /* Threshold 0: a word goes to the stream */
+  DMEM_SetThreshold(0);
+  memset(Destination, 0, SIM_BUFFER);
+  SIM_CHECK(DMEM_Copy(Destination + 4, Source + 4, 4, 0, 0) == 0);
+  SIM_CHECK(DMEM_Busy() == 1);
+  SIM_Poll();
+  SIM_CHECK((DMEM_Busy() == 0) && SIM_Copied(4, 4) && SIM_Filled(8, 4, 0));
+
+  DMAM_GetUsage(&usage);
+  SIM_CHECK(usage.Interrupts[9] == 4);
+}
+
+/**
+  * @brief  Whether Destination holds Source over a range
+  * @param  Offset: first byte
+  * @param  Length: bytes
+  * @retval 1 if it does, 0 otherwise
+  */
+static uint32_t SIM_Copied(uint32_t Offset, uint32_t Length)
+{
+  return (memcmp(Destination + Offset, Source + Offset, Length) == 0) ? 1 : 0;
+}
+
+/**
+  * @brief  Whether Destination holds a value over a range
+  * @param  Offset: first byte
+  * @param  Length: bytes
+  * @param  Value: byte expected
+  * @retval 1 if it does, 0 otherwise
+  */
+static uint32_t SIM_Filled(uint32_t Offset, uint32_t Length, uint8_t Value)
+{
+  uint32_t i = 0;
+
+  for (i = 0; i < Length; i++)
+  {
+    if (Destination[Offset + i] != Value)
+    {
+      return 0;
+    }
+  }
+  return 1;
+}
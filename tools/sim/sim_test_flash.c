@@ -0,0 +1,160 @@
+/**
+  ******************************************************************************
+  * @file    sim_test_flash.c
+  * @brief   Host tests of flash_if.c: the interrupt driven erase with its
+  *          blank check, programming by block and its failures.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "sim_test.h"
+#include "flash_if.h"
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define SIM_WORDS             512
+#define SIM_FLASH_ERRORS      (FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR | FLASH_FLAG_PGAERR | \
+                               FLASH_FLAG_PGPERR | FLASH_FLAG_PGSERR)
+
+/* Private variables ---------------------------------------------------------*/
+static uint32_t Words[SIM_WORDS];
+static volatile uint32_t Erased;
+
+/* Private function prototypes -----------------------------------------------*/
+static void SIM_Erased(uint32_t Status);
+static uint32_t SIM_Blank(uint32_t Address, uint32_t Length);
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  FLASH_If_EraseStart()
+  * @param  None
+  * @retval None
+  */
+void SIM_TestFlashErase(void)
+{
+  uint32_t* optcr = SIM_Register((uint32_t)&FLASH->OPTCR);
+
+  FLASH_If_Init();
+  NVIC_EnableIRQ(FLASH_IRQn);
+
+  /* Slot B: sectors 8 and 10 written, sector 9 blank and protected. The
+     blank sector is skipped, so its protection does not matter. */
+  SIM_CHECK(FLASH_ProgramWord(SLOT_B_ADDRESS + 0x100, 0x12345678) == FLASH_COMPLETE);
+  SIM_CHECK(FLASH_ProgramWord(ADDR_FLASH_SECTOR_10, 0) == FLASH_COMPLETE);
+  *optcr &= ~SIM_NWRP(9);
+  Erased = 0;
+  SIM_CHECK(FLASH_If_EraseStart(SLOT_B_ADDRESS, SLOT_SIZE, SIM_Erased) == 0);
+  SIM_CHECK(FLASH_If_EraseBusy() == 1);
+  SIM_CHECK(FLASH_If_EraseStart(SLOT_B_ADDRESS, SLOT_SIZE, SIM_Erased) == 1);
+  SIM_Poll();
+  SIM_CHECK(Erased == 1);
+  SIM_CHECK(FLASH_If_EraseBusy() == 0);
+  SIM_CHECK(SIM_Blank(SLOT_B_ADDRESS, SLOT_SIZE) != 0);
+
+  /* Only the last word of the protected sector is written: the blank check
+     goes through every chunk, one FLASH interrupt each, then the erase
+     fails and the word stays */
+  *optcr |= SIM_NWRP(9);
+  SIM_CHECK(FLASH_ProgramWord(ADDR_FLASH_SECTOR_10 - 4, 0x5A5A5A5A) == FLASH_COMPLETE);
+  *optcr &= ~SIM_NWRP(9);
+  Erased = 0;
+  SIM_CHECK(FLASH_If_EraseStart(ADDR_FLASH_SECTOR_9, ADDR_FLASH_SECTOR_10 - ADDR_FLASH_SECTOR_9,
+                                SIM_Erased) == 0);
+  SIM_CHECK(FLASH_If_EraseBusy() == 1);
+  SIM_Poll();
+  SIM_CHECK(Erased == 2);
+  SIM_CHECK(*(const uint32_t*)(ADDR_FLASH_SECTOR_10 - 4) == 0x5A5A5A5A);
+  SIM_CHECK((FLASH->SR & SIM_FLASH_ERRORS) == 0);
+
+  /* Nothing to erase: the blank sectors are only read */
+  Erased = 0;
+  SIM_CHECK(FLASH_If_EraseStart(ADDR_FLASH_SECTOR_6, 1, SIM_Erased) == 0);
+  SIM_Poll();
+  SIM_CHECK(Erased == 1);
+
+  /* Outside the flash */
+  SIM_CHECK(FLASH_If_EraseStart(USER_FLASH_END_ADDRESS - 3, 8, SIM_Erased) == 1);
+  SIM_CHECK(FLASH_If_EraseStart(SLOT_A_ADDRESS, 0, SIM_Erased) == 1);
+  SIM_CHECK(FLASH_If_EraseBusy() == 0);
+}
+
+/**
+  * @brief  FLASH_If_WriteBlock()
+  * @param  None
+  * @retval None
+  */
+void SIM_TestFlashWrite(void)
+{
+  uint32_t* optcr = SIM_Register((uint32_t)&FLASH->OPTCR);
+  __IO uint32_t address = 0;
+  uint32_t i = 0;
+
+  FLASH_If_Init();
+  for (i = 0; i < SIM_WORDS; i++)
+  {
+    Words[i] = i * 0x9E3779B9;
+  }
+
+  /* One programming sequence, one CRC check */
+  address = SLOT_B_ADDRESS;
+  SIM_CHECK(FLASH_If_WriteBlock(&address, Words, SIM_WORDS) == 0);
+  SIM_CHECK(address == SLOT_B_ADDRESS + sizeof(Words));
+  SIM_CHECK(memcmp((const void*)SLOT_B_ADDRESS, Words, sizeof(Words)) == 0);
+
+  /* Bits only go from 1 to 0: the CRC tells the flash differs */
+  for (i = 0; i < SIM_WORDS; i++)
+  {
+    Words[i] = ~Words[i];
+  }
+  address = SLOT_B_ADDRESS;
+  SIM_CHECK(FLASH_If_WriteBlock(&address, Words, SIM_WORDS) == 2);
+  SIM_CHECK(address == SLOT_B_ADDRESS);
+
+  /* A protected sector fails, its error flags are cleared for the next write */
+  *optcr &= ~SIM_NWRP(9);
+  address = ADDR_FLASH_SECTOR_9;
+  SIM_CHECK(FLASH_If_WriteBlock(&address, Words, 16) == 1);
+  SIM_CHECK((FLASH->SR & SIM_FLASH_ERRORS) == 0);
+  SIM_CHECK(SIM_Blank(ADDR_FLASH_SECTOR_9, 64) != 0);
+  address = ADDR_FLASH_SECTOR_10;
+  SIM_CHECK(FLASH_If_WriteBlock(&address, Words, 16) == 0);
+  SIM_CHECK(memcmp((const void*)ADDR_FLASH_SECTOR_10, Words, 64) == 0);
+
+  /* Past the end of the flash, or nothing to write */
+  address = USER_FLASH_END_ADDRESS + 1 - 8;
+  SIM_CHECK(FLASH_If_WriteBlock(&address, Words, 4) == 1);
+  SIM_CHECK(FLASH_If_WriteBlock(&address, Words, 0) == 1);
+  SIM_CHECK(FLASH_If_WriteBlock(&address, Words, 2) == 0);
+}
+
+/**
+  * @brief  End of an erase, from the FLASH interrupt
+  * @param  Status: 0 on success
+  * @retval None
+  */
+static void SIM_Erased(uint32_t Status)
+{
+  Erased = Status + 1;
+}
+
+/**
+  * @brief  Whether an area of the flash is erased
+  * @param  Address: first byte
+  * @param  Length: bytes
+  * @retval 1 if every byte is 0xFF, 0 otherwise
+  */
+static uint32_t SIM_Blank(uint32_t Address, uint32_t Length)
+{
+  const uint8_t* flash = (const uint8_t*)Address;
+  uint32_t i = 0;
+
+  for (i = 0; i < Length; i++)
+  {
+    if (flash[i] != 0xFF)
+    {
+      return 0;
+    }
+  }
+  return 1;
+}
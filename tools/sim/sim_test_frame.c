@@ -0,0 +1,251 @@
+/**
+  ******************************************************************************
+  * @file    sim_test_frame.c
+  * @brief   Host tests of iap_frame.c, the board side of the framed link:
+  *          lost, corrupted, reordered, repeated frames and frames past the
+  *          window, the selective acknowledgement bitmap, the reply bytes
+  *          sent again until the host confirms them. The CRC is the one of
+  *          the CRC unit, as on the board.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "sim_test.h"
+#include "iap_frame.h"
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define SIM_PAYLOAD           40
+#define SIM_DELIVERED_MAX     32
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  uint32_t Count;       /* FRAME_ACK frames sent */
+  uint32_t Valid;       /* the last one has a good header and CRC */
+  uint16_t Seq;
+  uint16_t Replied;
+  uint32_t Bitmap;
+  uint32_t Replies;     /* reply bytes it carries */
+  uint8_t Reply[FRAME_REPLY_SIZE];
+} SIM_Ack;
+
+/* Private variables ---------------------------------------------------------*/
+static FRAME_Link Link;
+static SIM_Ack Ack;
+static uint32_t Frame[FRAME_SIZE_MAX / 4];
+static uint8_t Delivered[SIM_DELIVERED_MAX];
+static uint32_t DeliveredCount;
+static uint32_t DeliverErrors;
+
+/* Private function prototypes -----------------------------------------------*/
+static uint32_t SIM_Crc(const uint32_t* Data, uint32_t Words);
+static void SIM_Send(const uint8_t* Data, uint32_t Length);
+static void SIM_Deliver(uint32_t Type, const uint32_t* Data, uint32_t Length);
+static uint32_t SIM_Frame(uint8_t Type, uint16_t Seq, uint16_t Acked, uint32_t Length);
+static void SIM_Host(uint8_t Type, uint16_t Seq, uint16_t Acked);
+static uint32_t SIM_Delivered(const uint8_t* Seqs, uint32_t Count);
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  FRAME_Receive(), FRAME_Reply() and the FRAME_ACK frames
+  * @param  None
+  * @retval None
+  */
+void SIM_TestFrame(void)
+{
+  static const uint8_t order[] = {0, 1, 2, 3, 4, 5, 6};
+  static const uint8_t garbage[] = {0x00, 0x55, 0x7F, 0xFF};
+  uint32_t length = 0, i = 0, count = 0;
+
+  RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_CRC, ENABLE);
+  FRAME_Init(&Link, SIM_Crc, SIM_Send, SIM_Deliver);
+
+  /* In order */
+  SIM_Host(FRAME_DATA, 0, 0);
+  SIM_CHECK(SIM_Delivered(order, 1) != 0);
+  SIM_CHECK((Ack.Count == 1) && (Ack.Valid != 0) && (Ack.Seq == 1) && (Ack.Bitmap == 0));
+
+  /* Frame 1 lost, 2 and 3 held and acknowledged in the bitmap */
+  SIM_Host(FRAME_CMD, 2, 0);
+  SIM_Host(FRAME_DATA, 3, 0);
+  SIM_CHECK(SIM_Delivered(order, 1) != 0);
+  SIM_CHECK((Ack.Count == 3) && (Ack.Seq == 1) && (Ack.Bitmap == 0x03));
+
+  /* Frame 1 corrupted: dropped without an answer */
+  length = SIM_Frame(FRAME_DATA, 1, 0, SIM_PAYLOAD);
+  ((uint8_t*)Frame)[FRAME_HEADER_SIZE + 3] ^= 0x10;
+  FRAME_Receive(&Link, (const uint8_t*)Frame, length);
+  SIM_CHECK(Ack.Count == 3);
+
+  /* Frame 5 after a gap */
+  SIM_Host(FRAME_DATA, 5, 0);
+  SIM_CHECK((Ack.Seq == 1) && (Ack.Bitmap == 0x0B));
+
+  /* Frame 1 again: 1, 2 and 3 handed over in order, with the reply of the
+     command of frame 2 */
+  SIM_Host(FRAME_DATA, 1, 0);
+  SIM_CHECK(SIM_Delivered(order, 4) != 0);
+  SIM_CHECK((Ack.Seq == 4) && (Ack.Bitmap == 0x01));
+  SIM_CHECK((Ack.Replied == 1) && (Ack.Replies == 1) && (Ack.Reply[0] == 0x42));
+
+  /* Its FRAME_ACK lost: frame 2 again is not handed over again, the reply
+     is sent again until the host confirms it */
+  SIM_Host(FRAME_CMD, 2, 0);
+  SIM_CHECK(SIM_Delivered(order, 4) != 0);
+  SIM_CHECK((Ack.Seq == 4) && (Ack.Replies == 1) && (Ack.Reply[0] == 0x42));
+
+  /* Past the window: dropped */
+  SIM_Host(FRAME_DATA, 4 + FRAME_WINDOW, 1);
+  SIM_CHECK((Ack.Seq == 4) && (Ack.Bitmap == 0x01) && (Ack.Replies == 0));
+
+  /* Frame 4: 4 and 5 handed over */
+  SIM_Host(FRAME_DATA, 4, 1);
+  SIM_CHECK(SIM_Delivered(order, 6) != 0);
+  SIM_CHECK((Ack.Seq == 6) && (Ack.Bitmap == 0));
+
+  /* A reply outside FRAME_Receive() goes at once; a poll gets an answer */
+  count = Ack.Count;
+  FRAME_Reply(&Link, 0x99);
+  SIM_CHECK((Ack.Count == count + 1) && (Ack.Replied == 2) && (Ack.Replies == 1) &&
+            (Ack.Reply[0] == 0x99));
+  SIM_Host(FRAME_POLL, 0, 2);
+  SIM_CHECK((Ack.Count == count + 2) && (Ack.Seq == 6) && (Ack.Replies == 0));
+  SIM_CHECK(SIM_Delivered(order, 6) != 0);
+
+  /* Bytes outside a frame skipped, a frame given byte by byte */
+  FRAME_Receive(&Link, garbage, sizeof(garbage));
+  length = SIM_Frame(FRAME_DATA, 6, 2, SIM_PAYLOAD);
+  for (i = 0; i < length; i++)
+  {
+    FRAME_Receive(&Link, (const uint8_t*)Frame + i, 1);
+  }
+  SIM_CHECK(SIM_Delivered(order, 7) != 0);
+  SIM_CHECK((Ack.Seq == 7) && (Ack.Valid != 0));
+  SIM_CHECK(DeliverErrors == 0);
+}
+
+/**
+  * @brief  CRC unit value over words, as the firmware gives it
+  * @param  Data: words
+  * @param  Words: number of words
+  * @retval CRC
+  */
+static uint32_t SIM_Crc(const uint32_t* Data, uint32_t Words)
+{
+  CRC_ResetDR();
+  return CRC_CalcBlockCRC((uint32_t*)Data, Words);
+}
+
+/**
+  * @brief  FRAME_ACK sent by the link, decoded into Ack
+  * @param  Data: frame
+  * @param  Length: bytes
+  * @retval None
+  */
+static void SIM_Send(const uint8_t* Data, uint32_t Length)
+{
+  static uint32_t words[FRAME_SIZE_MAX / 4];
+  const uint8_t* payload = Data + FRAME_HEADER_SIZE;
+  uint32_t size = Data[4] | (Data[5] << 8);
+
+  memcpy(words, Data, Length);
+  Ack.Count++;
+  Ack.Valid = ((Length % 4) == 0) && (Data[0] == FRAME_MAGIC) && (Data[1] == FRAME_ACK) &&
+              (size >= 4) && (Length == ((FRAME_HEADER_SIZE + size + 3) & ~3u) + 4) &&
+              (SIM_Crc(words, Length / 4 - 1) == words[Length / 4 - 1]);
+  Ack.Seq = Data[2] | (Data[3] << 8);
+  Ack.Replied = Data[6] | (Data[7] << 8);
+  Ack.Bitmap = payload[0] | (payload[1] << 8) | (payload[2] << 16) | ((uint32_t)payload[3] << 24);
+  Ack.Replies = (size >= 4) ? (size - 4) : 0;
+  memcpy(Ack.Reply, payload + 4, (Ack.Replies < FRAME_REPLY_SIZE) ? Ack.Replies : FRAME_REPLY_SIZE);
+}
+
+/**
+  * @brief  Payload handed over: its first byte is the sequence number. A
+  *         FRAME_CMD is answered with one reply byte.
+  * @param  Type: FRAME_CMD or FRAME_DATA
+  * @param  Data: payload
+  * @param  Length: bytes
+  * @retval None
+  */
+static void SIM_Deliver(uint32_t Type, const uint32_t* Data, uint32_t Length)
+{
+  const uint8_t* bytes = (const uint8_t*)Data;
+  uint32_t i = 0;
+
+  for (i = 1; i < Length; i++)
+  {
+    if (bytes[i] != (uint8_t)(bytes[0] + i))
+    {
+      DeliverErrors++;
+    }
+  }
+  if ((Length != SIM_PAYLOAD) || (DeliveredCount == SIM_DELIVERED_MAX))
+  {
+    DeliverErrors++;
+    return;
+  }
+  Delivered[DeliveredCount++] = bytes[0];
+  if (Type == FRAME_CMD)
+  {
+    FRAME_Reply(&Link, 0x40 | bytes[0]);
+  }
+}
+
+/**
+  * @brief  Builds a host frame in Frame, the payload numbered from Seq
+  * @param  Type: FRAME_CMD, FRAME_DATA or FRAME_POLL
+  * @param  Seq: sequence number
+  * @param  Acked: reply bytes received
+  * @param  Length: payload bytes
+  * @retval Frame length in bytes
+  */
+static uint32_t SIM_Frame(uint8_t Type, uint16_t Seq, uint16_t Acked, uint32_t Length)
+{
+  uint8_t* bytes = (uint8_t*)Frame;
+  uint32_t words = (FRAME_HEADER_SIZE + Length + 3) / 4;
+  uint32_t i = 0;
+
+  memset(Frame, 0xFF, sizeof(Frame));
+  bytes[0] = FRAME_MAGIC;
+  bytes[1] = Type;
+  bytes[2] = (uint8_t)Seq;
+  bytes[3] = (uint8_t)(Seq >> 8);
+  bytes[4] = (uint8_t)Length;
+  bytes[5] = (uint8_t)(Length >> 8);
+  bytes[6] = (uint8_t)Acked;
+  bytes[7] = (uint8_t)(Acked >> 8);
+  for (i = 0; i < Length; i++)
+  {
+    bytes[FRAME_HEADER_SIZE + i] = (uint8_t)(Seq + i);
+  }
+  Frame[words] = SIM_Crc(Frame, words);
+  return (words + 1) * 4;
+}
+
+/**
+  * @brief  Sends a host frame to the link in one piece
+  * @param  Type: FRAME_CMD, FRAME_DATA or FRAME_POLL
+  * @param  Seq: sequence number
+  * @param  Acked: reply bytes received
+  * @retval None
+  */
+static void SIM_Host(uint8_t Type, uint16_t Seq, uint16_t Acked)
+{
+  uint32_t length = SIM_Frame(Type, Seq, Acked, (Type == FRAME_POLL) ? 0 : SIM_PAYLOAD);
+
+  FRAME_Receive(&Link, (const uint8_t*)Frame, length);
+}
+
+/**
+  * @brief  Whether the payloads handed over are those expected, in order
+  * @param  Seqs: sequence numbers expected
+  * @param  Count: number of payloads expected
+  * @retval 1 if they are, 0 otherwise
+  */
+static uint32_t SIM_Delivered(const uint8_t* Seqs, uint32_t Count)
+{
+  return ((DeliveredCount == Count) && (memcmp(Delivered, Seqs, Count) == 0)) ? 1 : 0;
+}
@@ -0,0 +1,130 @@
+/**
+  ******************************************************************************
+  * @file    sim_test_hash.c
+  * @brief   Host tests of hash_engine.c and hmac_key.c: known answers,
+  *          messages in pieces, contexts sharing the peripheral, the
+  *          peripheral lent.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "sim_test.h"
+#include "hash_engine.h"
+#include "hmac_key.h"
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define SIM_MESSAGE           1000
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t Message[SIM_MESSAGE];
+static SIM_Calls Done;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  HENG_Update() and HENG_Final()
+  * @param  None
+  * @retval None
+  */
+void SIM_TestHash(void)
+{
+  static HENG_Context sha1, md5;
+  uint8_t digest[HENG_SHA1_SIZE], other[HENG_MD5_SIZE];
+  uint32_t i = 0, offset = 0, piece = 0;
+
+  HENG_Init();
+
+  /* FIPS 180-2 and RFC 1321, "abc" in two pieces */
+  HENG_Begin(&sha1, HASH_AlgoSelection_SHA1);
+  SIM_CHECK(HENG_Update(&sha1, "a", 1, 0, 0) == 0);
+  SIM_Poll();
+  SIM_CHECK(HENG_Final(&sha1, "bc", 2, digest, SIM_Done, &Done) == 0);
+  SIM_Poll();
+  SIM_CHECK((Done.Count == 1) && (HENG_Busy(&sha1) == 0));
+  SIM_CHECK(SIM_Hex(digest, "a9993e364706816aba3e25717850c26c9cd0d89d", HENG_SHA1_SIZE) != 0);
+  HENG_Begin(&md5, HASH_AlgoSelection_MD5);
+  SIM_CHECK(HENG_Final(&md5, "abc", 3, digest, 0, 0) == 0);
+  SIM_Poll();
+  SIM_CHECK(SIM_Hex(digest, "900150983cd24fb0d6963f7d28e17f72", HENG_MD5_SIZE) != 0);
+
+  /* Two messages over several blocks, their pieces of 1 to 97 bytes taken
+     in turn: each context saved and restored around the other. The model
+     takes the interrupts as soon as the driver unmasks them, so a piece is
+     over when HENG_Update() returns. */
+  for (i = 0; i < SIM_MESSAGE; i++)
+  {
+    Message[i] = (uint8_t)(i * 7 + 3);
+  }
+  HENG_Begin(&sha1, HASH_AlgoSelection_SHA1);
+  HENG_Begin(&md5, HASH_AlgoSelection_MD5);
+  for (offset = 0; offset < SIM_MESSAGE; offset += piece)
+  {
+    piece = (offset % 97) + 1;
+    if (offset + piece > SIM_MESSAGE)
+    {
+      piece = SIM_MESSAGE - offset;
+    }
+    SIM_CHECK(HENG_Update(&sha1, Message + offset, piece, 0, 0) == 0);
+    SIM_CHECK(HENG_Update(&md5, Message + offset, piece, 0, 0) == 0);
+  }
+  SIM_CHECK(HENG_Final(&sha1, 0, 0, digest, 0, 0) == 0);
+  SIM_CHECK(HENG_Final(&md5, 0, 0, other, 0, 0) == 0);
+  SIM_Poll();
+  SIM_CHECK(SIM_Hex(digest, "4231a8a50a10fa9758db8ec71fdef855b751048a", HENG_SHA1_SIZE) != 0);
+  SIM_CHECK(SIM_Hex(other, "10046f077f2082ac19676b8079f1cb1a", HENG_MD5_SIZE) != 0);
+}
+
+/**
+  * @brief  HKEY_Init(), HKEY_Mac(), HENG_Lock() and HENG_Unlock()
+  * @param  None
+  * @retval None
+  */
+void SIM_TestHmac(void)
+{
+  static HENG_Context sha1;
+  HKEY_Context hmac;
+  uint8_t digest[HENG_SHA1_SIZE], key[80];
+  uint32_t i = 0;
+
+  HENG_Init();
+
+  /* RFC 2202 cases 1 and 6, case 1 twice from the same key */
+  memset(key, 0x0B, 20);
+  SIM_CHECK(HKEY_Init(&hmac, HASH_AlgoSelection_SHA1, key, 20) == HKEY_OK);
+  for (i = 0; i < 2; i++)
+  {
+    memset(digest, 0, sizeof(digest));
+    SIM_CHECK(HKEY_Mac(&hmac, (const uint8_t*)"Hi There", 8, digest) == HKEY_OK);
+    SIM_CHECK(SIM_Hex(digest, "b617318655057264e28bc0b6fb378c8ef146be00", HENG_SHA1_SIZE) != 0);
+  }
+  SIM_CHECK(HKEY_Init(&hmac, HASH_AlgoSelection_MD5, key, 16) == HKEY_OK);
+  SIM_CHECK(HKEY_Mac(&hmac, (const uint8_t*)"Hi There", 8, digest) == HKEY_OK);
+  SIM_CHECK(SIM_Hex(digest, "9294727a3638bb1c13f48ef8158bfc9d", HENG_MD5_SIZE) != 0);
+  memset(key, 0xAA, 80);
+  SIM_CHECK(HKEY_Init(&hmac, HASH_AlgoSelection_SHA1, key, 80) == HKEY_OK);
+  SIM_CHECK(HKEY_Mac(&hmac, (const uint8_t*)"Test Using Larger Than Block-Size Key - Hash Key First",
+                     54, digest) == HKEY_OK);
+  SIM_CHECK(SIM_Hex(digest, "aa4ae5e15272d00e95705637ce8a3b55ed402112", HENG_SHA1_SIZE) != 0);
+
+  /* Peripheral lent: the pieces wait for HENG_Unlock(), HKEY_Init() and
+     HKEY_Mac() do not take it */
+  for (i = 0; i < SIM_MESSAGE; i++)
+  {
+    Message[i] = (uint8_t)(i * 7 + 3);
+  }
+  SIM_CHECK(HENG_Lock() == 0);
+  SIM_CHECK(HENG_Lock() == 1);
+  SIM_CHECK(HKEY_Init(&hmac, HASH_AlgoSelection_SHA1, key, 20) == HKEY_BUSY);
+  SIM_CHECK(HKEY_Mac(&hmac, (const uint8_t*)"abc", 3, digest) == HKEY_BUSY);
+  HENG_Begin(&sha1, HASH_AlgoSelection_SHA1);
+  Done.Count = 0;
+  SIM_CHECK(HENG_Final(&sha1, Message, SIM_MESSAGE, digest, SIM_Done, &Done) == 0);
+  SIM_CHECK(HENG_Final(&sha1, Message, SIM_MESSAGE, digest, SIM_Done, &Done) == 1);
+  SIM_Poll();
+  SIM_CHECK((HENG_Busy(&sha1) == 1) && (Done.Count == 0));
+  HENG_Unlock();
+  SIM_Poll();
+  SIM_CHECK((HENG_Busy(&sha1) == 0) && (Done.Count == 1));
+  SIM_CHECK(SIM_Hex(digest, "4231a8a50a10fa9758db8ec71fdef855b751048a", HENG_SHA1_SIZE) != 0);
+}
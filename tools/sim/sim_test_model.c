@@ -0,0 +1,147 @@
+/**
+  ******************************************************************************
+  * @file    sim_test_model.c
+  * @brief   Host tests of the register model itself, through the StdPeriph
+  *          drivers: the flash and its errors, the CRC, a memory to memory
+  *          DMA transfer, the bytes sent by a USART, the HASH and the AES
+  *          of the CRYP on known answers.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "sim_test.h"
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define SIM_WORD_ADDRESS      0x08080000
+#define SIM_DMA_WORDS         64
+#define SIM_SENT_MAX          16
+
+/* Private variables ---------------------------------------------------------*/
+/* Static: the DMA, and the StdPeriph HASH and CRYP functions, take 32-bit
+   addresses */
+static uint32_t Source[SIM_DMA_WORDS];
+static uint32_t Destination[SIM_DMA_WORDS];
+static uint8_t Digest[20];
+static uint8_t Cipher[16];
+static uint8_t Sent[SIM_SENT_MAX];
+static volatile uint32_t SentCount;
+
+/* FIPS-197 C.1 */
+static const uint8_t AesKey[16] =
+{
+  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F
+};
+static const uint8_t AesPlain[16] =
+{
+  0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF
+};
+static const uint8_t AesCipher[16] =
+{
+  0x69, 0xC4, 0xE0, 0xD8, 0x6A, 0x7B, 0x04, 0x30, 0xD8, 0xCD, 0xB7, 0x80, 0x70, 0xB4, 0xC5, 0x5A
+};
+
+/* Private function prototypes -----------------------------------------------*/
+static void SIM_Sent(const uint8_t* Data, uint32_t Length);
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  FLASH, CRC, DMA, USART, HASH and CRYP models
+  * @param  None
+  * @retval None
+  */
+void SIM_TestModel(void)
+{
+  uint32_t* optcr = SIM_Register((uint32_t)&FLASH->OPTCR);
+  const uint32_t* word = (const uint32_t*)SIM_WORD_ADDRESS;
+  DMA_InitTypeDef dma;
+  USART_InitTypeDef usart;
+  uint32_t i = 0;
+
+  /* Programming clears bits, the erase sets them back */
+  FLASH_Unlock();
+  SIM_CHECK(FLASH_ProgramWord(SIM_WORD_ADDRESS, 0x12345678) == FLASH_COMPLETE);
+  SIM_CHECK(FLASH_ProgramWord(SIM_WORD_ADDRESS, 0xFFFF00FF) == FLASH_COMPLETE);
+  SIM_CHECK(*word == 0x12340078);
+  SIM_CHECK(FLASH_EraseSector(FLASH_Sector_8, VoltageRange_3) == FLASH_COMPLETE);
+  SIM_CHECK(*word == 0xFFFFFFFF);
+
+  /* A protected sector, a locked flash: the word stays */
+  *optcr &= ~SIM_NWRP(8);
+  SIM_CHECK(FLASH_ProgramWord(SIM_WORD_ADDRESS, 0) == FLASH_ERROR_WRP);
+  SIM_CHECK(FLASH_EraseSector(FLASH_Sector_8, VoltageRange_3) == FLASH_ERROR_WRP);
+  *optcr |= SIM_NWRP(8);
+  FLASH_ClearFlag(FLASH_FLAG_WRPERR);
+  FLASH_Lock();
+  SIM_CHECK(FLASH_ProgramWord(SIM_WORD_ADDRESS, 0) == FLASH_ERROR_PROGRAM);
+  SIM_CHECK(FLASH_GetFlagStatus(FLASH_FLAG_PGSERR) == SET);
+  SIM_CHECK(*word == 0xFFFFFFFF);
+
+  /* CRC-32/MPEG-2 of a word */
+  RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_CRC, ENABLE);
+  CRC_ResetDR();
+  SIM_CHECK(CRC_CalcCRC(0x12345678) == 0xDF8A8A2B);
+
+  /* Memory to memory: done as soon as the stream is enabled */
+  for (i = 0; i < SIM_DMA_WORDS; i++)
+  {
+    Source[i] = i * 0x9E3779B9;
+  }
+  RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_DMA2, ENABLE);
+  DMA_StructInit(&dma);
+  dma.DMA_Channel = DMA_Channel_0;
+  dma.DMA_PeripheralBaseAddr = (uint32_t)Source;
+  dma.DMA_Memory0BaseAddr = (uint32_t)Destination;
+  dma.DMA_DIR = DMA_DIR_MemoryToMemory;
+  dma.DMA_BufferSize = SIM_DMA_WORDS;
+  dma.DMA_PeripheralInc = DMA_PeripheralInc_Enable;
+  dma.DMA_MemoryInc = DMA_MemoryInc_Enable;
+  dma.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Word;
+  dma.DMA_MemoryDataSize = DMA_MemoryDataSize_Word;
+  DMA_Init(DMA2_Stream0, &dma);
+  DMA_Cmd(DMA2_Stream0, ENABLE);
+  SIM_CHECK(DMA_GetFlagStatus(DMA2_Stream0, DMA_FLAG_TCIF0) == SET);
+  SIM_CHECK(memcmp(Destination, Source, sizeof(Source)) == 0);
+
+  /* USART1 sends what is written to DR */
+  SIM_UartOutput(USART1, SIM_Sent);
+  RCC_APB2PeriphClockCmd(RCC_APB2Periph_USART1, ENABLE);
+  USART_StructInit(&usart);
+  USART_Init(USART1, &usart);
+  USART_Cmd(USART1, ENABLE);
+  USART_SendData(USART1, 'O');
+  USART_SendData(USART1, 'K');
+  SIM_CHECK((SentCount == 2) && (Sent[0] == 'O') && (Sent[1] == 'K'));
+  SIM_CHECK(USART_GetFlagStatus(USART1, USART_FLAG_TC) == SET);
+
+  /* FIPS 180-2 and RFC 1321 */
+  RCC_AHB2PeriphClockCmd(RCC_AHB2Periph_HASH | RCC_AHB2Periph_CRYP, ENABLE);
+  SIM_CHECK(HASH_SHA1((uint8_t*)"abc", 3, Digest) == SUCCESS);
+  SIM_CHECK(SIM_Hex(Digest, "a9993e364706816aba3e25717850c26c9cd0d89d", 20) != 0);
+  SIM_CHECK(HASH_MD5((uint8_t*)"abc", 3, Digest) == SUCCESS);
+  SIM_CHECK(SIM_Hex(Digest, "900150983cd24fb0d6963f7d28e17f72", 16) != 0);
+
+  /* FIPS-197 C.1, both ways */
+  SIM_CHECK(CRYP_AES_ECB(MODE_ENCRYPT, (uint8_t*)AesKey, 128, (uint8_t*)AesPlain, 16, Cipher) ==
+            SUCCESS);
+  SIM_CHECK(memcmp(Cipher, AesCipher, 16) == 0);
+  SIM_CHECK(CRYP_AES_ECB(MODE_DECRYPT, (uint8_t*)AesKey, 128, Cipher, 16, Cipher) == SUCCESS);
+  SIM_CHECK(memcmp(Cipher, AesPlain, 16) == 0);
+}
+
+/**
+  * @brief  Bytes sent by USART1, from the trap handler
+  * @param  Data: bytes
+  * @param  Length: number of bytes
+  * @retval None
+  */
+static void SIM_Sent(const uint8_t* Data, uint32_t Length)
+{
+  uint32_t i = 0;
+
+  for (i = 0; (i < Length) && (SentCount < SIM_SENT_MAX); i++)
+  {
+    Sent[SentCount++] = Data[i];
+  }
+}
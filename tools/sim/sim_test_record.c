@@ -0,0 +1,91 @@
+/**
+  ******************************************************************************
+  * @file    sim_test_record.c
+  * @brief   Host tests of boot_record.c: the boot selection records, their
+  *          sequence across the two record sectors, the image checks.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "sim_test.h"
+#include "flash_if.h"
+#include "boot_record.h"
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+/* Entries of a record sector */
+#define SIM_RECORDS           (BOOT_RECORD_SIZE / sizeof(BOOT_Record))
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  BOOT_WriteRecord() and BOOT_ReadRecord(): sequence, a record cut
+  *         by a reset, the switch from one record sector to the other;
+  *         BOOT_IsValidImage() and BOOT_ImageCrc()
+  * @param  None
+  * @retval None
+  */
+void SIM_TestRecord(void)
+{
+  const BOOT_Record* sector0 = (const BOOT_Record*)BOOT_RECORD_ADDRESS_0;
+  const BOOT_Record* sector1 = (const BOOT_Record*)BOOT_RECORD_ADDRESS_1;
+  static uint32_t words[3];
+  BOOT_Record record, read;
+  __IO uint32_t address = 0;
+  uint32_t i = 0, crc = 0;
+
+  FLASH_If_Init();
+  SIM_CHECK(BOOT_ReadRecord(&read) == 1);
+
+  memset(&record, 0, sizeof(record));
+  record.Active = BOOT_SLOT_B;
+  record.State = BOOT_STATE_TRIAL;
+  record.Attempts = 1;
+  record.Size = 1234;
+  record.Crc = 0x55AA55AA;
+  SIM_CHECK(BOOT_WriteRecord(&record) == 0);
+  SIM_CHECK(record.Sequence == 1);
+  SIM_CHECK((BOOT_ReadRecord(&read) == 0) && (memcmp(&read, &record, sizeof(read)) == 0));
+
+  /* Only the Magic of the next entry reached the flash: ignored, and the
+     next record goes after it */
+  SIM_CHECK(FLASH_ProgramWord((uint32_t)&sector0[1], BOOT_RECORD_MAGIC) == FLASH_COMPLETE);
+  SIM_CHECK((BOOT_ReadRecord(&read) == 0) && (read.Sequence == 1));
+  record.State = BOOT_STATE_CONFIRMED;
+  SIM_CHECK(BOOT_WriteRecord(&record) == 0);
+  SIM_CHECK((sector0[2].Sequence == 2) && (sector0[2].State == BOOT_STATE_CONFIRMED));
+  SIM_CHECK((BOOT_ReadRecord(&read) == 0) && (read.Sequence == 2));
+
+  /* Sector 0 full: sector 1, holding anything, is erased and used */
+  SIM_CHECK(FLASH_ProgramWord((uint32_t)&sector1[0], 0x12345678) == FLASH_COMPLETE);
+  for (i = 3; i < SIM_RECORDS; i++)
+  {
+    record.Attempts = i;
+    SIM_CHECK(BOOT_WriteRecord(&record) == 0);
+  }
+  SIM_CHECK(sector0[SIM_RECORDS - 1].Sequence == SIM_RECORDS - 1);
+  SIM_CHECK(BOOT_WriteRecord(&record) == 0);
+  SIM_CHECK((sector1[0].Magic == BOOT_RECORD_MAGIC) && (sector1[0].Sequence == SIM_RECORDS));
+  SIM_CHECK((BOOT_ReadRecord(&read) == 0) && (read.Sequence == SIM_RECORDS));
+
+  /* And back to sector 0 */
+  for (i = 1; i < SIM_RECORDS; i++)
+  {
+    SIM_CHECK(BOOT_WriteRecord(&record) == 0);
+  }
+  SIM_CHECK(BOOT_WriteRecord(&record) == 0);
+  SIM_CHECK((sector0[0].Sequence == 2 * SIM_RECORDS) && (sector0[1].Magic == 0xFFFFFFFF));
+  SIM_CHECK((BOOT_ReadRecord(&read) == 0) && (read.Sequence == 2 * SIM_RECORDS));
+
+  /* A vector table linked for slot A */
+  words[0] = SRAM_BASE + 0x8000;
+  words[1] = SLOT_A_ADDRESS + 0x201;
+  words[2] = 0xA5A5A5A5;
+  address = SLOT_A_ADDRESS;
+  SIM_CHECK(FLASH_If_WriteBlock(&address, words, 3) == 0);
+  SIM_CHECK(BOOT_IsValidImage(BOOT_SLOT_A) == 1);
+  SIM_CHECK(BOOT_IsValidImage(BOOT_SLOT_B) == 0);
+  crc = BOOT_ImageCrc(BOOT_SLOT_A, 11);
+  CRC_ResetDR();
+  SIM_CHECK(crc == CRC_CalcBlockCRC(words, 3));
+}
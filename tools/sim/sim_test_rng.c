@@ -0,0 +1,56 @@
+/**
+  ******************************************************************************
+  * @file    sim_test_rng.c
+  * @brief   Host tests of rng_pool.c: the pool refilled from the RNG
+  *          interrupt only while the PLL runs, taken by whole words.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "sim_test.h"
+#include "rng_pool.h"
+#include <string.h>
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  RNGP_GetBytes() with the PLL off and on
+  * @param  None
+  * @retval None
+  */
+void SIM_TestRng(void)
+{
+  RNGP_Stats stats;
+  uint32_t words[RNGP_POOL_WORDS + 1];
+
+  /* HSI: the RNG does not run */
+  RNGP_Init();
+  SIM_Poll();
+  SIM_CHECK(RNGP_Available() == 0);
+  SIM_CHECK(RNGP_GetBytes(words, 1) == RNGP_EMPTY);
+
+  /* PLL: the pool gets full */
+  SIM_CHECK(SystemClockSwitch(SYSCLK_PROFILE_FULL) == 0);
+  SIM_Poll();
+  SIM_CHECK(RNGP_Available() == 4 * RNGP_POOL_WORDS);
+  SIM_CHECK(RNGP_GetBytes(words, 4 * RNGP_POOL_WORDS + 1) == RNGP_EMPTY);
+  memset(words, 0, sizeof(words));
+  /* Taken by whole words; the refill runs as soon as the interrupts are
+     unmasked again */
+  SIM_CHECK(RNGP_GetBytes(words, 6) == RNGP_OK);
+  SIM_CHECK((words[1] >> 16) == 0);
+  SIM_CHECK(RNGP_GetBytes(&words[2], 4 * (RNGP_POOL_WORDS - 2)) == RNGP_OK);
+  SIM_CHECK((words[0] != words[2]) && (words[2] != words[3]));
+  SIM_Poll();
+  SIM_CHECK(RNGP_Available() == 4 * RNGP_POOL_WORDS);
+  RNGP_GetStats(&stats);
+  SIM_CHECK((stats.Taken == RNGP_POOL_WORDS) && (stats.Empty == 2) && (stats.Refills >= 2) &&
+            (stats.Words == stats.Taken + RNGP_POOL_WORDS) && (stats.SeedErrors == 0) &&
+            (stats.ClockErrors == 0));
+
+  /* Back to the HSI: what is left can be taken, no refill */
+  SIM_CHECK(SystemClockSwitch(SYSCLK_PROFILE_HSI) == 0);
+  SIM_CHECK(RNGP_GetBytes(words, 16) == RNGP_OK);
+  SIM_Poll();
+  SIM_CHECK(RNGP_Available() == 4 * RNGP_POOL_WORDS - 16);
+}
@@ -0,0 +1,399 @@
+/**
+  ******************************************************************************
+  * @file    sim_test_stream.c
+  * @brief   Host tests of lz_flash.c and delta_flash.c: streams built here
+  *          together with the image they decode to, fed in pieces of every
+  *          size, and corrupted streams.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "sim_test.h"
+#include "flash_if.h"
+#include "lz_flash.h"
+#include "delta_flash.h"
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define SIM_IMAGE_MAX         16384
+#define SIM_STREAM_MAX        16384
+#define SIM_OLD_SIZE          6000
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t Image[SIM_IMAGE_MAX];
+static uint8_t Stream[SIM_STREAM_MAX];
+static uint8_t Old[SIM_OLD_SIZE];
+static uint8_t Bytes[1024];
+static uint32_t ImageLength;
+static uint32_t StreamLength;
+static uint32_t OldPos;
+static uint32_t Output;
+static LZ_Decoder Decoder;
+static DELTA_Patch Patcher;
+
+/* Private function prototypes -----------------------------------------------*/
+static void SIM_Start(void);
+static void SIM_Put(uint8_t Data);
+static void SIM_Length(uint32_t Length);
+static void SIM_LzSequence(uint32_t Literals, uint32_t Offset, uint32_t Match);
+static uint32_t SIM_LzRun(uint32_t Base, uint32_t Size, uint32_t Piece);
+static void SIM_Varint(uint32_t Value);
+static void SIM_DeltaOp(uint32_t Op, uint32_t Length, int32_t Seek);
+static uint32_t SIM_DeltaRun(uint32_t Base, uint32_t Size, uint32_t Piece);
+static void SIM_Written(const uint8_t* Data, uint32_t Length);
+static uint32_t SIM_Image(uint32_t Base);
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  LZ_Decode() and LZ_Finish(): extended lengths, overlapping
+  *         matches, matches older than the window read back from the flash
+  * @param  None
+  * @retval None
+  */
+void SIM_TestLz(void)
+{
+  uint32_t i = 0;
+
+  FLASH_If_Init();
+  for (i = 0; i < sizeof(Bytes); i++)
+  {
+    Bytes[i] = (uint8_t)((i * 0x9E3779B9) >> 13);
+  }
+
+  SIM_Start();
+  SIM_LzSequence(20, 1, 300);
+  SIM_LzSequence(300, 20, 700);
+  SIM_LzSequence(5, 1200, 2000);
+  SIM_LzSequence(0, 4, LZ_MIN_MATCH);
+  SIM_LzSequence(7, 0, 0);
+
+  /* In one piece, in pieces of 7 bytes, byte by byte */
+  SIM_CHECK(SIM_LzRun(SLOT_A_ADDRESS, ImageLength, StreamLength) == 0);
+  SIM_CHECK(SIM_Image(SLOT_A_ADDRESS) != 0);
+  SIM_CHECK(Output == ImageLength);
+  SIM_CHECK(SIM_LzRun(ADDR_FLASH_SECTOR_6, ImageLength, 7) == 0);
+  SIM_CHECK(SIM_Image(ADDR_FLASH_SECTOR_6) != 0);
+  SIM_CHECK(SIM_LzRun(ADDR_FLASH_SECTOR_7, ImageLength, 1) == 0);
+  SIM_CHECK(SIM_Image(ADDR_FLASH_SECTOR_7) != 0);
+
+  /* Longer or shorter than the image announced */
+  SIM_CHECK(SIM_LzRun(SLOT_B_ADDRESS, ImageLength - 1, StreamLength) != 0);
+  SIM_CHECK(SIM_LzRun(SLOT_B_ADDRESS, ImageLength + 1, StreamLength) != 0);
+
+  /* Cut in the offset of a match */
+  SIM_Start();
+  SIM_LzSequence(4, 4, 8);
+  StreamLength -= 1;
+  SIM_CHECK(SIM_LzRun(SLOT_B_ADDRESS, 12, StreamLength) != 0);
+
+  /* Offset 0, offset before the first byte */
+  SIM_Start();
+  SIM_LzSequence(4, 0, 8);
+  SIM_CHECK(SIM_LzRun(SLOT_B_ADDRESS, ImageLength, StreamLength) != 0);
+  SIM_Start();
+  SIM_LzSequence(4, 5, 8);
+  SIM_CHECK(SIM_LzRun(SLOT_B_ADDRESS, ImageLength, StreamLength) != 0);
+}
+
+/**
+  * @brief  DELTA_Apply() and DELTA_Finish(): the three operations, seeks
+  *         both ways, a COPY longer than DELTA_COPY_MAX left pending with
+  *         the stream after it held, corrupted streams
+  * @param  None
+  * @retval None
+  */
+void SIM_TestDelta(void)
+{
+  uint32_t i = 0;
+
+  FLASH_If_Init();
+  for (i = 0; i < SIM_OLD_SIZE; i++)
+  {
+    Old[i] = (uint8_t)((i * 0x2545F491) >> 11);
+  }
+  for (i = 0; i < sizeof(Bytes); i++)
+  {
+    Bytes[i] = (uint8_t)(i * 7);
+  }
+  memcpy(SIM_Register(SLOT_A_ADDRESS), Old, SIM_OLD_SIZE);
+
+  SIM_Start();
+  SIM_DeltaOp(DELTA_OP_COPY, 2500, 0);
+  SIM_DeltaOp(DELTA_OP_ADD, 300, 100);
+  SIM_DeltaOp(DELTA_OP_DATA, 200, 0);
+  SIM_DeltaOp(DELTA_OP_COPY, 1500, -2000);
+  SIM_DeltaOp(DELTA_OP_DATA, 0, 0);
+  SIM_DeltaOp(DELTA_OP_ADD, 50, 0);
+  SIM_DeltaOp(DELTA_OP_COPY, DELTA_COPY_MAX, -(int32_t)(OldPos));
+
+  /* In one piece: all but the first COPY is held */
+  SIM_CHECK(SIM_DeltaRun(SLOT_B_ADDRESS, ImageLength, StreamLength) == 0);
+  SIM_CHECK(SIM_Image(SLOT_B_ADDRESS) != 0);
+  SIM_CHECK(Output == ImageLength);
+  SIM_CHECK(SIM_DeltaRun(ADDR_FLASH_SECTOR_6, ImageLength, 3) == 0);
+  SIM_CHECK(SIM_Image(ADDR_FLASH_SECTOR_6) != 0);
+  SIM_CHECK(SIM_DeltaRun(ADDR_FLASH_SECTOR_7, ImageLength, 1) == 0);
+  SIM_CHECK(SIM_Image(ADDR_FLASH_SECTOR_7) != 0);
+
+  /* Longer or shorter than the image announced, or cut in an operation */
+  SIM_CHECK(SIM_DeltaRun(SLOT_B_ADDRESS, ImageLength - 1, StreamLength) != 0);
+  SIM_CHECK(SIM_DeltaRun(SLOT_B_ADDRESS, ImageLength + 1, StreamLength) != 0);
+  StreamLength -= 1;
+  SIM_CHECK(SIM_DeltaRun(SLOT_B_ADDRESS, ImageLength, StreamLength) != 0);
+
+  /* Outside the old image */
+  SIM_Start();
+  SIM_DeltaOp(DELTA_OP_COPY, 10, SIM_OLD_SIZE - 5);
+  SIM_CHECK(SIM_DeltaRun(SLOT_B_ADDRESS, 10, StreamLength) != 0);
+  SIM_Start();
+  SIM_DeltaOp(DELTA_OP_ADD, 10, -1);
+  SIM_CHECK(SIM_DeltaRun(SLOT_B_ADDRESS, 10, StreamLength) != 0);
+
+  /* Unknown operation */
+  SIM_Start();
+  SIM_Put(DELTA_OP_DATA + 1);
+  SIM_CHECK(SIM_DeltaRun(SLOT_B_ADDRESS, 1, StreamLength) != 0);
+
+  /* More than DELTA_HOLD_SIZE bytes behind a pending COPY */
+  SIM_Start();
+  SIM_DeltaOp(DELTA_OP_COPY, 2 * DELTA_COPY_MAX, 0);
+  while (StreamLength < DELTA_HOLD_SIZE + 16)
+  {
+    SIM_DeltaOp(DELTA_OP_DATA, sizeof(Bytes), 0);
+  }
+  DELTA_Init(&Patcher, SLOT_B_ADDRESS, ImageLength, SLOT_A_ADDRESS, SIM_OLD_SIZE, 0);
+  SIM_CHECK(DELTA_Apply(&Patcher, Stream, StreamLength) != 0);
+  SIM_CHECK(DELTA_Pending(&Patcher) == 0);
+}
+
+/**
+  * @brief  Empties the stream and the image
+  * @param  None
+  * @retval None
+  */
+static void SIM_Start(void)
+{
+  StreamLength = 0;
+  ImageLength = 0;
+  OldPos = 0;
+}
+
+/**
+  * @brief  Appends a byte to the stream
+  * @param  Data: byte
+  * @retval None
+  */
+static void SIM_Put(uint8_t Data)
+{
+  if (StreamLength < SIM_STREAM_MAX)
+  {
+    Stream[StreamLength++] = Data;
+  }
+}
+
+/**
+  * @brief  Appends the bytes of an LZ4 length past the 15 of its token
+  * @param  Length: length less 15
+  * @retval None
+  */
+static void SIM_Length(uint32_t Length)
+{
+  while (Length >= 255)
+  {
+    SIM_Put(255);
+    Length -= 255;
+  }
+  SIM_Put((uint8_t)Length);
+}
+
+/**
+  * @brief  Appends an LZ4 sequence and what it decodes to
+  * @param  Literals: number of literals, taken from Bytes
+  * @param  Offset: match offset
+  * @param  Match: match length, 0 for the last sequence
+  * @retval None
+  */
+static void SIM_LzSequence(uint32_t Literals, uint32_t Offset, uint32_t Match)
+{
+  uint32_t lit = (Literals < 15) ? Literals : 15;
+  uint32_t match = (Match == 0) ? 0 : (Match - LZ_MIN_MATCH);
+  uint32_t i = 0;
+
+  SIM_Put((uint8_t)((lit << 4) | ((match < 15) ? match : 15)));
+  if (lit == 15)
+  {
+    SIM_Length(Literals - 15);
+  }
+  for (i = 0; i < Literals; i++)
+  {
+    SIM_Put(Bytes[i]);
+    Image[ImageLength++] = Bytes[i];
+  }
+  if (Match == 0)
+  {
+    return;
+  }
+
+  SIM_Put((uint8_t)Offset);
+  SIM_Put((uint8_t)(Offset >> 8));
+  if (match >= 15)
+  {
+    SIM_Length(match - 15);
+  }
+  for (i = 0; (i < Match) && (Offset != 0) && (Offset <= ImageLength); i++)
+  {
+    Image[ImageLength] = Image[ImageLength - Offset];
+    ImageLength++;
+  }
+}
+
+/**
+  * @brief  Decodes the stream to a blank area, as the download does
+  * @param  Base: flash address of the image, SIM_IMAGE_MAX bytes erased
+  *         first
+  * @param  Size: image length announced
+  * @param  Piece: bytes of stream per LZ_Decode() call
+  * @retval 0 on success, 1 if the decoder failed
+  */
+static uint32_t SIM_LzRun(uint32_t Base, uint32_t Size, uint32_t Piece)
+{
+  uint32_t offset = 0, length = 0;
+
+  memset(SIM_Register(Base), 0xFF, SIM_IMAGE_MAX);
+  Output = 0;
+  LZ_Init(&Decoder, Base, Size, SIM_Written);
+  for (offset = 0; offset < StreamLength; offset += length)
+  {
+    length = (StreamLength - offset < Piece) ? (StreamLength - offset) : Piece;
+    if (LZ_Decode(&Decoder, Stream + offset, length) != 0)
+    {
+      return 1;
+    }
+  }
+  return LZ_Finish(&Decoder);
+}
+
+/**
+  * @brief  Appends a varint to the stream
+  * @param  Value: value
+  * @retval None
+  */
+static void SIM_Varint(uint32_t Value)
+{
+  while (Value >= 0x80)
+  {
+    SIM_Put((uint8_t)((Value & 0x7F) | 0x80));
+    Value >>= 7;
+  }
+  SIM_Put((uint8_t)Value);
+}
+
+/**
+  * @brief  Appends a delta operation and what it rebuilds from Old
+  * @param  Op: DELTA_OP_COPY, DELTA_OP_ADD or DELTA_OP_DATA
+  * @param  Length: new bytes, ADD and DATA bytes are taken from Bytes in turn
+  * @param  Seek: move of the old position, COPY and ADD only
+  * @retval None
+  */
+static void SIM_DeltaOp(uint32_t Op, uint32_t Length, int32_t Seek)
+{
+  uint32_t i = 0;
+  uint8_t data = 0;
+
+  SIM_Put((uint8_t)Op);
+  SIM_Varint(Length);
+  if (Op != DELTA_OP_DATA)
+  {
+    SIM_Varint((Seek >= 0) ? ((uint32_t)Seek << 1) : (((uint32_t)-Seek << 1) - 1));
+    OldPos += (uint32_t)Seek;
+  }
+  for (i = 0; i < Length; i++)
+  {
+    data = Bytes[i % sizeof(Bytes)];
+    if (Op != DELTA_OP_COPY)
+    {
+      SIM_Put(data);
+    }
+    if (Op == DELTA_OP_DATA)
+    {
+      Image[ImageLength++ % SIM_IMAGE_MAX] = data;
+    }
+    else
+    {
+      Image[ImageLength++ % SIM_IMAGE_MAX] = (uint8_t)(Old[OldPos % SIM_OLD_SIZE] +
+                                                     ((Op == DELTA_OP_ADD) ? data : 0));
+      OldPos++;
+    }
+  }
+}
+
+/**
+  * @brief  Applies the stream to a blank area, going on with a pending
+  *         COPY between the pieces as the RX DMA interrupt does
+  * @param  Base: flash address of the new image, SIM_IMAGE_MAX bytes
+  *         erased first
+  * @param  Size: image length announced
+  * @param  Piece: bytes of stream per DELTA_Apply() call
+  * @retval 0 on success, 1 if the patcher failed
+  */
+static uint32_t SIM_DeltaRun(uint32_t Base, uint32_t Size, uint32_t Piece)
+{
+  uint32_t offset = 0, length = 0;
+
+  memset(SIM_Register(Base), 0xFF, SIM_IMAGE_MAX);
+  Output = 0;
+  DELTA_Init(&Patcher, Base, Size, SLOT_A_ADDRESS, SIM_OLD_SIZE, SIM_Written);
+  for (offset = 0; offset < StreamLength; offset += length)
+  {
+    length = (StreamLength - offset < Piece) ? (StreamLength - offset) : Piece;
+    if (DELTA_Apply(&Patcher, Stream + offset, length) != 0)
+    {
+      return 1;
+    }
+    while (DELTA_Pending(&Patcher) != 0)
+    {
+      if (DELTA_Apply(&Patcher, 0, 0) != 0)
+      {
+        return 1;
+      }
+    }
+  }
+  return DELTA_Finish(&Patcher);
+}
+
+/**
+  * @brief  Decoded bytes before they are programmed, counted
+  * @param  Data: bytes
+  * @param  Length: number of bytes
+  * @retval None
+  */
+static void SIM_Written(const uint8_t* Data, uint32_t Length)
+{
+  (void)Data;
+  Output += Length;
+}
+
+/**
+  * @brief  Whether the flash holds the image followed by erased bytes
+  * @param  Base: flash address of the image
+  * @retval 1 if it does, 0 otherwise
+  */
+static uint32_t SIM_Image(uint32_t Base)
+{
+  const uint8_t* flash = (const uint8_t*)Base;
+  uint32_t i = 0;
+
+  if (memcmp(flash, Image, ImageLength) != 0)
+  {
+    return 0;
+  }
+  for (i = ImageLength; i < ImageLength + 8; i++)
+  {
+    if (flash[i] != 0xFF)
+    {
+      return 0;
+    }
+  }
+  return 1;
+}
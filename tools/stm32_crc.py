@@ -0,0 +1,26 @@
+# CRC computed by the STM32 CRC unit (CRC-32 polynomial 0x04C11DB7, initial
+# value 0xFFFFFFFF, no reflection, fed one little endian 32-bit word at a
+# time), as returned by CRC_ResetDR() followed by CRC_CalcBlockCRC().
+
+import struct
+
+
+def _table():
+  table = []
+  for i in range(256):
+    crc = i << 24
+    for _ in range(8):
+      crc = ((crc << 1) ^ 0x04C11DB7) if crc & 0x80000000 else (crc << 1)
+    table.append(crc & 0xFFFFFFFF)
+  return table
+
+_TABLE = _table()
+
+
+def stm32_crc(data, crc=0xFFFFFFFF):
+  """CRC over data, padded with 0xFF to a multiple of 4 bytes."""
+  data = bytes(data) + b'\xff' * (-len(data) % 4)
+  for (word,) in struct.iter_unpack('<I', data):
+    for shift in (24, 16, 8, 0):
+      crc = ((crc << 8) & 0xFFFFFFFF) ^ _TABLE[(crc >> 24) ^ ((word >> shift) & 0xFF)]
+  return crc